@@ -35,10 +35,40 @@ namespace UltimaLive
 		public static UInt32[][] MapCRCs32;
 		public static UInt32[] Crc32Table;
 
+		//CRC-32C, XXH64 and split CRC32s are only used by hash mode queries,
+		//their caches are allocated for a map the first time a client asks
+		public static UInt32[][] MapCRCs32C;
+		public static UInt64[][] MapXxh64s;
+		public static UInt64[][] MapSplitCRCs32;
+		public static UInt32[] Crc32CTable;
+
+		private const UInt64 XXH64_PRIME_1 = 0x9E3779B185EBCA87UL;
+		private const UInt64 XXH64_PRIME_2 = 0xC2B2AE3D27D4EB4FUL;
+		private const UInt64 XXH64_PRIME_3 = 0x165667B19E3779F9UL;
+		private const UInt64 XXH64_PRIME_4 = 0x85EBCA77C2B2AE63UL;
+		private const UInt64 XXH64_PRIME_5 = 0x27D4EB2F165667C5UL;
+
 		public static void InvalidateBlockCRC(int map, int block)
 		{
 			MapCRCs[map][block] = UInt16.MaxValue;
 			MapCRCs32[map][block] = UInt32.MaxValue;
+
+			if (MapCRCs32C[map] != null)
+			{
+				MapCRCs32C[map][block] = UInt32.MaxValue;
+			}
+
+			if (MapXxh64s[map] != null)
+			{
+				MapXxh64s[map][block] = UInt64.MaxValue;
+			}
+
+			if (MapSplitCRCs32[map] != null)
+			{
+				MapSplitCRCs32[map][block] = UInt64.MaxValue;
+			}
+
+			RegionHash.InvalidateBlock(map, block);
 		}
 
 		public static void Configure()
@@ -50,6 +80,21 @@ namespace UltimaLive
 		{
 			MapCRCs = new UInt16[256][];
 			MapCRCs32 = new UInt32[256][];
+			MapCRCs32C = new UInt32[256][];
+			MapXxh64s = new UInt64[256][];
+			MapSplitCRCs32 = new UInt64[256][];
+
+			//reflected Castagnoli polynomial
+			Crc32CTable = new UInt32[256];
+			for (UInt32 i = 0; i < 256; i++)
+			{
+				UInt32 entry = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					entry = (entry >> 1) ^ (0x82F63B78 & (0 - (entry & 1)));
+				}
+				Crc32CTable[i] = entry;
+			}
 
 			//We need CRCs for every block in every map.  
 			foreach (KeyValuePair<int, MapRegistry.MapDefinition> kvp in MapRegistry.Definitions)
@@ -163,5 +208,97 @@ namespace UltimaLive
 
 			return (currentCrc ^ 0xFFFFFFFF);
 		}
+
+		public static UInt32 CalculateCrc32C(byte[] data)
+		{
+			UInt32 currentCrc = 0xFFFFFFFF;
+			for (int index = 0; index < data.Length; ++index)
+			{
+				currentCrc = (currentCrc >> 8) ^ Crc32CTable[(currentCrc & 0xFF) ^ data[index]];
+			}
+
+			return (currentCrc ^ 0xFFFFFFFF);
+		}
+
+		/* XXH64 with a seed of 0, see https://github.com/Cyan4973/xxHash
+		/**/
+		public static UInt64 CalculateXxh64(byte[] data)
+		{
+			int index = 0;
+			UInt64 hash;
+
+			if (data.Length >= 32)
+			{
+				UInt64 v1 = unchecked(XXH64_PRIME_1 + XXH64_PRIME_2);
+				UInt64 v2 = XXH64_PRIME_2;
+				UInt64 v3 = 0;
+				UInt64 v4 = unchecked(0 - XXH64_PRIME_1);
+
+				for (; index + 32 <= data.Length; index += 32)
+				{
+					v1 = Xxh64Round(v1, BitConverter.ToUInt64(data, index));
+					v2 = Xxh64Round(v2, BitConverter.ToUInt64(data, index + 8));
+					v3 = Xxh64Round(v3, BitConverter.ToUInt64(data, index + 16));
+					v4 = Xxh64Round(v4, BitConverter.ToUInt64(data, index + 24));
+				}
+
+				hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+				hash = Xxh64MergeRound(hash, v1);
+				hash = Xxh64MergeRound(hash, v2);
+				hash = Xxh64MergeRound(hash, v3);
+				hash = Xxh64MergeRound(hash, v4);
+			}
+			else
+			{
+				hash = XXH64_PRIME_5;
+			}
+
+			hash += (UInt64)data.Length;
+
+			for (; index + 8 <= data.Length; index += 8)
+			{
+				hash ^= Xxh64Round(0, BitConverter.ToUInt64(data, index));
+				hash = RotateLeft(hash, 27) * XXH64_PRIME_1 + XXH64_PRIME_4;
+			}
+
+			if (index + 4 <= data.Length)
+			{
+				hash ^= (UInt64)BitConverter.ToUInt32(data, index) * XXH64_PRIME_1;
+				hash = RotateLeft(hash, 23) * XXH64_PRIME_2 + XXH64_PRIME_3;
+				index += 4;
+			}
+
+			for (; index < data.Length; index++)
+			{
+				hash ^= data[index] * XXH64_PRIME_5;
+				hash = RotateLeft(hash, 11) * XXH64_PRIME_1;
+			}
+
+			hash ^= hash >> 33;
+			hash *= XXH64_PRIME_2;
+			hash ^= hash >> 29;
+			hash *= XXH64_PRIME_3;
+			hash ^= hash >> 32;
+
+			return hash;
+		}
+
+		private static UInt64 Xxh64Round(UInt64 accumulator, UInt64 input)
+		{
+			accumulator += input * XXH64_PRIME_2;
+			accumulator = RotateLeft(accumulator, 31);
+			return accumulator * XXH64_PRIME_1;
+		}
+
+		private static UInt64 Xxh64MergeRound(UInt64 hash, UInt64 accumulator)
+		{
+			hash ^= Xxh64Round(0, accumulator);
+			return hash * XXH64_PRIME_1 + XXH64_PRIME_4;
+		}
+
+		private static UInt64 RotateLeft(UInt64 value, int bits)
+		{
+			return (value << bits) | (value >> (64 - bits));
+		}
 	}
 }
@@ -0,0 +1,239 @@
+/* Copyright(c) 2016 UltimaLive
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+
+
+using System;
+using System.Collections.Generic;
+using Server;
+using Server.Mobiles;
+
+namespace UltimaLive
+{
+    /*
+     * Hash modes a client can answer a hash mode query (UltimaLive command
+     * 0xF9) in. Clients report the modes they support, and the ones that
+     * are hardware accelerated on their machine, in their answer to a hash
+     * capabilities query (0xFA) right after login, along with the queries
+     * that take a hash mode.
+    /**/
+    public class HashModes
+    {
+        public const byte FLETCHER16 = 0x00;
+        public const byte CRC32 = 0x01;
+        public const byte CRC32C = 0x02;
+        public const byte XXH64 = 0x03;
+        public const byte SPLIT_CRC32 = 0x04;
+        public const byte NONE = 0xFF;
+
+        public const UInt16 EXPECTED_HASH_QUERY = 0x0001;
+
+        private static Dictionary<Mobile, byte> m_QueryModes = new Dictionary<Mobile, byte>();
+        private static HashSet<Mobile> m_ExpectedHashClients = new HashSet<Mobile>();
+
+        /*
+         * Picks the hash mode we query a client in. CRC-32C is only fast with
+         * the SSE4.2 crc32 instruction, so clients without it are asked for
+         * XXH64 instead when they support it.
+        /**/
+        public static void SetCapabilities(Mobile m, UInt16 supportedModes, UInt16 acceleratedModes, UInt16 supportedQueries)
+        {
+            byte mode = UltimaLiveSettings.PREFERRED_HASH_MODE;
+
+            if ((supportedQueries & EXPECTED_HASH_QUERY) != 0)
+            {
+                m_ExpectedHashClients.Add(m);
+            }
+            else
+            {
+                m_ExpectedHashClients.Remove(m);
+            }
+
+            if (mode == CRC32C && (acceleratedModes & (1 << CRC32C)) == 0 && (supportedModes & (1 << XXH64)) != 0)
+            {
+                mode = XXH64;
+            }
+
+            if (mode == NONE || (supportedModes & (1 << mode)) == 0)
+            {
+                m_QueryModes.Remove(m);
+                return;
+            }
+
+            m_QueryModes[m] = mode;
+        }
+
+        public static byte GetQueryMode(Mobile m)
+        {
+            byte mode;
+            if (m_QueryModes.TryGetValue(m, out mode))
+            {
+                return mode;
+            }
+
+            return NONE;
+        }
+
+        public static bool SupportsExpectedHashQuery(Mobile m)
+        {
+            return m_ExpectedHashClients.Contains(m);
+        }
+
+        public static void Forget(Mobile m)
+        {
+            m_QueryModes.Remove(m);
+            m_ExpectedHashClients.Remove(m);
+        }
+
+        public static int GetHashSize(byte mode)
+        {
+            switch (mode)
+            {
+                case FLETCHER16:
+                    return 2;
+                case CRC32:
+                case CRC32C:
+                    return 4;
+                case XXH64:
+                case SPLIT_CRC32:
+                    return 8;
+                default:
+                    return 0;
+            }
+        }
+
+        public static UInt64 GetBlockHash(int mapID, byte mode, int blockX, int blockY)
+        {
+            int heightInBlocks = RegionHash.GetHeightInBlocks(mapID);
+            int widthInBlocks = RegionHash.GetWidthInBlocks(mapID);
+
+            if (blockX < 0 || blockY < 0 || blockX >= widthInBlocks || blockY >= heightInBlocks)
+            {
+                return 0;
+            }
+
+            int blocknum = (blockX * heightInBlocks) + blockY;
+            Point2D blockPosition = new Point2D(blockX, blockY);
+            byte[] landData = new byte[0];
+            byte[] staticsData = new byte[0];
+
+            switch (mode)
+            {
+                case FLETCHER16:
+                    {
+                        UInt16 crc = CRC.MapCRCs[mapID][blocknum];
+                        if (crc == UInt16.MaxValue)
+                        {
+                            crc = UltimaLivePacketHandlers.GetBlockCrc(blockPosition, mapID, ref landData, ref staticsData);
+                            CRC.MapCRCs[mapID][blocknum] = crc;
+                        }
+                        return crc;
+                    }
+
+                case CRC32:
+                    return RegionHash.GetBlockCrc32(mapID, blockX, blockY);
+
+                case CRC32C:
+                    {
+                        if (CRC.MapCRCs32C[mapID] == null)
+                        {
+                            CRC.MapCRCs32C[mapID] = CreateCache<UInt32>(widthInBlocks * heightInBlocks, UInt32.MaxValue);
+                        }
+
+                        UInt32 crc = CRC.MapCRCs32C[mapID][blocknum];
+                        if (crc == UInt32.MaxValue)
+                        {
+                            crc = CRC.CalculateCrc32C(GetBlockData(blockPosition, mapID));
+                            CRC.MapCRCs32C[mapID][blocknum] = crc;
+                        }
+                        return crc;
+                    }
+
+                case XXH64:
+                    {
+                        if (CRC.MapXxh64s[mapID] == null)
+                        {
+                            CRC.MapXxh64s[mapID] = CreateCache<UInt64>(widthInBlocks * heightInBlocks, UInt64.MaxValue);
+                        }
+
+                        UInt64 hash = CRC.MapXxh64s[mapID][blocknum];
+                        if (hash == UInt64.MaxValue)
+                        {
+                            hash = CRC.CalculateXxh64(GetBlockData(blockPosition, mapID));
+                            CRC.MapXxh64s[mapID][blocknum] = hash;
+                        }
+                        return hash;
+                    }
+
+                case SPLIT_CRC32:
+                    {
+                        if (CRC.MapSplitCRCs32[mapID] == null)
+                        {
+                            CRC.MapSplitCRCs32[mapID] = CreateCache<UInt64>(widthInBlocks * heightInBlocks, UInt64.MaxValue);
+                        }
+
+                        UInt64 hash = CRC.MapSplitCRCs32[mapID][blocknum];
+                        if (hash == UInt64.MaxValue)
+                        {
+                            hash = GetSplitCrc32(blockPosition, mapID);
+                            CRC.MapSplitCRCs32[mapID][blocknum] = hash;
+                        }
+                        return hash;
+                    }
+
+                default:
+                    return 0;
+            }
+        }
+
+        /*
+         * The split CRC32 of a block is the CRC32 of its land data in the
+         * high 32 bits and the CRC32 of its statics data in the low 32 bits,
+         * so a mismatch tells which half of the block to resend.
+        /**/
+        public static UInt64 GetSplitCrc32(Point2D blockCoords, int mapID)
+        {
+            UInt32 landCrc = CRC.CalculateCrc32(BlockUtility.GetLandData(blockCoords, mapID));
+            UInt32 staticsCrc = CRC.CalculateCrc32(BlockUtility.GetRawStaticsData(blockCoords, mapID));
+            return ((UInt64)landCrc << 32) | staticsCrc;
+        }
+
+        private static byte[] GetBlockData(Point2D blockCoords, int mapID)
+        {
+            byte[] landData = BlockUtility.GetLandData(blockCoords, mapID);
+            byte[] staticsData = BlockUtility.GetRawStaticsData(blockCoords, mapID);
+            byte[] blockData = new byte[landData.Length + staticsData.Length];
+            Array.Copy(landData, 0, blockData, 0, landData.Length);
+            Array.Copy(staticsData, 0, blockData, landData.Length, staticsData.Length);
+            return blockData;
+        }
+
+        private static T[] CreateCache<T>(int blocks, T invalid)
+        {
+            T[] cache = new T[blocks];
+            for (int i = 0; i < blocks; i++)
+            {
+                cache[i] = invalid;
+            }
+            return cache;
+        }
+    }
+}
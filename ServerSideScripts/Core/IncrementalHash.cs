@@ -0,0 +1,131 @@
+/* Copyright(c) 2016 UltimaLive
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+
+
+using System;
+using System.Collections.Generic;
+using Server;
+using Server.Mobiles;
+
+namespace UltimaLive
+{
+    /*
+     * The block CRC32s a client reported in the last incremental query32
+     * response (UltimaLive command 0xFB) we applied, keyed by block number.
+    /**/
+    public class IncrementalHashWindow
+    {
+        public UInt16 Sequence;
+        public int MapID;
+        public Dictionary<int, UInt32> BlockCRCs;
+
+        public IncrementalHashWindow()
+        {
+            Sequence = 0;
+            MapID = -1;
+            BlockCRCs = new Dictionary<int, UInt32>();
+        }
+    }
+
+    /*
+     * Server side of the incremental query32.
+     *
+     * The query carries the sequence number of the last response we applied.
+     * When the client's last response has that sequence number, both sides
+     * hold the same window and the client only lists the blocks that entered
+     * its view range or changed since then. Otherwise it lists every block and
+     * flags the response as a full window.
+    /**/
+    public class IncrementalHash
+    {
+        private static Dictionary<Mobile, IncrementalHashWindow> m_Windows = new Dictionary<Mobile, IncrementalHashWindow>();
+
+        public static UInt16 GetAcknowledgedSequence(Mobile m)
+        {
+            IncrementalHashWindow window;
+            if (m_Windows.TryGetValue(m, out window) && window.MapID == m.Map.MapID)
+            {
+                return window.Sequence;
+            }
+
+            return 0;
+        }
+
+        public static void Forget(Mobile m)
+        {
+            m_Windows.Remove(m);
+        }
+
+        /*
+         * Rebuilds the client's window from the listed blocks and the window
+         * we applied last, then resends every block that differs from ours.
+         * Blocks we cannot account for reset the sequence number so the next
+         * response lists the whole window.
+        /**/
+        public static void ApplyResponse(PlayerMobile from, int block, int mapID, UInt16 sequence, bool fullWindow, Dictionary<int, UInt32> receivedCRCs)
+        {
+            IncrementalHashWindow window;
+            if (!m_Windows.TryGetValue(from, out window))
+            {
+                window = new IncrementalHashWindow();
+                m_Windows[from] = window;
+            }
+
+            Dictionary<int, UInt32> previousCRCs = window.BlockCRCs;
+            if (fullWindow || window.MapID != mapID)
+            {
+                previousCRCs = new Dictionary<int, UInt32>();
+            }
+
+            List<Point2D> windowBlocks = RegionHash.GetWindowBlocks(block, mapID, from.UOLive_FOV_MinBlockX, from.UOLive_FOV_MaxBlockX,
+                from.UOLive_FOV_MinBlockY, from.UOLive_FOV_MaxBlockY);
+            int heightInBlocks = RegionHash.GetHeightInBlocks(mapID);
+            Dictionary<int, UInt32> currentCRCs = new Dictionary<int, UInt32>();
+            bool complete = windowBlocks.Count > 0;
+
+            for (int i = 0; i < windowBlocks.Count; i++)
+            {
+                Point2D blockPosition = windowBlocks[i];
+                int blocknum = (blockPosition.X * heightInBlocks) + blockPosition.Y;
+
+                UInt32 clientCRC;
+                if (!receivedCRCs.TryGetValue(i, out clientCRC) && !previousCRCs.TryGetValue(blocknum, out clientCRC))
+                {
+                    complete = false;
+                    continue;
+                }
+
+                currentCRCs[blocknum] = clientCRC;
+
+                if (RegionHash.GetBlockCrc32(mapID, blockPosition.X, blockPosition.Y) != clientCRC)
+                {
+                    from.Send(new UltimaLive.Network.UpdateTerrainPacket(blockPosition, from));
+                    from.Send(new UltimaLive.Network.UpdateStaticsPacket(blockPosition, from));
+                }
+            }
+
+            window.BlockCRCs = currentCRCs;
+            window.MapID = mapID;
+            window.Sequence = complete ? sequence : (UInt16)0;
+        }
+    }
+}
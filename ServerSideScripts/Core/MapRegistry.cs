@@ -97,6 +97,11 @@ namespace UltimaLive
 
         private static void EventSink_Login(LoginEventArgs args)
         {
+            if (UltimaLiveSettings.PREFERRED_HASH_MODE != HashModes.NONE)
+            {
+                args.Mobile.Send(new UltimaLive.Network.QueryClientHashCapabilities(args.Mobile));
+            }
+
             args.Mobile.Send(new UltimaLive.Network.QueryClientHash(args.Mobile));
         }
     }
@@ -45,7 +45,26 @@ namespace UltimaLive
 
             if (blocknum != previousMapBlock)
             {
-                m.Send(new UltimaLive.Network.QueryClientHash(m));
+                if (UltimaLiveSettings.USE_REGION_HASH_QUERY)
+                {
+                    m.Send(new UltimaLive.Network.QueryClientRegionHash(m));
+                }
+                else if (UltimaLiveSettings.USE_INCREMENTAL_HASH_QUERY)
+                {
+                    m.Send(new UltimaLive.Network.QueryClientHash32(m, IncrementalHash.GetAcknowledgedSequence(m)));
+                }
+                else if (UltimaLiveSettings.USE_EXPECTED_HASH_QUERY && HashModes.GetQueryMode(m) != HashModes.NONE && HashModes.SupportsExpectedHashQuery(m))
+                {
+                    m.Send(new UltimaLive.Network.QueryClientExpectedHash(m, HashModes.GetQueryMode(m)));
+                }
+                else if (HashModes.GetQueryMode(m) != HashModes.NONE)
+                {
+                    m.Send(new UltimaLive.Network.QueryClientHashMode(m, HashModes.GetQueryMode(m)));
+                }
+                else
+                {
+                    m.Send(new UltimaLive.Network.QueryClientHash(m));
+                }
             }
 
             return blocknum;
@@ -0,0 +1,313 @@
+/* Copyright(c) 2016 UltimaLive
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+*/
+
+
+using System;
+using System.Collections.Generic;
+using Server;
+using Server.Mobiles;
+
+namespace UltimaLive
+{
+    /*
+     * A node of the region hash tree. Level 0 nodes are blocks. A node at
+     * level L covers the 2^L x 2^L blocks starting at (X << L, Y << L).
+    /**/
+    public struct RegionHashNode
+    {
+        public byte Level;
+        public UInt16 X;
+        public UInt16 Y;
+
+        public RegionHashNode(int level, int x, int y)
+        {
+            Level = (byte)level;
+            X = (UInt16)x;
+            Y = (UInt16)y;
+        }
+    }
+
+    /*
+     * Server side of the region hash query (UltimaLive command 0xFC).
+     *
+     * Both sides build the same quadtree over a map's block CRC32s. The hash
+     * of a node is the CRC32 of its four child hashes in the order
+     * (2x, 2y), (2x, 2y + 1), (2x + 1, 2y), (2x + 1, 2y + 1), each written
+     * big endian. Children outside the map hash to 0.
+     *
+     * The server asks for the nodes covering the player's view range, and
+     * the client answers with the hashes of their children. Only children
+     * that differ and overlap the view range are queried again, down to
+     * the blocks, which are then resent.
+    /**/
+    public class RegionHash
+    {
+        public const int MAX_NODES_PER_QUERY = 1024;
+
+        //Node CRC caching
+        //[map][level - 1][node]
+        private static UInt32[][][] m_NodeCRCs = new UInt32[256][][];
+
+        public static int GetWidthInBlocks(int mapID)
+        {
+            return MapRegistry.Definitions[mapID].Dimensions.X >> 3;
+        }
+
+        public static int GetHeightInBlocks(int mapID)
+        {
+            return MapRegistry.Definitions[mapID].Dimensions.Y >> 3;
+        }
+
+        /*
+         * Picks the level at which the view range is covered by at most
+         * 3 x 3 nodes.
+        /**/
+        public static int GetCoveringLevel(int blocksWidth, int blocksHeight)
+        {
+            int level = 1;
+            while ((2 << level) < Math.Max(blocksWidth, blocksHeight))
+            {
+                level++;
+            }
+
+            return level;
+        }
+
+        /*
+         * Lists the blocks in the view range around a block, wrapping the
+         * same way PushBlockUpdates32 does.
+        /**/
+        public static List<Point2D> GetWindowBlocks(int block, int mapID, int minBlockX, int maxBlockX, int minBlockY, int maxBlockY)
+        {
+            List<Point2D> windowBlocks = new List<Point2D>();
+
+            if (!MapRegistry.Definitions.ContainsKey(mapID))
+            {
+                return windowBlocks;
+            }
+
+            Int32 wrapWidthInBlocks = MapRegistry.Definitions[mapID].WrapAroundDimensions.X >> 3;
+            Int32 wrapHeightInBlocks = MapRegistry.Definitions[mapID].WrapAroundDimensions.Y >> 3;
+            Int32 mapWidthInBlocks = GetWidthInBlocks(mapID);
+            Int32 mapHeightInBlocks = GetHeightInBlocks(mapID);
+
+            if (block < 0 || block >= mapWidthInBlocks * mapHeightInBlocks)
+            {
+                return windowBlocks;
+            }
+
+            int blockX = block / mapHeightInBlocks;
+            int blockY = block % mapHeightInBlocks;
+
+            for (int x = minBlockX; x <= maxBlockX; x++)
+            {
+                int xBlockItr = 0;
+                if (blockX < wrapWidthInBlocks)
+                {
+                    xBlockItr = (blockX + x) % wrapWidthInBlocks;
+                    if (xBlockItr < 0)
+                    {
+                        xBlockItr += wrapWidthInBlocks;
+                    }
+                }
+                else
+                {
+                    xBlockItr = (blockX + x) % mapWidthInBlocks;
+                    if (xBlockItr < 0)
+                    {
+                        xBlockItr += mapWidthInBlocks;
+                    }
+                }
+
+                for (int y = minBlockY; y <= maxBlockY; y++)
+                {
+                    int yBlockItr = 0;
+                    if (blockY < wrapHeightInBlocks)
+                    {
+                        yBlockItr = (blockY + y) % wrapHeightInBlocks;
+                        if (yBlockItr < 0)
+                        {
+                            yBlockItr += wrapHeightInBlocks;
+                        }
+                    }
+                    else
+                    {
+                        yBlockItr = (blockY + y) % mapHeightInBlocks;
+                        if (yBlockItr < 0)
+                        {
+                            yBlockItr += mapHeightInBlocks;
+                        }
+                    }
+
+                    windowBlocks.Add(new Point2D(xBlockItr, yBlockItr));
+                }
+            }
+
+            return windowBlocks;
+        }
+
+        public static List<RegionHashNode> GetWindowNodes(List<Point2D> windowBlocks, int level)
+        {
+            List<RegionHashNode> nodes = new List<RegionHashNode>();
+
+            foreach (Point2D block in windowBlocks)
+            {
+                RegionHashNode node = new RegionHashNode(level, block.X >> level, block.Y >> level);
+                if (!nodes.Contains(node))
+                {
+                    nodes.Add(node);
+                }
+            }
+
+            return nodes;
+        }
+
+        public static bool NodeIntersectsWindow(List<Point2D> windowBlocks, int level, int nodeX, int nodeY)
+        {
+            foreach (Point2D block in windowBlocks)
+            {
+                if ((block.X >> level) == nodeX && (block.Y >> level) == nodeY)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        public static UInt32 GetBlockCrc32(int mapID, int blockX, int blockY)
+        {
+            int heightInBlocks = GetHeightInBlocks(mapID);
+
+            if (blockX < 0 || blockY < 0 || blockX >= GetWidthInBlocks(mapID) || blockY >= heightInBlocks)
+            {
+                return 0;
+            }
+
+            int blocknum = (blockX * heightInBlocks) + blockY;
+
+            //CRC caching
+            UInt32 crc = CRC.MapCRCs32[mapID][blocknum];
+            if (crc == UInt32.MaxValue)
+            {
+                byte[] landData = new byte[0];
+                byte[] staticsData = new byte[0];
+                crc = UltimaLivePacketHandlers.GetBlockCrc32(new Point2D(blockX, blockY), mapID, ref landData, ref staticsData);
+                CRC.MapCRCs32[mapID][blocknum] = crc;
+            }
+
+            return crc;
+        }
+
+        public static UInt32 GetNodeCrc32(int mapID, int level, int nodeX, int nodeY)
+        {
+            if (level == 0)
+            {
+                return GetBlockCrc32(mapID, nodeX, nodeY);
+            }
+
+            int widthInBlocks = GetWidthInBlocks(mapID);
+            int heightInBlocks = GetHeightInBlocks(mapID);
+
+            if (nodeX < 0 || nodeY < 0 || (nodeX << level) >= widthInBlocks || (nodeY << level) >= heightInBlocks)
+            {
+                return 0;
+            }
+
+            UInt32[] levelCRCs = GetLevelCRCs(mapID, level);
+            int index = (nodeX * GetLevelHeight(heightInBlocks, level)) + nodeY;
+
+            if (levelCRCs[index] == UInt32.MaxValue)
+            {
+                byte[] childHashes = new byte[16];
+                for (int i = 0; i < 4; i++)
+                {
+                    UInt32 childHash = GetNodeCrc32(mapID, level - 1, (nodeX << 1) + (i >> 1), (nodeY << 1) + (i & 1));
+                    childHashes[(i * 4) + 0] = (byte)(childHash >> 24);
+                    childHashes[(i * 4) + 1] = (byte)(childHash >> 16);
+                    childHashes[(i * 4) + 2] = (byte)(childHash >> 8);
+                    childHashes[(i * 4) + 3] = (byte)childHash;
+                }
+
+                levelCRCs[index] = CRC.CalculateCrc32(childHashes);
+            }
+
+            return levelCRCs[index];
+        }
+
+        public static void InvalidateBlock(int mapID, int block)
+        {
+            if (m_NodeCRCs[mapID] == null)
+            {
+                return;
+            }
+
+            int heightInBlocks = GetHeightInBlocks(mapID);
+            int blockX = block / heightInBlocks;
+            int blockY = block % heightInBlocks;
+
+            for (int level = 1; level <= m_NodeCRCs[mapID].Length; level++)
+            {
+                UInt32[] levelCRCs = m_NodeCRCs[mapID][level - 1];
+                if (levelCRCs != null)
+                {
+                    levelCRCs[((blockX >> level) * GetLevelHeight(heightInBlocks, level)) + (blockY >> level)] = UInt32.MaxValue;
+                }
+            }
+        }
+
+        private static int GetLevelHeight(int heightInBlocks, int level)
+        {
+            return (heightInBlocks + (1 << level) - 1) >> level;
+        }
+
+        private static UInt32[] GetLevelCRCs(int mapID, int level)
+        {
+            if (m_NodeCRCs[mapID] == null)
+            {
+                int levels = 1;
+                while ((1 << levels) < Math.Max(GetWidthInBlocks(mapID), GetHeightInBlocks(mapID)))
+                {
+                    levels++;
+                }
+
+                m_NodeCRCs[mapID] = new UInt32[levels][];
+            }
+
+            if (m_NodeCRCs[mapID][level - 1] == null)
+            {
+                int widthInBlocks = GetWidthInBlocks(mapID);
+                int heightInBlocks = GetHeightInBlocks(mapID);
+                UInt32[] levelCRCs = new UInt32[GetLevelHeight(widthInBlocks, level) * GetLevelHeight(heightInBlocks, level)];
+
+                for (int i = 0; i < levelCRCs.Length; i++)
+                {
+                    levelCRCs[i] = UInt32.MaxValue;
+                }
+
+                m_NodeCRCs[mapID][level - 1] = levelCRCs;
+            }
+
+            return m_NodeCRCs[mapID][level - 1];
+        }
+    }
+}
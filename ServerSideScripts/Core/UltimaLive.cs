@@ -496,6 +496,7 @@ namespace UltimaLive
             Register("LiveFreeze", AccessLevel.Administrator, new CommandEventHandler(LiveFreeze_OnCommand));
             Register("GetBlockNumber", AccessLevel.GameMaster, new CommandEventHandler(getBlockNumber_OnCommand));
             Register("QueryClientHash", AccessLevel.GameMaster, new CommandEventHandler(queryClientHash_OnCommand));
+            Register("QueryClientRegionHash", AccessLevel.GameMaster, new CommandEventHandler(queryClientRegionHash_OnCommand));
             Register("updateblock", AccessLevel.GameMaster, new CommandEventHandler(updateBlock_OnCommand));
             Register("CircularIndent", AccessLevel.GameMaster, new CommandEventHandler(circularIndent_OnCommand));
             TargetCommands.Register(new IncStaticYCommand());
@@ -906,6 +907,14 @@ namespace UltimaLive
             Mobile from = e.Mobile;
             from.Send(new UltimaLive.Network.QueryClientHash(from));
         }
+
+        [Usage("queryclientregionhash")]
+        [Description("sends the client a region hash request for its surrounding blocks")]
+        public static void queryClientRegionHash_OnCommand(CommandEventArgs e)
+        {
+            Mobile from = e.Mobile;
+            from.Send(new UltimaLive.Network.QueryClientRegionHash(from));
+        }
         #endregion
     }
 }
\ No newline at end of file
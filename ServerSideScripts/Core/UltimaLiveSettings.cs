@@ -37,6 +37,10 @@ namespace UltimaLive
     public class UltimaLiveSettings
     {
         public const string UNIQUE_SHARD_IDENTIFIER = "Test1"; //Must be 28 characters or less
+        public const bool USE_REGION_HASH_QUERY = false; //Query clients with region hashes (0xFC) instead of one hash per block (0xFF)
+        public const bool USE_INCREMENTAL_HASH_QUERY = false; //Query clients for the block hashes that changed since their last response (0xFD/0xFB)
+        public const byte PREFERRED_HASH_MODE = HashModes.NONE; //Hash mode to query clients in when they support it (0xFA/0xF9), see HashModes
+        public const bool USE_EXPECTED_HASH_QUERY = false; //Send clients our block hashes in the hash mode above and let them report the blocks that differ (0xF8)
 
         public const string ULTIMA_LIVE_ROOT_FOLDER_NAME = "UltimaLive";
         public const string ULTIMA_LIVE_MAP_CHANGES_FOLDER_NAME = "ClientFiles";
@@ -60,6 +60,8 @@ namespace UltimaLive
                 Console.WriteLine("Reseting UltimaLive Major and Minor version for " + player.Name);
                 player.UltimaLiveMajorVersion = 0;
                 player.UltimaLiveMinorVersion = 0;
+                IncrementalHash.Forget(player);
+                HashModes.Forget(player);
             }
         }
 
@@ -75,12 +77,49 @@ namespace UltimaLive
 
             switch (ultimaLiveCommand)
             {
+                case 0xFB: //incremental block query32 response
+                    {
+                        HandleIncrementalBlockQuery32Reply(state, pvSrc);
+                        break;
+                    }
+
                 case 0x04: //blocks view range response
                     {
                         HandleBlocksViewRangeReply(state, pvSrc);
                         break;
                     }
 
+                case 0xF8: //expected hash query response
+                    {
+                        HandleExpectedHashQueryReply(state, pvSrc);
+                        break;
+                    }
+
+                case 0xF9: //hash mode query response
+                    {
+                        HandleHashModeQueryReply(state, pvSrc);
+                        break;
+                    }
+
+                case 0xFA: //hash capabilities response
+                    {
+                        pvSrc.Seek(15, SeekOrigin.Begin);
+                        UInt16 supportedModes = pvSrc.ReadUInt16();
+                        UInt16 acceleratedModes = pvSrc.ReadUInt16();
+                        UInt16 supportedQueries = pvSrc.ReadUInt16(); //0 past the end of the 19 byte responses of older clients
+                        if (state != null && state.Mobile is PlayerMobile)
+                        {
+                            HashModes.SetCapabilities(state.Mobile, supportedModes, acceleratedModes, supportedQueries);
+                        }
+                        break;
+                    }
+
+                case 0xFC: //region hash query response
+                    {
+                        HandleRegionHashQueryReply(state, pvSrc);
+                        break;
+                    }
+
                 case 0xFD: //block query32 response
                     {
                         HandleBlockQuery32Reply(state, pvSrc);
@@ -205,6 +244,249 @@ namespace UltimaLive
             PushBlockUpdates32((int)blocknum, (int)mapID, receivedCRCs, from);
         }
 
+        /*
+         * An incremental query32 response only lists the blocks that entered
+         * the player's view range or changed since the response we applied
+         * last. The rest of the window is taken from that response.
+        /**/
+        public static void HandleIncrementalBlockQuery32Reply(NetState state, PacketReader pvSrc)
+        {
+            PlayerMobile from = state.Mobile as PlayerMobile;
+
+            if (from == null)
+                return;
+
+            //byte 000              -  cmd
+            //byte 001 through 002  -  packet size
+            pvSrc.Seek(3, SeekOrigin.Begin);            //byte 003 through 006  -  central block number for the query (block that player is standing in)
+            UInt32 blocknum = pvSrc.ReadUInt32();
+            pvSrc.Seek(11, SeekOrigin.Begin);           //byte 011 through 012  -  UltimaLive sequence number of this response
+            UInt16 sequence = pvSrc.ReadUInt16();
+                                                        //byte 013              -  UltimaLive command (0xFB is an incremental block Query32 Response)
+            pvSrc.Seek(14, SeekOrigin.Begin);           //byte 014              -  UltimaLive mapnumber
+            Int32 mapID = (Int32)pvSrc.ReadByte();
+
+            if (mapID != from.Map.MapID || !MapRegistry.Definitions.ContainsKey(mapID))
+            {
+                Console.WriteLine(string.Format("Received an incremental block query response from {0} for map {1} but that player is on map {2}",
+                    from.Name, mapID, from.Map.MapID));
+                return;
+            }
+
+            bool fullWindow = pvSrc.ReadByte() == 0x01; //byte 015              -  1 if every block of the window is listed
+            UInt16 count = pvSrc.ReadUInt16();          //byte 016 through 017  -  number of blocks
+
+            Dictionary<int, UInt32> receivedCRCs = new Dictionary<int, UInt32>();
+            for (int i = 0; i < count; i++)             //byte 018 onward       -  index in the window, CRC32
+            {
+                int index = pvSrc.ReadUInt16();
+                receivedCRCs[index] = pvSrc.ReadUInt32();
+            }
+
+            IncrementalHash.ApplyResponse(from, (int)blocknum, mapID, sequence, fullWindow, receivedCRCs);
+        }
+
+        /*
+         * A hash mode query response carries one hash per block of the view
+         * range in the hash mode we asked for, big endian and as wide as the
+         * hash mode's hashes.
+        /**/
+        public static void HandleHashModeQueryReply(NetState state, PacketReader pvSrc)
+        {
+            PlayerMobile from = state.Mobile as PlayerMobile;
+
+            if (from == null)
+                return;
+
+            //byte 000              -  cmd
+            //byte 001 through 002  -  packet size
+            pvSrc.Seek(3, SeekOrigin.Begin);            //byte 003 through 006  -  central block number for the query (block that player is standing in)
+            UInt32 blocknum = pvSrc.ReadUInt32();
+                                                        //byte 007 through 010  -  number of statics in the packet (8 for a query response)
+                                                        //byte 011 through 012  -  UltimaLive sequence number
+                                                        //byte 013              -  UltimaLive command (0xF9 is a hash mode query response)
+            pvSrc.Seek(14, SeekOrigin.Begin);           //byte 014              -  UltimaLive mapnumber
+            Int32 mapID = (Int32)pvSrc.ReadByte();
+
+            if (mapID != from.Map.MapID || !MapRegistry.Definitions.ContainsKey(mapID))
+            {
+                Console.WriteLine(string.Format("Received a hash mode query response from {0} for map {1} but that player is on map {2}",
+                    from.Name, mapID, from.Map.MapID));
+                return;
+            }
+
+            byte hashMode = pvSrc.ReadByte();           //byte 015              -  hash mode of the block hashes
+            int hashSize = HashModes.GetHashSize(hashMode);
+            if (hashSize == 0)
+            {
+                return;
+            }
+
+            List<Point2D> windowBlocks = RegionHash.GetWindowBlocks((int)blocknum, mapID, from.UOLive_FOV_MinBlockX, from.UOLive_FOV_MaxBlockX,
+                from.UOLive_FOV_MinBlockY, from.UOLive_FOV_MaxBlockY);
+
+            for (int i = 0; i < windowBlocks.Count; i++) //byte 016 onward       -  block hashes
+            {
+                UInt64 receivedHash = 0;
+                for (int j = 0; j < hashSize; j++)
+                {
+                    receivedHash = (receivedHash << 8) | pvSrc.ReadByte();
+                }
+
+                Point2D blockPosition = windowBlocks[i];
+                UInt64 blockHash = HashModes.GetBlockHash(mapID, hashMode, blockPosition.X, blockPosition.Y);
+
+                if (hashMode == HashModes.SPLIT_CRC32)
+                {
+                    //only resend the half of the block that differs
+                    if ((blockHash >> 32) != (receivedHash >> 32))
+                    {
+                        from.Send(new UltimaLive.Network.UpdateTerrainPacket(blockPosition, from));
+                    }
+
+                    if ((UInt32)blockHash != (UInt32)receivedHash)
+                    {
+                        from.Send(new UltimaLive.Network.UpdateStaticsPacket(blockPosition, from));
+                    }
+                }
+                else if (blockHash != receivedHash)
+                {
+                    from.Send(new UltimaLive.Network.UpdateTerrainPacket(blockPosition, from));
+                    from.Send(new UltimaLive.Network.UpdateStaticsPacket(blockPosition, from));
+                }
+            }
+        }
+
+        /*
+         * An expected hash query response carries one bit per block of the
+         * view range, set when the client's hash differs from the one we sent.
+        /**/
+        public static void HandleExpectedHashQueryReply(NetState state, PacketReader pvSrc)
+        {
+            PlayerMobile from = state.Mobile as PlayerMobile;
+
+            if (from == null)
+                return;
+
+            //byte 000              -  cmd
+            //byte 001 through 002  -  packet size
+            pvSrc.Seek(3, SeekOrigin.Begin);            //byte 003 through 006  -  central block number for the query (block that player is standing in)
+            UInt32 blocknum = pvSrc.ReadUInt32();
+                                                        //byte 007 through 010  -  number of statics in the packet (8 for a query response)
+                                                        //byte 011 through 012  -  UltimaLive sequence number
+                                                        //byte 013              -  UltimaLive command (0xF8 is an expected hash query response)
+            pvSrc.Seek(14, SeekOrigin.Begin);           //byte 014              -  UltimaLive mapnumber
+            Int32 mapID = (Int32)pvSrc.ReadByte();
+
+            if (mapID != from.Map.MapID || !MapRegistry.Definitions.ContainsKey(mapID))
+            {
+                Console.WriteLine(string.Format("Received an expected hash query response from {0} for map {1} but that player is on map {2}",
+                    from.Name, mapID, from.Map.MapID));
+                return;
+            }
+
+            pvSrc.ReadByte();                           //byte 015              -  hash mode of the compared hashes
+            int numberOfBlocks = pvSrc.ReadUInt16();    //byte 016 through 017  -  number of blocks in the client's view range
+
+            List<Point2D> windowBlocks = RegionHash.GetWindowBlocks((int)blocknum, mapID, from.UOLive_FOV_MinBlockX, from.UOLive_FOV_MaxBlockX,
+                from.UOLive_FOV_MinBlockY, from.UOLive_FOV_MaxBlockY);
+            int comparedBlocks = Math.Min(numberOfBlocks, windowBlocks.Count);
+            byte mismatches = 0;
+
+            for (int i = 0; i < comparedBlocks; i++)    //byte 018 onward       -  mismatch bitmap
+            {
+                if ((i & 7) == 0)
+                {
+                    mismatches = pvSrc.ReadByte();
+                }
+
+                if ((mismatches & (1 << (i & 7))) != 0)
+                {
+                    Point2D blockPosition = windowBlocks[i];
+                    from.Send(new UltimaLive.Network.UpdateTerrainPacket(blockPosition, from));
+                    from.Send(new UltimaLive.Network.UpdateStaticsPacket(blockPosition, from));
+                }
+            }
+        }
+
+        /*
+         * The client answers a region hash query with the hashes of the
+         * children of every node we asked for. Children that match are done.
+         * Differing blocks are resent, and differing regions that overlap the
+         * player's view range are queried again one level down.
+        /**/
+        public static void HandleRegionHashQueryReply(NetState state, PacketReader pvSrc)
+        {
+            PlayerMobile from = state.Mobile as PlayerMobile;
+
+            if (from == null)
+                return;
+
+            //byte 000              -  cmd
+            //byte 001 through 002  -  packet size
+            pvSrc.Seek(3, SeekOrigin.Begin);            //byte 003 through 006  -  central block number for the query (block that player is standing in)
+            UInt32 blocknum = pvSrc.ReadUInt32();
+                                                        //byte 007 through 010  -  number of statics in the packet (8 for a query response)
+                                                        //byte 011 through 012  -  UltimaLive sequence number
+                                                        //byte 013              -  UltimaLive command (0xFC is a region hash query response)
+            pvSrc.Seek(14, SeekOrigin.Begin);           //byte 014              -  UltimaLive mapnumber
+            Int32 mapID = (Int32)pvSrc.ReadByte();
+
+            if (mapID != from.Map.MapID || !MapRegistry.Definitions.ContainsKey(mapID))
+            {
+                Console.WriteLine(string.Format("Received a region hash query response from {0} for map {1} but that player is on map {2}",
+                    from.Name, mapID, from.Map.MapID));
+                return;
+            }
+
+            UInt16 nodeCount = pvSrc.ReadUInt16();      //byte 015 through 016  -  number of nodes
+
+            List<Point2D> windowBlocks = RegionHash.GetWindowBlocks((int)blocknum, mapID, from.UOLive_FOV_MinBlockX, from.UOLive_FOV_MaxBlockX,
+                from.UOLive_FOV_MinBlockY, from.UOLive_FOV_MaxBlockY);
+            List<RegionHashNode> differingNodes = new List<RegionHashNode>();
+
+            for (int i = 0; i < nodeCount; i++)         //byte 017 onward       -  level, node x, node y, 4 child hashes
+            {
+                int level = pvSrc.ReadByte();
+                int nodeX = pvSrc.ReadUInt16();
+                int nodeY = pvSrc.ReadUInt16();
+
+                for (int child = 0; child < 4; child++)
+                {
+                    UInt32 receivedCRC = pvSrc.ReadUInt32();
+                    int childX = (nodeX << 1) + (child >> 1);
+                    int childY = (nodeY << 1) + (child & 1);
+
+                    if (level < 1 || !RegionHash.NodeIntersectsWindow(windowBlocks, level - 1, childX, childY))
+                    {
+                        continue;
+                    }
+
+                    if (RegionHash.GetNodeCrc32(mapID, level - 1, childX, childY) == receivedCRC)
+                    {
+                        continue;
+                    }
+
+                    if (level == 1)
+                    {
+                        Point2D blockPosition = new Point2D(childX, childY);
+                        from.Send(new UltimaLive.Network.UpdateTerrainPacket(blockPosition, from));
+                        from.Send(new UltimaLive.Network.UpdateStaticsPacket(blockPosition, from));
+                    }
+                    else
+                    {
+                        differingNodes.Add(new RegionHashNode(level - 1, childX, childY));
+                    }
+                }
+            }
+
+            for (int i = 0; i < differingNodes.Count; i += RegionHash.MAX_NODES_PER_QUERY)
+            {
+                List<RegionHashNode> nodes = differingNodes.GetRange(i, Math.Min(RegionHash.MAX_NODES_PER_QUERY, differingNodes.Count - i));
+                from.Send(new UltimaLive.Network.QueryClientRegionHash((int)blocknum, mapID, nodes));
+            }
+        }
+
         /*
          * Whenever the client moves out of a block, we will ask the client to 
          * provide us with a list of blocks around it and their corresponding
@@ -25,6 +25,7 @@ using System.Net;
 using System.Collections;
 using System.Collections.Generic;
 using Server;
+using Server.Mobiles;
 using Server.Network;
 using Server.Targeting;
 using UltimaLive;
@@ -165,6 +166,174 @@ namespace UltimaLive.Network
             m_Stream.Write((byte)0xFD);                 //byte 013         -  UltimaLive command (0xFD is a block Query32)
             m_Stream.Write((byte)playerMap.MapID);      //byte 014         -  UltimaLive mapnumber
         }
+
+        //Asks for an incremental response (0xFB) against the last response we applied
+        public QueryClientHash32(Mobile m, UInt16 acknowledgedSequence)
+            : base(0x3F)
+        {
+            Map playerMap = m.Map;
+            TileMatrix tm = playerMap.Tiles;
+            int blocknum = (((m.Location.X >> 3) * tm.BlockHeight) + (m.Location.Y >> 3));
+
+            //byte 000         -  cmd
+            this.EnsureCapacity(16);                    //byte 001 to 002  -  packet size
+            m_Stream.Write((UInt32)blocknum);           //byte 003 to 006  -  central block number for the query (block that player is standing in)
+            m_Stream.Write((Int32)0);                   //byte 007 to 010  -  number of statics in the packet (0 for a query)
+            m_Stream.Write((UInt16)acknowledgedSequence); //byte 011 to 012  -  sequence number of the last incremental response we applied, 0 for none
+            m_Stream.Write((byte)0xFD);                 //byte 013         -  UltimaLive command (0xFD is a block Query32)
+            m_Stream.Write((byte)playerMap.MapID);      //byte 014         -  UltimaLive mapnumber
+            m_Stream.Write((byte)0x01);                 //byte 015         -  query mode (0x01 is incremental)
+        }
+    }
+    #endregion
+
+    #region Query Client Hash Capabilities Packet
+    //Asks the client which hash modes it can answer a hash mode query in
+    public class QueryClientHashCapabilities : Packet
+    {
+        public QueryClientHashCapabilities(Mobile m)
+            : base(0x3F)
+        {
+            //byte 000         -  cmd
+            this.EnsureCapacity(15);                    //byte 001 to 002  -  packet size
+            m_Stream.Write((UInt32)0);                  //byte 003 to 006  -  unused
+            m_Stream.Write((Int32)0);                   //byte 007 to 010  -  unused
+            m_Stream.Write((UInt16)0x0000);             //byte 011 to 012  -  UltimaLive sequence number
+            m_Stream.Write((byte)0xFA);                 //byte 013         -  UltimaLive command (0xFA is a hash capabilities query)
+            m_Stream.Write((byte)m.Map.MapID);          //byte 014         -  UltimaLive mapnumber
+        }
+    }
+    #endregion
+
+    #region Query Client Hash Mode Packet
+    //Asks the client for the block hashes of its view range in a hash mode it reported
+    public class QueryClientHashMode : Packet
+    {
+        public QueryClientHashMode(Mobile m, byte hashMode)
+            : base(0x3F)
+        {
+            Map playerMap = m.Map;
+            TileMatrix tm = playerMap.Tiles;
+            int blocknum = (((m.Location.X >> 3) * tm.BlockHeight) + (m.Location.Y >> 3));
+
+            //byte 000         -  cmd
+            this.EnsureCapacity(16);                    //byte 001 to 002  -  packet size
+            m_Stream.Write((UInt32)blocknum);           //byte 003 to 006  -  central block number for the query (block that player is standing in)
+            m_Stream.Write((Int32)0);                   //byte 007 to 010  -  number of statics in the packet (0 for a query)
+            m_Stream.Write((UInt16)0x0000);             //byte 011 to 012  -  UltimaLive sequence number
+            m_Stream.Write((byte)0xF9);                 //byte 013         -  UltimaLive command (0xF9 is a hash mode query)
+            m_Stream.Write((byte)playerMap.MapID);      //byte 014         -  UltimaLive mapnumber
+            m_Stream.Write((byte)hashMode);             //byte 015         -  hash mode of the response
+        }
+    }
+    #endregion
+
+    #region Query Client Expected Hash Packet
+    //Sends the client our block hashes of its view range, it answers with the blocks whose hashes differ
+    public class QueryClientExpectedHash : Packet
+    {
+        public QueryClientExpectedHash(Mobile m, byte hashMode)
+            : base(0x3F)
+        {
+            Map playerMap = m.Map;
+            TileMatrix tm = playerMap.Tiles;
+            int blocknum = (((m.Location.X >> 3) * tm.BlockHeight) + (m.Location.Y >> 3));
+
+            int minBlockX = -2;
+            int maxBlockX = 2;
+            int minBlockY = -2;
+            int maxBlockY = 2;
+
+            PlayerMobile player = m as PlayerMobile;
+            if (player != null)
+            {
+                minBlockX = player.UOLive_FOV_MinBlockX;
+                maxBlockX = player.UOLive_FOV_MaxBlockX;
+                minBlockY = player.UOLive_FOV_MinBlockY;
+                maxBlockY = player.UOLive_FOV_MaxBlockY;
+            }
+
+            List<Point2D> windowBlocks = RegionHash.GetWindowBlocks(blocknum, playerMap.MapID, minBlockX, maxBlockX, minBlockY, maxBlockY);
+            int hashSize = HashModes.GetHashSize(hashMode);
+
+            //byte 000         -  cmd
+            this.EnsureCapacity(18 + (windowBlocks.Count * hashSize)); //byte 001 to 002  -  packet size
+            m_Stream.Write((UInt32)blocknum);           //byte 003 to 006  -  central block number for the query (block that player is standing in)
+            m_Stream.Write((Int32)0);                   //byte 007 to 010  -  number of statics in the packet (0 for a query)
+            m_Stream.Write((UInt16)0x0000);             //byte 011 to 012  -  UltimaLive sequence number
+            m_Stream.Write((byte)0xF8);                 //byte 013         -  UltimaLive command (0xF8 is an expected hash query)
+            m_Stream.Write((byte)playerMap.MapID);      //byte 014         -  UltimaLive mapnumber
+            m_Stream.Write((byte)hashMode);             //byte 015         -  hash mode of the expected hashes
+            m_Stream.Write((UInt16)windowBlocks.Count); //byte 016 to 017  -  number of hashes
+
+            foreach (Point2D blockPosition in windowBlocks) //byte 018 to ???  -  hashSize bytes per block, big endian
+            {
+                UInt64 hash = HashModes.GetBlockHash(playerMap.MapID, hashMode, blockPosition.X, blockPosition.Y);
+                for (int j = hashSize - 1; j >= 0; j--)
+                {
+                    m_Stream.Write((byte)(hash >> (8 * j)));
+                }
+            }
+        }
+    }
+    #endregion
+
+    #region Query Client Region Hash Packet
+    //Asks the client for the child hashes of region hash tree nodes
+    public class QueryClientRegionHash : Packet
+    {
+        //Queries the nodes covering the player's view range
+        public QueryClientRegionHash(Mobile m)
+            : base(0x3F)
+        {
+            Map playerMap = m.Map;
+            TileMatrix tm = playerMap.Tiles;
+            int blocknum = (((m.Location.X >> 3) * tm.BlockHeight) + (m.Location.Y >> 3));
+
+            int minBlockX = -2;
+            int maxBlockX = 2;
+            int minBlockY = -2;
+            int maxBlockY = 2;
+
+            PlayerMobile player = m as PlayerMobile;
+            if (player != null)
+            {
+                minBlockX = player.UOLive_FOV_MinBlockX;
+                maxBlockX = player.UOLive_FOV_MaxBlockX;
+                minBlockY = player.UOLive_FOV_MinBlockY;
+                maxBlockY = player.UOLive_FOV_MaxBlockY;
+            }
+
+            List<Point2D> windowBlocks = RegionHash.GetWindowBlocks(blocknum, playerMap.MapID, minBlockX, maxBlockX, minBlockY, maxBlockY);
+            int level = RegionHash.GetCoveringLevel(maxBlockX - minBlockX + 1, maxBlockY - minBlockY + 1);
+            WriteQueryToStream(blocknum, playerMap.MapID, RegionHash.GetWindowNodes(windowBlocks, level));
+        }
+
+        //Queries specific nodes, used to descend into regions that differ
+        public QueryClientRegionHash(int blockNumber, int mapID, List<RegionHashNode> nodes)
+            : base(0x3F)
+        {
+            WriteQueryToStream(blockNumber, mapID, nodes);
+        }
+
+        public void WriteQueryToStream(int blockNumber, int mapID, List<RegionHashNode> nodes)
+        {
+            //byte 000         -  cmd
+            this.EnsureCapacity(17 + (nodes.Count * 5));  //byte 001 to 002  -  packet size
+            m_Stream.Write((UInt32)blockNumber);        //byte 003 to 006  -  central block number for the query (block that player is standing in)
+            m_Stream.Write((Int32)0);                   //byte 007 to 010  -  number of statics in the packet (0 for a query)
+            m_Stream.Write((UInt16)0x0000);             //byte 011 to 012  -  UltimaLive sequence number
+            m_Stream.Write((byte)0xFC);                 //byte 013         -  UltimaLive command (0xFC is a region hash query)
+            m_Stream.Write((byte)mapID);                //byte 014         -  UltimaLive mapnumber
+            m_Stream.Write((UInt16)nodes.Count);        //byte 015 to 016  -  number of nodes
+
+            foreach (RegionHashNode node in nodes)      //byte 017 to ???  -  5 bytes per node
+            {
+                m_Stream.Write(node.Level);
+                m_Stream.Write(node.X);
+                m_Stream.Write(node.Y);
+            }
+        }
     }
     #endregion
 
@@ -0,0 +1,334 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks of the BlockGroupLayout against the per-cell wrap loop that GetGroupOfBlockCrcs and GetGroupOfBlockCrcs32
+ * used before it, over every central block that can wrap and a sample of the others, then timings of both for view
+ * ranges from 5x5 to 31x31. Returns non-zero if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "BlockGroupLayout.h"
+
+#include "TestSupport.h"
+
+namespace
+{
+  /**
+   * @struct ViewRange
+   *
+   * @brief Offsets of the view range window from the central block
+   */
+  struct ViewRange
+  {
+    int32_t minBlockX; //!< min block x
+    int32_t maxBlockX; //!< max block x
+    int32_t minBlockY; //!< min block y
+    int32_t maxBlockY; //!< max block y
+  };
+
+  /**
+   * @brief Builds a map definition
+   *
+   * @param mapNumber Map Number
+   * @param width Width in tiles
+   * @param height Height in tiles
+   * @param wrapWidth Horizontal wrapping coordinate in tiles
+   * @param wrapHeight Vertical wrapping coordinate in tiles
+   *
+   * @return Map definition
+   */
+  MapDefinition makeDefinition(uint8_t mapNumber, uint16_t width, uint16_t height, uint16_t wrapWidth, uint16_t wrapHeight)
+  {
+    MapDefinition definition;
+    definition.mapNumber = mapNumber;
+    definition.mapWidthInTiles = width;
+    definition.mapHeightInTiles = height;
+    definition.mapWrapWidthInTiles = wrapWidth;
+    definition.mapWrapHeightInTiles = wrapHeight;
+    return definition;
+  }
+
+  /**
+   * @brief The group loop as it was in Atlas before BlockGroupLayout, including the lookup of the map definition by
+   * value, returning block numbers instead of hashes
+   *
+   * @param rDefinitions Map definitions by map number
+   * @param mapNumber Map Number
+   * @param blockNumber Number of the block containing the current player position
+   * @param rRange View range
+   * @param rBlocksOut Receives the block numbers, -1 for cells that were left empty
+   */
+  void referenceGroupOfBlockNumbers(std::map<uint32_t, MapDefinition>& rDefinitions, uint32_t mapNumber, uint32_t blockNumber, const ViewRange& rRange, std::vector<int32_t>& rBlocksOut)
+  {
+    int32_t blocksWidth = rRange.maxBlockX - rRange.minBlockX + 1;
+    int32_t blocksHeight = rRange.maxBlockY - rRange.minBlockY + 1;
+    rBlocksOut.assign(blocksWidth * blocksHeight, -1);
+
+    if (rDefinitions.find(mapNumber) != rDefinitions.end())
+    {
+      MapDefinition def = rDefinitions[mapNumber];
+      int32_t blockX = ((int32_t)blockNumber / (def.mapHeightInTiles >> 3));
+      int32_t blockY = ((int32_t)blockNumber % (def.mapHeightInTiles >> 3));
+
+      int32_t wrapWidthInBlocks = (def.mapWrapWidthInTiles >> 3);
+      int32_t wrapHeightInBlocks = (def.mapWrapHeightInTiles >> 3);
+      int32_t mapWidthInBlocks = (def.mapWidthInTiles >> 3);
+      int32_t mapHeightInBlocks = (def.mapHeightInTiles >> 3);
+
+      if (blockX < 0 || blockX >= mapWidthInBlocks || blockY < 0 || blockY >= mapHeightInBlocks)
+      {
+      }
+      else
+      {
+        int32_t boundX = rRange.minBlockX - 1;
+        int32_t absOffsetX = abs(rRange.minBlockX);
+        int32_t absOffsetY = abs(rRange.minBlockY);
+
+        for (int x = rRange.minBlockX; x <= rRange.maxBlockX; x++)
+        {
+          int xBlockItr = -1;
+          if (blockX < wrapWidthInBlocks)
+          {
+            xBlockItr = (blockX + x) % wrapWidthInBlocks;
+            if (xBlockItr < 0 && xBlockItr > boundX)
+            {
+              xBlockItr += wrapWidthInBlocks;
+            }
+          }
+          else
+          {
+            xBlockItr = (blockX + x) % mapWidthInBlocks;
+            if (xBlockItr < 0 && xBlockItr > boundX)
+            {
+              xBlockItr += mapWidthInBlocks;
+            }
+          }
+          for (int y = rRange.minBlockY; y <= rRange.maxBlockY; y++)
+          {
+            int yBlockItr = 0;
+            if (blockY < wrapHeightInBlocks)
+            {
+              yBlockItr = (blockY + y) % wrapHeightInBlocks;
+              if (yBlockItr < 0)
+              {
+                yBlockItr += wrapHeightInBlocks;
+              }
+            }
+            else
+            {
+              yBlockItr = (blockY + y) % mapHeightInBlocks;
+              if (yBlockItr < 0)
+              {
+                yBlockItr += mapHeightInBlocks;
+              }
+            }
+
+            int32_t currentBlock = (xBlockItr * mapHeightInBlocks) + yBlockItr;
+
+            if (currentBlock >= 0 && currentBlock <= (mapHeightInBlocks * mapWidthInBlocks))
+            {
+              rBlocksOut[((x + absOffsetX) * blocksHeight) + (y + absOffsetY)] = currentBlock;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Checks whether a block index lies close enough to an edge or a wrapping coordinate for its window to wrap
+   *
+   * @param index Block index on the axis
+   * @param margin Largest view range offset on the axis
+   * @param size Map size on the axis in blocks
+   * @param wrap Wrapping coordinate on the axis in blocks
+   *
+   * @return true if the window around the index may wrap
+   */
+  bool nearEdge(int32_t index, int32_t margin, int32_t size, int32_t wrap)
+  {
+    return index <= margin || index >= size - margin - 1 || abs(index - wrap) <= margin + 1;
+  }
+
+  const ViewRange g_viewRanges[] =
+  {
+    { -2, 2, -2, 2 },
+    { -4, 4, -4, 4 },
+    { -6, 6, -6, 6 },
+    { -8, 8, -8, 8 },
+    { -12, 12, -12, 12 },
+    { -15, 15, -15, 15 },
+    { -2, 5, -6, 1 }
+  }; //!< View ranges from 5x5 (the default) to 31x31, and one off center
+
+  /**
+   * @brief Compares the layout with the reference loop for every central block whose window can wrap and every 13th
+   * other block, on map shapes with and without wrapping coordinates, and on maps smaller than the window
+   */
+  void checkLayout()
+  {
+    const MapDefinition definitions[] =
+    {
+      makeDefinition(0, 7168, 4096, 5120, 4096),
+      makeDefinition(2, 2304, 1600, 2304, 1600),
+      makeDefinition(3, 2560, 2048, 2560, 2048),
+      makeDefinition(4, 1448, 1448, 1448, 1448),
+      makeDefinition(5, 1280, 4096, 1280, 4096),
+      makeDefinition(6, 256, 192, 128, 160),
+      makeDefinition(7, 16, 24, 16, 24)
+    };
+
+    std::vector<int32_t> expected;
+    std::vector<int32_t> blocks;
+
+    for (size_t d = 0; d < sizeof(definitions) / sizeof(definitions[0]); d++)
+    {
+      MapDefinition definition = definitions[d];
+      std::map<uint32_t, MapDefinition> definitionsByNumber;
+      definitionsByNumber[definition.mapNumber] = definition;
+
+      int32_t width = definition.mapWidthInTiles >> 3;
+      int32_t height = definition.mapHeightInTiles >> 3;
+      int32_t wrapWidth = definition.mapWrapWidthInTiles >> 3;
+      int32_t wrapHeight = definition.mapWrapHeightInTiles >> 3;
+
+      for (size_t r = 0; r < sizeof(g_viewRanges) / sizeof(g_viewRanges[0]); r++)
+      {
+        const ViewRange& rRange = g_viewRanges[r];
+        int32_t marginX = std::max(-rRange.minBlockX, rRange.maxBlockX);
+        int32_t marginY = std::max(-rRange.minBlockY, rRange.maxBlockY);
+
+        BlockGroupLayout layout;
+        layout.reset(definition, rRange.minBlockX, rRange.maxBlockX, rRange.minBlockY, rRange.maxBlockY);
+        check(layout.isLayoutFor(definition.mapNumber) && !layout.isLayoutFor(definition.mapNumber + 1), "layout map number", definition.mapNumber);
+
+        uint32_t numberOfMismatches = 0;
+
+        for (int32_t blockNumber = 0; blockNumber < width * height; blockNumber++)
+        {
+          int32_t blockX = blockNumber / height;
+          int32_t blockY = blockNumber % height;
+
+          if (blockNumber % 13 != 0 && !nearEdge(blockX, marginX, width, wrapWidth) && !nearEdge(blockY, marginY, height, wrapHeight))
+          {
+            continue;
+          }
+
+          referenceGroupOfBlockNumbers(definitionsByNumber, definition.mapNumber, blockNumber, rRange, expected);
+          layout.getBlockNumbers(blockNumber, blocks);
+
+          if (blocks != expected)
+          {
+            numberOfMismatches++;
+          }
+        }
+
+        //blocks outside the map leave every cell empty
+        referenceGroupOfBlockNumbers(definitionsByNumber, definition.mapNumber, width * height, rRange, expected);
+        layout.getBlockNumbers(width * height, blocks);
+        check(blocks == expected && blocks[0] == -1, "block outside the map", definition.mapNumber);
+
+        check(numberOfMismatches == 0, "layout matches the wrap loop", (definition.mapNumber << 8) | static_cast<uint32_t>(r));
+      }
+    }
+
+    BlockGroupLayout layout;
+    layout.getBlockNumbers(0, blocks);
+    check(blocks.empty() && !layout.isLayoutFor(0), "empty layout before reset", 0);
+
+    layout.reset(definitions[0], -2, 2, -2, 2);
+    layout.clear();
+    layout.getBlockNumbers(0, blocks);
+    check(blocks.empty() && !layout.isLayoutFor(0), "empty layout after clear", 0);
+  }
+
+  /**
+   * @brief Times group lookups around central blocks spread over the whole map, through the reference loop and the
+   * layout
+   */
+  void runBenchmarks()
+  {
+    const uint32_t calls = 200000;
+    MapDefinition definition = makeDefinition(0, 7168, 4096, 5120, 4096);
+    std::map<uint32_t, MapDefinition> definitionsByNumber;
+    definitionsByNumber[0] = definition;
+    int32_t height = definition.mapHeightInTiles >> 3;
+    int32_t numberOfBlocks = (definition.mapWidthInTiles >> 3) * height;
+
+    printf("Block group lookups on a 7168x4096 map, %u calls\n", calls);
+
+    std::vector<int32_t> blocks;
+
+    for (size_t r = 0; r < sizeof(g_viewRanges) / sizeof(g_viewRanges[0]) - 1; r++)
+    {
+      const ViewRange& rRange = g_viewRanges[r];
+      BlockGroupLayout layout;
+      layout.reset(definition, rRange.minBlockX, rRange.maxBlockX, rRange.minBlockY, rRange.maxBlockY);
+
+      int64_t sink = 0;
+      Stopwatch stopwatch;
+
+      for (uint32_t i = 0; i < calls; i++)
+      {
+        referenceGroupOfBlockNumbers(definitionsByNumber, 0, (i * 7919) % numberOfBlocks, rRange, blocks);
+        sink += blocks[i % blocks.size()];
+      }
+
+      double referenceSeconds = stopwatch.getSeconds();
+      stopwatch.restart();
+
+      for (uint32_t i = 0; i < calls; i++)
+      {
+        layout.getBlockNumbers((i * 7919) % numberOfBlocks, blocks);
+        sink += blocks[i % blocks.size()];
+      }
+
+      double layoutSeconds = stopwatch.getSeconds();
+      int32_t size = rRange.maxBlockX - rRange.minBlockX + 1;
+      printf("  %2ix%-2i  wrap loop %8.1f ns/call   layout %8.1f ns/call   %5.1fx (%x)\n", size, size,
+        referenceSeconds * 1e9 / calls, layoutSeconds * 1e9 / calls, referenceSeconds / layoutSeconds, static_cast<unsigned int>(sink & 0xF));
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  checkLayout();
+
+  int result = reportResults();
+
+  if (benchmarksRequested(argc, argv))
+  {
+    runBenchmarks();
+  }
+
+  return result;
+}
@@ -0,0 +1,445 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks of the BlockHashTree against a reference built bottom up from the block CRC32s, and a simulation of the
+ * region hash query (0xFC) that measures the bytes a view range check costs compared to the per-block query32
+ * (0xFD). The server side of the simulation follows RegionHash.cs: it asks for the nodes covering the view range and
+ * only descends into children whose hashes differ and that overlap the range. Returns non-zero if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "BlockCrc32Source.h"
+#include "BlockHashTree.h"
+#include "Crc32.h"
+
+#include "TestSupport.h"
+
+namespace
+{
+  /**
+   * @class TableCrc32Source
+   *
+   * @brief Block CRC32s from a table, counting lookups so the node cache can be checked
+   */
+  class TableCrc32Source : public BlockCrc32Source
+  {
+    public:
+      TableCrc32Source(uint32_t numberOfBlocks, uint32_t seed)
+        : m_crcs(numberOfBlocks, 0),
+        m_numberOfLookups(0)
+      {
+        std::mt19937 random(seed);
+
+        for (size_t i = 0; i < m_crcs.size(); i++)
+        {
+          m_crcs[i] = random();
+        }
+      }
+
+      uint32_t getCrc32(MapBlockReader*, uint8_t, uint32_t blockNumber)
+      {
+        m_numberOfLookups++;
+        return (blockNumber < m_crcs.size()) ? m_crcs[blockNumber] : 0;
+      }
+
+      std::vector<uint32_t> m_crcs; //!< CRC32 of every block in column order
+      uint32_t m_numberOfLookups;   //!< Number of getCrc32 calls
+  };
+
+  /**
+   * @struct ReferenceLevel
+   *
+   * @brief One level of the reference tree
+   */
+  struct ReferenceLevel
+  {
+    uint32_t width;                //!< Nodes across the map width
+    uint32_t height;               //!< Nodes across the map height
+    std::vector<uint32_t> hashes;  //!< Node hashes in column order
+  };
+
+  /**
+   * @brief Hashes every level of the tree bottom up, independently of the on demand recursion in BlockHashTree
+   *
+   * @param rCrcs Block CRC32s in column order
+   * @param widthInBlocks Map width in blocks
+   * @param heightInBlocks Map height in blocks
+   *
+   * @return Levels 0 (the blocks) up to the single root node
+   */
+
+  std::vector<ReferenceLevel> buildReferenceLevels(const std::vector<uint32_t>& rCrcs, uint32_t widthInBlocks, uint32_t heightInBlocks)
+  {
+    std::vector<ReferenceLevel> levels(1);
+    levels[0].width = widthInBlocks;
+    levels[0].height = heightInBlocks;
+    levels[0].hashes = rCrcs;
+
+    while (levels.size() == 1 || levels.back().width > 1 || levels.back().height > 1)
+    {
+      const ReferenceLevel& rBelow = levels.back();
+      ReferenceLevel level;
+      level.width = (rBelow.width + 1) / 2;
+      level.height = (rBelow.height + 1) / 2;
+
+      for (uint32_t x = 0; x < level.width; x++)
+      {
+        for (uint32_t y = 0; y < level.height; y++)
+        {
+          uint8_t childHashes[16];
+
+          for (uint32_t i = 0; i < 4; i++)
+          {
+            uint32_t childX = (x * 2) + (i >> 1);
+            uint32_t childY = (y * 2) + (i & 1);
+            uint32_t childHash = (childX < rBelow.width && childY < rBelow.height) ? rBelow.hashes[(childX * rBelow.height) + childY] : 0;
+            childHashes[(i * 4) + 0] = static_cast<uint8_t>(childHash >> 24);
+            childHashes[(i * 4) + 1] = static_cast<uint8_t>(childHash >> 16);
+            childHashes[(i * 4) + 2] = static_cast<uint8_t>(childHash >> 8);
+            childHashes[(i * 4) + 3] = static_cast<uint8_t>(childHash);
+          }
+
+          level.hashes.push_back(Crc32::calculate(childHashes, sizeof(childHashes)));
+        }
+      }
+
+      levels.push_back(level);
+    }
+
+    return levels;
+  }
+
+  /**
+   * @brief Compares the child hashes of every node in the tree with the reference
+   *
+   * @param rTree Tree under test
+   * @param rSource Source the tree was built over
+   * @param widthInBlocks Map width in blocks
+   * @param heightInBlocks Map height in blocks
+   * @param pName Name of the check
+   */
+  void compareWithReference(BlockHashTree& rTree, TableCrc32Source& rSource, uint32_t widthInBlocks, uint32_t heightInBlocks, const char* pName)
+  {
+    std::vector<ReferenceLevel> reference = buildReferenceLevels(rSource.m_crcs, widthInBlocks, heightInBlocks);
+    check(rTree.getNumberOfLevels() == reference.size() - 1, "number of levels", widthInBlocks);
+
+    uint32_t numberOfMismatches = 0;
+
+    for (uint8_t level = 1; level < reference.size(); level++)
+    {
+      const ReferenceLevel& rLevel = reference[level];
+      const ReferenceLevel& rBelow = reference[level - 1];
+
+      for (uint32_t x = 0; x < rLevel.width; x++)
+      {
+        for (uint32_t y = 0; y < rLevel.height; y++)
+        {
+          uint32_t hashes[4];
+          bool valid = rTree.getChildHashes(NULL, 0, level, x, y, hashes);
+
+          for (uint32_t i = 0; i < 4; i++)
+          {
+            uint32_t childX = (x * 2) + (i >> 1);
+            uint32_t childY = (y * 2) + (i & 1);
+            uint32_t expected = (childX < rBelow.width && childY < rBelow.height) ? rBelow.hashes[(childX * rBelow.height) + childY] : 0;
+
+            if (!valid || hashes[i] != expected)
+            {
+              numberOfMismatches++;
+            }
+          }
+        }
+      }
+    }
+
+    check(numberOfMismatches == 0, pName, widthInBlocks * heightInBlocks);
+  }
+
+  /**
+   * @brief Checks the node hashes of several map shapes, including odd sizes whose edge nodes have children outside
+   * the map, and requests for nodes that are not part of the tree
+   */
+  void checkNodeHashes()
+  {
+    const uint32_t shapes[][2] = { { 1, 1 }, { 2, 1 }, { 5, 3 }, { 7, 9 }, { 100, 37 }, { 144, 256 }, { 896, 512 } };
+
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++)
+    {
+      uint32_t width = shapes[s][0];
+      uint32_t height = shapes[s][1];
+      TableCrc32Source source(width * height, static_cast<uint32_t>(s) + 1);
+      BlockHashTree tree(&source);
+      tree.reset(width, height);
+      compareWithReference(tree, source, width, height, "node hashes");
+
+      uint32_t hashes[4] = { 1, 1, 1, 1 };
+      uint8_t root = tree.getNumberOfLevels();
+      check(!tree.getChildHashes(NULL, 0, 0, 0, 0, hashes) && hashes[0] == 0 && hashes[3] == 0, "level 0 is not a node", width);
+      check(!tree.getChildHashes(NULL, 0, root + 1, 0, 0, hashes), "level above the root", width);
+      check(!tree.getChildHashes(NULL, 0, root, 1, 0, hashes), "node x outside the map", width);
+      check(!tree.getChildHashes(NULL, 0, 1, 0, (height + 1) / 2, hashes), "node y outside the map", width);
+    }
+  }
+
+  /**
+   * @brief Checks that node hashes are cached, and that invalidating a changed block rehashes exactly the nodes
+   * above it
+   */
+  void checkInvalidation()
+  {
+    const uint32_t width = 144;
+    const uint32_t height = 256;
+    TableCrc32Source source(width * height, 42);
+    BlockHashTree tree(&source);
+    tree.reset(width, height);
+
+    uint32_t hashes[4];
+    tree.getChildHashes(NULL, 0, tree.getNumberOfLevels(), 0, 0, hashes);
+    check(source.m_numberOfLookups == width * height, "first root query hashes every block once", source.m_numberOfLookups);
+
+    source.m_numberOfLookups = 0;
+    tree.getChildHashes(NULL, 0, tree.getNumberOfLevels(), 0, 0, hashes);
+    check(source.m_numberOfLookups == 0, "second root query is cached", source.m_numberOfLookups);
+
+    std::mt19937 random(7);
+
+    for (uint32_t round = 0; round < 20; round++)
+    {
+      uint32_t blockNumber = random() % (width * height);
+      source.m_crcs[blockNumber] ^= 0x10000 | round;
+      tree.invalidateBlock(blockNumber);
+
+      source.m_numberOfLookups = 0;
+      tree.getChildHashes(NULL, 0, tree.getNumberOfLevels(), 0, 0, hashes);
+      check(source.m_numberOfLookups == 4, "invalidation rehashes one path", source.m_numberOfLookups);
+    }
+
+    tree.invalidateBlock(width * height);
+    compareWithReference(tree, source, width, height, "node hashes after invalidation");
+  }
+
+  /**
+   * @struct Window
+   *
+   * @brief View range around the player, in blocks, inclusive
+   */
+  struct Window
+  {
+    uint32_t minX; //!< First block column
+    uint32_t maxX; //!< Last block column
+    uint32_t minY; //!< First block row
+    uint32_t maxY; //!< Last block row
+  };
+
+  /**
+   * @brief Checks whether a node overlaps the view range
+   *
+   * @param rWindow View range
+   * @param level Level of the node
+   * @param nodeX Node x at that level
+   * @param nodeY Node y at that level
+   *
+   * @return true if at least one block below the node is in the view range
+   */
+  bool nodeIntersectsWindow(const Window& rWindow, uint8_t level, uint32_t nodeX, uint32_t nodeY)
+  {
+    return (nodeX << level) <= rWindow.maxX && (((nodeX + 1) << level) - 1) >= rWindow.minX
+      && (nodeY << level) <= rWindow.maxY && (((nodeY + 1) << level) - 1) >= rWindow.minY;
+  }
+
+  /**
+   * @brief Runs the server side of one region hash check: query the nodes covering the view range, then requery the
+   * differing children level by level down to the blocks
+   *
+   * @param rClientTree Tree of the client, answering the queries
+   * @param rServerTree Tree of the server
+   * @param rWindow View range
+   * @param viewRange Width of the view range in blocks
+   * @param heightInBlocks Map height in blocks
+   * @param rDifferingBlocksOut Receives the blocks the server would resend
+   * @param rRoundTripsOut Receives the number of queries sent
+   *
+   * @return Bytes sent in both directions
+   */
+  uint32_t runRegionHashCheck(BlockHashTree& rClientTree, BlockHashTree& rServerTree, const Window& rWindow, uint32_t viewRange,
+    uint32_t heightInBlocks, std::vector<uint32_t>& rDifferingBlocksOut, uint32_t& rRoundTripsOut)
+  {
+    //covering level as picked by RegionHash.GetCoveringLevel
+    uint8_t level = 1;
+    while ((2u << level) < viewRange)
+    {
+      level++;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t> > nodes;
+
+    for (uint32_t x = rWindow.minX >> level; x <= rWindow.maxX >> level; x++)
+    {
+      for (uint32_t y = rWindow.minY >> level; y <= rWindow.maxY >> level; y++)
+      {
+        nodes.push_back(std::make_pair(x, y));
+      }
+    }
+
+    uint32_t bytes = 0;
+    rRoundTripsOut = 0;
+
+    while (!nodes.empty())
+    {
+      bytes += 17 + (5 * static_cast<uint32_t>(nodes.size()));  //0xFC query
+      bytes += 17 + (21 * static_cast<uint32_t>(nodes.size())); //0xFC response
+      rRoundTripsOut++;
+
+      std::vector<std::pair<uint32_t, uint32_t> > nextNodes;
+
+      for (size_t n = 0; n < nodes.size(); n++)
+      {
+        uint32_t clientHashes[4];
+        uint32_t serverHashes[4];
+        rClientTree.getChildHashes(NULL, 0, level, nodes[n].first, nodes[n].second, clientHashes);
+        rServerTree.getChildHashes(NULL, 0, level, nodes[n].first, nodes[n].second, serverHashes);
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+          uint32_t childX = (nodes[n].first << 1) + (i >> 1);
+          uint32_t childY = (nodes[n].second << 1) + (i & 1);
+
+          if (clientHashes[i] != serverHashes[i] && nodeIntersectsWindow(rWindow, level - 1, childX, childY))
+          {
+            if (level == 1)
+            {
+              rDifferingBlocksOut.push_back((childX * heightInBlocks) + childY);
+            }
+            else
+            {
+              nextNodes.push_back(std::make_pair(childX, childY));
+            }
+          }
+        }
+      }
+
+      nodes.swap(nextNodes);
+      level--;
+    }
+
+    return bytes;
+  }
+
+  /**
+   * @brief Simulates region hash checks at random positions on an 896x512 block map with a few blocks changed on the
+   * server, checks that exactly the changed blocks are found and prints the bytes per check against the query32
+   */
+  void runSimulation()
+  {
+    const uint32_t width = 896;
+    const uint32_t height = 512;
+    const uint32_t viewRanges[] = { 5, 13, 25, 37 };
+    const uint32_t changedCounts[] = { 0, 1, 4, 16 };
+    const uint32_t numberOfPositions = 200;
+
+    TableCrc32Source clientSource(width * height, 1234);
+    TableCrc32Source serverSource(width * height, 1234);
+    BlockHashTree clientTree(&clientSource);
+    BlockHashTree serverTree(&serverSource);
+    clientTree.reset(width, height);
+    serverTree.reset(width, height);
+
+    printf("Region hash query, bytes per view range check (query and response) relative to query32, %u positions\n", numberOfPositions);
+    printf("  view   query32   changed:    0        1        4       16    round trips at 16\n");
+
+    std::mt19937 random(99);
+
+    for (size_t v = 0; v < sizeof(viewRanges) / sizeof(viewRanges[0]); v++)
+    {
+      uint32_t viewRange = viewRanges[v];
+      uint32_t query32Bytes = 15 + 15 + (4 * viewRange * viewRange);
+      printf("  %2ux%-2u %6u B          ", viewRange, viewRange, query32Bytes);
+
+      uint32_t roundTrips = 0;
+
+      for (size_t c = 0; c < sizeof(changedCounts) / sizeof(changedCounts[0]); c++)
+      {
+        uint64_t totalBytes = 0;
+        roundTrips = 0;
+
+        for (uint32_t p = 0; p < numberOfPositions; p++)
+        {
+          Window window;
+          window.minX = random() % (width - viewRange + 1);
+          window.minY = random() % (height - viewRange + 1);
+          window.maxX = window.minX + viewRange - 1;
+          window.maxY = window.minY + viewRange - 1;
+
+          std::vector<uint32_t> changedBlocks;
+
+          while (changedBlocks.size() < changedCounts[c])
+          {
+            uint32_t blockNumber = ((window.minX + (random() % viewRange)) * height) + window.minY + (random() % viewRange);
+
+            if (std::find(changedBlocks.begin(), changedBlocks.end(), blockNumber) == changedBlocks.end())
+            {
+              changedBlocks.push_back(blockNumber);
+              serverSource.m_crcs[blockNumber] ^= 0x5A5A5A5A;
+              serverTree.invalidateBlock(blockNumber);
+            }
+          }
+
+          std::vector<uint32_t> differingBlocks;
+          uint32_t positionRoundTrips = 0;
+          totalBytes += runRegionHashCheck(clientTree, serverTree, window, viewRange, height, differingBlocks, positionRoundTrips);
+          roundTrips = std::max(roundTrips, positionRoundTrips);
+
+          std::sort(changedBlocks.begin(), changedBlocks.end());
+          std::sort(differingBlocks.begin(), differingBlocks.end());
+          check(differingBlocks == changedBlocks, "region hash check finds exactly the changed blocks", viewRange);
+
+          for (size_t i = 0; i < changedBlocks.size(); i++)
+          {
+            serverSource.m_crcs[changedBlocks[i]] ^= 0x5A5A5A5A;
+            serverTree.invalidateBlock(changedBlocks[i]);
+          }
+        }
+
+        printf(" %6.0f%%", 100.0 * totalBytes / numberOfPositions / query32Bytes);
+      }
+
+      printf("    %u\n", roundTrips);
+    }
+  }
+}
+
+int main()
+{
+  checkNodeHashes();
+  checkInvalidation();
+  runSimulation();
+
+  return reportResults();
+}
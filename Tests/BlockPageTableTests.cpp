@@ -0,0 +1,425 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks of BlockPageTable and FinishedHashCache against the dense per-block cache they replaced, then a comparison
+ * of memory use and lookup latency of both on a Felucca sized map and a 16384x16384 custom map. Returns non-zero if
+ * any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "BlockPageTable.h"
+#include "FinishedHashCache.h"
+
+#include "TestSupport.h"
+
+namespace
+{
+  /**
+   * @class DenseHashCache
+   *
+   * @brief The finished hash cache as it was before paging: a hash and two bits for every block of the map
+   */
+  template <typename HashType>
+  class DenseHashCache
+  {
+    public:
+      DenseHashCache()
+        : m_hashes(),
+        m_validBits(),
+        m_staleBits(),
+        m_statistics()
+      {
+        //do nothing
+      }
+
+      void allocate(uint32_t numberOfBlocks)
+      {
+        m_hashes.assign(numberOfBlocks, 0);
+        m_validBits.assign((numberOfBlocks + 31) / 32, 0);
+        m_staleBits.assign((numberOfBlocks + 31) / 32, 0);
+        m_statistics.hits = 0;
+        m_statistics.misses = 0;
+        m_statistics.rehashes = 0;
+      }
+
+      bool isValid(uint32_t blockNumber) const
+      {
+        return blockNumber < m_hashes.size() && testBit(m_validBits, blockNumber);
+      }
+
+      bool lookup(uint32_t blockNumber, HashType& rHashOut)
+      {
+        if (blockNumber >= m_hashes.size())
+        {
+          return false;
+        }
+
+        if (testBit(m_validBits, blockNumber))
+        {
+          m_statistics.hits++;
+          rHashOut = m_hashes[blockNumber];
+          return true;
+        }
+
+        if (testBit(m_staleBits, blockNumber))
+        {
+          m_statistics.rehashes++;
+        }
+        else
+        {
+          m_statistics.misses++;
+        }
+
+        return false;
+      }
+
+      void store(uint32_t blockNumber, HashType hash)
+      {
+        if (blockNumber < m_hashes.size())
+        {
+          m_hashes[blockNumber] = hash;
+          setBit(m_validBits, blockNumber, true);
+          setBit(m_staleBits, blockNumber, false);
+        }
+      }
+
+      void invalidate(uint32_t blockNumber)
+      {
+        if (blockNumber < m_hashes.size() && testBit(m_validBits, blockNumber))
+        {
+          setBit(m_validBits, blockNumber, false);
+          setBit(m_staleBits, blockNumber, true);
+        }
+      }
+
+      const HashCacheStatistics& getStatistics() const
+      {
+        return m_statistics;
+      }
+
+      size_t getMemoryUsage() const
+      {
+        return (m_hashes.capacity() * sizeof(HashType)) + ((m_validBits.capacity() + m_staleBits.capacity()) * sizeof(uint32_t));
+      }
+
+    private:
+      static bool testBit(const std::vector<uint32_t>& rBits, uint32_t blockNumber)
+      {
+        return (rBits[blockNumber >> 5] & (1u << (blockNumber & 31))) != 0;
+      }
+
+      static void setBit(std::vector<uint32_t>& rBits, uint32_t blockNumber, bool value)
+      {
+        if (value)
+        {
+          rBits[blockNumber >> 5] |= (1u << (blockNumber & 31));
+        }
+        else
+        {
+          rBits[blockNumber >> 5] &= ~(1u << (blockNumber & 31));
+        }
+      }
+
+      std::vector<HashType> m_hashes;    //!< Finished hash per block
+      std::vector<uint32_t> m_validBits; //!< Set for blocks whose hash is valid
+      std::vector<uint32_t> m_staleBits; //!< Set for blocks whose valid hash was invalidated since
+      HashCacheStatistics m_statistics;  //!< Lookup counters since the cache was allocated
+  };
+
+  /**
+   * @struct TestPage
+   *
+   * @brief Page type for the BlockPageTable checks
+   */
+  struct TestPage
+  {
+    uint32_t values[BlockPage::SIZE]; //!< Value per block
+  };
+
+  /**
+   * @brief Checks page allocation, lookup and memory accounting of a BlockPageTable, including a last page that is
+   * only partly covered
+   */
+  void checkPageTable()
+  {
+    const uint32_t numberOfBlocks = (5 * BlockPage::SIZE) + 17;
+    BlockPageTable<TestPage> table;
+    check(table.size() == 0 && table.findPage(0) == NULL && table.getMemoryUsage() == 0, "empty table", 0);
+
+    table.reset(numberOfBlocks);
+    size_t directorySize = table.getMemoryUsage();
+    check(table.size() == numberOfBlocks && directorySize == 6 * sizeof(TestPage*), "directory covers the map", numberOfBlocks);
+
+    for (uint32_t blockNumber = 0; blockNumber < numberOfBlocks; blockNumber += 97)
+    {
+      check(table.findPage(blockNumber) == NULL, "pages start unallocated", blockNumber);
+    }
+
+    TestPage& rLastPage = table.getPage(numberOfBlocks - 1);
+    check(&rLastPage == table.findPage(5 * BlockPage::SIZE) && table.findPage((5 * BlockPage::SIZE) - 1) == NULL, "page covers its blocks only", numberOfBlocks - 1);
+    check(table.getMemoryUsage() == directorySize + sizeof(TestPage), "memory of one page", 1);
+
+    bool zeroFilled = true;
+    for (uint32_t i = 0; i < BlockPage::SIZE; i++)
+    {
+      zeroFilled = zeroFilled && rLastPage.values[i] == 0;
+    }
+    check(zeroFilled, "pages are zero filled", numberOfBlocks - 1);
+
+    for (uint32_t blockNumber = 0; blockNumber < numberOfBlocks; blockNumber++)
+    {
+      table.getPage(blockNumber).values[BlockPageTable<TestPage>::getIndexInPage(blockNumber)] = blockNumber ^ 0xA5A5A5A5;
+    }
+
+    uint32_t numberOfMismatches = 0;
+    for (uint32_t blockNumber = 0; blockNumber < numberOfBlocks; blockNumber++)
+    {
+      const TestPage* pPage = table.findPage(blockNumber);
+
+      if (pPage == NULL || pPage->values[BlockPageTable<TestPage>::getIndexInPage(blockNumber)] != (blockNumber ^ 0xA5A5A5A5))
+      {
+        numberOfMismatches++;
+      }
+    }
+
+    check(numberOfMismatches == 0, "values round trip through the pages", numberOfBlocks);
+    check(table.getMemoryUsage() == directorySize + (6 * sizeof(TestPage)), "memory of every page", 6);
+    check(table.findPage(numberOfBlocks) == NULL, "block past the end", numberOfBlocks);
+
+    table.release();
+    check(table.size() == 0 && table.findPage(0) == NULL && table.getMemoryUsage() == 0, "released table", 0);
+
+    table.reset(numberOfBlocks);
+    check(table.findPage(0) == NULL && table.getMemoryUsage() == directorySize, "reset drops the pages", numberOfBlocks);
+  }
+
+  /**
+   * @brief Runs the same random stores, invalidations and lookups on the paged and the dense cache and compares
+   * every result, the valid bits and the counters. Hashes include 0 and all ones, which must be cacheable.
+   *
+   * @param pName Name of the hash width
+   */
+  template <typename HashType>
+  void checkFinishedHashCache(const char* pName)
+  {
+    const uint32_t numberOfBlocks = (40 * BlockPage::SIZE) + 333;
+    FinishedHashCache<HashType> paged;
+    DenseHashCache<HashType> dense;
+
+    HashType hash = 0;
+    check(!paged.isAllocated() && !paged.lookup(0, hash) && paged.getMemoryUsage() == 0, pName, 0);
+
+    paged.allocate(numberOfBlocks);
+    dense.allocate(numberOfBlocks);
+    check(paged.isAllocated(), pName, numberOfBlocks);
+
+    std::mt19937 random(numberOfBlocks + sizeof(HashType));
+    uint32_t numberOfMismatches = 0;
+
+    for (uint32_t i = 0; i < 200000; i++)
+    {
+      //keep to a few pages so stores, invalidations and lookups hit the same blocks
+      uint32_t blockNumber = ((random() % 6) * 7 * BlockPage::SIZE) + (random() % (BlockPage::SIZE + 64));
+      uint32_t operation = random() % 4;
+
+      if (operation == 0)
+      {
+        uint64_t value = (static_cast<uint64_t>(random()) << 32) | random();
+
+        if (random() % 3 == 0)
+        {
+          value = (random() & 1) ? ~0ull : 0;
+        }
+
+        paged.store(blockNumber, static_cast<HashType>(value));
+        dense.store(blockNumber, static_cast<HashType>(value));
+      }
+      else if (operation == 1)
+      {
+        paged.invalidate(blockNumber);
+        dense.invalidate(blockNumber);
+      }
+      else
+      {
+        HashType pagedHash = 0;
+        HashType denseHash = 0;
+        bool pagedHit = paged.lookup(blockNumber, pagedHash);
+        bool denseHit = dense.lookup(blockNumber, denseHash);
+
+        if (pagedHit != denseHit || pagedHash != denseHash)
+        {
+          numberOfMismatches++;
+        }
+      }
+
+      if (paged.isValid(blockNumber) != dense.isValid(blockNumber))
+      {
+        numberOfMismatches++;
+      }
+    }
+
+    check(numberOfMismatches == 0, pName, numberOfBlocks);
+    check(paged.getStatistics().hits == dense.getStatistics().hits && paged.getStatistics().misses == dense.getStatistics().misses
+      && paged.getStatistics().rehashes == dense.getStatistics().rehashes, "counters match", paged.getStatistics().hits);
+    check(paged.getStatistics().rehashes > 0 && paged.getStatistics().misses > 0, "every counter exercised", paged.getStatistics().rehashes);
+
+    uint32_t numberOfUnusedPages = 0;
+    for (uint32_t blockNumber = 0; blockNumber < numberOfBlocks; blockNumber += BlockPage::SIZE)
+    {
+      if (blockNumber % (7 * BlockPage::SIZE) > BlockPage::SIZE && paged.isPageAllocated(blockNumber))
+      {
+        numberOfUnusedPages++;
+      }
+    }
+    check(numberOfUnusedPages == 0, "only touched pages are allocated", numberOfUnusedPages);
+
+    paged.invalidate(numberOfBlocks + 5);
+    paged.store(numberOfBlocks + 5, 1);
+    check(!paged.lookup(numberOfBlocks + 5, hash) && !paged.isValid(numberOfBlocks + 5), "block past the end", numberOfBlocks + 5);
+
+    paged.allocate(numberOfBlocks);
+    check(paged.getStatistics().hits == 0 && !paged.isValid(0) && !paged.isPageAllocated(0), "allocate clears the cache", 0);
+
+    paged.release();
+    check(!paged.isAllocated() && paged.getMemoryUsage() == 0, "released cache", 0);
+  }
+
+  /**
+   * @brief Lists the blocks a player sees on a random walk, with the view window stored at every step
+   *
+   * @param widthInBlocks Map width in blocks
+   * @param heightInBlocks Map height in blocks
+   * @param rBlocksOut Receives the block numbers seen, in the order they were seen, with repeats
+   */
+  void walk(uint32_t widthInBlocks, uint32_t heightInBlocks, std::vector<uint32_t>& rBlocksOut)
+  {
+    const int32_t steps = 300;
+    const int32_t range = 18;
+    std::mt19937 random(widthInBlocks);
+
+    int32_t x = widthInBlocks / 3;
+    int32_t y = heightInBlocks / 3;
+
+    for (int32_t step = 0; step < steps; step++)
+    {
+      x = std::min(std::max(x + static_cast<int32_t>(random() % 3) - 1, range), static_cast<int32_t>(widthInBlocks) - range - 1);
+      y = std::min(std::max(y + static_cast<int32_t>(random() % 3) - 1, range), static_cast<int32_t>(heightInBlocks) - range - 1);
+
+      for (int32_t windowX = x - range; windowX <= x + range; windowX++)
+      {
+        for (int32_t windowY = y - range; windowY <= y + range; windowY++)
+        {
+          rBlocksOut.push_back((windowX * heightInBlocks) + windowY);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Times lookups of the blocks seen on a walk through one cache
+   *
+   * @param rCache Cache holding the blocks
+   * @param rBlocks Blocks seen on the walk
+   * @param lookups Number of lookups
+   * @param rSink Receives a value depending on every lookup
+   *
+   * @return Nanoseconds per lookup
+   */
+  template <typename CacheType>
+  double timeLookups(CacheType& rCache, const std::vector<uint32_t>& rBlocks, uint32_t lookups, uint32_t& rSink)
+  {
+    Stopwatch stopwatch;
+
+    for (uint32_t i = 0; i < lookups; i++)
+    {
+      uint32_t hash = 0;
+      rCache.lookup(rBlocks[(i * 7919u) % rBlocks.size()], hash);
+      rSink += hash;
+    }
+
+    return stopwatch.getSeconds() * 1e9 / lookups;
+  }
+
+  /**
+   * @brief Compares memory use and lookup latency of the dense and the paged CRC32 cache after a 300 step walk with
+   * a 37x37 window
+   */
+  void runBenchmarks()
+  {
+    const uint32_t maps[][2] = { { 7168, 4096 }, { 16384, 16384 } };
+    const uint32_t lookups = 4000000;
+
+    printf("CRC32 cache after a 300 step walk with a 37x37 window, %u lookups of seen blocks\n", lookups);
+
+    for (size_t m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+    {
+      uint32_t widthInBlocks = maps[m][0] >> 3;
+      uint32_t heightInBlocks = maps[m][1] >> 3;
+      std::vector<uint32_t> blocks;
+      walk(widthInBlocks, heightInBlocks, blocks);
+
+      FinishedHashCache<uint32_t> paged;
+      DenseHashCache<uint32_t> dense;
+      paged.allocate(widthInBlocks * heightInBlocks);
+      dense.allocate(widthInBlocks * heightInBlocks);
+
+      for (size_t i = 0; i < blocks.size(); i++)
+      {
+        paged.store(blocks[i], blocks[i] * 2654435761u);
+        dense.store(blocks[i], blocks[i] * 2654435761u);
+      }
+
+      uint32_t sink = 0;
+      double denseNanoseconds = timeLookups(dense, blocks, lookups, sink);
+      double pagedNanoseconds = timeLookups(paged, blocks, lookups, sink);
+
+      printf("  %5ux%-5u  dense %6u KB %5.2f ns/lookup   paged %6u KB %5.2f ns/lookup (%x)\n", maps[m][0], maps[m][1],
+        static_cast<unsigned int>(dense.getMemoryUsage() / 1024), denseNanoseconds,
+        static_cast<unsigned int>(paged.getMemoryUsage() / 1024), pagedNanoseconds, sink & 0xF);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  checkPageTable();
+  checkFinishedHashCache<uint16_t>("Fletcher-16 cache matches the dense cache");
+  checkFinishedHashCache<uint32_t>("CRC32 cache matches the dense cache");
+  checkFinishedHashCache<uint64_t>("XXH64 cache matches the dense cache");
+
+  int result = reportResults();
+
+  if (benchmarksRequested(argc, argv))
+  {
+    runBenchmarks();
+  }
+
+  return result;
+}
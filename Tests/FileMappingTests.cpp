@@ -0,0 +1,248 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks of FileMapping on generated files: copy-on-write views hold the same bytes as reading the file through a
+ * stream, writes to a view never reach the file, and views past the end of a file or of missing files are refused.
+ * Then timings of loading Felucca sized map files the way LoadMap did before the mapped mode, with a stream read into
+ * a committed pool, against mapping a view. Returns non-zero if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FileMapping.h"
+
+#include "TestSupport.h"
+
+namespace
+{
+  const char* const TEST_FILENAME = "FileMappingTests.mul"; //!< Generated file
+
+  /**
+   * @brief Writes a file of random bytes
+   *
+   * @param size Size of the file in bytes
+   * @param seed Seed of the bytes
+   */
+  void writeFile(uint32_t size, uint32_t seed)
+  {
+    std::mt19937 random(seed);
+    std::vector<uint8_t> data(size);
+    for (uint32_t i = 0; i < size; i++)
+    {
+      data[i] = static_cast<uint8_t>(random());
+    }
+
+    std::ofstream file(TEST_FILENAME, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (size > 0)
+    {
+      file.write(reinterpret_cast<const char*>(&data[0]), size);
+    }
+  }
+
+  /**
+   * @brief Reads a whole file into a pool the way LoadMap did before the mapped mode
+   *
+   * @param pPool Pool of at least the size of the file
+   *
+   * @return Number of bytes read
+   */
+  uint32_t streamRead(uint8_t* pPool)
+  {
+    std::ifstream mapFile;
+    mapFile.open(TEST_FILENAME, std::ios::binary | std::ios::in);
+    std::streamoff length = 0;
+
+    if (mapFile.is_open())
+    {
+      mapFile.seekg(0, mapFile.end);
+      length = mapFile.tellg();
+      if (length > 0)
+      {
+        mapFile.seekg(0, mapFile.beg);
+        mapFile.read(reinterpret_cast<char*>(pPool), length);
+      }
+
+      mapFile.close();
+    }
+
+    return static_cast<uint32_t>(length);
+  }
+
+  /**
+   * @brief Checks views of files around the page and allocation granularities against stream reads, that writes
+   * to a view stay private, and that views the file cannot back are refused
+   */
+  void checkViews()
+  {
+    const uint32_t sizes[] = { 1, 4095, 4096, 4097, 65536 + 7, (1024 * 1024) + 123, 5505024 };
+
+    uint32_t granularity = FileMapping::getGranularity();
+    check(granularity >= 4096 && (granularity & (granularity - 1)) == 0, "granularity is a power of two", granularity);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+      uint32_t size = sizes[s];
+      writeFile(size, static_cast<uint32_t>(s));
+
+      std::vector<uint8_t> expected(size);
+      check(streamRead(&expected[0]) == size, "stream reads the whole file", size);
+
+      FileMapping mapping;
+      check(mapping.open(TEST_FILENAME) && mapping.isOpen() && mapping.getFileSize() == size, "file opens", size);
+
+      uint8_t* pView = mapping.mapView(size);
+      check(pView != NULL && memcmp(pView, &expected[0], size) == 0, "view matches the stream read", size);
+      check(mapping.mapView(size + 1) == NULL && mapping.mapView(0) == NULL, "view the file cannot back is refused", size);
+
+      if (pView == NULL)
+      {
+        continue;
+      }
+
+      //writes go to private copies of the pages, neither the file nor a second view sees them
+      std::vector<uint8_t> written(expected);
+      written[0] ^= 0xFF;
+      written[size - 1] ^= 0x5A;
+      pView[0] ^= 0xFF;
+      pView[size - 1] ^= 0x5A;
+
+      uint8_t* pSecondView = mapping.mapView(size);
+      std::vector<uint8_t> reread(size);
+      streamRead(&reread[0]);
+      check(reread == expected && pSecondView != NULL && memcmp(pSecondView, &expected[0], size) == 0, "writes stay private", size);
+
+      FileMapping::unmapView(pSecondView, size);
+
+      //views stay valid after the file is closed
+      mapping.close();
+      check(!mapping.isOpen() && mapping.getFileSize() == 0 && memcmp(pView, &written[0], size) == 0, "view outlives the file", size);
+      FileMapping::unmapView(pView, size);
+    }
+
+    writeFile(0, 0);
+    FileMapping emptyMapping;
+    check(emptyMapping.open(TEST_FILENAME) && emptyMapping.getFileSize() == 0 && emptyMapping.mapView(1) == NULL, "empty file", 0);
+    emptyMapping.close();
+
+    remove(TEST_FILENAME);
+
+    FileMapping missingMapping;
+    check(!missingMapping.open("missing.mul") && !missingMapping.isOpen() && missingMapping.mapView(1) == NULL, "missing file", 0);
+  }
+
+  /**
+   * @brief Gets the median of a set of timings
+   *
+   * @param timings Timings, reordered
+   *
+   * @return Median
+   */
+  double median(std::vector<double> timings)
+  {
+    std::sort(timings.begin(), timings.end());
+    return timings[timings.size() / 2];
+  }
+
+  /**
+   * @brief Times loading Felucca sized map, staidx and statics files through a stream read into a committed pool and
+   * through a mapped view, both alone and followed by a first read of every page. The files were just written, so
+   * they come from the page cache as they do on a map change back to a map that was loaded before.
+   */
+  void runBenchmarks()
+  {
+    struct MapFile
+    {
+      const char* pName; //!< Name of the file
+      uint32_t size;     //!< Size in bytes
+    };
+
+    const MapFile files[] = { { "map0.mul", 89915392 }, { "staidx0.mul", 5505024 }, { "statics0.mul", 37000000 } };
+    const int runs = 5;
+
+    printf("Loading map files, median of %i runs\n", runs);
+    printf("  %-13s %10s %14s %14s %16s\n", "file", "bytes", "stream read", "mapped view", "view + 1st read");
+
+    for (size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++)
+    {
+      uint32_t size = files[f].size;
+      writeFile(size, 7);
+
+      //the pool is committed and was written by the previous map
+      std::vector<uint8_t> pool(size, 0xCD);
+      std::vector<double> streamTimings;
+      std::vector<double> viewTimings;
+      std::vector<double> touchTimings;
+      uint32_t sink = 0;
+
+      for (int run = 0; run < runs; run++)
+      {
+        Stopwatch stopwatch;
+        streamRead(&pool[0]);
+        streamTimings.push_back(stopwatch.getMilliseconds());
+
+        stopwatch.restart();
+        FileMapping mapping;
+        mapping.open(TEST_FILENAME);
+        uint8_t* pView = mapping.mapView(size);
+        viewTimings.push_back(stopwatch.getMilliseconds());
+
+        for (uint32_t i = 0; i < size; i += 4096)
+        {
+          sink += pView[i];
+        }
+
+        touchTimings.push_back(stopwatch.getMilliseconds());
+
+        FileMapping::unmapView(pView, size);
+      }
+
+      printf("  %-13s %10u %11.2f ms %11.3f ms %13.2f ms (%x)\n", files[f].pName, size, median(streamTimings), median(viewTimings),
+        median(touchTimings), sink & 0xF);
+    }
+
+    remove(TEST_FILENAME);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  checkViews();
+
+  int result = reportResults();
+
+  if (benchmarksRequested(argc, argv))
+  {
+    runBenchmarks();
+  }
+
+  return result;
+}
@@ -0,0 +1,555 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Standalone checks and timings for the hashing units in UltimaLive/Hashing. Every SIMD and table-driven kernel is
+ * compared against a plain reference implementation over many lengths and alignments and against published test
+ * vectors, then timed on block-sized and large buffers. Returns non-zero if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "Crc32.h"
+#include "Crc32c.h"
+#include "Fletcher16.h"
+#include "Fletcher16Crc32.h"
+#include "HashCompare.h"
+#include "Xxh64.h"
+
+#include "TestSupport.h"
+
+namespace
+{
+  /**
+   * @brief Fills a buffer with a repeatable pattern, the same one the XXH64 vectors below were generated from
+   *
+   * @param rData Buffer to fill
+   * @param length Number of bytes
+   */
+  void fillPattern(std::vector<uint8_t>& rData, size_t length)
+  {
+    rData.resize(length);
+
+    for (size_t i = 0; i < length; i++)
+    {
+      rData[i] = static_cast<uint8_t>((i * 131) + 7);
+    }
+  }
+
+  /**
+   * @brief Bit at a time reflected CRC, the reference for both CRC32 and CRC-32C
+   *
+   * @param polynomial Reflected polynomial
+   * @param pData Pointer to the data
+   * @param length Number of bytes in the data
+   *
+   * @return CRC of the data
+   */
+  uint32_t referenceCrc(uint32_t polynomial, const uint8_t* pData, size_t length)
+  {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < length; i++)
+    {
+      crc ^= pData[i];
+
+      for (int bit = 0; bit < 8; bit++)
+      {
+        crc = (crc >> 1) ^ (polynomial & (0 - (crc & 1)));
+      }
+    }
+
+    return ~crc;
+  }
+
+  /**
+   * @brief Byte at a time Fletcher-16 reducing both sums after every byte, as the block hashes were first calculated
+   *
+   * @param pData Pointer to the data
+   * @param length Number of bytes in the data
+   *
+   * @return 16 bit checksum
+   */
+  uint16_t referenceFletcher16(const uint8_t* pData, size_t length)
+  {
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+
+    for (size_t i = 0; i < length; i++)
+    {
+      sum1 = (sum1 + pData[i]) % 255;
+      sum2 = (sum2 + sum1) % 255;
+    }
+
+    return static_cast<uint16_t>((sum2 << 8) | sum1);
+  }
+
+  /**
+   * @brief Byte at a time table CRC32, as block hashes were calculated before the slice-by-8 and PCLMUL kernels
+   *
+   * @param pData Pointer to the data
+   * @param length Number of bytes in the data
+   *
+   * @return CRC32 of the data
+   */
+  uint64_t crc32ByteTable(const uint8_t* pData, size_t length)
+  {
+    static uint32_t table[256];
+
+    if (table[1] == 0)
+    {
+      for (uint32_t i = 0; i < 256; i++)
+      {
+        uint32_t entry = i;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+          entry = (entry >> 1) ^ (0xEDB88320 & (0 - (entry & 1)));
+        }
+
+        table[i] = entry;
+      }
+    }
+
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < length; i++)
+    {
+      crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+  }
+
+  uint64_t crc32Dispatch(const uint8_t* pData, size_t length)
+  {
+    return Crc32::calculate(pData, length);
+  }
+
+  uint64_t crc32SliceBy8(const uint8_t* pData, size_t length)
+  {
+    return ~Crc32::updateSliceBy8(Crc32::INITIAL_STATE, pData, length);
+  }
+
+  uint64_t crc32Bitwise(const uint8_t* pData, size_t length)
+  {
+    return referenceCrc(0xEDB88320, pData, length);
+  }
+
+  uint64_t crc32cDispatch(const uint8_t* pData, size_t length)
+  {
+    return Crc32c::calculate(pData, length);
+  }
+
+  uint64_t crc32cSliceBy8(const uint8_t* pData, size_t length)
+  {
+    return ~Crc32c::updateSliceBy8(Crc32c::INITIAL_STATE, pData, length);
+  }
+
+  uint64_t fletcher16Dispatch(const uint8_t* pData, size_t length)
+  {
+    return Fletcher16::calculate(pData, length);
+  }
+
+  uint64_t fletcher16Scalar(const uint8_t* pData, size_t length)
+  {
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+    Fletcher16::updateScalar(sum1, sum2, pData, length);
+    return Fletcher16::finalize(sum1, sum2);
+  }
+
+  uint64_t fletcher16Reference(const uint8_t* pData, size_t length)
+  {
+    return referenceFletcher16(pData, length);
+  }
+
+  uint64_t fletcher16Crc32(const uint8_t* pData, size_t length)
+  {
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+    uint32_t crc32State = Crc32::INITIAL_STATE;
+    Fletcher16Crc32::update(sum1, sum2, crc32State, pData, length);
+    return crc32State ^ sum1 ^ (sum2 << 8);
+  }
+
+  uint64_t xxh64(const uint8_t* pData, size_t length)
+  {
+    return Xxh64::calculate(pData, length);
+  }
+
+  /**
+   * @brief Times a hash function and prints its throughput
+   *
+   * @param pName Name of the kernel
+   * @param pHash Hash function
+   * @param rData Data to hash
+   * @param length Number of bytes hashed per call
+   */
+  void benchmark(const char* pName, uint64_t (*pHash)(const uint8_t*, size_t), const std::vector<uint8_t>& rData, size_t length)
+  {
+    size_t calls = 1 + (static_cast<size_t>(64 * 1024 * 1024) / length);
+    uint64_t sink = 0;
+
+    Stopwatch stopwatch;
+
+    for (size_t i = 0; i < calls; i++)
+    {
+      sink += pHash(&rData[(i * 64) % (rData.size() - length + 1)], length);
+    }
+
+    double seconds = stopwatch.getSeconds();
+    printf("  %-24s %8u bytes: %9.1f MB/s %11.1f ns/call (%x)\n", pName, static_cast<unsigned int>(length),
+      (calls * length) / seconds / 1e6, seconds * 1e9 / calls, static_cast<unsigned int>(sink & 0xF));
+  }
+
+  /**
+   * @brief Checks the CRC32 kernels against the bitwise reference and the published check value
+   */
+  void checkCrc32()
+  {
+    const uint8_t* pCheck = reinterpret_cast<const uint8_t*>("123456789");
+    const uint8_t* pFox = reinterpret_cast<const uint8_t*>("The quick brown fox jumps over the lazy dog");
+    check(Crc32::calculate(pCheck, 9) == 0xCBF43926, "CRC32 check value", 9);
+    check(Crc32::calculate(pFox, 43) == 0x414FA339, "CRC32 fox vector", 43);
+
+    std::vector<uint8_t> data;
+    fillPattern(data, 4096 + 16);
+
+    for (size_t offset = 0; offset < 16; offset++)
+    {
+      for (size_t length = 0; length <= 1024; length += (length < 300) ? 1 : 37)
+      {
+        const uint8_t* pData = &data[offset];
+        uint32_t expected = referenceCrc(0xEDB88320, pData, length);
+        check(~Crc32::updateSliceBy8(Crc32::INITIAL_STATE, pData, length) == expected, "CRC32 slice-by-8", length);
+        check(Crc32::calculate(pData, length) == expected, "CRC32 dispatch", length);
+        check(crc32ByteTable(pData, length) == expected, "CRC32 byte table", length);
+
+        if (CpuFeatures::hasPclmul() && length >= Crc32::PCLMUL_MINIMUM_LENGTH)
+        {
+          size_t foldedLength = length & ~static_cast<size_t>(15);
+          uint32_t state = Crc32::updatePclmul(Crc32::INITIAL_STATE, pData, foldedLength);
+          state = Crc32::updateSliceBy8(state, pData + foldedLength, length - foldedLength);
+          check(~state == expected, "CRC32 PCLMUL", length);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Checks that combining the CRC32s of two buffers gives the CRC32 of both, for every split of a buffer
+   */
+  void checkCrc32Combine()
+  {
+    std::vector<uint8_t> data;
+    fillPattern(data, 600);
+
+    for (size_t split = 0; split <= data.size(); split += 7)
+    {
+      uint32_t crcA = Crc32::calculate(&data[0], split);
+      uint32_t crcB = Crc32::calculate(&data[0] + split, data.size() - split);
+      uint32_t combined = Crc32::combine(crcA, crcB, Crc32::getCombineOperator(data.size() - split));
+      check(combined == Crc32::calculate(&data[0], data.size()), "CRC32 combine", split);
+    }
+  }
+
+  /**
+   * @brief Checks the CRC-32C kernels against the bitwise reference and the published check value
+   */
+  void checkCrc32c()
+  {
+    check(Crc32c::calculate(reinterpret_cast<const uint8_t*>("123456789"), 9) == 0xE3069283, "CRC-32C check value", 9);
+
+    std::vector<uint8_t> data;
+    fillPattern(data, 1024 + 16);
+
+    for (size_t offset = 0; offset < 16; offset++)
+    {
+      for (size_t length = 0; length <= 1024; length += (length < 300) ? 1 : 37)
+      {
+        const uint8_t* pData = &data[offset];
+        uint32_t expected = referenceCrc(0x82F63B78, pData, length);
+        check(~Crc32c::updateSliceBy8(Crc32c::INITIAL_STATE, pData, length) == expected, "CRC-32C slice-by-8", length);
+        check(Crc32c::calculate(pData, length) == expected, "CRC-32C dispatch", length);
+
+        if (CpuFeatures::hasSse42())
+        {
+          check(~Crc32c::updateSse42(Crc32c::INITIAL_STATE, pData, length) == expected, "CRC-32C SSE4.2", length);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Checks the Fletcher-16 kernels against the byte at a time reference, including the all 0xFF worst case
+   * for the deferred reductions
+   */
+  void checkFletcher16()
+  {
+    std::vector<uint8_t> data;
+    fillPattern(data, 3 * Fletcher16::CHUNK_LENGTH + 16);
+    std::vector<uint8_t> ones(3 * Fletcher16::CHUNK_LENGTH, 0xFF);
+
+    for (size_t offset = 0; offset < 16; offset += 5)
+    {
+      for (size_t length = 0; length <= 3 * Fletcher16::CHUNK_LENGTH; length += (length < 300) ? 1 : 251)
+      {
+        const uint8_t* pData = &data[offset];
+        uint16_t expected = referenceFletcher16(pData, length);
+        check(fletcher16Scalar(pData, length) == expected, "Fletcher-16 scalar", length);
+        check(Fletcher16::calculate(pData, length) == expected, "Fletcher-16 dispatch", length);
+        check(Fletcher16::calculate(&ones[0], length) == referenceFletcher16(&ones[0], length), "Fletcher-16 0xFF", length);
+
+        if (CpuFeatures::hasSse2())
+        {
+          uint32_t sum1 = 0;
+          uint32_t sum2 = 0;
+          Fletcher16::updateSse2(sum1, sum2, pData, length);
+          check(Fletcher16::finalize(sum1, sum2) == expected, "Fletcher-16 SSE2", length);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Checks that combining the sums of land and statics gives the checksum of the whole block
+   */
+  void checkFletcher16Combine()
+  {
+    std::vector<uint8_t> data;
+    fillPattern(data, 2000);
+
+    for (size_t split = 0; split <= data.size(); split += 13)
+    {
+      uint32_t sum1 = 0;
+      uint32_t sum2 = 0;
+      Fletcher16::update(sum1, sum2, &data[0], split);
+
+      uint32_t sum1B = 0;
+      uint32_t sum2B = 0;
+      Fletcher16::update(sum1B, sum2B, &data[0] + split, data.size() - split);
+
+      Fletcher16::combine(sum1, sum2, sum1B, sum2B, data.size() - split);
+      check(Fletcher16::finalize(sum1, sum2) == referenceFletcher16(&data[0], data.size()), "Fletcher-16 combine", split);
+    }
+  }
+
+  /**
+   * @brief Checks that the fused Fletcher-16 and CRC32 pass matches both checksums run separately
+   */
+  void checkFletcher16Crc32()
+  {
+    std::vector<uint8_t> data;
+    fillPattern(data, 5000);
+
+    for (size_t length = 0; length <= data.size(); length += (length < 300) ? 1 : 97)
+    {
+      uint32_t sum1 = 0;
+      uint32_t sum2 = 0;
+      uint32_t crc32State = Crc32::INITIAL_STATE;
+      Fletcher16Crc32::update(sum1, sum2, crc32State, &data[0], length);
+
+      check(Fletcher16::finalize(sum1, sum2) == referenceFletcher16(&data[0], length), "Fletcher-16 fused", length);
+      check(~crc32State == referenceCrc(0xEDB88320, &data[0], length), "CRC32 fused", length);
+    }
+  }
+
+  /**
+   * @brief Checks XXH64 against published vectors and vectors from the reference implementation, in one call and
+   * streamed in pieces
+   */
+  void checkXxh64()
+  {
+    struct TextVector
+    {
+      const char* pText;
+      uint64_t digest;
+    };
+
+    struct PatternVector
+    {
+      size_t length;
+      uint64_t digest;
+    };
+
+    const TextVector textVectors[] =
+    {
+      { "", 0xEF46DB3751D8E999ULL },
+      { "a", 0xD24EC4F1A98C6E5BULL },
+      { "abc", 0x44BC2CF5AD770999ULL },
+      { "123456789", 0x8CB841DB40E6AE83ULL },
+      { "Nobody inspects the spammish repetition", 0xFBCEA83C8A378BF1ULL }
+    };
+
+    const PatternVector patternVectors[] =
+    {
+      { 1, 0xA96C7F0CE858BBB7ULL },
+      { 4, 0xFA212AE44B3BB23DULL },
+      { 8, 0x994B676B71CE94DDULL },
+      { 14, 0x574269377227D80AULL },
+      { 31, 0x6711D55E306B5D8FULL },
+      { 32, 0x07F7B8E3BC5D6E25ULL },
+      { 33, 0x09F85EEB4E1CBE9FULL },
+      { 64, 0x50D4159A0411632EULL },
+      { 100, 0x9DDADA11D3DC2D8FULL },
+      { 192, 0x33492A361B958D9CULL },
+      { 1000, 0x0BF0BDBCC82EB373ULL }
+    };
+
+    for (size_t i = 0; i < sizeof(textVectors) / sizeof(textVectors[0]); i++)
+    {
+      size_t length = strlen(textVectors[i].pText);
+      check(Xxh64::calculate(reinterpret_cast<const uint8_t*>(textVectors[i].pText), length) == textVectors[i].digest, "XXH64 text vector", length);
+    }
+
+    std::vector<uint8_t> data;
+
+    for (size_t i = 0; i < sizeof(patternVectors) / sizeof(patternVectors[0]); i++)
+    {
+      size_t length = patternVectors[i].length;
+      fillPattern(data, length);
+      check(Xxh64::calculate(&data[0], length) == patternVectors[i].digest, "XXH64 pattern vector", length);
+
+      for (size_t split = 0; split <= length; split++)
+      {
+        Xxh64 state;
+        state.update(&data[0], split);
+        state.update(&data[0] + split, length - split);
+        check(state.digest() == patternVectors[i].digest, "XXH64 streamed", split);
+      }
+    }
+  }
+
+  /**
+   * @brief Checks the SSE2 hash comparison against the scalar one, for every hash size it accepts and counts that do
+   * not fill whole vectors
+   */
+  void checkHashCompare()
+  {
+    const size_t hashSizes[] = { 2, 4, 8 };
+    std::vector<uint8_t> hashesA;
+    fillPattern(hashesA, 8 * 300);
+
+    for (size_t i = 0; i < sizeof(hashSizes) / sizeof(hashSizes[0]); i++)
+    {
+      size_t hashSize = hashSizes[i];
+
+      for (size_t numberOfHashes = 0; numberOfHashes < 300; numberOfHashes += 7)
+      {
+        std::vector<uint8_t> hashesB(hashesA);
+
+        for (size_t position = 0; position < numberOfHashes; position += 3)
+        {
+          hashesB[(position * hashSize) + (position % hashSize)] ^= 0x5A;
+        }
+
+        size_t bitmapSize = HashCompare::getBitmapSize(numberOfHashes);
+        std::vector<uint8_t> expected(bitmapSize + 1, 0);
+        std::vector<uint8_t> scalar(bitmapSize + 1, 0xCC);
+        std::vector<uint8_t> dispatched(bitmapSize + 1, 0xCC);
+
+        for (size_t position = 0; position < numberOfHashes; position++)
+        {
+          if (memcmp(&hashesA[position * hashSize], &hashesB[position * hashSize], hashSize) != 0)
+          {
+            expected[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+          }
+        }
+
+        HashCompare::findMismatchesScalar(&hashesA[0], &hashesB[0], numberOfHashes, hashSize, &scalar[0]);
+        HashCompare::findMismatches(&hashesA[0], &hashesB[0], numberOfHashes, hashSize, &dispatched[0]);
+        check(memcmp(&scalar[0], &expected[0], bitmapSize) == 0, "HashCompare scalar", numberOfHashes);
+        check(memcmp(&dispatched[0], &expected[0], bitmapSize) == 0, "HashCompare dispatch", numberOfHashes);
+
+        if (CpuFeatures::hasSse2())
+        {
+          std::vector<uint8_t> sse2(bitmapSize + 1, 0xCC);
+          HashCompare::findMismatchesSse2(&hashesA[0], &hashesB[0], numberOfHashes, hashSize, &sse2[0]);
+          check(memcmp(&sse2[0], &expected[0], bitmapSize) == 0, "HashCompare SSE2", numberOfHashes);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Times every kernel on a typical block (192 bytes of land and 300 bytes of statics) and on a large buffer
+   */
+  void runBenchmarks()
+  {
+    const size_t lengths[] = { 492, 1024 * 1024 };
+    std::vector<uint8_t> data;
+    fillPattern(data, 2 * 1024 * 1024);
+
+    printf("CPU: SSE2 %i, SSE4.2 %i, PCLMUL %i\n", CpuFeatures::hasSse2(), CpuFeatures::hasSse42(), CpuFeatures::hasPclmul());
+
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+      benchmark("CRC32 bitwise", &crc32Bitwise, data, lengths[i]);
+      benchmark("CRC32 byte table", &crc32ByteTable, data, lengths[i]);
+      benchmark("CRC32 slice-by-8", &crc32SliceBy8, data, lengths[i]);
+      benchmark("CRC32 dispatch", &crc32Dispatch, data, lengths[i]);
+      benchmark("CRC-32C slice-by-8", &crc32cSliceBy8, data, lengths[i]);
+      benchmark("CRC-32C dispatch", &crc32cDispatch, data, lengths[i]);
+      benchmark("Fletcher-16 mod per byte", &fletcher16Reference, data, lengths[i]);
+      benchmark("Fletcher-16 scalar", &fletcher16Scalar, data, lengths[i]);
+      benchmark("Fletcher-16 dispatch", &fletcher16Dispatch, data, lengths[i]);
+      benchmark("Fletcher-16 + CRC32", &fletcher16Crc32, data, lengths[i]);
+      benchmark("XXH64", &xxh64, data, lengths[i]);
+    }
+  }
+}
+
+/**
+ * @brief Runs the checks, then the timings unless --no-bench is passed
+ *
+ * @param argc Number of arguments
+ * @param argv Arguments, --no-bench skips the timings
+ *
+ * @return 0 if every check passed
+ */
+int main(int argc, char* argv[])
+{
+  checkCrc32();
+  checkCrc32Combine();
+  checkCrc32c();
+  checkFletcher16();
+  checkFletcher16Combine();
+  checkFletcher16Crc32();
+  checkXxh64();
+  checkHashCompare();
+
+  int result = reportResults();
+
+  if (benchmarksRequested(argc, argv))
+  {
+    runBenchmarks();
+  }
+
+  return result;
+}
@@ -0,0 +1,132 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Bookkeeping shared by the standalone test programs: checks are counted and failures reported in one format, timings
+ * are taken with a Stopwatch, and main ends with reportResults() and runs its timings unless --no-bench is passed.
+ */
+
+#ifndef _TEST_SUPPORT_H
+#define _TEST_SUPPORT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+inline int g_numberOfChecks = 0;   //!< Number of checks run
+inline int g_numberOfFailures = 0; //!< Number of checks that failed
+
+/**
+ * @brief Records the result of a check and reports it if it failed
+ *
+ * @param passed Result of the check
+ * @param pName Name of the check
+ * @param value Value the check was run for, such as a length or a map size
+ */
+inline void check(bool passed, const char* pName, uint64_t value)
+{
+  g_numberOfChecks++;
+
+  if (!passed)
+  {
+    g_numberOfFailures++;
+    printf("FAILED: %s, %llu\n", pName, static_cast<unsigned long long>(value));
+  }
+}
+
+/**
+ * @brief Prints how many checks passed
+ *
+ * @return Exit code for main, 0 if every check passed
+ */
+inline int reportResults()
+{
+  printf("%i of %i checks passed\n", g_numberOfChecks - g_numberOfFailures, g_numberOfChecks);
+  return (g_numberOfFailures == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Checks if the timings should run, which they do unless the first argument is --no-bench
+ *
+ * @param argc Number of arguments
+ * @param argv Arguments
+ *
+ * @return true if the timings should run
+ */
+inline bool benchmarksRequested(int argc, char* argv[])
+{
+  return argc < 2 || strcmp(argv[1], "--no-bench") != 0;
+}
+
+/**
+ * @class Stopwatch
+ *
+ * @brief Measures the time since it was created or last restarted, on the steady clock
+ */
+class Stopwatch
+{
+  public:
+    /**
+     * @brief Stopwatch constructor, starts timing
+     */
+    Stopwatch()
+      : m_start(std::chrono::steady_clock::now())
+    {
+      //do nothing
+    }
+
+    /**
+     * @brief Starts timing again from now
+     */
+    void restart()
+    {
+      m_start = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * @brief Gets the time since the start
+     *
+     * @return Elapsed seconds
+     */
+    double getSeconds() const
+    {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    /**
+     * @brief Gets the time since the start
+     *
+     * @return Elapsed milliseconds
+     */
+    double getMilliseconds() const
+    {
+      return getSeconds() * 1e3;
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_start; //!< Time timing started
+};
+
+#endif
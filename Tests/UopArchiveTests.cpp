@@ -0,0 +1,491 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks of UopArchive on generated archives, from disk and from memory: chained, partly filled and cyclic file
+ * tables give the same entries as the old per-entry reader, entries are found by path checksum exactly as a scan of
+ * the tables would find them, their data reads back, and broken archives are rejected. Then timings of reading the
+ * file tables entry by entry and table by table, and of matching a map's file numbers to entries through the old
+ * nested scan and through the index. Returns non-zero if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "UopArchive.h"
+
+#include "TestSupport.h"
+
+namespace
+{
+  const uint32_t EMPTY_SLOT = 0xFFFFFFFF;                 //!< Table order value of a slot that is left zeroed
+  const char* const ARCHIVE_FILENAME = "UopArchiveTests.uop"; //!< Generated archive written to disk
+
+  /**
+   * @brief Writes a little endian value into a buffer
+   *
+   * @param rBuffer Buffer
+   * @param offset Offset of the value
+   * @param value Value
+   * @param size Number of bytes
+   */
+  void put(std::vector<uint8_t>& rBuffer, size_t offset, uint64_t value, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      rBuffer[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+  }
+
+  /**
+   * @brief Generates a UOP archive. File i has the path checksum rChecksums[i] and dataSize bytes of data derived
+   * from i. The files are spread over chained tables of tableCapacity slots, in the order given by rTableOrder.
+   *
+   * @param rChecksums Path checksum of every file
+   * @param rTableOrder File number of every table slot in table order, EMPTY_SLOT for a slot that is left zeroed
+   * @param tableCapacity Slots per file table
+   * @param dataSize Data bytes per file
+   * @param cyclic Link the last table back to the first one
+   * @param rArchiveOut Receives the archive
+   */
+  void buildArchive(const std::vector<uint64_t>& rChecksums, const std::vector<uint32_t>& rTableOrder, uint32_t tableCapacity,
+    uint32_t dataSize, bool cyclic, std::vector<uint8_t>& rArchiveOut)
+  {
+    uint32_t numberOfTables = static_cast<uint32_t>((rTableOrder.size() + tableCapacity - 1) / tableCapacity);
+    rArchiveOut.assign(0x200, 0);
+
+    put(rArchiveOut, 0, 0x50594D, 4);  //myp\0
+    put(rArchiveOut, 4, 5, 4);
+    put(rArchiveOut, 8, 0xFD23EC43, 4);
+    put(rArchiveOut, 12, (numberOfTables > 0) ? rArchiveOut.size() : 0, 8);
+    put(rArchiveOut, 20, tableCapacity, 4);
+    put(rArchiveOut, 24, rChecksums.size(), 4);
+    put(rArchiveOut, 28, numberOfTables, 4);
+
+    for (uint32_t table = 0; table < numberOfTables; table++)
+    {
+      size_t tableOffset = rArchiveOut.size();
+      rArchiveOut.resize(tableOffset + UopArchive::TABLE_HEADER_SIZE + (tableCapacity * UopArchive::ENTRY_SIZE), 0);
+      put(rArchiveOut, tableOffset, tableCapacity, 4);
+
+      for (uint32_t slot = 0; slot < tableCapacity && (table * tableCapacity) + slot < rTableOrder.size(); slot++)
+      {
+        uint32_t file = rTableOrder[(table * tableCapacity) + slot];
+        if (file == EMPTY_SLOT)
+        {
+          continue;
+        }
+
+        size_t entryOffset = tableOffset + UopArchive::TABLE_HEADER_SIZE + (slot * UopArchive::ENTRY_SIZE);
+        size_t dataOffset = rArchiveOut.size();
+
+        rArchiveOut.resize(dataOffset + 8 + dataSize, 0);
+        for (uint32_t i = 0; i < dataSize; i++)
+        {
+          rArchiveOut[dataOffset + 8 + i] = static_cast<uint8_t>((file * 31) + i);
+        }
+
+        put(rArchiveOut, entryOffset, dataOffset, 8);
+        put(rArchiveOut, entryOffset + 8, 8, 4);
+        put(rArchiveOut, entryOffset + 12, dataSize, 4);
+        put(rArchiveOut, entryOffset + 16, dataSize, 4);
+        put(rArchiveOut, entryOffset + 20, rChecksums[file], 8);
+      }
+
+      //link the table to the next one, which starts where this table's data ends
+      if (table + 1 < numberOfTables)
+      {
+        put(rArchiveOut, tableOffset + 4, rArchiveOut.size(), 8);
+      }
+      else if (cyclic)
+      {
+        put(rArchiveOut, tableOffset + 4, 0x200, 8);
+      }
+    }
+  }
+
+  /**
+   * @brief Makes distinct path checksums and a shuffled table order for a number of files
+   *
+   * @param numberOfFiles Number of files
+   * @param seed Seed of the checksums and the order
+   * @param rChecksumsOut Receives a checksum per file
+   * @param rTableOrderOut Receives the file numbers in table order
+   */
+  void makeFiles(uint32_t numberOfFiles, uint32_t seed, std::vector<uint64_t>& rChecksumsOut, std::vector<uint32_t>& rTableOrderOut)
+  {
+    std::mt19937_64 random(seed);
+    rChecksumsOut.clear();
+    rTableOrderOut.clear();
+
+    for (uint32_t i = 0; i < numberOfFiles; i++)
+    {
+      rChecksumsOut.push_back(random() | 1);
+      rTableOrderOut.push_back(i);
+    }
+
+    std::shuffle(rTableOrderOut.begin(), rTableOrderOut.end(), random);
+  }
+
+  /**
+   * @brief Writes a generated archive to disk
+   *
+   * @param rArchive Archive
+   *
+   * @return true if the file was written
+   */
+  bool writeArchive(const std::vector<uint8_t>& rArchive)
+  {
+    std::ofstream file(ARCHIVE_FILENAME, std::ios::binary | std::ios::out | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&rArchive[0]), static_cast<std::streamsize>(rArchive.size()));
+    return file.good();
+  }
+
+  /**
+   * @brief Reads the file entries of an archive on disk the way UopUtility did before UopArchive, with a seek and a
+   * read per 34-byte slot, extended to follow the chain of tables so it can serve as the reference for every table
+   *
+   * @param rEntriesOut Receives the entries of the used slots in table order
+   */
+  void perEntryRead(std::vector<FileEntry>& rEntriesOut)
+  {
+    rEntriesOut.clear();
+
+    std::ifstream file(ARCHIVE_FILENAME, std::ios::binary | std::ios::in);
+    uint64_t tableOffset = 0;
+    file.seekg(12, std::ios::beg);
+    file.read(reinterpret_cast<char*>(&tableOffset), sizeof(uint64_t));
+
+    std::set<uint64_t> visitedTables;
+    while (file.good() && tableOffset != 0 && visitedTables.insert(tableOffset).second)
+    {
+      uint32_t capacity = 0;
+      uint64_t nextTableOffset = 0;
+      file.seekg(static_cast<std::streamoff>(tableOffset), std::ios::beg);
+      file.read(reinterpret_cast<char*>(&capacity), sizeof(uint32_t));
+      file.read(reinterpret_cast<char*>(&nextTableOffset), sizeof(uint64_t));
+
+      uint8_t fileEntryBuffer[UopArchive::ENTRY_SIZE];
+      uint64_t filePosition = tableOffset + UopArchive::TABLE_HEADER_SIZE;
+      for (uint32_t i = 0; i < capacity && file.good(); i++, filePosition += UopArchive::ENTRY_SIZE)
+      {
+        file.seekg(static_cast<std::streamoff>(filePosition), std::ios::beg);
+        file.read(reinterpret_cast<char*>(fileEntryBuffer), UopArchive::ENTRY_SIZE);
+
+        uint64_t dataOffset = 0;
+        memcpy(&dataOffset, fileEntryBuffer, sizeof(uint64_t));
+        if (dataOffset != 0)
+        {
+          FileEntry entry;
+          entry.unmarshal(fileEntryBuffer);
+          rEntriesOut.push_back(entry);
+        }
+      }
+
+      tableOffset = nextTableOffset;
+    }
+  }
+
+  /**
+   * @brief Checks that an archive holds exactly the reference entries, finds each file by its checksum and reads
+   * back the data of every file
+   *
+   * @param rArchive Loaded archive
+   * @param rExpected Reference entries in table order
+   * @param rChecksums Checksum of every file
+   * @param dataSize Data bytes per file
+   * @param pName Name of the case
+   * @param value Value the case is reported with
+   */
+  void checkLoadedArchive(UopArchive& rArchive, const std::vector<FileEntry>& rExpected, const std::vector<uint64_t>& rChecksums,
+    uint32_t dataSize, const char* pName, uint32_t value)
+  {
+    bool sameEntries = rArchive.getNumberOfEntries() == rExpected.size() && rArchive.getEntry(rArchive.getNumberOfEntries()) == NULL;
+    for (uint32_t i = 0; sameEntries && i < rExpected.size(); i++)
+    {
+      const FileEntry* pEntry = rArchive.getEntry(i);
+      sameEntries = pEntry->UopFileOffset == rExpected[i].UopFileOffset && pEntry->MetaDataSize == rExpected[i].MetaDataSize &&
+        pEntry->CompressedDataSize == rExpected[i].CompressedDataSize && pEntry->UncompressedDataSize == rExpected[i].UncompressedDataSize &&
+        pEntry->PathChecksum == rExpected[i].PathChecksum && pEntry->MetadataCrc == rExpected[i].MetadataCrc &&
+        pEntry->CompressionMethod == rExpected[i].CompressionMethod;
+    }
+
+    check(sameEntries && rArchive.getTotalFiles() == rChecksums.size(), pName, value);
+
+    std::vector<uint8_t> data(dataSize);
+    bool dataMatches = true;
+    for (uint32_t file = 0; dataMatches && file < rChecksums.size(); file++)
+    {
+      const FileEntry* pEntry = rArchive.findEntry(rChecksums[file]);
+      dataMatches = pEntry != NULL && rArchive.readEntryData(pEntry, &data[0]);
+
+      for (uint32_t i = 0; dataMatches && i < dataSize; i++)
+      {
+        dataMatches = data[i] == static_cast<uint8_t>((file * 31) + i);
+      }
+    }
+
+    check(dataMatches, "entry data reads back", value);
+  }
+
+  /**
+   * @brief Checks reading single, chained, partly filled, cyclic and empty file tables from disk and from memory
+   * against the per-entry reader, and that truncated archives and missing files are rejected
+   */
+  void checkArchiveReading()
+  {
+    struct ArchiveShape
+    {
+      uint32_t numberOfFiles; //!< Files in the archive
+      uint32_t capacity;      //!< Slots per table
+      uint32_t gapInterval;   //!< Every gapInterval-th slot is left empty, 0 for none
+      bool cyclic;            //!< Last table links back to the first
+    };
+
+    const ArchiveShape shapes[] = { { 113, 1000, 0, false }, { 2500, 1000, 0, false }, { 3000, 100, 7, false },
+      { 1500, 1000, 0, true }, { 0, 1000, 0, false } };
+
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++)
+    {
+      std::vector<uint64_t> checksums;
+      std::vector<uint32_t> files;
+      std::vector<uint32_t> tableOrder;
+      makeFiles(shapes[s].numberOfFiles, static_cast<uint32_t>(s), checksums, files);
+
+      for (size_t i = 0; i < files.size(); i++)
+      {
+        if (shapes[s].gapInterval != 0 && tableOrder.size() % shapes[s].gapInterval == 0)
+        {
+          tableOrder.push_back(EMPTY_SLOT);
+        }
+
+        tableOrder.push_back(files[i]);
+      }
+
+      std::vector<uint8_t> archiveData;
+      std::vector<FileEntry> expected;
+      buildArchive(checksums, tableOrder, shapes[s].capacity, 64, shapes[s].cyclic, archiveData);
+      writeArchive(archiveData);
+      perEntryRead(expected);
+
+      UopArchive diskArchive;
+      UopArchive memoryArchive;
+      check(diskArchive.open(ARCHIVE_FILENAME) && memoryArchive.load(&archiveData[0], archiveData.size()), "archive opens", shapes[s].numberOfFiles);
+      check(expected.size() == shapes[s].numberOfFiles, "reference reads every file", shapes[s].numberOfFiles);
+      checkLoadedArchive(diskArchive, expected, checksums, 64, "disk entries match the per-entry reader", shapes[s].numberOfFiles);
+      checkLoadedArchive(memoryArchive, expected, checksums, 64, "memory entries match the per-entry reader", shapes[s].numberOfFiles);
+
+      if (shapes[s].numberOfFiles == 0)
+      {
+        continue;
+      }
+
+      //cut the archive inside the last table, and inside the data of the last file
+      uint64_t lastTableOffset = 0x200;
+      uint64_t nextTableOffset = 0;
+      memcpy(&nextTableOffset, &archiveData[lastTableOffset + 4], sizeof(uint64_t));
+      while (nextTableOffset != 0 && nextTableOffset != 0x200)
+      {
+        lastTableOffset = nextTableOffset;
+        memcpy(&nextTableOffset, &archiveData[lastTableOffset + 4], sizeof(uint64_t));
+      }
+
+      UopArchive truncatedArchive;
+      check(!truncatedArchive.load(&archiveData[0], lastTableOffset + UopArchive::TABLE_HEADER_SIZE + 10), "truncated table is rejected", shapes[s].numberOfFiles);
+      check(truncatedArchive.getNumberOfEntries() == 0, "rejected archive has no entries", shapes[s].numberOfFiles);
+
+      std::vector<uint8_t> data(64);
+      const FileEntry* pLastEntry = truncatedArchive.load(&archiveData[0], archiveData.size() - 1) ? truncatedArchive.findEntry(checksums[tableOrder.back()]) : NULL;
+      check(pLastEntry != NULL && !truncatedArchive.readEntryData(pLastEntry, &data[0]), "truncated data is rejected", shapes[s].numberOfFiles);
+    }
+
+    UopArchive archive;
+    uint8_t header[UopArchive::HEADER_SIZE] = { 0 };
+    check(!archive.load(header, UopArchive::HEADER_SIZE - 1) && archive.load(header, UopArchive::HEADER_SIZE), "short header", 0);
+    check(!archive.load(NULL, 0) && !archive.open("missing.uop"), "missing archive", 0);
+
+    remove(ARCHIVE_FILENAME);
+  }
+
+  /**
+   * @brief Matches file numbers to entries the way parseMapFile did before the index: compare each expected checksum
+   * with every entry until one matches
+   *
+   * @param rArchive Loaded archive
+   * @param rChecksums Expected checksum of every file number
+   * @param rEntriesOut Receives the entry of every file number, NULL if it is missing
+   */
+  void nestedMatch(UopArchive& rArchive, const std::vector<uint64_t>& rChecksums, std::vector<const FileEntry*>& rEntriesOut)
+  {
+    rEntriesOut.assign(rChecksums.size(), NULL);
+
+    for (size_t i = 0; i < rChecksums.size(); i++)
+    {
+      for (uint32_t j = 0; j < rArchive.getNumberOfEntries(); j++)
+      {
+        if (rArchive.getEntry(j)->PathChecksum == rChecksums[i])
+        {
+          rEntriesOut[i] = rArchive.getEntry(j);
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Matches file numbers to entries through the index, the way parseMapFile does it now
+   *
+   * @param rArchive Loaded archive
+   * @param rChecksums Expected checksum of every file number
+   * @param rEntriesOut Receives the entry of every file number, NULL if it is missing
+   */
+  void indexedMatch(UopArchive& rArchive, const std::vector<uint64_t>& rChecksums, std::vector<const FileEntry*>& rEntriesOut)
+  {
+    rEntriesOut.assign(rChecksums.size(), NULL);
+
+    for (size_t i = 0; i < rChecksums.size(); i++)
+    {
+      rEntriesOut[i] = rArchive.findEntry(rChecksums[i]);
+    }
+  }
+
+  /**
+   * @brief Checks that the index finds the same entry as a scan for every file, for missing checksums and for
+   * checksums that appear twice, where the first entry in table order wins
+   */
+  void checkEntryIndex()
+  {
+    const uint32_t sizes[][2] = { { 1, 100 }, { 113, 1000 }, { 1000, 100 }, { 4000, 1000 } };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+      std::vector<uint64_t> checksums;
+      std::vector<uint32_t> tableOrder;
+      makeFiles(sizes[s][0], static_cast<uint32_t>(s), checksums, tableOrder);
+
+      //a copy of the file in the last slot under the checksum of the file in the first, which must not win
+      tableOrder.push_back(static_cast<uint32_t>(checksums.size()));
+      checksums.push_back(checksums[tableOrder[0]]);
+
+      std::vector<uint8_t> archiveData;
+      buildArchive(checksums, tableOrder, sizes[s][1], 16, false, archiveData);
+      checksums.pop_back();
+
+      UopArchive archive;
+      check(archive.load(&archiveData[0], archiveData.size()) && archive.getNumberOfEntries() == checksums.size() + 1, "archive loads", sizes[s][0]);
+
+      std::vector<const FileEntry*> expected;
+      std::vector<const FileEntry*> found;
+      nestedMatch(archive, checksums, expected);
+      indexedMatch(archive, checksums, found);
+
+      bool allFound = std::find(found.begin(), found.end(), static_cast<const FileEntry*>(NULL)) == found.end();
+      check(found == expected && allFound, "index matches the nested scan", sizes[s][0]);
+      check(archive.findEntry(checksums[tableOrder[0]]) == archive.getEntry(0), "first entry with a checksum wins", sizes[s][0]);
+      check(archive.findEntry(0x1234) == NULL, "missing checksum", sizes[s][0]);
+    }
+  }
+
+  /**
+   * @brief Times matching every file number of a map to its entry on archives with up to 16000 files, through the
+   * nested scan and through loading the archive with its index
+   */
+  void runBenchmarks()
+  {
+    std::vector<uint64_t> checksums;
+    std::vector<uint32_t> tableOrder;
+    std::vector<uint8_t> archiveData;
+    makeFiles(16000, 98, checksums, tableOrder);
+    buildArchive(checksums, tableOrder, 1000, 16, false, archiveData);
+    writeArchive(archiveData);
+
+    printf("Reading the file tables of a 16000 entry archive on disk, 16 tables of 1000 slots\n");
+
+    for (int run = 0; run < 3; run++)
+    {
+      std::vector<FileEntry> entries;
+      Stopwatch stopwatch;
+      perEntryRead(entries);
+      double perEntryMilliseconds = stopwatch.getMilliseconds();
+
+      stopwatch.restart();
+      UopArchive archive;
+      archive.open(ARCHIVE_FILENAME);
+      double perTableMilliseconds = stopwatch.getMilliseconds();
+
+      printf("  run %i  seek and read per entry %6.2f ms   per table %5.2f ms\n", run + 1, perEntryMilliseconds, perTableMilliseconds);
+    }
+
+    remove(ARCHIVE_FILENAME);
+
+    const uint32_t sizes[] = { 113, 1000, 4000, 16000 };
+
+    printf("\nMatching file numbers to UOP entries, shuffled file tables of 1000 slots\n");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+      makeFiles(sizes[s], 99, checksums, tableOrder);
+      buildArchive(checksums, tableOrder, 1000, 16, false, archiveData);
+
+      std::vector<const FileEntry*> nested;
+      std::vector<const FileEntry*> indexed;
+
+      Stopwatch stopwatch;
+      UopArchive nestedArchive;
+      nestedArchive.load(&archiveData[0], archiveData.size());
+      nestedMatch(nestedArchive, checksums, nested);
+      double nestedMilliseconds = stopwatch.getMilliseconds();
+
+      stopwatch.restart();
+      UopArchive indexedArchive;
+      indexedArchive.load(&archiveData[0], archiveData.size());
+      indexedMatch(indexedArchive, checksums, indexed);
+      double indexedMilliseconds = stopwatch.getMilliseconds();
+
+      printf("  %5u entries  nested scan %9.2f ms   index %6.2f ms\n", sizes[s], nestedMilliseconds, indexedMilliseconds);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  checkArchiveReading();
+  checkEntryIndex();
+
+  int result = reportResults();
+
+  if (benchmarksRequested(argc, argv))
+  {
+    runBenchmarks();
+  }
+
+  return result;
+}
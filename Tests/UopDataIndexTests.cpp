@@ -0,0 +1,273 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks of UopDataIndex against the linear walk over the file entries that seekLandBlock used before it, on the
+ * layout of the Felucca map file and on runs with random entry sizes, then timings of block lookups through both.
+ * Returns non-zero if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+#include "UopDataIndex.h"
+
+#include "TestSupport.h"
+
+namespace
+{
+  /**
+   * @struct RunEntry
+   *
+   * @brief File entry of a run, as far as the lookup needs it
+   */
+  struct RunEntry
+  {
+    uint32_t poolOffset; //!< Offset of the entry's data in the pool
+    uint32_t dataSize;   //!< Uncompressed data size
+  };
+
+  /**
+   * @brief The lookup as seekLandBlock did it before the index: walk the entries, summing their sizes
+   *
+   * @param rEntries Entries of the run
+   * @param dataOffset Offset in the data of the run
+   * @param rPoolOffsetOut Receives the pool offset
+   *
+   * @return false if the offset lies past the data of the last entry
+   */
+  bool linearFind(const std::vector<RunEntry>& rEntries, uint32_t dataOffset, uint32_t& rPoolOffsetOut)
+  {
+    uint32_t fileSeekLocation = 0;
+
+    for (size_t i = 0; i < rEntries.size(); i++)
+    {
+      if (dataOffset < (fileSeekLocation + rEntries[i].dataSize))
+      {
+        rPoolOffsetOut = rEntries[i].poolOffset + (dataOffset - fileSeekLocation);
+        return true;
+      }
+
+      fileSeekLocation += rEntries[i].dataSize;
+    }
+
+    return false;
+  }
+
+  /**
+   * @brief Lays out a run of entries the way the client's map files are split: full entries of 4096 blocks and a
+   * shorter last one, each behind a 12 byte meta data header
+   *
+   * @param numberOfBlocks Number of blocks in the map
+   * @param rEntriesOut Receives the entries
+   */
+  void makeMapRun(uint32_t numberOfBlocks, std::vector<RunEntry>& rEntriesOut)
+  {
+    uint32_t poolOffset = 0x3000;
+
+    for (uint32_t firstBlock = 0; firstBlock < numberOfBlocks; firstBlock += 4096)
+    {
+      RunEntry entry;
+      entry.poolOffset = poolOffset + 12;
+      entry.dataSize = (numberOfBlocks - firstBlock < 4096 ? numberOfBlocks - firstBlock : 4096) * 196;
+      rEntriesOut.push_back(entry);
+      poolOffset += 12 + entry.dataSize;
+    }
+  }
+
+  /**
+   * @brief Builds the index of a run
+   *
+   * @param rEntries Entries of the run
+   * @param rIndex Index to fill
+   */
+  void buildIndex(const std::vector<RunEntry>& rEntries, UopDataIndex& rIndex)
+  {
+    rIndex.clear();
+
+    for (size_t i = 0; i < rEntries.size(); i++)
+    {
+      rIndex.addEntry(rEntries[i].poolOffset, rEntries[i].dataSize);
+    }
+  }
+
+  /**
+   * @brief Compares the index with the linear walk at every block, at both sides of every entry boundary and past
+   * the end, and checks the entries read back
+   *
+   * @param rEntries Entries of the run
+   * @param step Distance between checked offsets
+   * @param pName Name of the check
+   */
+  void compareWithLinearWalk(const std::vector<RunEntry>& rEntries, uint32_t step, const char* pName)
+  {
+    UopDataIndex index;
+    buildIndex(rEntries, index);
+
+    uint32_t numberOfMismatches = 0;
+    uint32_t totalSize = 0;
+    std::vector<uint32_t> offsets;
+
+    for (size_t i = 0; i < rEntries.size(); i++)
+    {
+      if (index.getPoolOffset(static_cast<uint32_t>(i)) != rEntries[i].poolOffset || index.getDataSize(static_cast<uint32_t>(i)) != rEntries[i].dataSize)
+      {
+        numberOfMismatches++;
+      }
+
+      offsets.push_back(totalSize);
+      offsets.push_back(totalSize + rEntries[i].dataSize - 1);
+      totalSize += rEntries[i].dataSize;
+    }
+
+    for (uint32_t offset = 0; offset < totalSize + (2 * step); offset += step)
+    {
+      offsets.push_back(offset);
+    }
+
+    offsets.push_back(totalSize);
+    offsets.push_back(0xFFFFFFFF);
+
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+      uint32_t expected = 0;
+      uint32_t found = 0;
+      bool expectedFound = linearFind(rEntries, offsets[i], expected);
+      bool indexFound = index.find(offsets[i], found);
+
+      if (expectedFound != indexFound || (expectedFound && found != expected))
+      {
+        numberOfMismatches++;
+      }
+    }
+
+    check(index.getNumberOfEntries() == rEntries.size(), pName, static_cast<uint32_t>(rEntries.size()));
+    check(numberOfMismatches == 0, pName, totalSize);
+  }
+
+  /**
+   * @brief Checks the map layouts of the client's maps, runs with random and empty entries, and an empty run
+   */
+  void checkDataIndex()
+  {
+    const uint32_t maps[] = { 896 * 512, 288 * 200, 320 * 256, 181 * 181, 160 * 512, 2048 * 2048 };
+
+    for (size_t m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+    {
+      std::vector<RunEntry> entries;
+      makeMapRun(maps[m], entries);
+      compareWithLinearWalk(entries, 196, "map layout matches the linear walk");
+    }
+
+    std::mt19937 random(23);
+
+    for (uint32_t run = 0; run < 20; run++)
+    {
+      std::vector<RunEntry> entries;
+      uint32_t poolOffset = random() % 1000;
+      uint32_t numberOfEntries = 1 + (random() % 300);
+
+      for (uint32_t i = 0; i < numberOfEntries; i++)
+      {
+        RunEntry entry;
+        entry.poolOffset = poolOffset;
+        entry.dataSize = (random() % 5 == 0) ? 0 : 1 + (random() % 20000);
+        entries.push_back(entry);
+        poolOffset += entry.dataSize + (random() % 64);
+      }
+
+      compareWithLinearWalk(entries, 7, "random run matches the linear walk");
+    }
+
+    UopDataIndex index;
+    uint32_t poolOffset = 0;
+    check(index.getNumberOfEntries() == 0 && !index.find(0, poolOffset), "empty index", 0);
+
+    index.addEntry(100, 50);
+    index.clear();
+    check(index.getNumberOfEntries() == 0 && !index.find(0, poolOffset), "cleared index", 0);
+  }
+
+  /**
+   * @brief Times lookups of blocks spread over the map through the linear walk and the index
+   */
+  void runBenchmarks()
+  {
+    const uint32_t maps[][2] = { { 7168, 4096 }, { 16384, 16384 } };
+    const uint32_t lookups = 2000000;
+
+    printf("Land block lookups, %u blocks spread over the map\n", lookups);
+
+    for (size_t m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+    {
+      uint32_t numberOfBlocks = (maps[m][0] >> 3) * (maps[m][1] >> 3);
+      std::vector<RunEntry> entries;
+      makeMapRun(numberOfBlocks, entries);
+
+      UopDataIndex index;
+      buildIndex(entries, index);
+
+      uint32_t sink = 0;
+      Stopwatch stopwatch;
+
+      for (uint32_t i = 0; i < lookups; i++)
+      {
+        uint32_t poolOffset = 0;
+        linearFind(entries, ((i * 7919u) % numberOfBlocks) * 196, poolOffset);
+        sink += poolOffset;
+      }
+
+      double linearSeconds = stopwatch.getSeconds();
+      stopwatch.restart();
+
+      for (uint32_t i = 0; i < lookups; i++)
+      {
+        uint32_t poolOffset = 0;
+        index.find(((i * 7919u) % numberOfBlocks) * 196, poolOffset);
+        sink += poolOffset;
+      }
+
+      double indexSeconds = stopwatch.getSeconds();
+
+      printf("  %5ux%-5u %4u entries  linear walk %7.2f M lookups/s   index %7.2f M lookups/s (%x)\n", maps[m][0], maps[m][1],
+        static_cast<unsigned int>(entries.size()), lookups / linearSeconds / 1e6, lookups / indexSeconds / 1e6, sink & 0xF);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  checkDataIndex();
+
+  int result = reportResults();
+
+  if (benchmarksRequested(argc, argv))
+  {
+    runBenchmarks();
+  }
+
+  return result;
+}
@@ -245,9 +245,10 @@ Client::RefreshTerrainFunction Client::FindRefreshTerrainFunction()
 }
 
 /**
- * @brief Searches for the client Player structure memory address
+ * @brief Searches for the instruction that loads the client Player instance from a global. The signature ends in a
+ *        mov reg,[addr] whose address operand starts 6 bytes into the match, see getCurrentPlayerMobile.
  *
- * @return Pointer to the memory address of the client player structure
+ * @return Pointer to the address operand, or NULL if the signature was not found
  */
 CPlayerMobile* Client::FindPlayerStructure()
 {
@@ -258,6 +259,11 @@ CPlayerMobile* Client::FindPlayerStructure()
     pOffset = MasterControlUtils::FindSignatureOffset(BASE_ADDRESS, CLIENT_IMAGE_MAX_SIZE, g_PlayerBaseSignature2, sizeof(g_PlayerBaseSignature2));
   }
 
+  if (pOffset == 0)
+  {
+    return NULL;
+  }
+
   return reinterpret_cast<CPlayerMobile*>(static_cast<char*>(pOffset) + 6);
 }
 
@@ -587,6 +593,34 @@ CPlayerMobile* Client::getPlayerMobile()
   return m_pPlayerStructure;
 }
 
+/**
+ * @brief Reads the client's current Player instance through the address operand found by FindPlayerStructure. The
+ *        global changes when a character logs in or out, so it is read on every call.
+ *
+ * @return Pointer to the current client Player instance, or NULL while there is none
+ */
+CPlayerMobile* Client::getCurrentPlayerMobile()
+{
+  if (m_pPlayerStructure == NULL)
+  {
+    return NULL;
+  }
+
+  CPlayerMobile** ppPlayer = *reinterpret_cast<CPlayerMobile***>(m_pPlayerStructure);
+  if (ppPlayer == NULL)
+  {
+    return NULL;
+  }
+
+  CPlayerMobile* pPlayer = *ppPlayer;
+  if (pPlayer == NULL || pPlayer->drawItemMembers.bitPattern != 0xFEEDBEEF)
+  {
+    return NULL;
+  }
+
+  return pPlayer;
+}
+
 /**
  * @brief Getter for the client Network Manager Pointer
  *
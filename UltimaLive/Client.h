@@ -138,7 +138,7 @@ class Client
     MapTileDefinition* m_pMapDimensionsStructure;     //!< Pointer to client's Map Dimension Structure instance
     MapMinDisplay* m_pMapMinCoordDisplayStructure;    //!< Pointer to client's Mininum Coordinate Display Structure
     int* m_pClientDisplayedBlocksTable;               //!< Pointer to client's Displayed Blocks Table
-    CPlayerMobile* m_pPlayerStructure;				  //!< Pointer to client's Player Class Instance
+    CPlayerMobile* m_pPlayerStructure;				  //!< Pointer to the address operand of the client's Player Class Instance global
     RefreshTerrainFunction m_pRefreshTerrainFunction; //!< Pointer to client's Refresh Terrain function
     CStaticObject** m_pMasterStaticsList;			  //!< Pointer to client's Master Statics List
   #pragma endregion
@@ -161,6 +161,7 @@ class Client
     void SetMapDimensions(MapTileDefinition definition);
 
     CPlayerMobile* getPlayerMobile();
+    CPlayerMobile* getCurrentPlayerMobile();
     bool LookupClientInternalStructuresAndFunctions();
 
     ClientRecvFunction& getRecvFunction();
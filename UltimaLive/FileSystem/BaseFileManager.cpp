@@ -29,6 +29,9 @@
 #pragma comment(lib,"shlwapi.lib")
 #include "shlobj.h"
 #include "..\Maps\MapDefinition.h"
+#include "..\Hashing\Crc32.h"
+
+const uint32_t BaseFileManager::INVALID_BLOCK_HASH_STAMP;
 
 /** 
  * @brief Reads a land block and returns a pointer to the newly allocated memory. Caller is responsible for memory cleanup.
@@ -40,20 +43,31 @@
  */
 unsigned char* BaseFileManager::readLandBlock(uint8_t mapNumber, uint32_t blockNum)
 {
-	unsigned char* pBlockPosition = seekLandBlock(mapNumber, blockNum);
+	const uint8_t* pBlockPosition = viewLandBlock(mapNumber, blockNum);
 	unsigned char* pData = new uint8_t[192];
 
 	if (pBlockPosition != NULL)
 	{
-		for (int i = 0; i < 192; ++i)
-		{
-			pData[i] = reinterpret_cast<unsigned char*>(pBlockPosition)[i];
-		}
+		memcpy(pData, pBlockPosition, 192);
 	}
 
 	return pData;
 }
 
+/** 
+ * @brief Gets a read only view of a land block without copying it. The view points into the map memory pool and
+ * is only valid until the block is updated or another map is loaded.
+ *
+ * @param mapNumber number corresponding to the map to search
+ * @param blockNum number corresponding to the block in the map
+ *
+ * @return Pointer to the 192 bytes of land data, or NULL if the block could not be found
+ */
+const uint8_t* BaseFileManager::viewLandBlock(uint8_t mapNumber, uint32_t blockNum)
+{
+  return seekLandBlock(mapNumber, blockNum);
+}
+
 /** 
  * @brief updates a land block in memory and in UltimaLive's map cache on disk
  *
@@ -117,6 +131,8 @@ bool BaseFileManager::updateLandBlock(uint8_t mapNumber, uint32_t blockNum, uint
 	m_pMapFileStream->flush();
 	Logger::g_pLogger->LogPrint("Flushed successfully\n");
 
+	stampBlockHash(mapNumber, blockNum);
+
 	return true;
 }
 
@@ -129,31 +145,54 @@ bool BaseFileManager::updateLandBlock(uint8_t mapNumber, uint32_t blockNum, uint
  * 
  * @return pointer to memory containing statics in the block
  */
-unsigned char* BaseFileManager::readStaticsBlock(uint32_t, uint32_t blockNum, uint32_t& rNumberOfBytesOut)
+unsigned char* BaseFileManager::readStaticsBlock(uint32_t mapNumber, uint32_t blockNum, uint32_t& rNumberOfBytesOut)
 {
-  uint8_t* pBlockIdx = m_pStaidxPool;
-  pBlockIdx += (blockNum * 12);
-
-  uint32_t lookup = *reinterpret_cast<uint32_t*>(pBlockIdx); 
-  rNumberOfBytesOut = *reinterpret_cast<uint32_t*>(pBlockIdx + 4); //length
+  const uint8_t* pStatics = viewStaticsBlock(mapNumber, blockNum, rNumberOfBytesOut);
   uint8_t* pRawStaticData = NULL;
 
-  if (lookup >= 0 && lookup < STATICS_MEMORY_SIZE && rNumberOfBytesOut > 0 && rNumberOfBytesOut != 0xFFFFFFFF)
+  if (pStatics != NULL)
   {
-    uint8_t* pStatics = reinterpret_cast<uint8_t*>(m_pStaticsPool);
-    pStatics += lookup;
-
     pRawStaticData = new uint8_t[rNumberOfBytesOut];
-
-    for(uint32_t i = 0; i < rNumberOfBytesOut; ++i)
-    {
-      pRawStaticData[i] = pStatics[i];
-    }
+    memcpy(pRawStaticData, pStatics, rNumberOfBytesOut);
   }
 
   return pRawStaticData;
 }
 
+/** 
+ * @brief Gets a read only view of the statics contained in one map block without copying them. The view points into
+ * the statics memory pool and is only valid until the block is rewritten or another map is loaded.
+ *
+ * @param mapNumber Map Number
+ * @param blockNum Block Number
+ * @param rNumberOfBytesOut number of bytes in the view, zero if the block has no statics
+ * 
+ * @return pointer to the statics in the block, or NULL if the block has no statics
+ */
+const uint8_t* BaseFileManager::viewStaticsBlock(uint32_t, uint32_t blockNum, uint32_t& rNumberOfBytesOut)
+{
+  if (blockNum >= m_staidxPool.getCommittedSize() / 12)
+  {
+    rNumberOfBytesOut = 0;
+    return NULL;
+  }
+
+  const uint8_t* pBlockIdx = m_pStaidxPool + (blockNum * 12);
+
+  uint32_t lookup = *reinterpret_cast<const uint32_t*>(pBlockIdx);
+  uint32_t length = *reinterpret_cast<const uint32_t*>(pBlockIdx + 4);
+
+  uint32_t staticsSize = m_staticsPool.getCommittedSize();
+  if (lookup >= staticsSize || length == 0 || length == 0xFFFFFFFF || length > staticsSize - lookup)
+  {
+    rNumberOfBytesOut = 0;
+    return NULL;
+  }
+
+  rNumberOfBytesOut = length;
+  return m_pStaticsPool + lookup;
+}
+
 /** 
  * @brief Writes data corresponding to the statics in a map block out to memory and to the UltimaLive file cache
  *
@@ -164,7 +203,7 @@ unsigned char* BaseFileManager::readStaticsBlock(uint32_t, uint32_t blockNum, ui
  *
  * @return true on success
  */
-bool BaseFileManager::writeStaticsBlock(uint8_t, uint32_t blockNum, uint8_t* pBlockData, uint32_t updatedStaticsLength)
+bool BaseFileManager::writeStaticsBlock(uint8_t mapNumber, uint32_t blockNum, uint8_t* pBlockData, uint32_t updatedStaticsLength)
 {
   Logger::g_pLogger->LogPrint("Writing statics: %i\n", blockNum);
 
@@ -194,6 +233,7 @@ bool BaseFileManager::writeStaticsBlock(uint8_t, uint32_t blockNum, uint8_t* pBl
     m_pStaidxFileStream->write(buffer, sizeof(uint32_t));
     m_pStaidxFileStream->flush();
 
+    stampBlockHash(mapNumber, blockNum);
     return true;
   }
 
@@ -210,7 +250,7 @@ bool BaseFileManager::writeStaticsBlock(uint8_t, uint32_t blockNum, uint8_t* pBl
   m_pStaidxFileStream->write(buffer, sizeof(uint32_t));
 
   //Do we have enough room to write the statics into the existing location?
-  if (existingStaticsLength >= updatedStaticsLength && existingLookup != 0xFFFFFFFF && existingLookup < STATICS_MEMORY_SIZE)
+  if (existingStaticsLength >= updatedStaticsLength && existingLookup != 0xFFFFFFFF && existingLookup < m_staticsPool.getCommittedSize())
   {
     Logger::g_pLogger->LogPrint("writing statics to existing file location at 0x%x, length:%i\n", existingLookup, updatedStaticsLength);
 
@@ -228,6 +268,11 @@ bool BaseFileManager::writeStaticsBlock(uint8_t, uint32_t blockNum, uint8_t* pBl
     uint32_t newLookup = m_pStaticsPoolEnd - m_pStaticsPool;
     Logger::g_pLogger->LogPrint("writing statics to end of file 0x%x, length:%i\n", newLookup, updatedStaticsLength);
 
+    if (!m_staticsPool.commit(newLookup + updatedStaticsLength))
+    {
+      return false;
+    }
+
     //update index lookup in memory
     *reinterpret_cast<uint32_t*>(pBlockIdx) = newLookup;
 
@@ -248,9 +293,264 @@ bool BaseFileManager::writeStaticsBlock(uint8_t, uint32_t blockNum, uint8_t* pBl
 
   m_pStaidxFileStream->flush();
   m_pStaticsFileStream->flush();
+
+  stampBlockHash(mapNumber, blockNum);
   return true;
 }
 
+/**
+ * @brief Checks if the hash stamps in the third field of the loaded map's staidx entries can be trusted. Stamps are
+ * only trusted once every block of the map has been stamped, which is recorded by a marker file next to staidx#.mul.
+ * Blocks are stamped as they are written and as the precompute workers hash them, see writeBlockHashStamps().
+ *
+ * @return true if getBlockHashStamp() returns block CRC32s
+ */
+bool BaseFileManager::hasBlockHashStamps()
+{
+  return m_blockHashStampsValid;
+}
+
+/**
+ * @brief Gets the hash stamp of a block of the loaded map. The stamp is the same CRC32 of the land and statics data
+ * that is reported to the server.
+ *
+ * @param blockNum Block Number
+ *
+ * @return CRC32 of the block, or INVALID_BLOCK_HASH_STAMP if it is not known
+ */
+uint32_t BaseFileManager::getBlockHashStamp(uint32_t blockNum)
+{
+  if (!m_blockHashStampsValid || blockNum >= m_numberOfBlockHashStamps)
+  {
+    return INVALID_BLOCK_HASH_STAMP;
+  }
+
+  return *reinterpret_cast<const uint32_t*>(m_pStaidxPool + (blockNum * 12) + 8);
+}
+
+/**
+ * @brief Hashes a block of the loaded map and stores the CRC32 in the third field of its staidx entry, in memory
+ * and in UltimaLive's map cache on disk. Called whenever the land or statics of a block are written, between
+ * BlockHashCache::beginDataUpdate() and endDataUpdate(). Writes out the whole index and the marker file if this was
+ * the last block of the map without a stamp.
+ *
+ * @param mapNumber Map Number
+ * @param blockNum Block Number
+ */
+void BaseFileManager::stampBlockHash(uint8_t mapNumber, uint32_t blockNum)
+{
+  if (!m_pStaidxFileStream->is_open() || blockNum >= m_numberOfBlockHashStamps)
+  {
+    return;
+  }
+
+  uint32_t stamp = calculateBlockHashStamp(mapNumber, blockNum);
+
+  EnterCriticalSection(&m_blockHashStampLock);
+  *reinterpret_cast<uint32_t*>(m_pStaidxPool + (blockNum * 12) + 8) = stamp;
+  bool complete = markBlockHashStamped(blockNum);
+  LeaveCriticalSection(&m_blockHashStampLock);
+
+  m_pStaidxFileStream->seekp((blockNum * 12) + 8, std::ios::beg);
+  m_pStaidxFileStream->write(reinterpret_cast<const char*>(&stamp), sizeof(uint32_t));
+  m_pStaidxFileStream->flush();
+
+  if (complete)
+  {
+    writeBlockHashStamps();
+  }
+}
+
+/**
+ * @brief Stores a stamp the precompute workers calculated for a block of the loaded map in its staidx entry in
+ * memory. A block that has been stamped since the map was loaded keeps its stamp, since a write may have changed the
+ * block after the worker hashed it. The stamps only reach the disk through writeBlockHashStamps().
+ *
+ * @param mapNumber Map Number the stamp was calculated for
+ * @param blockNum Block Number
+ * @param stamp CRC32 of the block, or INVALID_BLOCK_HASH_STAMP if the block could not be found
+ *
+ * @return true if this was the last block of the map without a stamp
+ */
+bool BaseFileManager::recordBlockHashStamp(uint8_t mapNumber, uint32_t blockNum, uint32_t stamp)
+{
+  bool complete = false;
+
+  EnterCriticalSection(&m_blockHashStampLock);
+
+  if (!m_blockHashStampsValid && mapNumber == m_blockHashStampMapNumber && blockNum < m_blockHashStamped.size() && !m_blockHashStamped[blockNum])
+  {
+    *reinterpret_cast<uint32_t*>(m_pStaidxPool + (blockNum * 12) + 8) = stamp;
+    complete = markBlockHashStamped(blockNum);
+  }
+
+  LeaveCriticalSection(&m_blockHashStampLock);
+
+  return complete;
+}
+
+/**
+ * @brief Writes the statics index of the loaded map back to disk in one pass and creates the marker file, once
+ * every block has been stamped. Must be called between BlockHashCache::beginDataUpdate() and endDataUpdate(), so the
+ * index in memory matches the index on disk apart from the stamps.
+ */
+void BaseFileManager::writeBlockHashStamps()
+{
+  EnterCriticalSection(&m_blockHashStampLock);
+
+  if (!m_blockHashStampsValid && m_pStaidxFileStream->is_open() && m_numberOfBlockHashStamps > 0 &&
+    m_numberOfStampedBlocks == m_numberOfBlockHashStamps)
+  {
+    m_pStaidxFileStream->seekp(0, std::ios::beg);
+    m_pStaidxFileStream->write(reinterpret_cast<const char*>(m_pStaidxPool), m_numberOfBlockHashStamps * 12);
+    m_pStaidxFileStream->flush();
+
+    if (m_pStaidxFileStream->good())
+    {
+      std::ofstream markerFile(m_blockHashStampMarkerPath, std::ios::out | std::ios::trunc);
+      markerFile << "UltimaLive block hash stamps: CRC32" << std::endl;
+      markerFile.close();
+
+      m_blockHashStampsValid = true;
+      m_blockHashStamped.clear();
+      Logger::g_pLogger->LogPrint("Block hash stamps: %u blocks of map %i stamped\n", m_numberOfBlockHashStamps, m_blockHashStampMapNumber);
+    }
+  }
+
+  LeaveCriticalSection(&m_blockHashStampLock);
+}
+
+/**
+ * @brief Notes that a block of the loaded map has been stamped. Must be called with the stamp lock held.
+ *
+ * @param blockNum Block Number
+ *
+ * @return true if this was the last block of the map without a stamp
+ */
+bool BaseFileManager::markBlockHashStamped(uint32_t blockNum)
+{
+  if (blockNum >= m_blockHashStamped.size() || m_blockHashStamped[blockNum])
+  {
+    return false;
+  }
+
+  m_blockHashStamped[blockNum] = true;
+  m_numberOfStampedBlocks++;
+
+  return m_numberOfStampedBlocks == m_numberOfBlockHashStamps;
+}
+
+/**
+ * @brief Calculates the stamp of a block: the CRC32 of its land data followed by its statics data
+ *
+ * @param mapNumber Map Number
+ * @param blockNum Block Number
+ *
+ * @return CRC32 of the block, or INVALID_BLOCK_HASH_STAMP if the land block could not be found
+ */
+uint32_t BaseFileManager::calculateBlockHashStamp(uint8_t mapNumber, uint32_t blockNum)
+{
+  const uint8_t* pLandData = viewLandBlock(mapNumber, blockNum);
+
+  if (pLandData == NULL)
+  {
+    return INVALID_BLOCK_HASH_STAMP;
+  }
+
+  uint32_t staticsLength = 0;
+  const uint8_t* pStaticsData = viewStaticsBlock(mapNumber, blockNum, staticsLength);
+
+  uint32_t crc = Crc32::update(Crc32::INITIAL_STATE, pLandData, 192);
+
+  if (pStaticsData != NULL)
+  {
+    crc = Crc32::update(crc, pStaticsData, staticsLength);
+  }
+
+  return ~crc;
+}
+
+/**
+ * @brief Looks up the marker file of a map after it has been loaded and counts its staidx entries, up to the number
+ * of blocks in its map definition. Without a marker every block starts out unstamped. Must be called after the
+ * staidx file stream has been opened.
+ *
+ * @param pathWithoutFilename Folder containing the map files, ending in a path separator
+ * @param mapNumber Map Number
+ */
+void BaseFileManager::loadBlockHashStamps(std::string pathWithoutFilename, uint8_t mapNumber)
+{
+  EnterCriticalSection(&m_blockHashStampLock);
+
+  m_blockHashStampMarkerPath = getBlockHashStampMarkerPath(pathWithoutFilename, mapNumber);
+  m_blockHashStampMapNumber = mapNumber;
+  m_numberOfBlockHashStamps = 0;
+  m_blockHashStampsValid = false;
+  m_blockHashStamped.clear();
+  m_numberOfStampedBlocks = 0;
+
+  if (m_pStaidxFileStream->is_open())
+  {
+    m_pStaidxFileStream->seekp(0, std::ios::end);
+    std::streamoff length = m_pStaidxFileStream->tellp();
+
+    if (length > 0)
+    {
+      m_numberOfBlockHashStamps = static_cast<uint32_t>(min(length, (std::streamoff)STAIDX_MEMORY_SIZE) / 12);
+    }
+
+    if (getMapBlockCount(mapNumber) > 0)
+    {
+      m_numberOfBlockHashStamps = min(m_numberOfBlockHashStamps, getMapBlockCount(mapNumber));
+    }
+
+    m_blockHashStampsValid = PathFileExistsA(m_blockHashStampMarkerPath.c_str()) != FALSE;
+
+    if (!m_blockHashStampsValid)
+    {
+      m_blockHashStamped.assign(m_numberOfBlockHashStamps, false);
+    }
+  }
+
+  LeaveCriticalSection(&m_blockHashStampLock);
+
+  Logger::g_pLogger->LogPrint("Block hash stamps: %s\n", m_blockHashStampsValid ? "valid" : "missing");
+}
+
+/**
+ * @brief Gets the folder in UltimaLive's map cache that holds the map files of the current shard
+ *
+ * @return Folder path, ending in a path separator
+ */
+std::string BaseFileManager::getShardMapFolder()
+{
+  std::string filenameAndPath = getUltimaLiveSavePath();
+  if (m_shardIdentifier != "")
+  {
+    filenameAndPath.append(m_shardIdentifier);
+    filenameAndPath.append("\\");
+  }
+
+  return filenameAndPath;
+}
+
+/**
+ * @brief Gets the path of the marker file that vouches for the hash stamps in a staidx file
+ *
+ * @param pathWithoutFilename Folder containing the map files, ending in a path separator
+ * @param mapNumber Map Number
+ *
+ * @return Marker file path
+ */
+std::string BaseFileManager::getBlockHashStampMarkerPath(std::string pathWithoutFilename, uint8_t mapNumber)
+{
+  char filename[32];
+  sprintf_s(filename, "staidx%i.crc", mapNumber);
+  pathWithoutFilename.append(filename);
+
+  return pathWithoutFilename;
+}
+
 /** 
  * @brief Initializes the BaseFileManager by allocating memory internally in the client for maps, statics, and indices
  * 
@@ -262,31 +562,133 @@ bool BaseFileManager::Initialize()
 
   bool success = true;
 
-  Logger::g_pLogger->LogPrintWithoutDate("   Allocating %-12i bytes for client map handling                 ", MAP_MEMORY_SIZE);
-  m_pMapPool = reinterpret_cast<uint8_t*>(VirtualAlloc(NULL, MAP_MEMORY_SIZE, MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+  //pool addresses are handed to the client before the server sends its map definitions, so the largest possible
+  //files are reserved up front and pages are only committed as maps are loaded
+  Logger::g_pLogger->LogPrintWithoutDate("   Reserving  %-12i bytes for client map handling                 ", MAP_MEMORY_SIZE);
+  m_mapPool.reserve("map", MAP_MEMORY_SIZE);
+  m_pMapPool = m_mapPool.getBase();
   Logger::g_pLogger->LogPrintWithoutDate(" [0x%08x] ", m_pMapPool);
   checkValidMemoryAllocated(m_pMapPool);
 
   if (success)
   {
-    Logger::g_pLogger->LogPrintWithoutDate("   Allocating %-12i bytes for client statics index handling       ", STAIDX_MEMORY_SIZE);
-    m_pStaidxPool = reinterpret_cast<uint8_t*>(VirtualAlloc(NULL, STAIDX_MEMORY_SIZE, MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+    Logger::g_pLogger->LogPrintWithoutDate("   Reserving  %-12i bytes for client statics index handling       ", STAIDX_MEMORY_SIZE);
+    m_staidxPool.reserve("staidx", STAIDX_MEMORY_SIZE);
+    m_pStaidxPool = m_staidxPool.getBase();
     Logger::g_pLogger->LogPrintWithoutDate(" [0x%08x] ", m_pStaidxPool);
     checkValidMemoryAllocated(m_pStaidxPool);
   }
 
   if (success)
   {
-    Logger::g_pLogger->LogPrintWithoutDate("   Allocating %-12i bytes for client statics handling             ", STATICS_MEMORY_SIZE);
-    m_pStaticsPool = reinterpret_cast<uint8_t*>(VirtualAlloc(NULL, STATICS_MEMORY_SIZE, MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+    Logger::g_pLogger->LogPrintWithoutDate("   Reserving  %-12i bytes for client statics handling             ", STATICS_MEMORY_SIZE);
+    m_staticsPool.reserve("statics", STATICS_MEMORY_SIZE);
+    m_pStaticsPool = m_staticsPool.getBase();
     m_pStaticsPoolEnd = m_pStaticsPool;
     Logger::g_pLogger->LogPrintWithoutDate(" [0x%08x] ", m_pStaticsPool);
     checkValidMemoryAllocated(m_pStaidxPool);
   }
 
+  //map files are mapped over the pools unless [Maps] MappedLoad=0 in UltimaLive.ini or the system lacks placeholders
+  m_mappedLoad = Utils::GetSettingInt("Maps", "MappedLoad", 1) != 0;
+
+  if (m_mappedLoad && !ReservedPool::supportsViews())
+  {
+    Logger::g_pLogger->LogPrint("Mapped loading needs Windows 10 version 1803 or later, map files are read instead\n");
+    m_mappedLoad = false;
+  }
+
   return success;
 }
 
+/**
+ * @brief Loads a file into the start of a memory pool. The file is mapped over the pool when mapped loading is on,
+ *        so pages are read from disk as the client touches them, and read into the pool otherwise or if it cannot
+ *        be mapped. Pages the previous map needed past the end of the file are decommitted, apart from the floor
+ *        the client reads.
+ *
+ * @param filePath Path of the file
+ * @param rMappedFile Mapping of the pool, unmapped first if it holds the file of another map
+ * @param rPool Pool to load the file into
+ * @param definedSize Size of the file according to the map definitions, committed even if the file is shorter
+ * @param rLengthOut Receives the number of bytes of the file in the pool
+ *
+ * @return true if the file could be opened
+ */
+bool BaseFileManager::loadPool(std::string filePath, MappedFile& rMappedFile, ReservedPool& rPool, uint32_t definedSize, uint32_t& rLengthOut)
+{
+  rLengthOut = 0;
+
+  if (m_mappedLoad && rMappedFile.mapOver(filePath, rPool, rLengthOut))
+  {
+    rPool.commit(definedSize);
+    return true;
+  }
+
+  if (!rMappedFile.unmap())
+  {
+    return false;
+  }
+
+  rPool.decommit();
+  rPool.commit(definedSize);
+
+  std::ifstream file;
+  file.open(filePath, std::ios::binary | std::ios::in);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  file.seekg(0, file.end);
+  std::streamoff length = file.tellg();
+  if (length > 0)
+  {
+    rLengthOut = (uint32_t)min(length, (std::streamoff)rPool.getReservedSize());
+    rPool.commit(rLengthOut);
+    rLengthOut = min(rLengthOut, rPool.getCommittedSize());
+    file.seekg(0, file.beg);
+    file.read(reinterpret_cast<char*>(rPool.getBase()), rLengthOut);
+  }
+
+  file.close();
+  return true;
+}
+
+/**
+ * @brief Commits the part of a pool the client can read after it is handed out in place of a view of a client file.
+ *        The client takes the pool to be its own file, so the pool keeps that much committed whatever map is loaded.
+ *
+ * @param rPool Pool handed to the client
+ * @param pFileset Handles of the client file
+ * @param numberOfBytesToMap Size of the view the client asked for, 0 for the whole file
+ */
+void BaseFileManager::commitClientView(ReservedPool& rPool, ClientFileHandleSet* pFileset, SIZE_T numberOfBytesToMap)
+{
+  uint32_t size = static_cast<uint32_t>(numberOfBytesToMap);
+  LARGE_INTEGER fileSize;
+
+  if (size == 0 && GetFileSizeEx(pFileset->m_createFileHandle, &fileSize))
+  {
+    size = (fileSize.HighPart != 0) ? rPool.getReservedSize() : fileSize.LowPart;
+  }
+
+  rPool.commitFloor(size);
+}
+
+/**
+ * @brief Gets the number of blocks in a map of the shard
+ *
+ * @param mapNumber Map Number
+ *
+ * @return Number of blocks given by the map definition, 0 if the shard did not define the map
+ */
+uint32_t BaseFileManager::getMapBlockCount(uint8_t mapNumber)
+{
+  std::map<uint32_t, uint32_t>::iterator itr = m_mapBlockCounts.find(mapNumber);
+  return (itr != m_mapBlockCounts.end()) ? itr->second : 0;
+}
+
 /** 
  * @brief handles client logout and prepares UltimaLive for a new login
  */
@@ -311,6 +713,11 @@ void BaseFileManager::onLogout()
     m_pStaticsFileStream->flush();
     m_pStaticsFileStream->close();
   }
+
+  //the shard's files may be replaced before the next login, which is not possible while they are mapped
+  m_mappedMapFile.unmap();
+  m_mappedStaidxFile.unmap();
+  m_mappedStaticsFile.unmap();
 }
 
 /** 
@@ -480,8 +887,12 @@ void BaseFileManager::InitializeShardMaps(std::string shardIdentifier, std::map<
   shardFullPath.append(shardIdentifier);
   CreateDirectoryA(shardFullPath.c_str(), NULL);
 
+  m_mapBlockCounts.clear();
+
   for (std::map<uint32_t, MapDefinition>::iterator itr = mapDefinitions.begin(); itr != mapDefinitions.end(); itr++)
   {
+    m_mapBlockCounts[itr->first] = (itr->second.mapWidthInTiles >> 3) * (itr->second.mapHeightInTiles >> 3);
+
     std::string filePath(shardFullPath);
     filePath.append("\\");
     char filename[32];
@@ -497,6 +908,9 @@ void BaseFileManager::InitializeShardMaps(std::string shardIdentifier, std::map<
     }
     else
     {
+      //freshly copied or created files carry no hash stamps
+      DeleteFileA(getBlockHashStampMarkerPath(shardFullPath + "\\", static_cast<uint8_t>(itr->first)).c_str());
+
       //copy existing maps if they match the dimensions specified in the map definitions
       uint32_t fileSizeNeeded = (itr->second.mapWidthInTiles >> 3) * (itr->second.mapHeightInTiles >> 3) * 196;
 
@@ -621,9 +1035,23 @@ BaseFileManager::BaseFileManager()
   m_pMapFileStream(new std::ofstream()),
   m_pStaidxFileStream(new std::ofstream()),
   m_pStaticsFileStream(new std::ofstream()),
-  m_pProgressDlg()
+  m_pProgressDlg(),
+  m_blockHashStampMarkerPath(""),
+  m_numberOfBlockHashStamps(0),
+  m_blockHashStampsValid(false),
+  m_blockHashStampMapNumber(0),
+  m_blockHashStamped(),
+  m_numberOfStampedBlocks(0),
+  m_mappedLoad(false),
+  m_mappedMapFile(),
+  m_mappedStaidxFile(),
+  m_mappedStaticsFile(),
+  m_mapPool(),
+  m_staidxPool(),
+  m_staticsPool(),
+  m_mapBlockCounts()
 {
-  //do nothing
+  InitializeCriticalSection(&m_blockHashStampLock);
 }
 
 /**
@@ -29,11 +29,14 @@
 #include <fstream>
 #include <map>
 #include <string>
+#include <vector>
 #include <stdio.h>
 #include <Windows.h>
 
 #include "ClientFileHandleSet.h"
-#include "BaseFileManager.h"
+#include "MapBlockReader.h"
+#include "MappedFile.h"
+#include "ReservedPool.h"
 #include "..\Utils.h"
 #include "..\ProgressBarDialog.h"
 #include "..\ClassRegistration\SelfRegisteringClass.h"
@@ -53,7 +56,7 @@ class LoginHandler;
  * The file manager will redirect the client to open files from alternate folders, alter files that are on disk, 
  * create new map files, defragment files, and any other filesystem type tasks.
  */
-class BaseFileManager
+class BaseFileManager : public MapBlockReader
 {
   public:
     BaseFileManager();
@@ -88,6 +91,7 @@ class BaseFileManager
   virtual BOOL WINAPI OnCloseHandle(_In_  HANDLE hObject);
 
   virtual unsigned char* readStaticsBlock(uint32_t mapNumber, uint32_t blockNum, uint32_t& rNumberOfBytesOut);
+  virtual const uint8_t* viewStaticsBlock(uint32_t mapNumber, uint32_t blockNum, uint32_t& rNumberOfBytesOut);
   virtual bool writeStaticsBlock(uint8_t mapNumber, uint32_t blockNum, uint8_t* pBlockData, uint32_t length);
   virtual bool Initialize();
 
@@ -102,6 +106,15 @@ class BaseFileManager
   virtual void onLogout();
   virtual bool updateLandBlock(uint8_t mapNumber, uint32_t blockNum, uint8_t* pData);
   virtual unsigned char* readLandBlock(uint8_t mapNumber, uint32_t blockNum);
+  virtual const uint8_t* viewLandBlock(uint8_t mapNumber, uint32_t blockNum);
+
+  virtual bool hasBlockHashStamps();
+  virtual uint32_t getBlockHashStamp(uint32_t blockNum);
+  virtual void stampBlockHash(uint8_t mapNumber, uint32_t blockNum);
+  virtual bool recordBlockHashStamp(uint8_t mapNumber, uint32_t blockNum, uint32_t stamp);
+  virtual void writeBlockHashStamps();
+  std::string getShardMapFolder();
+  static std::string getBlockHashStampMarkerPath(std::string pathWithoutFilename, uint8_t mapNumber);
 
   /**
    * @brief Seeks a land block in map file
@@ -115,9 +128,10 @@ class BaseFileManager
 
   static void copyFile(std::string sourceFilePath, std::string destFilePath, ProgressBarDialog* pProgress);
 
-  static const int MAP_MEMORY_SIZE = 100000000;     //!< Memory to allocate for the largest possible map file  
-  static const int STAIDX_MEMORY_SIZE = 10000000;	//!< Memory to allocate for the largest possible statics index file
-  static const int STATICS_MEMORY_SIZE = 200000000;	//!< Memory to allocate for the largets possible statics file
+  static const int MAP_MEMORY_SIZE = 100000000;     //!< Address space to reserve for the largest possible map file  
+  static const int STAIDX_MEMORY_SIZE = 10000000;	//!< Address space to reserve for the largest possible statics index file
+  static const int STATICS_MEMORY_SIZE = 200000000;	//!< Address space to reserve for the largets possible statics file
+  static const uint32_t INVALID_BLOCK_HASH_STAMP = 0xFFFFFFFF; //!< Stamp of a block whose hash is not known
 
 protected:
   std::map<std::string, ClientFileHandleSet*> m_files; //!< Maps the base map name to the set of handles for the corresponding files (map#.mul, staidx#.mul statics#.mul)
@@ -136,5 +150,30 @@ protected:
   bool checkValidMemoryAllocated(void* pBuffer);
 
   ProgressBarDialog* m_pProgressDlg; //!< Pointer to the progress bar dialog
+
+  bool loadPool(std::string filePath, MappedFile& rMappedFile, ReservedPool& rPool, uint32_t definedSize, uint32_t& rLengthOut);
+  void commitClientView(ReservedPool& rPool, ClientFileHandleSet* pFileset, SIZE_T numberOfBytesToMap);
+  uint32_t getMapBlockCount(uint8_t mapNumber);
+  void loadBlockHashStamps(std::string pathWithoutFilename, uint8_t mapNumber);
+  uint32_t calculateBlockHashStamp(uint8_t mapNumber, uint32_t blockNum);
+  bool markBlockHashStamped(uint32_t blockNum);
+
+  std::string m_blockHashStampMarkerPath; //!< Path of the marker file that vouches for the stamps of the loaded map
+  uint32_t m_numberOfBlockHashStamps;     //!< Number of staidx entries on disk for the loaded map
+  bool m_blockHashStampsValid;            //!< Indicates if the staidx stamps of the loaded map can be trusted
+  uint8_t m_blockHashStampMapNumber;      //!< Map number of the loaded map the stamps belong to
+  std::vector<bool> m_blockHashStamped;   //!< Blocks of the loaded map stamped since it was loaded, only used while the marker is missing
+  uint32_t m_numberOfStampedBlocks;       //!< Number of blocks set in m_blockHashStamped
+  CRITICAL_SECTION m_blockHashStampLock;  //!< Guards the stamps in the statics index pool, written by the network thread and the precompute workers
+
+  bool m_mappedLoad;                //!< Indicates if map files are mapped over the pools instead of read into them
+  MappedFile m_mappedMapFile;       //!< map#.mul of the loaded map when it is mapped over the map pool
+  MappedFile m_mappedStaidxFile;    //!< staidx#.mul of the loaded map when it is mapped over the statics index pool
+  MappedFile m_mappedStaticsFile;   //!< statics#.mul of the loaded map when it is mapped over the statics pool
+
+  ReservedPool m_mapPool;       //!< Address space of the map pool, m_pMapPool is its base
+  ReservedPool m_staidxPool;    //!< Address space of the statics index pool, m_pStaidxPool is its base
+  ReservedPool m_staticsPool;   //!< Address space of the statics pool, m_pStaticsPool is its base
+  std::map<uint32_t, uint32_t> m_mapBlockCounts; //!< Number of blocks in each map of the shard, from its map definitions
 };
 #endif
\ No newline at end of file
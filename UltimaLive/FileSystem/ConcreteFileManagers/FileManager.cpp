@@ -80,12 +80,7 @@ void FileManager::LoadMap(uint8_t mapNumber)
     m_pStaticsFileStream->close();
   }
 
-  std::string filenameAndPath = BaseFileManager::getUltimaLiveSavePath();
-  if (m_shardIdentifier != "")
-  {
-    filenameAndPath.append(m_shardIdentifier);
-    filenameAndPath.append("\\");
-  }
+  std::string filenameAndPath = getShardMapFolder();
 
   std::string mapFileNameAndPath(filenameAndPath);
   char filename[32];
@@ -100,61 +95,27 @@ void FileManager::LoadMap(uint8_t mapNumber)
   sprintf_s(filename, "statics%i.mul", mapNumber);
   staticsFileNameAndPath.append(filename);
 
-  Logger::g_pLogger->LogPrint("Loading Map: %s\n", mapFileNameAndPath.c_str());
-
-  std::ifstream mapFile;
-  mapFile.open(mapFileNameAndPath, std::ios::binary | std::ios::in);
-  if (mapFile.is_open())
-  {
-    mapFile.seekg (0, mapFile.end);
-    std::streamoff length = mapFile.tellg();
-    if (length > 0)
-    {
-      mapFile.seekg (0, mapFile.beg);
-      mapFile.read(reinterpret_cast<char*>(m_pMapPool), length);
-    }
+  uint32_t length = 0;
+  uint32_t numberOfBlocks = getMapBlockCount(mapNumber);
 
-    mapFile.close();
-  }
+  Logger::g_pLogger->LogPrint("Loading Map: %s\n", mapFileNameAndPath.c_str());
+  loadPool(mapFileNameAndPath, m_mappedMapFile, m_mapPool, numberOfBlocks * 196, length);
 
   Logger::g_pLogger->LogPrint("Loading Staidx: %s\n", staidxFileNameAndPath.c_str());
-
-  std::ifstream staidxFile;
-  staidxFile.open(staidxFileNameAndPath, std::ios::binary | std::ios::in);
-
-  if (staidxFile.is_open())
-  {
-    staidxFile.seekg (0, staidxFile.end);
-    std::streamoff length = staidxFile.tellg();
-    if (length > 0)
-    {
-      staidxFile.seekg (0, staidxFile.beg);
-      staidxFile.read(reinterpret_cast<char*>(m_pStaidxPool), length);
-    }
-    staidxFile.close();
-  }
+  loadPool(staidxFileNameAndPath, m_mappedStaidxFile, m_staidxPool, numberOfBlocks * 12, length);
 
   Logger::g_pLogger->LogPrint("Loading Statics: %s\n", staticsFileNameAndPath.c_str());
-
-  std::ifstream staticsFile;
-  staticsFile.open(staticsFileNameAndPath, std::ios::binary | std::ios::in);
-  if (staticsFile.is_open())
+  if (loadPool(staticsFileNameAndPath, m_mappedStaticsFile, m_staticsPool, 0, length))
   {
-    staticsFile.seekg (0, staticsFile.end);
-    std::streamoff length = staticsFile.tellg();
-    if (length > 0)
-    {
-      staticsFile.seekg (0, staticsFile.beg);
-      staticsFile.read(reinterpret_cast<char*>(m_pStaticsPool), length);
-    }
     m_pStaticsPoolEnd = m_pStaticsPool + length;
-    staticsFile.close();
   }
 
   m_pMapFileStream->open(mapFileNameAndPath, std::ios::out | std::ios::in | std::ios::binary);
   m_pStaidxFileStream->open(staidxFileNameAndPath, std::ios::out | std::ios::in | std::ios::binary);
   m_pStaticsFileStream->open(staticsFileNameAndPath, std::ios::out | std::ios::in | std::ios::binary);
 
+  loadBlockHashStamps(filenameAndPath, mapNumber);
+
   Logger::g_pLogger->LogPrint("Finished Loading Map!\n");
 }
 
@@ -204,14 +165,17 @@ LPVOID WINAPI FileManager::OnMapViewOfFile(
       if (shortFilename.find("map") != std::string::npos)
       {
           handleToReturn = m_pMapPool;
+          commitClientView(m_mapPool, pMatchingFileset, dwNumberOfBytesToMap);
       }
       else if (shortFilename.find("statics") != std::string::npos)
       {
         handleToReturn = m_pStaticsPool;
+        commitClientView(m_staticsPool, pMatchingFileset, dwNumberOfBytesToMap);
       }
       else if (shortFilename.find("staidx") != std::string::npos)
       {
         handleToReturn = m_pStaidxPool;
+        commitClientView(m_staidxPool, pMatchingFileset, dwNumberOfBytesToMap);
       }
     }
   }
@@ -25,6 +25,7 @@
 
 #include "FileManager_7_0_29_2.h"
 #include <cstdio>
+#include "..\Uop\UopArchive.h"
 #include "..\Uop\UopUtility.h"
 #include "..\..\Maps\MapDefinition.h"
 
@@ -34,6 +35,7 @@
 FileManager_7_0_29_2::FileManager_7_0_29_2()
   : BaseFileManager(),
     m_fileEntries(),
+    m_dataIndex(),
     m_neededFiles()
 {
   m_neededFiles["map0LegacyMUL.uop"] = 0;
@@ -83,12 +85,7 @@ void FileManager_7_0_29_2::LoadMap(uint8_t mapNumber)
     m_pStaticsFileStream->close();
   }
 
-  std::string filenameAndPath = BaseFileManager::getUltimaLiveSavePath();
-  if (m_shardIdentifier != "")
-  {
-    filenameAndPath.append(m_shardIdentifier);
-    filenameAndPath.append("\\");
-  }
+  std::string filenameAndPath = getShardMapFolder();
 
   std::string mapFileNameAndPath(filenameAndPath);
   char filename[32];
@@ -105,52 +102,45 @@ void FileManager_7_0_29_2::LoadMap(uint8_t mapNumber)
 
   Logger::g_pLogger->LogPrint("******************Loading Map: %s *************************\n", mapFileNameAndPath.c_str());
 
+  //the pool holds the map in the layout of the uop file, so unlike the statics it cannot be mapped from the mul file
   std::ifstream mapFile;
   mapFile.open(mapFileNameAndPath, std::ios::binary | std::ios::in);
   if (mapFile.is_open())
   {
-    int numFilesInMap = m_fileEntries.size();
-    for (int i = 0; i < numFilesInMap; i++)
+    //only the contiguous run of entries parseMapFile indexed holds map data, it stops at the first missing entry
+    for (uint32_t i = 0; i < m_dataIndex.getNumberOfEntries(); i++)
     {
-      FileEntry* pCurrentEntry = m_fileEntries[i];
-      char* offset = reinterpret_cast<char*>(m_pMapPool + pCurrentEntry->MetaDataSize + pCurrentEntry->UopFileOffset);
-      mapFile.read(offset, pCurrentEntry->UncompressedDataSize);
+      uint32_t entryOffset = m_dataIndex.getPoolOffset(i);
+      uint32_t entrySize = m_dataIndex.getDataSize(i);
+
+      if (!m_mapPool.commit(entryOffset + entrySize))
+      {
+        break;
+      }
+
+      char* offset = reinterpret_cast<char*>(m_pMapPool + entryOffset);
+      mapFile.read(offset, entrySize);
     }
     mapFile.close();
   }
 
-  Logger::g_pLogger->LogPrint("******************Loading Staidx: %s *************************\n", staidxFileNameAndPath.c_str());
+  uint32_t length = 0;
 
-  std::ifstream staidxFile;
-  staidxFile.open(staidxFileNameAndPath, std::ios::binary | std::ios::in);
-
-  if (staidxFile.is_open())
-  {
-    staidxFile.seekg (0, staidxFile.end);
-    std::streamoff length = staidxFile.tellg();
-    staidxFile.seekg (0, staidxFile.beg);
-    staidxFile.read(reinterpret_cast<char*>(m_pStaidxPool), length);
-    staidxFile.close();
-  }
+  Logger::g_pLogger->LogPrint("******************Loading Staidx: %s *************************\n", staidxFileNameAndPath.c_str());
+  loadPool(staidxFileNameAndPath, m_mappedStaidxFile, m_staidxPool, getMapBlockCount(mapNumber) * 12, length);
 
   Logger::g_pLogger->LogPrint("******************Loading Statics: %s *************************\n", staticsFileNameAndPath.c_str());
-
-  std::ifstream staticsFile;
-  staticsFile.open(staticsFileNameAndPath, std::ios::binary | std::ios::in);
-  if (staticsFile.is_open())
+  if (loadPool(staticsFileNameAndPath, m_mappedStaticsFile, m_staticsPool, 0, length))
   {
-    staticsFile.seekg (0, staticsFile.end);
-    std::streamoff length = staticsFile.tellg();
-    staticsFile.seekg (0, staticsFile.beg);
-    staticsFile.read(reinterpret_cast<char*>(m_pStaticsPool), length);
     m_pStaticsPoolEnd = m_pStaticsPool + length;
-    staticsFile.close();
   }
 
   m_pMapFileStream->open(mapFileNameAndPath, std::ios::out | std::ios::in | std::ios::binary);
   m_pStaidxFileStream->open(staidxFileNameAndPath, std::ios::out | std::ios::in | std::ios::binary);
   m_pStaticsFileStream->open(staticsFileNameAndPath, std::ios::out | std::ios::in | std::ios::binary);
 
+  loadBlockHashStamps(filenameAndPath, mapNumber);
+
   Logger::g_pLogger->LogPrint("##################   Finished Loading Map!\n");
 }
 
@@ -210,33 +200,39 @@ LPVOID WINAPI FileManager_7_0_29_2::OnMapViewOfFile(
       if (shortFilename.find("map") != std::string::npos)
       {
         handleToReturn = m_pMapPool;
+        commitClientView(m_mapPool, pMatchingFileset, dwNumberOfBytesToMap);
 
         if (shortFilename == "map0LegacyMUL.uop")
         {
           std::ifstream map0(m_files["map0LegacyMUL.uop"]->m_filename, std::ios::in|std::ios::binary);
+          uint32_t mapLength = 0;
 
           if (map0.is_open())
           {
             map0.seekg (0, map0.end);
             std::streamoff length = map0.tellg();
             map0.seekg (0, map0.beg);
-            map0.read(reinterpret_cast<char*>(m_pMapPool), length);
+            m_mapPool.commit(static_cast<uint32_t>(length));
+            mapLength = static_cast<uint32_t>(min(length, (std::streamoff)m_mapPool.getCommittedSize()));
+            map0.read(reinterpret_cast<char*>(m_pMapPool), mapLength);
             map0.close();
           }
           else
           {
             Logger::g_pLogger->LogPrint("FAILED TO OPEN FILE\n");
           }
-          parseMapFile("map0legacymul");
+          parseMapFile("map0legacymul", mapLength);
         }
       }
       else if (shortFilename.find("statics") != std::string::npos)
       {
         handleToReturn = m_pStaticsPool;
+        commitClientView(m_staticsPool, pMatchingFileset, dwNumberOfBytesToMap);
       }
       else if (shortFilename.find("staidx") != std::string::npos)
       {
         handleToReturn = m_pStaidxPool;
+        commitClientView(m_staidxPool, pMatchingFileset, dwNumberOfBytesToMap);
       }
     }
   }
@@ -258,33 +254,44 @@ LPVOID WINAPI FileManager_7_0_29_2::OnMapViewOfFile(
  *        the UltimaLive Shared memory
  *
  * @param filename map filename
+ * @param length Number of bytes of the UOP file in the map pool
  */
-void FileManager_7_0_29_2::parseMapFile(std::string filename)
+void FileManager_7_0_29_2::parseMapFile(std::string filename, uint32_t length)
 {
-  UopHeader header; 
-  header.unmarshal(m_pMapPool);
-  
-  std::map<uint32_t, uint64_t>* pHashes = UopUtility::getMapHashes(header.TotalFiles, filename);
-  
-  //unmarshal file table
-  FileTable table;
-  table.unmarshal(m_pMapPool + header.FileTableOffset);
-  
-  //make a list of file entries and map them in order
-  for (uint32_t i = 0; i < header.TotalFiles; ++i)
+  for (std::map<uint32_t, FileEntry*>::iterator itr = m_fileEntries.begin(); itr != m_fileEntries.end(); itr++)
   {
-    //find the corresponding FileEntry
-    for (uint32_t j = 0; j < header.TotalFiles; ++j)
+    delete itr->second;
+  }
+
+  m_fileEntries.clear();
+  m_dataIndex.clear();
+
+  //the map pool holds the whole archive, so its file tables are read from memory
+  UopArchive archive;
+  if (!archive.load(m_pMapPool, length))
+  {
+    Logger::g_pLogger->LogPrintError("Unable to read the file tables of %s\n", filename.c_str());
+    return;
+  }
+
+  uint32_t totalFiles = archive.getTotalFiles();
+  std::vector<uint64_t> hashes = UopUtility::getMapHashes(totalFiles, filename);
+
+  //map the file entries in order up to the first one missing from the archive, so every index below the size of
+  //m_fileEntries exists, and index where their data lies for seekLandBlock
+  for (uint32_t i = 0; i < totalFiles; ++i)
+  {
+    const FileEntry* pEntry = archive.findEntry(hashes[i]);
+    if (pEntry == NULL)
     {
-      if ((*pHashes)[i] == table.pEntries[j].PathChecksum)
-      {
-        m_fileEntries[i] = new FileEntry(table.pEntries[j]);
-        break;
-      }
+      Logger::g_pLogger->LogPrintError("UOP file %u is missing from %s, the map stops there\n", i, filename.c_str());
+      break;
     }
-  }
 
-  delete pHashes;
+    m_fileEntries[i] = new FileEntry(*pEntry);
+
+    m_dataIndex.addEntry(static_cast<uint32_t>(pEntry->UopFileOffset + pEntry->MetaDataSize), pEntry->UncompressedDataSize);
+  }
 }
 
 /**
@@ -297,29 +304,13 @@ void FileManager_7_0_29_2::parseMapFile(std::string filename)
  */
 unsigned char* FileManager_7_0_29_2::seekLandBlock(uint8_t, uint32_t blockNum)
 {
-  uint8_t* pData = NULL;
-  uint32_t blockSeekLocation = blockNum * 196;
-  int numFilesInMap = m_fileEntries.size();
-  uint32_t fileSeekLocation = 0;
-    
-  for (int i = 0; i < numFilesInMap; i++)
+  uint32_t poolOffset = 0;
+  if (!m_dataIndex.find(blockNum * 196, poolOffset))
   {
-    FileEntry* pCurrentEntry = m_fileEntries[i];
-    
-    if (blockSeekLocation < (fileSeekLocation + pCurrentEntry->UncompressedDataSize))
-    {
-      uint32_t blockOffset = blockSeekLocation - fileSeekLocation;
-      uint32_t fileViewAddress = (uint32_t)m_pMapPool;
-      uint32_t fileEntryAddress = static_cast<uint32_t>(fileViewAddress + pCurrentEntry->UopFileOffset);
-      pData = reinterpret_cast<unsigned char*>(fileEntryAddress + blockOffset + pCurrentEntry->MetaDataSize + 4);
-    
-      break;
-    }
-    
-    fileSeekLocation += pCurrentEntry->UncompressedDataSize;
+    return NULL;
   }
 
-  return pData;
+  return m_pMapPool + poolOffset + 4;
 }
 
 /**
@@ -342,8 +333,12 @@ void FileManager_7_0_29_2::InitializeShardMaps(std::string shardIdentifier, std:
   shardFullPath.append(shardIdentifier);
   CreateDirectoryA(shardFullPath.c_str(), NULL);
 
+  m_mapBlockCounts.clear();
+
   for (std::map<uint32_t, MapDefinition>::iterator itr = mapDefinitions.begin(); itr != mapDefinitions.end(); itr++)
   {
+    m_mapBlockCounts[itr->first] = (itr->second.mapWidthInTiles >> 3) * (itr->second.mapHeightInTiles >> 3);
+
     std::string filePath(shardFullPath);
     filePath.append("\\");
     char filename[32];
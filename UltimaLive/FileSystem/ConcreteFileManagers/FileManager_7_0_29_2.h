@@ -28,17 +28,20 @@
 #define _FILE_MANAGER_7_0_29_2_H
 
 #include "..\BaseFileManager.h"
+#include "..\Uop\UopDataIndex.h"
 #include "..\Uop\UopStructs.h"
 #include "..\Uop\UopUtility.h"
 #include "..\..\Utils.h"
 #include "..\..\LocalPeHelper32.hpp"
 
 #include <Windows.h>
+#include <algorithm>
 #include <list>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <vector>
 #include <stdint.h>
 
 /**
@@ -65,9 +68,10 @@ class FileManager_7_0_29_2 : public BaseFileManager
     void LoadMap(uint8_t mapNumber);
   protected:
     std::map<uint32_t, FileEntry*> m_fileEntries; //!< file entries in the UOP file
+    UopDataIndex m_dataIndex;                     //!< Locates the map data of the file entries in the map pool, in map order
     std::map<std::string, uint32_t> m_neededFiles; //!< files needed by this File Manager
     unsigned char* seekLandBlock(uint8_t mapNumber, uint32_t blockNum);
 
-    void parseMapFile(std::string filename);
+    void parseMapFile(std::string filename, uint32_t length);
 };
 #endif
\ No newline at end of file
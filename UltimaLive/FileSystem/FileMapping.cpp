@@ -0,0 +1,235 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FileMapping.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief FileMapping constructor
+ */
+FileMapping::FileMapping()
+  :
+#if defined(_WIN32)
+  m_fileHandle(INVALID_HANDLE_VALUE),
+  m_mappingHandle(NULL),
+#else
+  m_fileDescriptor(-1),
+#endif
+  m_open(false),
+  m_fileSize(0)
+{
+  //do nothing
+}
+
+/**
+ * @brief FileMapping destructor, closes the file. Views mapped from it stay valid until they are unmapped.
+ */
+FileMapping::~FileMapping()
+{
+  close();
+}
+
+/**
+ * @brief Opens a file for copy-on-write views, closing the file that was open before
+ *
+ * @param filePath Path of the file
+ *
+ * @return true if the file is open
+ */
+bool FileMapping::open(std::string filePath)
+{
+  close();
+
+#if defined(_WIN32)
+  m_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (m_fileHandle == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(m_fileHandle, &size))
+  {
+    close();
+    return false;
+  }
+
+  m_fileSize = static_cast<uint64_t>(size.QuadPart);
+
+  //empty files cannot be mapped
+  if (m_fileSize > 0)
+  {
+    m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (m_mappingHandle == NULL)
+    {
+      close();
+      return false;
+    }
+  }
+#else
+  m_fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+  if (m_fileDescriptor < 0)
+  {
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(m_fileDescriptor, &status) != 0)
+  {
+    close();
+    return false;
+  }
+
+  m_fileSize = static_cast<uint64_t>(status.st_size);
+#endif
+
+  m_open = true;
+  return true;
+}
+
+/**
+ * @brief Closes the file, does nothing if no file is open
+ */
+void FileMapping::close()
+{
+#if defined(_WIN32)
+  if (m_mappingHandle != NULL)
+  {
+    CloseHandle(m_mappingHandle);
+    m_mappingHandle = NULL;
+  }
+
+  if (m_fileHandle != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(m_fileHandle);
+    m_fileHandle = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (m_fileDescriptor >= 0)
+  {
+    ::close(m_fileDescriptor);
+    m_fileDescriptor = -1;
+  }
+#endif
+
+  m_open = false;
+  m_fileSize = 0;
+}
+
+/**
+ * @brief Checks if a file is open
+ *
+ * @return true if a file is open
+ */
+bool FileMapping::isOpen()
+{
+  return m_open;
+}
+
+/**
+ * @brief Gets the size of the open file
+ *
+ * @return Size in bytes, 0 if no file is open
+ */
+uint64_t FileMapping::getFileSize()
+{
+  return m_fileSize;
+}
+
+/**
+ * @brief Maps a copy-on-write view of the start of the file
+ *
+ * @param viewSize Size of the view, at most the size of the file
+ *
+ * @return Start of the view, NULL on failure
+ */
+uint8_t* FileMapping::mapView(uint32_t viewSize)
+{
+  if (!m_open || viewSize == 0 || viewSize > m_fileSize)
+  {
+    return NULL;
+  }
+
+#if defined(_WIN32)
+  return static_cast<uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_COPY, 0, 0, viewSize));
+#else
+  void* pView = mmap(NULL, viewSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fileDescriptor, 0);
+  return (pView != MAP_FAILED) ? static_cast<uint8_t*>(pView) : NULL;
+#endif
+}
+
+/**
+ * @brief Unmaps a view returned by mapView, dropping the changes made to it
+ *
+ * @param pView Start of the view
+ * @param viewSize Size the view was mapped with
+ */
+void FileMapping::unmapView(uint8_t* pView, uint32_t viewSize)
+{
+  if (pView == NULL)
+  {
+    return;
+  }
+
+#if defined(_WIN32)
+  UNREFERENCED_PARAMETER(viewSize);
+  UnmapViewOfFile(pView);
+#else
+  munmap(pView, viewSize);
+#endif
+}
+
+/**
+ * @brief Gets the granularity views are mapped at, the allocation granularity on Windows and the page size elsewhere
+ *
+ * @return Granularity in bytes
+ */
+uint32_t FileMapping::getGranularity()
+{
+#if defined(_WIN32)
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return systemInfo.dwAllocationGranularity;
+#else
+  return static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#if defined(_WIN32)
+/**
+ * @brief Gets the handle of the file mapping, for mapping views in place with the placeholder functions
+ *
+ * @return Handle of the mapping, NULL if no file is open or the file is empty
+ */
+HANDLE FileMapping::getMappingHandle()
+{
+  return m_mappingHandle;
+}
+#endif
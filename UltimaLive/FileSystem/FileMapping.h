@@ -0,0 +1,77 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _FILE_MAPPING_H
+#define _FILE_MAPPING_H
+
+#include <stdint.h>
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+/**
+ * @class FileMapping
+ *
+ * @brief Copy-on-write mapping of a file, over CreateFileMapping on Windows and mmap elsewhere. Views of the mapping
+ * are read from the file the first time their pages are touched, and writes to them stay private to the process.
+ *
+ * Views are mapped wherever the system puts them. MappedFile maps a view in place of the start of a pool instead,
+ * which takes the Windows placeholder functions, see ReservedPool::mapView() and getMappingHandle().
+ */
+class FileMapping
+{
+  public:
+    FileMapping();
+    ~FileMapping();
+
+    bool open(std::string filePath);
+    void close();
+    bool isOpen();
+    uint64_t getFileSize();
+
+    uint8_t* mapView(uint32_t viewSize);
+    static void unmapView(uint8_t* pView, uint32_t viewSize);
+    static uint32_t getGranularity();
+
+#if defined(_WIN32)
+    HANDLE getMappingHandle();
+#endif
+
+  private:
+    FileMapping(const FileMapping&);
+    FileMapping& operator=(const FileMapping&);
+
+#if defined(_WIN32)
+    HANDLE m_fileHandle;    //!< Handle of the file
+    HANDLE m_mappingHandle; //!< Handle of the file mapping, NULL if the file is empty
+#else
+    int m_fileDescriptor;   //!< Descriptor of the file
+#endif
+    bool m_open;            //!< A file is open
+    uint64_t m_fileSize;    //!< Size of the file in bytes
+};
+
+#endif
@@ -0,0 +1,73 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MAP_BLOCK_READER_H
+#define _MAP_BLOCK_READER_H
+
+#include <stdint.h>
+
+/**
+ * @class MapBlockReader
+ *
+ * @brief Read only access to the land and statics blocks of a map and to the hash stamps in its statics index.
+ * Implemented by the file manager for the loaded map and by MapFileReader for the files of any other shard map, so
+ * block hashes can be calculated from either.
+ */
+class MapBlockReader
+{
+  public:
+    virtual ~MapBlockReader() {}
+
+    /**
+     * @brief Gets a read only view of a land block
+     *
+     * @param mapNumber Map Number
+     * @param blockNum Block Number
+     *
+     * @return Pointer to the 192 bytes of land data, or NULL if the block could not be found
+     */
+    virtual const uint8_t* viewLandBlock(uint8_t mapNumber, uint32_t blockNum) = 0;
+
+    /**
+     * @brief Gets a read only view of the statics contained in one map block
+     *
+     * @param mapNumber Map Number
+     * @param blockNum Block Number
+     * @param rNumberOfBytesOut number of bytes in the view, zero if the block has no statics
+     *
+     * @return pointer to the statics in the block, or NULL if the block has no statics
+     */
+    virtual const uint8_t* viewStaticsBlock(uint32_t mapNumber, uint32_t blockNum, uint32_t& rNumberOfBytesOut) = 0;
+
+    /**
+     * @brief Gets the hash stamp of a block, the CRC32 of its land and statics data
+     *
+     * @param blockNum Block Number
+     *
+     * @return CRC32 of the block, or BaseFileManager::INVALID_BLOCK_HASH_STAMP if it is not known
+     */
+    virtual uint32_t getBlockHashStamp(uint32_t blockNum) = 0;
+};
+
+#endif
@@ -0,0 +1,272 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "MapFileReader.h"
+#include "BaseFileManager.h"
+#include "..\Debug.h"
+
+/**
+ * @brief MapFileReader constructor
+ */
+MapFileReader::MapFileReader()
+  : m_mapView(),
+  m_staidxView(),
+  m_staticsView(),
+  m_mapNumber(0),
+  m_open(false),
+  m_blockHashStampsValid(false)
+{
+  m_mapView.fileHandle = INVALID_HANDLE_VALUE;
+  m_staidxView.fileHandle = INVALID_HANDLE_VALUE;
+  m_staticsView.fileHandle = INVALID_HANDLE_VALUE;
+}
+
+/**
+ * @brief MapFileReader destructor, closes the open files
+ */
+MapFileReader::~MapFileReader()
+{
+  close();
+}
+
+/**
+ * @brief Maps the files of a shard map, closing the files that were open before
+ *
+ * @param pathWithoutFilename Folder containing the map files, ending in a path separator
+ * @param mapNumber Map Number
+ *
+ * @return true if all three files could be mapped
+ */
+bool MapFileReader::open(std::string pathWithoutFilename, uint8_t mapNumber)
+{
+  close();
+
+  char filename[32];
+  sprintf_s(filename, "map%i.mul", mapNumber);
+  bool success = openView(pathWithoutFilename + filename, m_mapView);
+
+  sprintf_s(filename, "staidx%i.mul", mapNumber);
+  success = success && openView(pathWithoutFilename + filename, m_staidxView);
+
+  sprintf_s(filename, "statics%i.mul", mapNumber);
+  success = success && openView(pathWithoutFilename + filename, m_staticsView);
+
+  if (!success)
+  {
+    Logger::g_pLogger->LogPrint("Map file reader: unable to map the files of map %i\n", mapNumber);
+    close();
+    return false;
+  }
+
+  m_mapNumber = mapNumber;
+  m_open = true;
+  m_blockHashStampsValid = GetFileAttributesA(BaseFileManager::getBlockHashStampMarkerPath(pathWithoutFilename, mapNumber).c_str()) != INVALID_FILE_ATTRIBUTES;
+
+  Logger::g_pLogger->LogPrint("Map file reader: mapped map %i, block hash stamps %s\n", mapNumber, m_blockHashStampsValid ? "valid" : "missing");
+
+  return true;
+}
+
+/**
+ * @brief Unmaps and closes the files
+ */
+void MapFileReader::close()
+{
+  closeView(m_mapView);
+  closeView(m_staidxView);
+  closeView(m_staticsView);
+  m_open = false;
+  m_blockHashStampsValid = false;
+}
+
+/**
+ * @brief Checks if the files of a map are open
+ *
+ * @return true if a map is open
+ */
+bool MapFileReader::isOpen()
+{
+  return m_open;
+}
+
+/**
+ * @brief Gets the map number of the open files
+ *
+ * @return Map Number, only meaningful while a map is open
+ */
+uint8_t MapFileReader::getMapNumber()
+{
+  return m_mapNumber;
+}
+
+/**
+ * @brief Checks if the hash stamps in the open statics index can be trusted
+ *
+ * @return true if getBlockHashStamp() returns block CRC32s
+ */
+bool MapFileReader::hasBlockHashStamps()
+{
+  return m_blockHashStampsValid;
+}
+
+/**
+ * @brief Gets a read only view of a land block of the open map
+ *
+ * @param mapNumber Map Number, must be the open map
+ * @param blockNum Block Number
+ *
+ * @return Pointer to the 192 bytes of land data, or NULL if the block could not be found
+ */
+const uint8_t* MapFileReader::viewLandBlock(uint8_t mapNumber, uint32_t blockNum)
+{
+  if (!m_open || mapNumber != m_mapNumber || blockNum >= m_mapView.size / 196)
+  {
+    return NULL;
+  }
+
+  return m_mapView.pData + (blockNum * 196) + 4;
+}
+
+/**
+ * @brief Gets a read only view of the statics contained in one block of the open map
+ *
+ * @param mapNumber Map Number, must be the open map
+ * @param blockNum Block Number
+ * @param rNumberOfBytesOut number of bytes in the view, zero if the block has no statics
+ *
+ * @return pointer to the statics in the block, or NULL if the block has no statics
+ */
+const uint8_t* MapFileReader::viewStaticsBlock(uint32_t mapNumber, uint32_t blockNum, uint32_t& rNumberOfBytesOut)
+{
+  rNumberOfBytesOut = 0;
+
+  if (!m_open || mapNumber != m_mapNumber || blockNum >= m_staidxView.size / 12)
+  {
+    return NULL;
+  }
+
+  const uint8_t* pBlockIdx = m_staidxView.pData + (blockNum * 12);
+
+  uint32_t lookup = *reinterpret_cast<const uint32_t*>(pBlockIdx);
+  uint32_t length = *reinterpret_cast<const uint32_t*>(pBlockIdx + 4);
+
+  if (lookup >= m_staticsView.size || length == 0 || length == 0xFFFFFFFF || length > m_staticsView.size - lookup)
+  {
+    return NULL;
+  }
+
+  rNumberOfBytesOut = length;
+  return m_staticsView.pData + lookup;
+}
+
+/**
+ * @brief Gets the hash stamp of a block of the open map
+ *
+ * @param blockNum Block Number
+ *
+ * @return CRC32 of the block, or INVALID_BLOCK_HASH_STAMP if it is not known
+ */
+uint32_t MapFileReader::getBlockHashStamp(uint32_t blockNum)
+{
+  if (!m_blockHashStampsValid || blockNum >= m_staidxView.size / 12)
+  {
+    return BaseFileManager::INVALID_BLOCK_HASH_STAMP;
+  }
+
+  return *reinterpret_cast<const uint32_t*>(m_staidxView.pData + (blockNum * 12) + 8);
+}
+
+/**
+ * @brief Maps a whole file read only. The file stays writable by others, so the file manager can keep writing it.
+ *
+ * @param filePath Path of the file
+ * @param rView Receives the view
+ *
+ * @return true on success, an empty file gives an empty view
+ */
+bool MapFileReader::openView(std::string filePath, FileView& rView)
+{
+  rView.mappingHandle = NULL;
+  rView.pData = NULL;
+  rView.size = 0;
+  rView.fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+  if (rView.fileHandle == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(rView.fileHandle, &size) || size.HighPart != 0)
+  {
+    return false;
+  }
+
+  rView.size = size.LowPart;
+
+  if (rView.size > 0)
+  {
+    rView.mappingHandle = CreateFileMappingA(rView.fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (rView.mappingHandle != NULL)
+    {
+      rView.pData = reinterpret_cast<const uint8_t*>(MapViewOfFile(rView.mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+
+    if (rView.pData == NULL)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Unmaps and closes a file, does nothing if it is not open
+ *
+ * @param rView View of the file
+ */
+void MapFileReader::closeView(FileView& rView)
+{
+  if (rView.pData != NULL)
+  {
+    UnmapViewOfFile(rView.pData);
+    rView.pData = NULL;
+  }
+
+  if (rView.mappingHandle != NULL)
+  {
+    CloseHandle(rView.mappingHandle);
+    rView.mappingHandle = NULL;
+  }
+
+  if (rView.fileHandle != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(rView.fileHandle);
+    rView.fileHandle = INVALID_HANDLE_VALUE;
+  }
+
+  rView.size = 0;
+}
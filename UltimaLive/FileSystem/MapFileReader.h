@@ -0,0 +1,83 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MAP_FILE_READER_H
+#define _MAP_FILE_READER_H
+
+#include <stdint.h>
+#include <string>
+#include <Windows.h>
+
+#include "MapBlockReader.h"
+
+/**
+ * @class MapFileReader
+ *
+ * @brief Read only, memory mapped view of the map#.mul, staidx#.mul and statics#.mul files of a shard map that is not
+ * loaded into the client. Used to answer hash queries that name another map, see Atlas::getBlockReader(). Only one map
+ * is open at a time, since the views take up a lot of the client's address space.
+ */
+class MapFileReader : public MapBlockReader
+{
+  public:
+    MapFileReader();
+    ~MapFileReader();
+
+    bool open(std::string pathWithoutFilename, uint8_t mapNumber);
+    void close();
+
+    bool isOpen();
+    uint8_t getMapNumber();
+    bool hasBlockHashStamps();
+
+    const uint8_t* viewLandBlock(uint8_t mapNumber, uint32_t blockNum);
+    const uint8_t* viewStaticsBlock(uint32_t mapNumber, uint32_t blockNum, uint32_t& rNumberOfBytesOut);
+    uint32_t getBlockHashStamp(uint32_t blockNum);
+
+  private:
+    /**
+     * @struct FileView
+     *
+     * @brief Read only view of a whole file
+     */
+    struct FileView
+    {
+      HANDLE fileHandle;    //!< Handle of the file
+      HANDLE mappingHandle; //!< Handle of the file mapping, NULL for an empty file
+      const uint8_t* pData; //!< Start of the view, NULL for an empty file
+      uint32_t size;        //!< Size of the file in bytes
+    };
+
+    static bool openView(std::string filePath, FileView& rView);
+    static void closeView(FileView& rView);
+
+    FileView m_mapView;          //!< View of map#.mul
+    FileView m_staidxView;       //!< View of staidx#.mul
+    FileView m_staticsView;      //!< View of statics#.mul
+    uint8_t m_mapNumber;         //!< Map number of the open files
+    bool m_open;                 //!< Indicates if all three files are open
+    bool m_blockHashStampsValid; //!< Indicates if the staidx stamps can be trusted
+};
+
+#endif
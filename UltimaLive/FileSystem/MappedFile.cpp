@@ -0,0 +1,147 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <fstream>
+
+#include "MappedFile.h"
+
+/**
+ * @brief MappedFile constructor
+ */
+MappedFile::MappedFile()
+  : m_mapping(),
+  m_pPool(NULL)
+{
+  //do nothing
+}
+
+/**
+ * @brief MappedFile destructor, gives the pool back its address range
+ */
+MappedFile::~MappedFile()
+{
+  unmap();
+}
+
+/**
+ * @brief Maps a file over the start of a pool, giving the pool back its address range first if a file is mapped over
+ *        it. On failure the pool is left reserved and empty, and the caller reads the file into it instead. Files
+ *        smaller than one allocation granule are not worth a view and are not mapped.
+ *
+ * @param filePath Path of the file
+ * @param rPool Pool to map the file over
+ * @param rFileSizeOut Receives the size of the file
+ *
+ * @return true if the file is mapped
+ */
+bool MappedFile::mapOver(std::string filePath, ReservedPool& rPool, uint32_t& rFileSizeOut)
+{
+  unmap();
+  rFileSizeOut = 0;
+
+  if (!m_mapping.open(filePath) || m_mapping.getFileSize() > rPool.getReservedSize())
+  {
+    unmap();
+    return false;
+  }
+
+  uint32_t fileSize = static_cast<uint32_t>(m_mapping.getFileSize());
+  uint32_t viewSize = fileSize - (fileSize % FileMapping::getGranularity());
+
+  if (viewSize == 0 || !rPool.mapView(m_mapping.getMappingHandle(), viewSize))
+  {
+    unmap();
+    return false;
+  }
+
+  m_pPool = &rPool;
+
+  if (!rPool.commit(fileSize) ||
+    !readTail(filePath, viewSize, rPool.getBase() + viewSize, fileSize - viewSize))
+  {
+    unmap();
+    return false;
+  }
+
+  rFileSizeOut = fileSize;
+  return true;
+}
+
+/**
+ * @brief Unmaps the file and reserves the whole pool again in place, does nothing to the pool if no file is mapped
+ *
+ * @return true if the pool is reserved again, or no file was mapped
+ */
+bool MappedFile::unmap()
+{
+  bool success = true;
+
+  if (m_pPool != NULL)
+  {
+    success = m_pPool->unmapView();
+    m_pPool = NULL;
+  }
+
+  m_mapping.close();
+  return success;
+}
+
+/**
+ * @brief Checks if a file is mapped over a pool
+ *
+ * @return true if a file is mapped
+ */
+bool MappedFile::isMapped()
+{
+  return m_pPool != NULL;
+}
+
+/**
+ * @brief Reads the end of a file that is not covered by its view
+ *
+ * @param filePath Path of the file
+ * @param offset Offset of the first byte past the view
+ * @param pDestination Memory right behind the view
+ * @param length Number of bytes to read
+ *
+ * @return true if all bytes were read
+ */
+bool MappedFile::readTail(std::string filePath, uint32_t offset, uint8_t* pDestination, uint32_t length)
+{
+  if (length == 0)
+  {
+    return true;
+  }
+
+  std::ifstream file;
+  file.open(filePath, std::ios::binary | std::ios::in);
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  file.seekg(offset, file.beg);
+  file.read(reinterpret_cast<char*>(pDestination), length);
+  return file.gcount() == (std::streamsize)length;
+}
@@ -0,0 +1,66 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <stdint.h>
+#include <string>
+
+#include "FileMapping.h"
+#include "ReservedPool.h"
+
+/**
+ * @class MappedFile
+ *
+ * @brief Copy-on-write view of a FileMapping mapped over the start of a memory pool the client already holds a pointer to.
+ * The pool keeps its address: the view takes the place of the start of its placeholder reservation, see
+ * ReservedPool::mapView(). Pages of the view are read from the file the first time they are touched,
+ * and writes to them stay private to the process, so the file is still written through the file manager's streams.
+ *
+ * Views cover the whole allocation granules of the file. The rest of the file is read into the memory behind the
+ * view, where the pool can also grow past the end of the file. Systems without placeholders cannot map a view in
+ * place, the caller then reads the whole file into the pool instead.
+ */
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    bool mapOver(std::string filePath, ReservedPool& rPool, uint32_t& rFileSizeOut);
+    bool unmap();
+    bool isMapped();
+
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    static bool readTail(std::string filePath, uint32_t offset, uint8_t* pDestination, uint32_t length);
+
+    FileMapping m_mapping;  //!< Mapping of the file
+    ReservedPool* m_pPool;  //!< Pool the view is mapped over, NULL when nothing is mapped
+};
+
+#endif
@@ -0,0 +1,371 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ReservedPool.h"
+#include "..\Debug.h"
+
+#ifndef MEM_RESERVE_PLACEHOLDER
+#define MEM_RESERVE_PLACEHOLDER 0x00040000
+#endif
+
+#ifndef MEM_REPLACE_PLACEHOLDER
+#define MEM_REPLACE_PLACEHOLDER 0x00004000
+#endif
+
+#ifndef MEM_PRESERVE_PLACEHOLDER
+#define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+
+#ifndef MEM_COALESCE_PLACEHOLDERS
+#define MEM_COALESCE_PLACEHOLDERS 0x00000001
+#endif
+
+const uint32_t ReservedPool::COMMIT_STEP;
+
+/**
+ * @brief PlaceholderApi constructor, looks the functions up
+ */
+ReservedPool::PlaceholderApi::PlaceholderApi()
+  : pVirtualAlloc2(NULL),
+  pMapViewOfFile3(NULL),
+  pUnmapViewOfFile2(NULL)
+{
+  HMODULE hKernelBase = GetModuleHandleA("kernelbase.dll");
+
+  if (hKernelBase != NULL)
+  {
+    pVirtualAlloc2 = (VirtualAlloc2Signature) GetProcAddress(hKernelBase, "VirtualAlloc2");
+    pMapViewOfFile3 = (MapViewOfFile3Signature) GetProcAddress(hKernelBase, "MapViewOfFile3");
+    pUnmapViewOfFile2 = (UnmapViewOfFile2Signature) GetProcAddress(hKernelBase, "UnmapViewOfFile2");
+  }
+}
+
+/**
+ * @brief Gets the placeholder functions, looking them up on first use
+ *
+ * @return Placeholder functions
+ */
+const ReservedPool::PlaceholderApi& ReservedPool::getPlaceholderApi()
+{
+  static PlaceholderApi api;
+  return api;
+}
+
+/**
+ * @brief Checks if files can be mapped over pools on this system
+ *
+ * @return true if the placeholder functions are available
+ */
+bool ReservedPool::supportsViews()
+{
+  const PlaceholderApi& api = getPlaceholderApi();
+  return api.pVirtualAlloc2 != NULL && api.pMapViewOfFile3 != NULL && api.pUnmapViewOfFile2 != NULL;
+}
+
+/**
+ * @brief ReservedPool constructor
+ */
+ReservedPool::ReservedPool()
+  : m_name(""),
+  m_pBase(NULL),
+  m_reservedSize(0),
+  m_placeholder(false),
+  m_viewSize(0),
+  m_committedSize(0),
+  m_floorSize(0),
+  m_highWaterMark(0)
+{
+  //do nothing
+}
+
+/**
+ * @brief Reserves the address range of the pool without committing any of it. The range is reserved through a
+ *        placeholder where the system supports views, and plainly otherwise.
+ *
+ * @param name Name used in log messages
+ * @param size Size of the address range in bytes
+ *
+ * @return true on success
+ */
+bool ReservedPool::reserve(std::string name, uint32_t size)
+{
+  m_name = name;
+  m_pBase = NULL;
+  m_reservedSize = 0;
+  m_placeholder = false;
+  m_viewSize = 0;
+  m_committedSize = 0;
+  m_floorSize = 0;
+
+  if (supportsViews())
+  {
+    m_pBase = reinterpret_cast<uint8_t*>(getPlaceholderApi().pVirtualAlloc2(NULL, NULL, size,
+      MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, NULL, 0));
+
+    if (m_pBase != NULL)
+    {
+      m_reservedSize = size;
+      m_placeholder = replacePlaceholder(0);
+
+      if (!m_placeholder)
+      {
+        VirtualFree(m_pBase, 0, MEM_RELEASE);
+        m_pBase = NULL;
+        m_reservedSize = 0;
+      }
+    }
+  }
+
+  if (m_pBase == NULL)
+  {
+    m_pBase = reinterpret_cast<uint8_t*>(VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+    m_reservedSize = (m_pBase != NULL) ? size : 0;
+  }
+
+  return m_pBase != NULL;
+}
+
+/**
+ * @brief Makes sure the first bytes of the pool can be accessed, committing up to the next commit step
+ *
+ * @param size Number of bytes from the start of the pool, clamped to the reserved size
+ *
+ * @return true if the bytes are committed
+ */
+bool ReservedPool::commit(uint32_t size)
+{
+  size = min(size, m_reservedSize);
+
+  if (size <= m_committedSize)
+  {
+    return true;
+  }
+
+  uint32_t committedSize = min(((size + COMMIT_STEP - 1) / COMMIT_STEP) * COMMIT_STEP, m_reservedSize);
+
+  if (VirtualAlloc(m_pBase + m_committedSize, committedSize - m_committedSize, MEM_COMMIT, PAGE_EXECUTE_READWRITE) == NULL)
+  {
+    Logger::g_pLogger->LogPrintError("Pool %s: unable to commit %u bytes\n", m_name.c_str(), committedSize);
+    return false;
+  }
+
+  m_committedSize = committedSize;
+
+  if (m_committedSize > m_highWaterMark)
+  {
+    m_highWaterMark = m_committedSize;
+    Logger::g_pLogger->LogPrint("Pool %s: %u of %u reserved bytes committed\n", m_name.c_str(), m_highWaterMark, m_reservedSize);
+  }
+
+  return true;
+}
+
+/**
+ * @brief Raises the number of bytes that stay committed from the start of the pool, and commits them
+ *
+ * @param size Number of bytes from the start of the pool
+ *
+ * @return true if the bytes are committed
+ */
+bool ReservedPool::commitFloor(uint32_t size)
+{
+  m_floorSize = max(m_floorSize, size);
+  return commit(m_floorSize);
+}
+
+/**
+ * @brief Decommits the memory of the pool above its floor and behind a view mapped over it. The pages read as zero
+ *        once they are committed again.
+ */
+void ReservedPool::decommit()
+{
+  uint32_t keptSize = max(m_viewSize, min(((m_floorSize + COMMIT_STEP - 1) / COMMIT_STEP) * COMMIT_STEP, m_reservedSize));
+
+  if (m_committedSize > keptSize)
+  {
+    VirtualFree(m_pBase + keptSize, m_committedSize - keptSize, MEM_DECOMMIT);
+    m_committedSize = keptSize;
+  }
+}
+
+/**
+ * @brief Maps a copy-on-write view of a file mapping over the start of the pool. The pool's memory is turned back
+ *        into a placeholder, split at the end of the view, and the view replaces the first part, so the address
+ *        range stays the pool's throughout. On failure the pool is left reserved and empty apart from its floor.
+ *
+ * @param mappingHandle File mapping created with PAGE_WRITECOPY
+ * @param viewSize Size of the view, a multiple of the allocation granularity
+ *
+ * @return true if the view is mapped at the start of the pool, false if it is not or the system lacks placeholders
+ */
+bool ReservedPool::mapView(HANDLE mappingHandle, uint32_t viewSize)
+{
+  if (!m_placeholder || m_viewSize != 0 || viewSize == 0 || viewSize > m_reservedSize)
+  {
+    return false;
+  }
+
+  if (!VirtualFree(m_pBase, m_reservedSize, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER))
+  {
+    return false;
+  }
+
+  m_committedSize = 0;
+
+  if (viewSize < m_reservedSize && !VirtualFree(m_pBase, viewSize, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER))
+  {
+    restoreReservation();
+    return false;
+  }
+
+  const PlaceholderApi& api = getPlaceholderApi();
+  PVOID pView = api.pMapViewOfFile3(mappingHandle, GetCurrentProcess(), m_pBase, 0, viewSize, MEM_REPLACE_PLACEHOLDER, PAGE_WRITECOPY, NULL, 0);
+
+  if (pView == m_pBase && replacePlaceholder(viewSize))
+  {
+    m_viewSize = viewSize;
+    m_committedSize = viewSize;
+    return commit(m_floorSize);
+  }
+
+  if (pView == m_pBase)
+  {
+    api.pUnmapViewOfFile2(GetCurrentProcess(), m_pBase, MEM_PRESERVE_PLACEHOLDER);
+  }
+
+  if (viewSize < m_reservedSize)
+  {
+    VirtualFree(m_pBase, m_reservedSize, MEM_RELEASE | MEM_COALESCE_PLACEHOLDERS);
+  }
+
+  restoreReservation();
+  return false;
+}
+
+/**
+ * @brief Unmaps the view mapped over the pool and reserves the whole pool again in place, without the address range
+ *        being released in between. Does nothing if no view is mapped.
+ *
+ * @return true if the pool is reserved again and its floor committed
+ */
+bool ReservedPool::unmapView()
+{
+  if (m_viewSize == 0)
+  {
+    return true;
+  }
+
+  const PlaceholderApi& api = getPlaceholderApi();
+  bool success = true;
+
+  if (m_viewSize < m_reservedSize)
+  {
+    success = VirtualFree(m_pBase + m_viewSize, m_reservedSize - m_viewSize, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER) != FALSE;
+  }
+
+  success = success && api.pUnmapViewOfFile2(GetCurrentProcess(), m_pBase, MEM_PRESERVE_PLACEHOLDER);
+
+  if (success && m_viewSize < m_reservedSize)
+  {
+    success = VirtualFree(m_pBase, m_reservedSize, MEM_RELEASE | MEM_COALESCE_PLACEHOLDERS) != FALSE;
+  }
+
+  if (!success)
+  {
+    Logger::g_pLogger->LogPrintError("Pool %s: unable to unmap the view at 0x%08x\n", m_name.c_str(), m_pBase);
+    return false;
+  }
+
+  m_viewSize = 0;
+  return restoreReservation();
+}
+
+/**
+ * @brief Replaces the placeholder covering the pool from an offset to its end with a reservation
+ *
+ * @param offset Start of the placeholder
+ *
+ * @return true if the range is reserved at the pool's address
+ */
+bool ReservedPool::replacePlaceholder(uint32_t offset)
+{
+  if (offset >= m_reservedSize)
+  {
+    return true;
+  }
+
+  PVOID pRegion = getPlaceholderApi().pVirtualAlloc2(GetCurrentProcess(), m_pBase + offset, m_reservedSize - offset,
+    MEM_RESERVE | MEM_REPLACE_PLACEHOLDER, PAGE_EXECUTE_READWRITE, NULL, 0);
+
+  return pRegion == m_pBase + offset;
+}
+
+/**
+ * @brief Turns the placeholder covering the whole pool back into a reservation and commits the floor again
+ *
+ * @return true on success
+ */
+bool ReservedPool::restoreReservation()
+{
+  m_viewSize = 0;
+  m_committedSize = 0;
+
+  if (!replacePlaceholder(0))
+  {
+    Logger::g_pLogger->LogPrintError("Pool %s: unable to reserve 0x%08x again\n", m_name.c_str(), m_pBase);
+    return false;
+  }
+
+  return commit(m_floorSize);
+}
+
+/**
+ * @brief Gets the start of the pool
+ *
+ * @return Start of the pool, NULL if it is not reserved
+ */
+uint8_t* ReservedPool::getBase()
+{
+  return m_pBase;
+}
+
+/**
+ * @brief Gets the size of the address range of the pool
+ *
+ * @return Size in bytes
+ */
+uint32_t ReservedPool::getReservedSize()
+{
+  return m_reservedSize;
+}
+
+/**
+ * @brief Gets the number of bytes from the start of the pool that can be accessed
+ *
+ * @return Size in bytes, including a view mapped over the pool
+ */
+uint32_t ReservedPool::getCommittedSize()
+{
+  return m_committedSize;
+}
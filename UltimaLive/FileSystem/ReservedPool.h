@@ -0,0 +1,100 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _RESERVED_POOL_H
+#define _RESERVED_POOL_H
+
+#include <stdint.h>
+#include <string>
+#include <Windows.h>
+
+/**
+ * @class ReservedPool
+ *
+ * @brief Memory pool that reserves its whole address range up front, since its address is handed to the client
+ * before the shard's maps are known, but only commits pages as the pool is filled. Commits grow in steps of
+ * COMMIT_STEP bytes from the start of the pool and every new high-water mark is logged. The client is told the pool
+ * is a view of its own file, so the size of that file is kept committed as a floor whatever map is loaded.
+ *
+ * Where the system supports placeholders (Windows 10 version 1803 and later) the address range is reserved as a
+ * placeholder first, and a file view can then take the place of the start of the pool without the range ever being
+ * released, see mapView() and MappedFile. The pool then only manages the memory behind the view.
+ */
+class ReservedPool
+{
+  public:
+    ReservedPool();
+
+    bool reserve(std::string name, uint32_t size);
+    bool commit(uint32_t size);
+    bool commitFloor(uint32_t size);
+    void decommit();
+
+    bool mapView(HANDLE mappingHandle, uint32_t viewSize);
+    bool unmapView();
+
+    uint8_t* getBase();
+    uint32_t getReservedSize();
+    uint32_t getCommittedSize();
+
+    static bool supportsViews();
+
+    static const uint32_t COMMIT_STEP = 1024 * 1024; //!< Granularity of commits, keeps growing statics from committing page by page
+
+  private:
+    ReservedPool(const ReservedPool&);
+    ReservedPool& operator=(const ReservedPool&);
+
+    typedef PVOID (WINAPI *VirtualAlloc2Signature)(HANDLE, PVOID, SIZE_T, ULONG, ULONG, PVOID, ULONG);
+    typedef PVOID (WINAPI *MapViewOfFile3Signature)(HANDLE, HANDLE, PVOID, ULONG64, SIZE_T, ULONG, ULONG, PVOID, ULONG);
+    typedef BOOL (WINAPI *UnmapViewOfFile2Signature)(HANDLE, PVOID, ULONG);
+
+    /**
+     * @brief Placeholder functions of kernelbase.dll, looked up at run time since older systems do not export them
+     */
+    struct PlaceholderApi
+    {
+      PlaceholderApi();
+
+      VirtualAlloc2Signature pVirtualAlloc2;       //!< VirtualAlloc2, NULL if missing
+      MapViewOfFile3Signature pMapViewOfFile3;     //!< MapViewOfFile3, NULL if missing
+      UnmapViewOfFile2Signature pUnmapViewOfFile2; //!< UnmapViewOfFile2, NULL if missing
+    };
+
+    static const PlaceholderApi& getPlaceholderApi();
+
+    bool replacePlaceholder(uint32_t offset);
+    bool restoreReservation();
+
+    std::string m_name;         //!< Name used in log messages
+    uint8_t* m_pBase;           //!< Start of the pool, NULL until reserved
+    uint32_t m_reservedSize;    //!< Size of the address range in bytes
+    bool m_placeholder;         //!< Range was reserved as a placeholder, so views can be mapped over it
+    uint32_t m_viewSize;        //!< Size of the view mapped over the start of the pool, 0 if there is none
+    uint32_t m_committedSize;   //!< Bytes from the start of the pool that can be accessed
+    uint32_t m_floorSize;       //!< Bytes from the start of the pool that stay committed
+    uint32_t m_highWaterMark;   //!< Most bytes ever committed
+};
+
+#endif
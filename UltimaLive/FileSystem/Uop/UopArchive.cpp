@@ -0,0 +1,275 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstring>
+#include <set>
+
+#include "UopArchive.h"
+
+const uint32_t UopArchive::HEADER_SIZE;
+const uint32_t UopArchive::TABLE_HEADER_SIZE;
+const uint32_t UopArchive::ENTRY_SIZE;
+
+/**
+ * @brief UopArchive constructor
+ */
+UopArchive::UopArchive()
+  : m_file(),
+  m_pData(NULL),
+  m_dataSize(0),
+  m_header(),
+  m_entries(),
+  m_entryIndices()
+{
+  //do nothing
+}
+
+/**
+ * @brief Opens a UOP archive on disk and reads its file tables
+ *
+ * @param filename Path of the archive
+ *
+ * @return true if the header and every file table could be read
+ */
+bool UopArchive::open(std::string filename)
+{
+  close();
+
+  m_file.open(filename, std::ios::binary | std::ios::in);
+  if (!m_file.is_open())
+  {
+    return false;
+  }
+
+  m_file.seekg(0, std::ios::end);
+  m_dataSize = static_cast<uint64_t>(m_file.tellg());
+
+  if (!readFileTables())
+  {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Reads the file tables of a UOP archive that is held in memory. The memory must stay valid while the
+ *        archive is used.
+ *
+ * @param pData Start of the archive
+ * @param dataSize Size of the archive in bytes
+ *
+ * @return true if the header and every file table could be read
+ */
+bool UopArchive::load(const uint8_t* pData, uint64_t dataSize)
+{
+  close();
+
+  m_pData = pData;
+  m_dataSize = dataSize;
+
+  if (pData == NULL || !readFileTables())
+  {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Closes the archive and forgets its entries
+ */
+void UopArchive::close()
+{
+  if (m_file.is_open())
+  {
+    m_file.close();
+  }
+
+  m_file.clear();
+  m_pData = NULL;
+  m_dataSize = 0;
+  m_header = UopHeader();
+  m_entries.clear();
+  m_entryIndices.clear();
+}
+
+/**
+ * @brief Gets the number of files the archive header claims
+ *
+ * @return Total files from the header
+ */
+uint32_t UopArchive::getTotalFiles()
+{
+  return m_header.TotalFiles;
+}
+
+/**
+ * @brief Gets the number of file entries found in the file tables
+ *
+ * @return Number of entries
+ */
+uint32_t UopArchive::getNumberOfEntries()
+{
+  return static_cast<uint32_t>(m_entries.size());
+}
+
+/**
+ * @brief Gets a file entry by its position in the file tables
+ *
+ * @param index Entry index, counting only the used slots of every table in the chain
+ *
+ * @return Entry, or NULL if the index is out of range
+ */
+const FileEntry* UopArchive::getEntry(uint32_t index)
+{
+  return (index < m_entries.size()) ? &m_entries[index] : NULL;
+}
+
+/**
+ * @brief Finds a file entry by the hash of its path
+ *
+ * @param pathChecksum Hash of the path, see UopUtility::HashFileName
+ *
+ * @return First entry with the checksum, or NULL if there is none
+ */
+const FileEntry* UopArchive::findEntry(uint64_t pathChecksum)
+{
+  std::unordered_map<uint64_t, uint32_t>::iterator itr = m_entryIndices.find(pathChecksum);
+  return (itr != m_entryIndices.end()) ? &m_entries[itr->second] : NULL;
+}
+
+/**
+ * @brief Reads the uncompressed data of a file entry
+ *
+ * @param pEntry Entry of this archive
+ * @param pBuffer Receives UncompressedDataSize bytes
+ *
+ * @return true if the data lies within the archive and could be read
+ */
+bool UopArchive::readEntryData(const FileEntry* pEntry, uint8_t* pBuffer)
+{
+  return readBytes(pEntry->UopFileOffset + pEntry->MetaDataSize, pBuffer, pEntry->UncompressedDataSize);
+}
+
+/**
+ * @brief Reads the archive header and follows the chain of file tables, reading each table in one go. The chain
+ *        ends at a zero offset, and also stops if it leads back to a table that was already read.
+ *
+ * @return true if the header and every file table could be read
+ */
+bool UopArchive::readFileTables()
+{
+  uint8_t headerBuffer[HEADER_SIZE];
+  if (!readBytes(0, headerBuffer, HEADER_SIZE))
+  {
+    return false;
+  }
+
+  m_header.unmarshal(headerBuffer);
+
+  std::vector<uint8_t> tableBuffer;
+  std::set<uint64_t> visitedTables;
+  uint64_t tableOffset = m_header.FileTableOffset;
+
+  while (tableOffset != 0 && visitedTables.insert(tableOffset).second)
+  {
+    uint8_t tableHeader[TABLE_HEADER_SIZE];
+    if (!readBytes(tableOffset, tableHeader, TABLE_HEADER_SIZE))
+    {
+      return false;
+    }
+
+    uint32_t capacity = 0;
+    uint64_t nextTableOffset = 0;
+    memcpy(&capacity, tableHeader, sizeof(uint32_t));
+    memcpy(&nextTableOffset, tableHeader + 4, sizeof(uint64_t));
+
+    uint64_t tableSize = static_cast<uint64_t>(capacity) * ENTRY_SIZE;
+    if (tableSize > m_dataSize)
+    {
+      return false;
+    }
+
+    tableBuffer.resize(static_cast<size_t>(tableSize));
+    if (tableSize > 0 && !readBytes(tableOffset + TABLE_HEADER_SIZE, &tableBuffer[0], tableSize))
+    {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+      uint8_t* pEntryData = &tableBuffer[i * ENTRY_SIZE];
+
+      //unused slots at the end of a table are zeroed
+      uint64_t dataOffset = 0;
+      memcpy(&dataOffset, pEntryData, sizeof(uint64_t));
+      if (dataOffset == 0)
+      {
+        continue;
+      }
+
+      FileEntry entry;
+      entry.unmarshal(pEntryData);
+
+      m_entryIndices.insert(std::make_pair(entry.PathChecksum, static_cast<uint32_t>(m_entries.size())));
+      m_entries.push_back(entry);
+    }
+
+    tableOffset = nextTableOffset;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Reads bytes of the archive from disk or memory
+ *
+ * @param offset Offset in the archive
+ * @param pBuffer Receives the bytes
+ * @param length Number of bytes
+ *
+ * @return true if the bytes lie within the archive and could be read
+ */
+bool UopArchive::readBytes(uint64_t offset, uint8_t* pBuffer, uint64_t length)
+{
+  if (offset > m_dataSize || length > m_dataSize - offset)
+  {
+    return false;
+  }
+
+  if (m_pData != NULL)
+  {
+    memcpy(pBuffer, m_pData + offset, static_cast<size_t>(length));
+    return true;
+  }
+
+  m_file.clear();
+  m_file.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+  m_file.read(reinterpret_cast<char*>(pBuffer), static_cast<std::streamsize>(length));
+
+  return m_file.good();
+}
@@ -0,0 +1,79 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _UOP_ARCHIVE_H
+#define _UOP_ARCHIVE_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "UopStructs.h"
+
+/**
+ * @class UopArchive
+ *
+ * @brief Reads the file entries of a UOP archive, from disk or from memory that holds the whole archive. Every file
+ * table in the chain is read, each one in a single read, and the entries are kept in table order with an index by
+ * path checksum. Empty table slots are skipped.
+ *
+ * The reader only depends on the standard library, so it can be built and run outside of the client.
+ */
+class UopArchive
+{
+  public:
+    UopArchive();
+
+    bool open(std::string filename);
+    bool load(const uint8_t* pData, uint64_t dataSize);
+    void close();
+
+    uint32_t getTotalFiles();
+    uint32_t getNumberOfEntries();
+    const FileEntry* getEntry(uint32_t index);
+    const FileEntry* findEntry(uint64_t pathChecksum);
+    bool readEntryData(const FileEntry* pEntry, uint8_t* pBuffer);
+
+    static const uint32_t HEADER_SIZE = 32;       //!< Bytes of the archive header that are unmarshalled
+    static const uint32_t TABLE_HEADER_SIZE = 12; //!< Capacity and offset of the next table in front of each file table
+    static const uint32_t ENTRY_SIZE = 34;        //!< Bytes of a file entry in a file table
+
+  private:
+    UopArchive(const UopArchive&);
+    UopArchive& operator=(const UopArchive&);
+
+    bool readFileTables();
+    bool readBytes(uint64_t offset, uint8_t* pBuffer, uint64_t length);
+
+    std::ifstream m_file;   //!< Archive on disk, unused when the archive is in memory
+    const uint8_t* m_pData; //!< Archive in memory, NULL when it is read from disk
+    uint64_t m_dataSize;    //!< Size of the archive in bytes
+    UopHeader m_header;     //!< Header of the archive
+    std::vector<FileEntry> m_entries;                       //!< File entries in table order
+    std::unordered_map<uint64_t, uint32_t> m_entryIndices;  //!< Links path checksums to entry indices, the first entry with a checksum wins
+};
+
+#endif
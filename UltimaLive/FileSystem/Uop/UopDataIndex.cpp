@@ -0,0 +1,117 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "UopDataIndex.h"
+
+/**
+ * @brief UopDataIndex constructor
+ */
+UopDataIndex::UopDataIndex()
+  : m_dataEnds(),
+  m_poolOffsets()
+{
+  //do nothing
+}
+
+/**
+ * @brief Removes every entry
+ */
+void UopDataIndex::clear()
+{
+  m_dataEnds.clear();
+  m_poolOffsets.clear();
+}
+
+/**
+ * @brief Appends the next entry of the run
+ *
+ * @param poolOffset Offset of the entry's data in the pool, past its meta data
+ * @param dataSize Uncompressed data size of the entry
+ */
+void UopDataIndex::addEntry(uint32_t poolOffset, uint32_t dataSize)
+{
+  uint32_t dataStart = m_dataEnds.empty() ? 0 : m_dataEnds.back();
+  m_dataEnds.push_back(dataStart + dataSize);
+  m_poolOffsets.push_back(poolOffset);
+}
+
+/**
+ * @brief Gets the number of entries in the run
+ *
+ * @return Number of entries
+ */
+uint32_t UopDataIndex::getNumberOfEntries() const
+{
+  return static_cast<uint32_t>(m_poolOffsets.size());
+}
+
+/**
+ * @brief Gets the offset of an entry's data in the pool
+ *
+ * @param index Index of the entry in the run
+ *
+ * @return Pool offset
+ */
+uint32_t UopDataIndex::getPoolOffset(uint32_t index) const
+{
+  return m_poolOffsets[index];
+}
+
+/**
+ * @brief Gets the data size of an entry
+ *
+ * @param index Index of the entry in the run
+ *
+ * @return Uncompressed data size
+ */
+uint32_t UopDataIndex::getDataSize(uint32_t index) const
+{
+  return m_dataEnds[index] - ((index > 0) ? m_dataEnds[index - 1] : 0);
+}
+
+/**
+ * @brief Finds where an offset in the data of the run lies in the pool
+ *
+ * @param dataOffset Offset in the data of the run
+ * @param rPoolOffsetOut Receives the pool offset
+ *
+ * @return false if the offset lies past the data of the last entry
+ */
+bool UopDataIndex::find(uint32_t dataOffset, uint32_t& rPoolOffsetOut) const
+{
+  //the first entry whose running total passes the offset holds it
+  std::vector<uint32_t>::const_iterator itr = std::upper_bound(m_dataEnds.begin(), m_dataEnds.end(), dataOffset);
+  if (itr == m_dataEnds.end())
+  {
+    return false;
+  }
+
+  size_t index = itr - m_dataEnds.begin();
+  uint32_t dataStart = (index > 0) ? m_dataEnds[index - 1] : 0;
+  rPoolOffsetOut = m_poolOffsets[index] + (dataOffset - dataStart);
+
+  return true;
+}
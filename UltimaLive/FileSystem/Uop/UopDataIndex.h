@@ -0,0 +1,58 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _UOP_DATA_INDEX_H
+#define _UOP_DATA_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @class UopDataIndex
+ *
+ * @brief Locates offsets in the data of a run of UOP file entries, taken as if the entries were one file, the way the
+ * map files are split into UOP entries. Running totals of the entry sizes are kept, so an offset is resolved with a
+ * binary search instead of walking the entries.
+ *
+ * The index only depends on the standard library, so it can be built and run outside of the client.
+ */
+class UopDataIndex
+{
+  public:
+    UopDataIndex();
+
+    void clear();
+    void addEntry(uint32_t poolOffset, uint32_t dataSize);
+
+    uint32_t getNumberOfEntries() const;
+    uint32_t getPoolOffset(uint32_t index) const;
+    uint32_t getDataSize(uint32_t index) const;
+    bool find(uint32_t dataOffset, uint32_t& rPoolOffsetOut) const;
+
+  private:
+    std::vector<uint32_t> m_dataEnds;    //!< Running total of the data sizes of the entries
+    std::vector<uint32_t> m_poolOffsets; //!< Offset of the data of each entry in the pool holding the archive
+};
+
+#endif
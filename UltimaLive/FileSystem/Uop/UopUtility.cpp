@@ -35,68 +35,54 @@
  */
 void UopUtility::convertUopMapToMul(std::string uopSourceFilename, std::string uopDestFilename, ProgressBarDialog* pProgress)
 {
-  std::ifstream uopSourceFile;
-  uopSourceFile.open(uopSourceFilename, std::ios::binary | std::ios::in);
+  UopArchive archive;
 
-  if (uopSourceFile.is_open())
+  if (archive.open(uopSourceFilename))
   {
     std::ofstream mulDestFile;
     mulDestFile.open(uopDestFilename, std::ios::binary | std::ios::out);
 
-    //read the offset to the file table
-    uopSourceFile.seekg(12, std::ios::beg);
-    uint32_t fileTableOffset = 0;
-    uopSourceFile.read(reinterpret_cast<char*>(&fileTableOffset), sizeof(uint32_t));
-
-    uint32_t totalFiles = 0;
-    uopSourceFile.seekg(24, std::ios::beg);
-    uopSourceFile.read(reinterpret_cast<char*>(&totalFiles), sizeof(uint32_t));
+    uint32_t totalFiles = archive.getTotalFiles();
 
     std::string hashfilename = Utils::getFilenameFromPath(uopSourceFilename);
     hashfilename = Utils::getBaseFilenameWithoutExtension(hashfilename);
     std::transform(hashfilename.begin(), hashfilename.end(), hashfilename.begin(), ::tolower);
 
-    std::map<uint32_t, uint64_t>* pHashes = UopUtility::getMapHashes(totalFiles, hashfilename);
-
-    //seek the first file entry
-    char fileEntryBuffer[34];
-    uint32_t filePosition = fileTableOffset + 12;
-    uopSourceFile.seekg(filePosition, std::ios::beg);
-    uopSourceFile.read(fileEntryBuffer, 34);
-    std::map<uint64_t, FileEntry*> entries;
+    std::vector<uint64_t> hashes = UopUtility::getMapHashes(totalFiles, hashfilename);
 
+    //count the bytes of the files that make up the map
     uint32_t totalFileSizeInBytes = 0;
-
-    //read through all the file entries and count the bytes
-    while (*reinterpret_cast<uint64_t*>(fileEntryBuffer) != 0)
+    for (uint32_t i = 0; i < totalFiles; ++i)
     {
-       FileEntry* pEntry = new FileEntry(); 
-       pEntry->unmarshal(reinterpret_cast<uint8_t*>(fileEntryBuffer));
-    
-       if (entries.find(pEntry->PathChecksum) == entries.end())
-       {
-         entries[pEntry->PathChecksum] = pEntry;
-         totalFileSizeInBytes += pEntry->UncompressedDataSize;
-       }
-
-       filePosition += 34;
-       uopSourceFile.seekg(filePosition, std::ios::beg);
-       uopSourceFile.read(fileEntryBuffer, 34);
+      const FileEntry* pEntry = archive.findEntry(hashes[i]);
+      if (pEntry != NULL)
+      {
+        totalFileSizeInBytes += pEntry->UncompressedDataSize;
+      }
     }
     
-    Logger::g_pLogger->LogPrint("There are %i file entries in the list\n", entries.size());
+    Logger::g_pLogger->LogPrint("There are %i file entries in the list\n", archive.getNumberOfEntries());
     uint32_t bytesCopied = 0;
     uint32_t prevPercent = 0;
+    std::vector<uint8_t> entryData;
 
     for(uint32_t i = 0; i < totalFiles; ++i)
     {
-      uint64_t hash = (*pHashes)[i];
-      FileEntry* pEntry = entries[hash];
+      const FileEntry* pEntry = archive.findEntry(hashes[i]);
+      if (pEntry == NULL)
+      {
+        Logger::g_pLogger->LogPrintError("UOP file %u is missing from %s\n", i, uopSourceFilename.c_str());
+        break;
+      }
+
+      entryData.resize(pEntry->UncompressedDataSize);
+      if (pEntry->UncompressedDataSize > 0 && !archive.readEntryData(pEntry, &entryData[0]))
+      {
+        Logger::g_pLogger->LogPrintError("Unable to read UOP file %u from %s\n", i, uopSourceFilename.c_str());
+        break;
+      }
 
-      char* pEntryData = new char[pEntry->UncompressedDataSize];
-      uopSourceFile.seekg(pEntry->UopFileOffset + pEntry->MetaDataSize, std::ios::beg);
-      uopSourceFile.read(pEntryData, pEntry->UncompressedDataSize);
-      mulDestFile.write(pEntryData, pEntry->UncompressedDataSize);
+      mulDestFile.write(reinterpret_cast<const char*>(entryData.data()), pEntry->UncompressedDataSize);
 
       bytesCopied += pEntry->UncompressedDataSize;
       if (pProgress != NULL)
@@ -108,116 +94,104 @@ void UopUtility::convertUopMapToMul(std::string uopSourceFilename, std::string u
           pProgress->setProgress((uint32_t)percent);
         }
       }
-
-      delete [] pEntryData;
     }
 
-    delete pHashes;
     mulDestFile.flush();
     mulDestFile.close();
-    uopSourceFile.close();
+    archive.close();
   }
 }
 
 /**
- * @brief Retrieves map size from UOP file. This method assumes that there is only one file table.
+ * @brief Retrieves map size from UOP file, counting the files in every file table of the archive
  * 
  * @param filename filename of the UOP file 
  */
 uint32_t UopUtility::getUopMapSizeInBytes(std::string filename)
 {
   uint32_t totalBytes = 0;
-  std::ifstream mapFile;
-  mapFile.open(filename, std::ios::binary | std::ios::in);
+  UopArchive archive;
 
-  if (mapFile.is_open())
+  if (archive.open(filename))
   {
-    //read the offset to the file table
-    mapFile.seekg(12, std::ios::beg);
-    uint32_t fileTableOffset = 0;
-    mapFile.read(reinterpret_cast<char*>(&fileTableOffset), sizeof(uint32_t));
-
-    //seek the first file entry
-    char fileEntryBuffer[34];
-    uint32_t filePosition = fileTableOffset + 12;
-    mapFile.seekg(filePosition, std::ios::beg);
-    mapFile.read(fileEntryBuffer, 34);
-
-    //read through all the file entries and count the bytes
-    while (*reinterpret_cast<uint64_t*>(fileEntryBuffer) != 0)
+    for (uint32_t i = 0; i < archive.getNumberOfEntries(); i++)
     {
-       FileEntry entry; 
-       entry.unmarshal(reinterpret_cast<uint8_t*>(fileEntryBuffer));
-       totalBytes += entry.UncompressedDataSize;
-
-       if (entry.UncompressedDataSize != entry.CompressedDataSize)
-       {
-         Logger::g_pLogger->LogPrint("Size mismatches\n");
-       }
-
-       filePosition += 34;
-       mapFile.seekg(filePosition, std::ios::beg);
-       mapFile.read(fileEntryBuffer, 34);
+      const FileEntry* pEntry = archive.getEntry(i);
+      totalBytes += pEntry->UncompressedDataSize;
+
+      if (pEntry->UncompressedDataSize != pEntry->CompressedDataSize)
+      {
+        Logger::g_pLogger->LogPrint("Size mismatches\n");
+      }
     }
 
-    mapFile.close();
+    archive.close();
   }
 
   return totalBytes;
 }
 
 /**
- * @brief zero pads a number
+ * @brief gets hashes corresponding to an internal map filename. The hashes of a pattern are only calculated the first
+ * time they are asked for and kept for the lifetime of the process.
  *
- * @param num number to convert and zero pad
- * @param fieldWidth width of the formatted number
+ * @param count Number of files
+ * @param pattern filename and folder pattern
  *
- * @return string containing the zero padded number
+ * @return Copy of the hash of each file by file number, holding at least count hashes
+ */
+std::vector<uint64_t> UopUtility::getMapHashes(uint32_t count, std::string pattern)
+{
+  MapHashCache& rCache = getMapHashCache();
+  EnterCriticalSection(&rCache.lock);
+
+  std::vector<uint64_t>& hashes = rCache.hashes[pattern];
+
+  std::string folder("build/");
+  folder.append(pattern);
+  folder.append("/");
+
+  for (uint32_t i = static_cast<uint32_t>(hashes.size()); i < count; i++)
+  {
+    char filename[16];
+    sprintf_s(filename, "%08u.dat", i);
+    hashes.push_back(HashFileName(folder + filename));
+  }
+
+  std::vector<uint64_t> hashesCopy(hashes);
+  LeaveCriticalSection(&rCache.lock);
+
+  return hashesCopy;
+}
+
+/**
+ * @brief MapHashCache constructor
+ */
+UopUtility::MapHashCache::MapHashCache()
+  : hashes()
+{
+  InitializeCriticalSection(&lock);
+}
+
+/**
+ * @brief MapHashCache destructor
  */
-std::string ZeroPadNumber(int num, int fieldWidth)
+UopUtility::MapHashCache::~MapHashCache()
 {
-	std::stringstream ss;
-	
-	// the number is converted to string with the help of stringstream
-	ss << num; 
-	std::string ret;
-	ss >> ret;
-	
-	// Append zero chars
-	int str_length = ret.length();
-	for (int i = 0; i < fieldWidth - str_length; i++)
-		ret = "0" + ret;
-	return ret;
+  DeleteCriticalSection(&lock);
 }
 
 /**
- * @brief gets hashes corresponding to an internal map filename
+ * @brief Gets the hashes calculated so far for each internal map filename pattern
  *
- * @param count Number of maps
- * @param pattern filename and folder pattern
+ * see: http://www.parashift.com/c++-faq/construct-on-first-use-v2.html
  *
- * @return Map containing map number and hash for each map
+ * @return Cache linking patterns to the hashes of their files
  */
-std::map<uint32_t, uint64_t>* UopUtility::getMapHashes(int count, std::string pattern)
+UopUtility::MapHashCache& UopUtility::getMapHashCache()
 {
-  std::map<uint32_t, uint64_t>* pHashes = new std::map<uint32_t, uint64_t>();
-
-  for (int i = 0; i < count; i++)
-  {
-    std::string filename("build/");
-    filename.append(pattern);
-    filename.append("/");
-    filename.append(ZeroPadNumber(i, 8));
-    filename.append(".dat");
-
-    uint64_t hash = HashFileName(filename);
-    if (pHashes->find(i) == pHashes->end())
-    {
-      (*pHashes)[i] = hash;
-    }
-  }
-
-  return pHashes;
+  static MapHashCache mapHashes;
+  return mapHashes;
 }
 
 /**
@@ -28,9 +28,12 @@
 #include <stdint.h>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <list>
 #include <sstream>
 #include <fstream>
+#include "UopArchive.h"
 #include "UopStructs.h"
 #include "..\..\Utils.h"
 #include <algorithm>
@@ -46,9 +49,25 @@ class UopUtility
 {
   public:
     static uint64_t HashFileName(std::string s);
-    static std::map<uint32_t, uint64_t>* getMapHashes(int count, std::string pattern);
+    static std::vector<uint64_t> getMapHashes(uint32_t count, std::string pattern);
     static uint32_t getUopMapSizeInBytes(std::string filename);
     static void convertUopMapToMul(std::string uopSourceFilename, std::string uopDestFilename, ProgressBarDialog* pProgress);
+
+  private:
+    /**
+     * @brief Hashes calculated so far for each internal map filename pattern, shared by the threads that convert and
+     *        load maps
+     */
+    struct MapHashCache
+    {
+      MapHashCache();
+      ~MapHashCache();
+
+      CRITICAL_SECTION lock;                                //!< Guards the hashes
+      std::map<std::string, std::vector<uint64_t> > hashes; //!< Hash of each file by file number, per pattern
+    };
+
+    static MapHashCache& getMapHashCache();
 };
 
 #endif
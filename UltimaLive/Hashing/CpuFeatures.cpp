@@ -0,0 +1,135 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+/**
+ * @brief Reads cpuid leaf 1 and records the feature bits
+ */
+CpuFeatures::Flags::Flags()
+  : sse2(false),
+  ssse3(false),
+  sse41(false),
+  sse42(false),
+  pclmul(false)
+{
+  uint32_t ecx = 0;
+  uint32_t edx = 0;
+
+#if defined(_MSC_VER)
+  int registers[4] = { 0, 0, 0, 0 };
+  __cpuid(registers, 0);
+
+  if (registers[0] >= 1)
+  {
+    __cpuid(registers, 1);
+    ecx = static_cast<uint32_t>(registers[2]);
+    edx = static_cast<uint32_t>(registers[3]);
+  }
+#else
+  unsigned int eax = 0;
+  unsigned int ebx = 0;
+  unsigned int ecxOut = 0;
+  unsigned int edxOut = 0;
+
+  if (__get_cpuid(1, &eax, &ebx, &ecxOut, &edxOut))
+  {
+    ecx = ecxOut;
+    edx = edxOut;
+  }
+#endif
+
+  sse2 = (edx & (1u << 26)) != 0;
+  pclmul = (ecx & (1u << 1)) != 0;
+  ssse3 = (ecx & (1u << 9)) != 0;
+  sse41 = (ecx & (1u << 19)) != 0;
+  sse42 = (ecx & (1u << 20)) != 0;
+}
+
+/**
+ * @brief Gets the feature flags, detecting them on first use
+ *
+ * @return Feature flags for the current processor
+ */
+const CpuFeatures::Flags& CpuFeatures::getFlags()
+{
+  static const Flags flags;
+  return flags;
+}
+
+/**
+ * @brief Checks for SSE2 support
+ *
+ * @return True if the processor supports SSE2
+ */
+bool CpuFeatures::hasSse2()
+{
+  return getFlags().sse2;
+}
+
+/**
+ * @brief Checks for SSSE3 support
+ *
+ * @return True if the processor supports SSSE3
+ */
+bool CpuFeatures::hasSsse3()
+{
+  return getFlags().ssse3;
+}
+
+/**
+ * @brief Checks for SSE4.1 support
+ *
+ * @return True if the processor supports SSE4.1
+ */
+bool CpuFeatures::hasSse41()
+{
+  return getFlags().sse41;
+}
+
+/**
+ * @brief Checks for SSE4.2 support
+ *
+ * @return True if the processor supports SSE4.2
+ */
+bool CpuFeatures::hasSse42()
+{
+  return getFlags().sse42;
+}
+
+/**
+ * @brief Checks for carry-less multiply (PCLMULQDQ) support
+ *
+ * @return True if the processor supports PCLMULQDQ
+ */
+bool CpuFeatures::hasPclmul()
+{
+  return getFlags().pclmul;
+}
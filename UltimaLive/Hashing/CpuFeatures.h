@@ -0,0 +1,78 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _CPU_FEATURES_H
+#define _CPU_FEATURES_H
+
+#include <stdint.h>
+
+/**
+ * Instruction set extensions are enabled per function on GCC and Clang so that the hashing units can be built
+ * without raising the baseline instruction set of the whole module. MSVC allows intrinsics in any function.
+ */
+#if defined(_MSC_VER)
+#define HASHING_TARGET_SSE2
+#define HASHING_TARGET_PCLMUL
+#define HASHING_TARGET_SSE42
+#else
+#define HASHING_TARGET_SSE2 __attribute__((target("sse2")))
+#define HASHING_TARGET_PCLMUL __attribute__((target("sse2,pclmul")))
+#define HASHING_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+
+/**
+ * @class CpuFeatures
+ *
+ * @brief Runtime detection of the processor features used by the hashing kernels
+ */
+class CpuFeatures
+{
+  public:
+    static bool hasSse2();
+    static bool hasSsse3();
+    static bool hasSse41();
+    static bool hasSse42();
+    static bool hasPclmul();
+
+  private:
+    /**
+     * @struct Flags
+     *
+     * @brief Feature bits read from cpuid leaf 1
+     */
+    struct Flags
+    {
+      Flags();
+
+      bool sse2;   //!< SSE2 is available
+      bool ssse3;  //!< SSSE3 is available
+      bool sse41;  //!< SSE4.1 is available
+      bool sse42;  //!< SSE4.2 is available
+      bool pclmul; //!< Carry-less multiply is available
+    };
+
+    static const Flags& getFlags();
+};
+
+#endif
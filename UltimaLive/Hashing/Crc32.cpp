@@ -0,0 +1,365 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#include "Crc32.h"
+#include "CpuFeatures.h"
+
+const uint32_t Crc32::INITIAL_STATE;
+const size_t Crc32::PCLMUL_MINIMUM_LENGTH;
+
+namespace
+{
+  /**
+   * @class SliceBy8Tables
+   *
+   * @brief Lookup tables for the slice-by-8 CRC. Table 0 is the classic byte-at-a-time table, table n advances a
+   * byte that is followed by n more bytes.
+   */
+  class SliceBy8Tables
+  {
+    public:
+      SliceBy8Tables()
+      {
+        for (uint32_t index = 0; index < 256; ++index)
+        {
+          uint32_t crc = index;
+
+          for (int bit = 0; bit < 8; ++bit)
+          {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+          }
+
+          m_table[0][index] = crc;
+        }
+
+        for (uint32_t index = 0; index < 256; ++index)
+        {
+          for (int slice = 1; slice < 8; ++slice)
+          {
+            uint32_t previous = m_table[slice - 1][index];
+            m_table[slice][index] = (previous >> 8) ^ m_table[0][previous & 0xFF];
+          }
+        }
+      }
+
+      uint32_t m_table[8][256]; //!< Slice tables
+  };
+
+  /**
+   * @brief Gets the slice-by-8 tables, building them on first use
+   *
+   * @return Slice-by-8 tables
+   */
+  const SliceBy8Tables& getTables()
+  {
+    static const SliceBy8Tables tables;
+    return tables;
+  }
+
+  /**
+   * @class PowerTable
+   *
+   * @brief x^(2^n) modulo the CRC polynomial for n = 0..31, in the reflected bit order used by the CRC register
+   */
+  class PowerTable
+  {
+    public:
+      PowerTable(uint32_t (*pMultiply)(uint32_t, uint32_t))
+      {
+        uint32_t power = 1u << 30; //x^1
+        m_powers[0] = power;
+
+        for (int index = 1; index < 32; ++index)
+        {
+          power = pMultiply(power, power);
+          m_powers[index] = power;
+        }
+      }
+
+      uint32_t m_powers[32]; //!< x^(2^n) mod P
+  };
+
+  /**
+   * @brief Reads a little endian 32 bit value from unaligned memory
+   *
+   * @param pData Pointer to the data
+   *
+   * @return 32 bit value
+   */
+  inline uint32_t readUint32(const uint8_t* pData)
+  {
+    uint32_t value;
+    memcpy(&value, pData, sizeof(value));
+    return value;
+  }
+}
+
+/**
+ * @brief Continues a CRC over a buffer using the fastest implementation available
+ *
+ * @param state CRC register state (INITIAL_STATE for a new CRC)
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return New CRC register state
+ */
+uint32_t Crc32::update(uint32_t state, const uint8_t* pData, size_t length)
+{
+  if (length >= PCLMUL_MINIMUM_LENGTH && CpuFeatures::hasPclmul())
+  {
+    size_t foldedLength = length & ~static_cast<size_t>(15);
+    state = updatePclmul(state, pData, foldedLength);
+    pData += foldedLength;
+    length -= foldedLength;
+  }
+
+  return updateSliceBy8(state, pData, length);
+}
+
+/**
+ * @brief Calculates the CRC of a single buffer
+ *
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return 32 bit CRC
+ */
+uint32_t Crc32::calculate(const uint8_t* pData, size_t length)
+{
+  return ~update(INITIAL_STATE, pData, length);
+}
+
+/**
+ * @brief Multiplies two polynomials modulo the CRC polynomial. Both operands and the result use the reflected
+ * bit order of the CRC register (x^0 is the most significant bit).
+ *
+ * @param a First polynomial
+ * @param b Second polynomial
+ *
+ * @return a * b mod P
+ */
+uint32_t Crc32::multiplyModP(uint32_t a, uint32_t b)
+{
+  uint32_t product = 0;
+
+  for (uint32_t mask = 1u << 31; mask != 0; mask >>= 1)
+  {
+    if (a & mask)
+    {
+      product ^= b;
+
+      if ((a & (mask - 1)) == 0)
+      {
+        break;
+      }
+    }
+
+    b = (b & 1) ? (b >> 1) ^ 0xEDB88320 : b >> 1;
+  }
+
+  return product;
+}
+
+/**
+ * @brief Gets the operator that shifts a CRC past lengthB bytes, for use with combine(). The operator only depends
+ * on the length, so it can be cached along with the CRC of the second buffer.
+ *
+ * @param lengthB Number of bytes in the second buffer
+ *
+ * @return x^(8 * lengthB) mod P
+ */
+uint32_t Crc32::getCombineOperator(size_t lengthB)
+{
+  static const PowerTable table(&Crc32::multiplyModP);
+
+  uint32_t combineOperator = 1u << 31; //x^0
+  uint64_t bits = (uint64_t)lengthB * 8;
+
+  for (int index = 0; bits != 0; ++index, bits >>= 1)
+  {
+    if (bits & 1)
+    {
+      combineOperator = multiplyModP(table.m_powers[index & 31], combineOperator);
+    }
+  }
+
+  return combineOperator;
+}
+
+/**
+ * @brief Calculates the CRC of two concatenated buffers from the CRCs of each buffer
+ *
+ * @param crcA CRC of the first buffer
+ * @param crcB CRC of the second buffer
+ * @param combineOperator getCombineOperator() for the length of the second buffer
+ *
+ * @return CRC of the first buffer followed by the second buffer
+ */
+uint32_t Crc32::combine(uint32_t crcA, uint32_t crcB, uint32_t combineOperator)
+{
+  return multiplyModP(combineOperator, crcA) ^ crcB;
+}
+
+/**
+ * @brief Continues a CRC over a buffer eight bytes at a time
+ *
+ * @param state CRC register state
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return New CRC register state
+ */
+uint32_t Crc32::updateSliceBy8(uint32_t state, const uint8_t* pData, size_t length)
+{
+  const SliceBy8Tables& tables = getTables();
+  const uint32_t (*t)[256] = tables.m_table;
+
+  while (length >= 8)
+  {
+    uint32_t low = readUint32(pData) ^ state;
+    uint32_t high = readUint32(pData + 4);
+
+    state = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+      t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+
+    pData += 8;
+    length -= 8;
+  }
+
+  while (length > 0)
+  {
+    state = (state >> 8) ^ t[0][(state & 0xFF) ^ *pData];
+    ++pData;
+    --length;
+  }
+
+  return state;
+}
+
+/**
+ * @brief Continues a CRC by folding 64 bytes at a time with carry-less multiplication, following Intel's
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" white paper.
+ *
+ * @param state CRC register state
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data, a multiple of 16 and at least PCLMUL_MINIMUM_LENGTH
+ *
+ * @return New CRC register state
+ */
+HASHING_TARGET_PCLMUL uint32_t Crc32::updatePclmul(uint32_t state, const uint8_t* pData, size_t length)
+{
+  //bit reflected folding constants and the Barrett reduction constants for the CRC-32 polynomial
+  alignas(16) static const uint64_t k1k2[2] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+  alignas(16) static const uint64_t k3k4[2] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+  alignas(16) static const uint64_t k5k0[2] = { 0x0163cd6124ULL, 0x0000000000ULL };
+  alignas(16) static const uint64_t poly[2] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x00));
+  x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x10));
+  x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x20));
+  x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(state)));
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+  pData += 64;
+  length -= 64;
+
+  //fold four lanes in parallel
+  while (length >= 64)
+  {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + 0x30)));
+
+    pData += 64;
+    length -= 64;
+  }
+
+  //fold the four lanes into one
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  //fold any remaining 16 byte blocks
+  while (length >= 16)
+  {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData))), x5);
+
+    pData += 16;
+    length -= 16;
+  }
+
+  //fold 128 bits down to 64 bits
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+
+  x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  //Barrett reduction down to 32 bits
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
+}
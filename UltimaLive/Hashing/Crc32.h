@@ -0,0 +1,61 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _CRC32_H
+#define _CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class Crc32
+ *
+ * @brief Reflected CRC-32 (polynomial 0xEDB88320, the zlib/PNG CRC) with a slice-by-8 table implementation and a
+ * carry-less multiply folding implementation that is selected at runtime when the processor supports it.
+ *
+ * update() works on the raw shift register so that a CRC can be continued across several buffers; the caller
+ * starts with INITIAL_STATE and inverts the final state. combine() joins two finished CRCs without touching the
+ * data again, which lets land and statics be hashed and cached separately.
+ */
+class Crc32
+{
+  public:
+    static const uint32_t INITIAL_STATE = 0xFFFFFFFF; //!< Register value before any data has been processed
+
+    static uint32_t update(uint32_t state, const uint8_t* pData, size_t length);
+    static uint32_t calculate(const uint8_t* pData, size_t length);
+
+    static uint32_t getCombineOperator(size_t lengthB);
+    static uint32_t combine(uint32_t crcA, uint32_t crcB, uint32_t combineOperator);
+
+    static uint32_t updateSliceBy8(uint32_t state, const uint8_t* pData, size_t length);
+    static uint32_t updatePclmul(uint32_t state, const uint8_t* pData, size_t length);
+
+    static const size_t PCLMUL_MINIMUM_LENGTH = 64; //!< Smallest buffer handed to the carry-less multiply path
+
+  private:
+    static uint32_t multiplyModP(uint32_t a, uint32_t b);
+};
+
+#endif
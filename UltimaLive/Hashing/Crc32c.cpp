@@ -0,0 +1,206 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <nmmintrin.h>
+
+#include "Crc32c.h"
+#include "CpuFeatures.h"
+
+const uint32_t Crc32c::INITIAL_STATE;
+
+namespace
+{
+  /**
+   * @class Crc32cTables
+   *
+   * @brief Slice-by-8 lookup tables for the Castagnoli polynomial. Table 0 is the classic byte-at-a-time table,
+   * table n advances a byte that is followed by n more bytes.
+   */
+  class Crc32cTables
+  {
+    public:
+      Crc32cTables()
+      {
+        for (uint32_t index = 0; index < 256; ++index)
+        {
+          uint32_t crc = index;
+
+          for (int bit = 0; bit < 8; ++bit)
+          {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+          }
+
+          m_table[0][index] = crc;
+        }
+
+        for (uint32_t index = 0; index < 256; ++index)
+        {
+          for (int slice = 1; slice < 8; ++slice)
+          {
+            uint32_t previous = m_table[slice - 1][index];
+            m_table[slice][index] = (previous >> 8) ^ m_table[0][previous & 0xFF];
+          }
+        }
+      }
+
+      uint32_t m_table[8][256]; //!< Slice tables
+  };
+
+  /**
+   * @brief Gets the slice-by-8 tables, building them on first use
+   *
+   * @return Slice-by-8 tables
+   */
+  const Crc32cTables& getTables()
+  {
+    static const Crc32cTables tables;
+    return tables;
+  }
+
+  /**
+   * @brief Reads a little endian 32 bit value from unaligned memory
+   *
+   * @param pData Pointer to the data
+   *
+   * @return 32 bit value
+   */
+  inline uint32_t readUint32(const uint8_t* pData)
+  {
+    uint32_t value;
+    memcpy(&value, pData, sizeof(value));
+    return value;
+  }
+}
+
+/**
+ * @brief Continues a CRC over a buffer using the fastest implementation available
+ *
+ * @param state CRC register state (INITIAL_STATE for a new CRC)
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return New CRC register state
+ */
+uint32_t Crc32c::update(uint32_t state, const uint8_t* pData, size_t length)
+{
+  if (CpuFeatures::hasSse42())
+  {
+    return updateSse42(state, pData, length);
+  }
+
+  return updateSliceBy8(state, pData, length);
+}
+
+/**
+ * @brief Calculates the CRC of a single buffer
+ *
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return 32 bit CRC-32C
+ */
+uint32_t Crc32c::calculate(const uint8_t* pData, size_t length)
+{
+  return ~update(INITIAL_STATE, pData, length);
+}
+
+/**
+ * @brief Continues a CRC over a buffer eight bytes at a time
+ *
+ * @param state CRC register state
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return New CRC register state
+ */
+uint32_t Crc32c::updateSliceBy8(uint32_t state, const uint8_t* pData, size_t length)
+{
+  const Crc32cTables& tables = getTables();
+  const uint32_t (*t)[256] = tables.m_table;
+
+  while (length >= 8)
+  {
+    uint32_t low = readUint32(pData) ^ state;
+    uint32_t high = readUint32(pData + 4);
+
+    state = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+      t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+
+    pData += 8;
+    length -= 8;
+  }
+
+  while (length > 0)
+  {
+    state = (state >> 8) ^ t[0][(state & 0xFF) ^ *pData];
+    ++pData;
+    --length;
+  }
+
+  return state;
+}
+
+/**
+ * @brief Continues a CRC with the SSE4.2 crc32 instruction, four bytes at a time (eight on 64 bit builds)
+ *
+ * @param state CRC register state
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return New CRC register state
+ */
+HASHING_TARGET_SSE42 uint32_t Crc32c::updateSse42(uint32_t state, const uint8_t* pData, size_t length)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+  uint64_t state64 = state;
+
+  while (length >= 8)
+  {
+    uint64_t value;
+    memcpy(&value, pData, sizeof(value));
+    state64 = _mm_crc32_u64(state64, value);
+    pData += 8;
+    length -= 8;
+  }
+
+  state = static_cast<uint32_t>(state64);
+#endif
+
+  while (length >= 4)
+  {
+    state = _mm_crc32_u32(state, readUint32(pData));
+    pData += 4;
+    length -= 4;
+  }
+
+  while (length > 0)
+  {
+    state = _mm_crc32_u8(state, *pData);
+    ++pData;
+    --length;
+  }
+
+  return state;
+}
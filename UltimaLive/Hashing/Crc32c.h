@@ -0,0 +1,53 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _CRC32C_H
+#define _CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class Crc32c
+ *
+ * @brief Reflected CRC-32C (Castagnoli polynomial 0x82F63B78, the iSCSI/SSE4.2 CRC) with a slice-by-8 table
+ * implementation and an SSE4.2 crc32 instruction implementation that is selected at runtime when the processor
+ * supports it.
+ *
+ * update() works on the raw shift register like Crc32::update(), so a CRC can be continued from the land data into
+ * the statics data; the caller starts with INITIAL_STATE and inverts the final state.
+ */
+class Crc32c
+{
+  public:
+    static const uint32_t INITIAL_STATE = 0xFFFFFFFF; //!< Register value before any data has been processed
+
+    static uint32_t update(uint32_t state, const uint8_t* pData, size_t length);
+    static uint32_t calculate(const uint8_t* pData, size_t length);
+
+    static uint32_t updateSliceBy8(uint32_t state, const uint8_t* pData, size_t length);
+    static uint32_t updateSse42(uint32_t state, const uint8_t* pData, size_t length);
+};
+
+#endif
@@ -0,0 +1,197 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <emmintrin.h>
+
+#include "Fletcher16.h"
+#include "CpuFeatures.h"
+
+const size_t Fletcher16::CHUNK_LENGTH;
+
+/**
+ * @brief Continues a checksum over a buffer using the fastest implementation available
+ *
+ * @param rSum1 Running sum of the data, reduced modulo 255
+ * @param rSum2 Running sum of sum1, reduced modulo 255
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ */
+void Fletcher16::update(uint32_t& rSum1, uint32_t& rSum2, const uint8_t* pData, size_t length)
+{
+  if (length >= 16 && CpuFeatures::hasSse2())
+  {
+    updateSse2(rSum1, rSum2, pData, length);
+  }
+  else
+  {
+    updateScalar(rSum1, rSum2, pData, length);
+  }
+}
+
+/**
+ * @brief Packs a pair of reduced sums into a 16 bit checksum
+ *
+ * @param sum1 Sum of the data, reduced modulo 255
+ * @param sum2 Sum of sum1, reduced modulo 255
+ *
+ * @return 16 bit checksum
+ */
+uint16_t Fletcher16::finalize(uint32_t sum1, uint32_t sum2)
+{
+  return (uint16_t)((sum2 << 8) | sum1);
+}
+
+/**
+ * @brief Calculates the checksum of a single buffer
+ *
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return 16 bit checksum
+ */
+uint16_t Fletcher16::calculate(const uint8_t* pData, size_t length)
+{
+  uint32_t sum1 = 0;
+  uint32_t sum2 = 0;
+  update(sum1, sum2, pData, length);
+  return finalize(sum1, sum2);
+}
+
+/**
+ * @brief Appends the sums of a second buffer to the sums of a first buffer. While the second buffer is processed
+ * sum2 picks up sum1 of the first buffer once per byte, so sum2 = sum2A + lengthB * sum1A + sum2B.
+ *
+ * @param rSum1 Reduced sum1 of the first buffer, replaced by sum1 of both buffers
+ * @param rSum2 Reduced sum2 of the first buffer, replaced by sum2 of both buffers
+ * @param sum1B Reduced sum1 of the second buffer, started from zero
+ * @param sum2B Reduced sum2 of the second buffer, started from zero
+ * @param lengthB Number of bytes in the second buffer
+ */
+void Fletcher16::combine(uint32_t& rSum1, uint32_t& rSum2, uint32_t sum1B, uint32_t sum2B, size_t lengthB)
+{
+  uint32_t sum2 = rSum2 + (uint32_t)(lengthB % 255) * rSum1 + sum2B;
+  rSum1 = (rSum1 + sum1B) % 255;
+  rSum2 = sum2 % 255;
+}
+
+/**
+ * @brief Continues a checksum one byte at a time, reducing the sums once per chunk
+ *
+ * @param rSum1 Running sum of the data, reduced modulo 255
+ * @param rSum2 Running sum of sum1, reduced modulo 255
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ */
+void Fletcher16::updateScalar(uint32_t& rSum1, uint32_t& rSum2, const uint8_t* pData, size_t length)
+{
+  uint32_t sum1 = rSum1;
+  uint32_t sum2 = rSum2;
+
+  while (length > 0)
+  {
+    size_t chunk = length < CHUNK_LENGTH ? length : CHUNK_LENGTH;
+    length -= chunk;
+
+    while (chunk > 0)
+    {
+      sum1 += *pData++;
+      sum2 += sum1;
+      --chunk;
+    }
+
+    sum1 %= 255;
+    sum2 %= 255;
+  }
+
+  rSum1 = sum1;
+  rSum2 = sum2;
+}
+
+/**
+ * @brief Continues a checksum sixteen bytes at a time. Within a chunk the byte sums, the running total of the
+ * byte sums and the position weighted byte sums are kept in separate vector accumulators and only folded into
+ * the Fletcher sums at the end of the chunk.
+ *
+ * @param rSum1 Running sum of the data, reduced modulo 255
+ * @param rSum2 Running sum of sum1, reduced modulo 255
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ */
+HASHING_TARGET_SSE2 void Fletcher16::updateSse2(uint32_t& rSum1, uint32_t& rSum2, const uint8_t* pData, size_t length)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weightsLow = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+  const __m128i weightsHigh = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+
+  uint32_t sum1 = rSum1;
+  uint32_t sum2 = rSum2;
+
+  while (length >= 16)
+  {
+    size_t chunk = length < CHUNK_LENGTH ? length : CHUNK_LENGTH;
+    size_t blocks = chunk / 16;
+    length -= blocks * 16;
+
+    __m128i byteSums = _mm_setzero_si128();     //sum of all bytes in the chunk
+    __m128i prefixSums = _mm_setzero_si128();   //sum of byteSums as it stood before each block
+    __m128i weightedSums = _mm_setzero_si128(); //bytes weighted by their distance from the end of their block
+
+    for (size_t block = 0; block < blocks; ++block)
+    {
+      __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData));
+
+      prefixSums = _mm_add_epi32(prefixSums, byteSums);
+      byteSums = _mm_add_epi32(byteSums, _mm_sad_epu8(data, zero));
+
+      weightedSums = _mm_add_epi32(weightedSums, _mm_madd_epi16(_mm_unpacklo_epi8(data, zero), weightsLow));
+      weightedSums = _mm_add_epi32(weightedSums, _mm_madd_epi16(_mm_unpackhi_epi8(data, zero), weightsHigh));
+
+      pData += 16;
+    }
+
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), byteSums);
+    uint64_t chunkByteSum = (uint64_t)lanes[0] + lanes[2];
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), prefixSums);
+    uint64_t chunkPrefixSum = (uint64_t)lanes[0] + lanes[2];
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), weightedSums);
+    uint64_t chunkWeightedSum = (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    uint64_t newSum2 = sum2 + (uint64_t)sum1 * blocks * 16 + chunkPrefixSum * 16 + chunkWeightedSum;
+    uint64_t newSum1 = sum1 + chunkByteSum;
+
+    sum1 = (uint32_t)(newSum1 % 255);
+    sum2 = (uint32_t)(newSum2 % 255);
+  }
+
+  rSum1 = sum1;
+  rSum2 = sum2;
+
+  if (length > 0)
+  {
+    updateScalar(rSum1, rSum2, pData, length);
+  }
+}
@@ -0,0 +1,55 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _FLETCHER16_H
+#define _FLETCHER16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class Fletcher16
+ *
+ * @brief Fletcher-16 checksum (both sums modulo 255) that defers the modulo to once per chunk instead of once
+ * per byte. An SSE2 implementation is selected at runtime when available.
+ *
+ * update() continues a checksum from a pair of reduced sums, so a checksum can be carried across several buffers;
+ * the caller starts with both sums at zero and packs them with finalize(). combine() appends the sums of a second
+ * buffer to those of a first one without touching the data again.
+ */
+class Fletcher16
+{
+  public:
+    static void update(uint32_t& rSum1, uint32_t& rSum2, const uint8_t* pData, size_t length);
+    static uint16_t finalize(uint32_t sum1, uint32_t sum2);
+    static uint16_t calculate(const uint8_t* pData, size_t length);
+    static void combine(uint32_t& rSum1, uint32_t& rSum2, uint32_t sum1B, uint32_t sum2B, size_t lengthB);
+
+    static void updateScalar(uint32_t& rSum1, uint32_t& rSum2, const uint8_t* pData, size_t length);
+    static void updateSse2(uint32_t& rSum1, uint32_t& rSum2, const uint8_t* pData, size_t length);
+
+    static const size_t CHUNK_LENGTH = 4096; //!< Bytes that can be summed in 32 bits before the sums must be reduced
+};
+
+#endif
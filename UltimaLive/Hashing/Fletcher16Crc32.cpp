@@ -0,0 +1,52 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Fletcher16Crc32.h"
+#include "Fletcher16.h"
+#include "Crc32.h"
+
+const size_t Fletcher16Crc32::CHUNK_LENGTH;
+
+/**
+ * @brief Continues a Fletcher-16 and a CRC32 over the same buffer
+ *
+ * @param rSum1 Running Fletcher sum of the data, reduced modulo 255
+ * @param rSum2 Running Fletcher sum of sum1, reduced modulo 255
+ * @param rCrc32State Running CRC32 register
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ */
+void Fletcher16Crc32::update(uint32_t& rSum1, uint32_t& rSum2, uint32_t& rCrc32State, const uint8_t* pData, size_t length)
+{
+  while (length > 0)
+  {
+    size_t chunkLength = (length < CHUNK_LENGTH) ? length : CHUNK_LENGTH;
+
+    Fletcher16::update(rSum1, rSum2, pData, chunkLength);
+    rCrc32State = Crc32::update(rCrc32State, pData, chunkLength);
+
+    pData += chunkLength;
+    length -= chunkLength;
+  }
+}
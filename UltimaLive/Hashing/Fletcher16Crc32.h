@@ -0,0 +1,49 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _FLETCHER16_CRC32_H
+#define _FLETCHER16_CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class Fletcher16Crc32
+ *
+ * @brief Computes the Fletcher-16 and the CRC32 of a buffer in one pass over memory. The buffer is walked in chunks
+ * small enough to stay in the L1 cache, and both checksums are advanced over each chunk before moving on, so every
+ * byte is fetched from memory once while each checksum keeps its own SIMD implementation.
+ *
+ * The sums and the CRC register are continued like Fletcher16::update() and Crc32::update(): start with both sums at
+ * zero and the register at Crc32::INITIAL_STATE, then finish with Fletcher16::finalize() and by inverting the register.
+ */
+class Fletcher16Crc32
+{
+  public:
+    static void update(uint32_t& rSum1, uint32_t& rSum2, uint32_t& rCrc32State, const uint8_t* pData, size_t length);
+
+    static const size_t CHUNK_LENGTH = 1024; //!< Bytes hashed by both checksums before moving to the next chunk
+};
+
+#endif
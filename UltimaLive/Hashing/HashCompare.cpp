@@ -0,0 +1,132 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <emmintrin.h>
+#include <string.h>
+
+#include "HashCompare.h"
+#include "CpuFeatures.h"
+
+/**
+ * @brief Marks the positions whose hashes differ using the fastest implementation available
+ *
+ * @param pHashesA Pointer to the first array of hashes
+ * @param pHashesB Pointer to the second array of hashes
+ * @param numberOfHashes Number of hashes in each array
+ * @param hashSize Number of bytes per hash
+ * @param pBitmapOut Pointer to getBitmapSize(numberOfHashes) bytes, overwritten with the mismatch bitmap
+ */
+void HashCompare::findMismatches(const uint8_t* pHashesA, const uint8_t* pHashesB, size_t numberOfHashes, size_t hashSize, uint8_t* pBitmapOut)
+{
+  if (hashSize > 0 && hashSize <= 16 && (16 % hashSize) == 0 && CpuFeatures::hasSse2())
+  {
+    findMismatchesSse2(pHashesA, pHashesB, numberOfHashes, hashSize, pBitmapOut);
+  }
+  else
+  {
+    findMismatchesScalar(pHashesA, pHashesB, numberOfHashes, hashSize, pBitmapOut);
+  }
+}
+
+/**
+ * @brief Marks the positions whose hashes differ one hash at a time
+ *
+ * @param pHashesA Pointer to the first array of hashes
+ * @param pHashesB Pointer to the second array of hashes
+ * @param numberOfHashes Number of hashes in each array
+ * @param hashSize Number of bytes per hash
+ * @param pBitmapOut Pointer to getBitmapSize(numberOfHashes) bytes, overwritten with the mismatch bitmap
+ */
+void HashCompare::findMismatchesScalar(const uint8_t* pHashesA, const uint8_t* pHashesB, size_t numberOfHashes, size_t hashSize, uint8_t* pBitmapOut)
+{
+  memset(pBitmapOut, 0, getBitmapSize(numberOfHashes));
+
+  for (size_t i = 0; i < numberOfHashes; i++)
+  {
+    if (memcmp(pHashesA + (i * hashSize), pHashesB + (i * hashSize), hashSize) != 0)
+    {
+      pBitmapOut[i >> 3] |= (uint8_t)(1 << (i & 7));
+    }
+  }
+}
+
+/**
+ * @brief Marks the positions whose hashes differ sixteen bytes at a time. The byte compare mask of every vector is
+ * split into one group of hashSize bits per hash, and a hash differs when any bit of its group is clear. Vectors
+ * without a differing byte, the common case, cost one compare and one branch.
+ *
+ * @param pHashesA Pointer to the first array of hashes
+ * @param pHashesB Pointer to the second array of hashes
+ * @param numberOfHashes Number of hashes in each array
+ * @param hashSize Number of bytes per hash, a divisor of sixteen
+ * @param pBitmapOut Pointer to getBitmapSize(numberOfHashes) bytes, overwritten with the mismatch bitmap
+ */
+HASHING_TARGET_SSE2 void HashCompare::findMismatchesSse2(const uint8_t* pHashesA, const uint8_t* pHashesB, size_t numberOfHashes, size_t hashSize, uint8_t* pBitmapOut)
+{
+  memset(pBitmapOut, 0, getBitmapSize(numberOfHashes));
+
+  const size_t hashesPerVector = 16 / hashSize;
+  const uint32_t hashMask = (1u << hashSize) - 1;
+  size_t index = 0;
+
+  for (; index + hashesPerVector <= numberOfHashes; index += hashesPerVector)
+  {
+    __m128i hashesA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pHashesA + (index * hashSize)));
+    __m128i hashesB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pHashesB + (index * hashSize)));
+    uint32_t differentBytes = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hashesA, hashesB)) & 0xFFFF;
+
+    if (differentBytes == 0)
+    {
+      continue;
+    }
+
+    for (size_t i = 0; i < hashesPerVector; i++)
+    {
+      if (((differentBytes >> (i * hashSize)) & hashMask) != 0)
+      {
+        pBitmapOut[(index + i) >> 3] |= (uint8_t)(1 << ((index + i) & 7));
+      }
+    }
+  }
+
+  for (; index < numberOfHashes; index++)
+  {
+    if (memcmp(pHashesA + (index * hashSize), pHashesB + (index * hashSize), hashSize) != 0)
+    {
+      pBitmapOut[index >> 3] |= (uint8_t)(1 << (index & 7));
+    }
+  }
+}
+
+/**
+ * @brief Gets the number of bytes of a mismatch bitmap
+ *
+ * @param numberOfHashes Number of compared hashes
+ *
+ * @return One bit per hash, rounded up to whole bytes
+ */
+size_t HashCompare::getBitmapSize(size_t numberOfHashes)
+{
+  return (numberOfHashes + 7) / 8;
+}
@@ -0,0 +1,49 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _HASH_COMPARE_H
+#define _HASH_COMPARE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class HashCompare
+ *
+ * @brief Compares two arrays of serialized block hashes position by position and packs the positions that differ
+ * into a bitmap, bit (i & 7) of byte (i >> 3) for position i. An SSE2 implementation that compares sixteen bytes
+ * at a time is selected at runtime for hash sizes that divide sixteen.
+ */
+class HashCompare
+{
+  public:
+    static void findMismatches(const uint8_t* pHashesA, const uint8_t* pHashesB, size_t numberOfHashes, size_t hashSize, uint8_t* pBitmapOut);
+
+    static void findMismatchesScalar(const uint8_t* pHashesA, const uint8_t* pHashesB, size_t numberOfHashes, size_t hashSize, uint8_t* pBitmapOut);
+    static void findMismatchesSse2(const uint8_t* pHashesA, const uint8_t* pHashesB, size_t numberOfHashes, size_t hashSize, uint8_t* pBitmapOut);
+
+    static size_t getBitmapSize(size_t numberOfHashes);
+};
+
+#endif
@@ -0,0 +1,248 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "Xxh64.h"
+
+const uint64_t Xxh64::PRIME64_1;
+const uint64_t Xxh64::PRIME64_2;
+const uint64_t Xxh64::PRIME64_3;
+const uint64_t Xxh64::PRIME64_4;
+const uint64_t Xxh64::PRIME64_5;
+
+/**
+ * @brief Xxh64 constructor, starts a new hash with seed 0
+ */
+Xxh64::Xxh64()
+  : m_totalLength(0),
+  m_bufferSize(0)
+{
+  m_accumulators[0] = PRIME64_1 + PRIME64_2;
+  m_accumulators[1] = PRIME64_2;
+  m_accumulators[2] = 0;
+  m_accumulators[3] = 0 - PRIME64_1;
+  memset(m_buffer, 0, sizeof(m_buffer));
+}
+
+/**
+ * @brief Feeds more data into the hash
+ *
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ */
+void Xxh64::update(const uint8_t* pData, size_t length)
+{
+  m_totalLength += length;
+
+  if (m_bufferSize + length < 32)
+  {
+    if (length > 0)
+    {
+      memcpy(m_buffer + m_bufferSize, pData, length);
+    }
+
+    m_bufferSize += static_cast<uint32_t>(length);
+    return;
+  }
+
+  if (m_bufferSize > 0)
+  {
+    size_t fill = 32 - m_bufferSize;
+    memcpy(m_buffer + m_bufferSize, pData, fill);
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+      m_accumulators[lane] = round(m_accumulators[lane], readUint64(m_buffer + (lane * 8)));
+    }
+
+    pData += fill;
+    length -= fill;
+    m_bufferSize = 0;
+  }
+
+  while (length >= 32)
+  {
+    for (int lane = 0; lane < 4; lane++)
+    {
+      m_accumulators[lane] = round(m_accumulators[lane], readUint64(pData + (lane * 8)));
+    }
+
+    pData += 32;
+    length -= 32;
+  }
+
+  if (length > 0)
+  {
+    memcpy(m_buffer, pData, length);
+    m_bufferSize = static_cast<uint32_t>(length);
+  }
+}
+
+/**
+ * @brief Finishes the hash of the data fed so far. The state is not changed, so more data may follow.
+ *
+ * @return 64 bit digest
+ */
+uint64_t Xxh64::digest() const
+{
+  uint64_t hash;
+
+  if (m_totalLength >= 32)
+  {
+    hash = rotateLeft(m_accumulators[0], 1) + rotateLeft(m_accumulators[1], 7) +
+      rotateLeft(m_accumulators[2], 12) + rotateLeft(m_accumulators[3], 18);
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+      hash = mergeRound(hash, m_accumulators[lane]);
+    }
+  }
+  else
+  {
+    hash = m_accumulators[2] + PRIME64_5;
+  }
+
+  hash += m_totalLength;
+
+  const uint8_t* pData = m_buffer;
+  uint32_t remaining = m_bufferSize;
+
+  while (remaining >= 8)
+  {
+    hash ^= round(0, readUint64(pData));
+    hash = (rotateLeft(hash, 27) * PRIME64_1) + PRIME64_4;
+    pData += 8;
+    remaining -= 8;
+  }
+
+  if (remaining >= 4)
+  {
+    hash ^= static_cast<uint64_t>(readUint32(pData)) * PRIME64_1;
+    hash = (rotateLeft(hash, 23) * PRIME64_2) + PRIME64_3;
+    pData += 4;
+    remaining -= 4;
+  }
+
+  while (remaining > 0)
+  {
+    hash ^= (*pData) * PRIME64_5;
+    hash = rotateLeft(hash, 11) * PRIME64_1;
+    ++pData;
+    --remaining;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= PRIME64_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+/**
+ * @brief Calculates the XXH64 of a single buffer
+ *
+ * @param pData Pointer to the data
+ * @param length Number of bytes in the data
+ *
+ * @return 64 bit digest
+ */
+uint64_t Xxh64::calculate(const uint8_t* pData, size_t length)
+{
+  Xxh64 hash;
+  hash.update(pData, length);
+  return hash.digest();
+}
+
+/**
+ * @brief Mixes an 8 byte input into a lane accumulator
+ *
+ * @param accumulator Lane accumulator
+ * @param input Input value
+ *
+ * @return New accumulator
+ */
+uint64_t Xxh64::round(uint64_t accumulator, uint64_t input)
+{
+  accumulator += input * PRIME64_2;
+  accumulator = rotateLeft(accumulator, 31);
+  return accumulator * PRIME64_1;
+}
+
+/**
+ * @brief Merges a lane accumulator into the hash
+ *
+ * @param accumulator Hash being finalized
+ * @param value Lane accumulator
+ *
+ * @return New hash
+ */
+uint64_t Xxh64::mergeRound(uint64_t accumulator, uint64_t value)
+{
+  accumulator ^= round(0, value);
+  return (accumulator * PRIME64_1) + PRIME64_4;
+}
+
+/**
+ * @brief Rotates a 64 bit value left
+ *
+ * @param value Value to rotate
+ * @param bits Number of bits, 1 to 63
+ *
+ * @return Rotated value
+ */
+uint64_t Xxh64::rotateLeft(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+/**
+ * @brief Reads a little endian 64 bit value from unaligned memory
+ *
+ * @param pData Pointer to the data
+ *
+ * @return 64 bit value
+ */
+uint64_t Xxh64::readUint64(const uint8_t* pData)
+{
+  uint64_t value;
+  memcpy(&value, pData, sizeof(value));
+  return value;
+}
+
+/**
+ * @brief Reads a little endian 32 bit value from unaligned memory
+ *
+ * @param pData Pointer to the data
+ *
+ * @return 32 bit value
+ */
+uint32_t Xxh64::readUint32(const uint8_t* pData)
+{
+  uint32_t value;
+  memcpy(&value, pData, sizeof(value));
+  return value;
+}
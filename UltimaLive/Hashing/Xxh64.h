@@ -0,0 +1,66 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _XXH64_H
+#define _XXH64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class Xxh64
+ *
+ * @brief Streaming XXH64 (xxHash, 64 bit) with seed 0. A block is hashed by feeding the land data and then the
+ * statics data, which gives the same digest as hashing both in one buffer.
+ */
+class Xxh64
+{
+  public:
+    Xxh64();
+
+    void update(const uint8_t* pData, size_t length);
+    uint64_t digest() const;
+
+    static uint64_t calculate(const uint8_t* pData, size_t length);
+
+  private:
+    static uint64_t round(uint64_t accumulator, uint64_t input);
+    static uint64_t mergeRound(uint64_t accumulator, uint64_t value);
+    static uint64_t rotateLeft(uint64_t value, int bits);
+    static uint64_t readUint64(const uint8_t* pData);
+    static uint32_t readUint32(const uint8_t* pData);
+
+    static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL; //!< xxHash prime 1
+    static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL; //!< xxHash prime 2
+    static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL; //!< xxHash prime 3
+    static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL; //!< xxHash prime 4
+    static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL; //!< xxHash prime 5
+
+    uint64_t m_accumulators[4]; //!< Lane accumulators
+    uint64_t m_totalLength;     //!< Number of bytes fed so far
+    uint8_t m_buffer[32];       //!< Bytes that do not fill a stripe yet
+    uint32_t m_bufferSize;      //!< Number of bytes in m_buffer
+};
+
+#endif
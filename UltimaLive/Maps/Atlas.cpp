@@ -23,9 +23,13 @@
  */
 
 #include "Atlas.h"
+#include "BlockHashPolicies.h"
 #include "..\UltimaLive.h"
 #include "..\Network\NetworkManager.h"
 #include "..\FileSystem\BaseFileManager.h"
+#include "..\Hashing\Crc32.h"
+#include "..\Hashing\CpuFeatures.h"
+#include "..\Hashing\Fletcher16.h"
 
 #pragma region Self Registration
 SelfRegisteringClass <Atlas> Atlas::m_registration;
@@ -81,7 +85,11 @@ bool Atlas::Initialize()
       pNetworkManager->subscribeToRefreshClient(std::bind(&Atlas::onRefreshClientView, pInstance));
       pNetworkManager->subscribeToBlocksViewRange(std::bind(&Atlas::onBlocksViewRange, pInstance, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
       pNetworkManager->subscribeToBlockQueryRequest(std::bind(&Atlas::onHashQuery, pInstance, std::placeholders::_1, std::placeholders::_2));
-      pNetworkManager->subscribeToBlockQuery32Request(std::bind(&Atlas::onHashQuery32, pInstance, std::placeholders::_1, std::placeholders::_2));
+      pNetworkManager->subscribeToBlockQuery32Request(std::bind(&Atlas::onHashQuery32, pInstance, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+      pNetworkManager->subscribeToRegionHashQueryRequest(std::bind(&Atlas::onRegionHashQuery, pInstance, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+      pNetworkManager->subscribeToHashCapabilitiesRequest(std::bind(&Atlas::onHashCapabilitiesQuery, pInstance));
+      pNetworkManager->subscribeToHashModeQueryRequest(std::bind(&Atlas::onHashModeQuery, pInstance, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+      pNetworkManager->subscribeToExpectedHashQueryRequest(std::bind(&Atlas::onExpectedHashQuery, pInstance, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6));
       pNetworkManager->subscribeToStaticsUpdate(std::bind(&Atlas::onUpdateStatics, pInstance, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
       pNetworkManager->subscribeToMapDefinitionUpdate(std::bind(&Atlas::onUpdateMapDefinitions, pInstance, std::placeholders::_1));
       pNetworkManager->subscribeToLandUpdate(std::bind(&Atlas::onUpdateLand, pInstance, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -92,6 +100,25 @@ bool Atlas::Initialize()
     pInstance->m_pFileManager = pFileManager;
     pInstance->m_pNetworkManager = pNetworkManager;
     pInstance->m_pClient = pClient;
+
+    //background hashing is opt-in, [Hashing] PrecomputeThreads=n in UltimaLive.ini
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    uint32_t precomputeThreads = (uint32_t)Utils::GetSettingInt("Hashing", "PrecomputeThreads", 0);
+    pInstance->m_precomputeThreads = min(precomputeThreads, (uint32_t)systemInfo.dwNumberOfProcessors);
+    Logger::g_pLogger->LogPrint("Atlas: %i hash precompute threads\n", pInstance->m_precomputeThreads);
+
+    //blocks ahead of the moving player are hashed unless [Hashing] PrefetchIntervalMilliseconds=0 in UltimaLive.ini
+    pInstance->m_prefetchInterval = (uint32_t)Utils::GetSettingInt("Hashing", "PrefetchIntervalMilliseconds", BlockHashPrefetcher::DEFAULT_INTERVAL_MILLISECONDS);
+    pInstance->m_prefetchLookahead = (uint32_t)Utils::GetSettingInt("Hashing", "PrefetchLookaheadBlocks", BlockHashPrefetcher::DEFAULT_LOOKAHEAD_BLOCKS);
+    Logger::g_pLogger->LogPrint("Atlas: hash prefetch every %u ms, %u blocks ahead\n", pInstance->m_prefetchInterval, pInstance->m_prefetchLookahead);
+
+    //the view ranges around the most visited blocks are hashed after a map load unless [Hashing] WarmupSpots=0 in UltimaLive.ini
+    pInstance->m_warmupSpots = (uint32_t)Utils::GetSettingInt("Hashing", "WarmupSpots", DEFAULT_WARMUP_SPOTS);
+
+    //hashes of maps visited earlier stay resident up to [Hashing] MapCacheMegabytes=n in UltimaLive.ini
+    uint32_t mapCacheMegabytes = (uint32_t)Utils::GetSettingInt("Hashing", "MapCacheMegabytes", BlockHashCache::DEFAULT_MEMORY_LIMIT_MEGABYTES);
+    pInstance->m_blockHashCache.setMemoryLimit((size_t)mapCacheMegabytes * 1024 * 1024);
   }
   else
   {
@@ -113,10 +140,26 @@ Atlas::Atlas()
   m_mapDefinitions(),
   m_currentMap(0),
   m_shardIdentifier(),
-  m_firstMapLoad(true)
+  m_firstMapLoad(true),
+  m_blockHashCache(),
+  m_mapFileReader(),
+  m_precomputer(&m_blockHashCache),
+  m_prefetcher(&m_blockHashCache),
+  m_blockHashTree(&m_blockHashCache),
+  m_hashResponseCache(),
+  m_blockGroupLayout(),
+  m_precomputeThreads(0),
+  m_prefetchInterval(0),
+  m_prefetchLookahead(BlockHashPrefetcher::DEFAULT_LOOKAHEAD_BLOCKS),
+  m_blockHeatmap(),
+  m_warmupSpots(0),
+  m_precomputePending(false),
+  m_incrementalWindow(),
+  m_incrementalSequence(0),
+  m_incrementalMap(0)
 {
-    m_crcCache.resize(896 * 512, 0xFFFF);
-    m_crc32Cache.resize(896 * 512, 0xFFFFFFFF);
+    m_blockHashCache.selectMap(0, 896 * 512);
+    m_blockHashTree.reset(896, 512);
 }
 
 /**
@@ -134,9 +177,92 @@ void Atlas::onShardIdentifierUpdate(std::string shardIdentifier)
  */
 void Atlas::onLogout()
 {
+  m_precomputer.stop();
+  m_prefetcher.stop();
+  m_precomputePending = false;
+  m_blockHashCache.logStatistics();
+  m_incrementalWindow.clear();
+  m_hashResponseCache.clear();
+  saveHeatmap();
+  m_blockHeatmap.clear();
+
+  m_blockHashCache.beginDataUpdate();
+  m_mapFileReader.close();
+  m_blockHashCache.endDataUpdate();
+
   m_pFileManager->onLogout();
 }
 
+/**
+ * @brief Starts background hashing of the loaded map if it is enabled and waiting for the player's position. The
+ *        first hash query after a map load carries the block the player is standing in, so hashing works outward
+ *        from there.
+ *
+ * @param mapNumber Map number of the hash query
+ * @param blockNumber Central block number of the hash query
+ */
+void Atlas::startPendingPrecompute(uint8_t mapNumber, uint32_t blockNumber)
+{
+  if (m_precomputePending && mapNumber == m_currentMap && m_mapDefinitions.find(mapNumber) != m_mapDefinitions.end())
+  {
+    m_precomputePending = false;
+
+    MapDefinition& rDefinition = m_mapDefinitions[mapNumber];
+    m_precomputer.start(m_pFileManager, mapNumber, rDefinition.mapWidthInTiles >> 3, rDefinition.mapHeightInTiles >> 3, blockNumber, m_precomputeThreads);
+  }
+}
+
+/**
+ * @brief Counts the central block of a hash query as a visit in the heatmap of the loaded map
+ *
+ * @param mapNumber Map number of the hash query
+ * @param blockNumber Central block number of the hash query
+ */
+void Atlas::recordVisit(uint8_t mapNumber, uint32_t blockNumber)
+{
+  if (mapNumber == m_currentMap)
+  {
+    m_blockHeatmap.recordVisit(blockNumber);
+  }
+}
+
+/**
+ * @brief Saves the heatmap of the loaded map next to the shard's map files
+ */
+void Atlas::saveHeatmap()
+{
+  if (!m_firstMapLoad)
+  {
+    m_blockHeatmap.save(BlockHeatmap::getFilePath(m_pFileManager->getShardMapFolder(), m_currentMap));
+  }
+}
+
+/**
+ * @brief Gets the blocks in the view ranges around the most visited blocks of a map, most visited first
+ *
+ * @param mapNumber Map Number
+ * @param rBlocksOut Receives the block numbers
+ */
+void Atlas::getWarmupBlocks(uint8_t mapNumber, std::vector<uint32_t>& rBlocksOut)
+{
+  std::vector<uint32_t> hottestBlocks;
+  m_blockHeatmap.getHottestBlocks(m_warmupSpots, hottestBlocks);
+
+  rBlocksOut.clear();
+  for (std::vector<uint32_t>::iterator itr = hottestBlocks.begin(); itr != hottestBlocks.end(); itr++)
+  {
+    std::vector<int32_t> blocks = GetGroupOfBlockNumbers(mapNumber, *itr);
+
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+      if (blocks[i] >= 0)
+      {
+        rBlocksOut.push_back(static_cast<uint32_t>(blocks[i]));
+      }
+    }
+  }
+}
+
 /**
  * @brief Loads a map based on map number
  *
@@ -161,15 +287,34 @@ void Atlas::LoadMap(uint8_t map)
     definition.mapWrapWidthInTiles = m_mapDefinitions[map].mapWrapWidthInTiles;
     definition.mapWrapHeightInTiles = m_mapDefinitions[map].mapWrapHeightInTiles;
 
-    m_crcCache.clear();
-    m_crc32Cache.clear();
-
-    m_crcCache.resize((definition.mapWidthInTiles / 8) * (definition.mapHeightInTiles / 8), 0xFFFF);
-    m_crc32Cache.resize((definition.mapWidthInTiles / 8) * (definition.mapHeightInTiles / 8), 0xFFFFFFFF);
+    m_precomputer.stop();
+    m_prefetcher.stop();
+    saveHeatmap();
+    m_blockHashCache.logStatistics();
+    m_blockHashCache.beginDataUpdate();
+    m_mapFileReader.close();
+    bool hashesKept = m_blockHashCache.selectMap(map, (definition.mapWidthInTiles / 8) * (definition.mapHeightInTiles / 8));
+    m_blockHashTree.reset(definition.mapWidthInTiles / 8, definition.mapHeightInTiles / 8);
+    m_incrementalWindow.clear();
+    m_hashResponseCache.clear();
 
     m_pClient->SetMapDimensions(definition);
     m_pFileManager->LoadMap(map);
     m_currentMap = map;
+
+    if (!hashesKept && m_pFileManager->hasBlockHashStamps())
+    {
+      m_blockHashCache.enableCrc32Seeding();
+    }
+
+    m_blockHashCache.endDataUpdate();
+
+    m_precomputePending = m_precomputeThreads > 0;
+
+    m_blockHeatmap.load(BlockHeatmap::getFilePath(m_pFileManager->getShardMapFolder(), map), (definition.mapWidthInTiles / 8) * (definition.mapHeightInTiles / 8));
+    std::vector<uint32_t> warmupBlocks;
+    getWarmupBlocks(map, warmupBlocks);
+    m_prefetcher.start(m_pFileManager, m_pClient, map, definition.mapWidthInTiles / 8, definition.mapHeightInTiles / 8, m_prefetchInterval, m_prefetchLookahead, warmupBlocks);
   }
 #ifdef DEBUG
   else 
@@ -195,9 +340,12 @@ void Atlas::LoadMap(uint8_t map)
 void Atlas::onUpdateStatics(uint8_t mapNumber, uint32_t blockNumber, uint8_t* pData, uint32_t length)
 {
   Logger::g_pLogger->LogPrint("Block: %i Map Number: %i Length: %i\n", blockNumber, mapNumber, length);
+  m_blockHashCache.beginDataUpdate();
   m_pFileManager->writeStaticsBlock(mapNumber, blockNumber, pData, length);
-  m_crcCache[blockNumber] = 0xFFFF;
-  m_crc32Cache[blockNumber] = 0xFFFFFFFF;
+  m_blockHashCache.invalidateStatics(mapNumber, blockNumber);
+  m_blockHashCache.endDataUpdate();
+  m_blockHashTree.invalidateBlock(blockNumber);
+  m_hashResponseCache.invalidateBlock(blockNumber);
   m_pClient->refreshClientStatics(blockNumber);
 }
 
@@ -210,9 +358,12 @@ void Atlas::onUpdateStatics(uint8_t mapNumber, uint32_t blockNumber, uint8_t* pD
 */
 void Atlas::onUpdateLand(uint8_t mapNumber, uint32_t blockNumber, uint8_t* pLandData)
 {
+  m_blockHashCache.beginDataUpdate();
   m_pFileManager->updateLandBlock(mapNumber, blockNumber, pLandData);
-  m_crcCache[blockNumber] = 0xFFFF;
-  m_crc32Cache[blockNumber] = 0xFFFFFFFF;
+  m_blockHashCache.invalidateLand(mapNumber, blockNumber);
+  m_blockHashCache.endDataUpdate();
+  m_blockHashTree.invalidateBlock(blockNumber);
+  m_hashResponseCache.invalidateBlock(blockNumber);
   m_pClient->refreshClientLand();
 }
 
@@ -233,6 +384,9 @@ void Atlas::onBlocksViewRange(int32_t minBlockX, int32_t maxBlockX, int32_t minB
 
     m_BlocksWidth = m_MaxBlockX - m_MinBlockX + 1;
     m_BlocksHeight = m_MaxBlockY - m_MinBlockY + 1;
+    m_prefetcher.setViewRange(m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY);
+    m_incrementalWindow.clear();
+    m_blockGroupLayout.clear();
 
     std::vector<uint8_t> response(23, 0);
     uint8_t* pResponse = &response[0];
@@ -261,6 +415,16 @@ void Atlas::onBlocksViewRange(int32_t minBlockX, int32_t maxBlockX, int32_t minB
 void Atlas::onHashQuery(uint32_t blockNumber, uint8_t mapNumber)
 {
   Logger::g_pLogger->LogPrint("Atlas: Got Hash Query\n");
+  startPendingPrecompute(mapNumber, blockNumber);
+  recordVisit(mapNumber, blockNumber);
+
+  std::vector<uint8_t> cachedResponse;
+  if (m_hashResponseCache.lookup(0xFF, Fletcher16HashPolicy::HASH_MODE, mapNumber, blockNumber, m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY, cachedResponse))
+  {
+    m_pNetworkManager->sendPacketToServer(&cachedResponse[0]);
+    return;
+  }
+
   std::vector<uint16_t> crcs = GetGroupOfBlockCrcs(mapNumber, blockNumber);
   size_t size = 15 + crcs.size() * sizeof(uint16_t);
   std::vector<uint8_t> response(size, 0);
@@ -286,6 +450,7 @@ void Atlas::onHashQuery(uint32_t blockNumber, uint8_t mapNumber)
   //pResponse[69] = 0xFF;                                           //byte 069              -  padding
   //pResponse[70] = 0xFF;                                           //byte 070              -  padding
 
+  m_hashResponseCache.store(0xFF, Fletcher16HashPolicy::HASH_MODE, mapNumber, blockNumber, m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY, GetGroupOfBlockNumbers(mapNumber, blockNumber), response);
   m_pNetworkManager->sendPacketToServer(pResponse);
 }
 
@@ -294,10 +459,28 @@ void Atlas::onHashQuery(uint32_t blockNumber, uint8_t mapNumber)
  *
  * @param blockNumber Map Block Number
  * @param mapNumber Map Number
+ * @param incremental True if the server asked for an incremental response
+ * @param acknowledgedSequence Sequence number of the last incremental response the server applied, 0 for none
  */
-void Atlas::onHashQuery32(uint32_t blockNumber, uint8_t mapNumber)
+void Atlas::onHashQuery32(uint32_t blockNumber, uint8_t mapNumber, bool incremental, uint16_t acknowledgedSequence)
 {
     Logger::g_pLogger->LogPrint("Atlas: Got Hash Query\n");
+    startPendingPrecompute(mapNumber, blockNumber);
+    recordVisit(mapNumber, blockNumber);
+
+    if (incremental)
+    {
+        sendIncrementalHashResponse(blockNumber, mapNumber, acknowledgedSequence);
+        return;
+    }
+
+    std::vector<uint8_t> cachedResponse;
+    if (m_hashResponseCache.lookup(0xFD, Crc32HashPolicy::HASH_MODE, mapNumber, blockNumber, m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY, cachedResponse))
+    {
+        m_pNetworkManager->sendPacketToServer(&cachedResponse[0]);
+        return;
+    }
+
     std::vector<uint32_t> crcs = GetGroupOfBlockCrcs32(mapNumber, blockNumber);
     size_t size = 15 + crcs.size() * sizeof(uint32_t);
     std::vector<uint8_t> response(size, 0);
@@ -323,9 +506,278 @@ void Atlas::onHashQuery32(uint32_t blockNumber, uint8_t mapNumber)
     //pResponse[69] = 0xFF;                                           //byte 069              -  padding
     //pResponse[70] = 0xFF;                                           //byte 070              -  padding
 
+    m_hashResponseCache.store(0xFD, Crc32HashPolicy::HASH_MODE, mapNumber, blockNumber, m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY, GetGroupOfBlockNumbers(mapNumber, blockNumber), response);
     m_pNetworkManager->sendPacketToServer(pResponse);
 }
 
+/**
+ * @brief Tells the server which hash modes the client can answer hash mode queries (0xF9) in, and which of them are
+ *        hardware accelerated on this machine, so it can pick the fastest one both sides support. The queries that
+ *        take a hash mode are listed as well.
+ */
+void Atlas::onHashCapabilitiesQuery()
+{
+  Logger::g_pLogger->LogPrint("Atlas: Got Hash Capabilities Query\n");
+
+  uint16_t supportedModes = (1 << Fletcher16HashPolicy::HASH_MODE) | (1 << Crc32HashPolicy::HASH_MODE) |
+    (1 << Crc32cHashPolicy::HASH_MODE) | (1 << Xxh64HashPolicy::HASH_MODE) | (1 << SplitCrc32HashPolicy::HASH_MODE);
+  uint16_t acceleratedModes = 0;
+
+  if (CpuFeatures::hasPclmul())
+  {
+    acceleratedModes |= (1 << Crc32HashPolicy::HASH_MODE) | (1 << SplitCrc32HashPolicy::HASH_MODE);
+  }
+
+  if (CpuFeatures::hasSse42())
+  {
+    acceleratedModes |= (1 << Crc32cHashPolicy::HASH_MODE);
+  }
+
+  uint16_t supportedQueries = EXPECTED_HASH_QUERY_CAPABILITY;
+
+  uint8_t response[21];
+  memset(response, 0, sizeof(response));
+
+  response[0] = 0x3F;                                                         //byte 000              -  cmd
+  *reinterpret_cast<uint16_t*>(response + 1) = (uint16_t)sizeof(response);   //byte 001 through 002  -  packet size
+  *reinterpret_cast<uint32_t*>(response + 3) = htonl(0);                      //byte 003 through 006  -  unused
+  *reinterpret_cast<uint32_t*>(response + 7) = htonl(0);                      //byte 007 through 010  -  unused
+  *reinterpret_cast<uint16_t*>(response + 11) = htons(0);                     //byte 011 through 012  -  UltimaLive sequence number
+  response[13] = 0xFA;                                                        //byte 013              -  UltimaLive command (0xFA is a hash capabilities response)
+  response[14] = m_currentMap;                                                //byte 014              -  UltimaLive mapnumber
+  *reinterpret_cast<uint16_t*>(response + 15) = htons(supportedModes);        //byte 015 through 016  -  bit mask of supported hash modes
+  *reinterpret_cast<uint16_t*>(response + 17) = htons(acceleratedModes);      //byte 017 through 018  -  bit mask of hardware accelerated hash modes
+  *reinterpret_cast<uint16_t*>(response + 19) = htons(supportedQueries);      //byte 019 through 020  -  bit mask of supported hash mode queries
+
+  m_pNetworkManager->sendPacketToServer(response);
+}
+
+/**
+ * @brief Responds to a server hash mode query with the hashes of the view range in the hash mode the server picked.
+ *        Responses go through the same response cache as hash queries, with a slot per hash mode.
+ *
+ * @param blockNumber Map Block Number
+ * @param mapNumber Map Number
+ * @param hashMode Hash mode the server picked from the hash capabilities response
+ */
+void Atlas::onHashModeQuery(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode)
+{
+  Logger::g_pLogger->LogPrint("Atlas: Got Hash Mode Query (mode %d)\n", hashMode);
+  startPendingPrecompute(mapNumber, blockNumber);
+  recordVisit(mapNumber, blockNumber);
+
+  std::vector<uint8_t> response;
+  if (m_hashResponseCache.lookup(0xF9, hashMode, mapNumber, blockNumber, m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY, response))
+  {
+    m_pNetworkManager->sendPacketToServer(&response[0]);
+    return;
+  }
+
+  switch (hashMode)
+  {
+    case Fletcher16HashPolicy::HASH_MODE:
+      response = buildHashModeResponse<Fletcher16HashPolicy>(blockNumber, mapNumber);
+      break;
+    case Crc32HashPolicy::HASH_MODE:
+      response = buildHashModeResponse<Crc32HashPolicy>(blockNumber, mapNumber);
+      break;
+    case Crc32cHashPolicy::HASH_MODE:
+      response = buildHashModeResponse<Crc32cHashPolicy>(blockNumber, mapNumber);
+      break;
+    case Xxh64HashPolicy::HASH_MODE:
+      response = buildHashModeResponse<Xxh64HashPolicy>(blockNumber, mapNumber);
+      break;
+    case SplitCrc32HashPolicy::HASH_MODE:
+      response = buildHashModeResponse<SplitCrc32HashPolicy>(blockNumber, mapNumber);
+      break;
+    default:
+      Logger::g_pLogger->LogPrint("Atlas: Unknown hash mode %d in hash mode query\n", hashMode);
+      return;
+  }
+
+  m_hashResponseCache.store(0xF9, hashMode, mapNumber, blockNumber, m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY, GetGroupOfBlockNumbers(mapNumber, blockNumber), response);
+  m_pNetworkManager->sendPacketToServer(&response[0]);
+}
+
+/**
+ * @brief Responds to a server expected hash query with a bitmap of the view range blocks whose hashes differ from the
+ *        ones the server sent, so the response carries one bit per block instead of a whole hash.
+ *
+ * @param blockNumber Map Block Number
+ * @param mapNumber Map Number
+ * @param hashMode Hash mode of the expected hashes
+ * @param pExpectedHashes Pointer to the server's hashes of the view range, big endian and in query32 order
+ * @param numberOfHashes Number of expected hashes the server sent
+ * @param dataLength Number of bytes the expected hashes can take up in the packet
+ */
+void Atlas::onExpectedHashQuery(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode, uint8_t* pExpectedHashes, uint16_t numberOfHashes, uint16_t dataLength)
+{
+  Logger::g_pLogger->LogPrint("Atlas: Got Expected Hash Query for %i blocks (mode %d)\n", numberOfHashes, hashMode);
+  startPendingPrecompute(mapNumber, blockNumber);
+  recordVisit(mapNumber, blockNumber);
+
+  std::vector<uint8_t> response;
+
+  switch (hashMode)
+  {
+    case Fletcher16HashPolicy::HASH_MODE:
+      response = buildExpectedHashResponse<Fletcher16HashPolicy>(blockNumber, mapNumber, pExpectedHashes, numberOfHashes, dataLength);
+      break;
+    case Crc32HashPolicy::HASH_MODE:
+      response = buildExpectedHashResponse<Crc32HashPolicy>(blockNumber, mapNumber, pExpectedHashes, numberOfHashes, dataLength);
+      break;
+    case Crc32cHashPolicy::HASH_MODE:
+      response = buildExpectedHashResponse<Crc32cHashPolicy>(blockNumber, mapNumber, pExpectedHashes, numberOfHashes, dataLength);
+      break;
+    case Xxh64HashPolicy::HASH_MODE:
+      response = buildExpectedHashResponse<Xxh64HashPolicy>(blockNumber, mapNumber, pExpectedHashes, numberOfHashes, dataLength);
+      break;
+    case SplitCrc32HashPolicy::HASH_MODE:
+      response = buildExpectedHashResponse<SplitCrc32HashPolicy>(blockNumber, mapNumber, pExpectedHashes, numberOfHashes, dataLength);
+      break;
+    default:
+      Logger::g_pLogger->LogPrint("Atlas: Unknown hash mode %d in expected hash query\n", hashMode);
+      return;
+  }
+
+  m_pNetworkManager->sendPacketToServer(&response[0]);
+}
+
+/**
+ * @brief Answers an incremental hash query32. Only the blocks that were not part of the window of the last response,
+ *        or whose CRC32 changed since it, are sent. Everything is sent when the server has not applied the last
+ *        response yet, so both sides always compare against the same window.
+ *
+ * @param blockNumber Block the player is standing in
+ * @param mapNumber Map Number
+ * @param acknowledgedSequence Sequence number of the last incremental response the server applied, 0 for none
+ */
+void Atlas::sendIncrementalHashResponse(uint32_t blockNumber, uint8_t mapNumber, uint16_t acknowledgedSequence)
+{
+  bool fullWindow = acknowledgedSequence == 0 || acknowledgedSequence != m_incrementalSequence ||
+    mapNumber != m_incrementalMap || m_incrementalWindow.empty();
+
+  std::vector<int32_t> blocks = GetGroupOfBlockNumbers(mapNumber, blockNumber);
+  std::map<uint32_t, uint32_t> window;
+  std::vector<uint16_t> changedIndices;
+  std::vector<uint32_t> changedCrcs;
+
+  for (size_t i = 0; i < blocks.size(); i++)
+  {
+    if (blocks[i] < 0)
+    {
+      continue;
+    }
+
+    uint32_t crc = getBlockCrc32(mapNumber, blocks[i]);
+    window[blocks[i]] = crc;
+
+    std::map<uint32_t, uint32_t>::iterator itr = m_incrementalWindow.find(blocks[i]);
+    if (fullWindow || itr == m_incrementalWindow.end() || itr->second != crc)
+    {
+      changedIndices.push_back(static_cast<uint16_t>(i));
+      changedCrcs.push_back(crc);
+    }
+  }
+
+  m_incrementalSequence++;
+  if (m_incrementalSequence == 0)
+  {
+    m_incrementalSequence = 1;
+  }
+
+  m_incrementalMap = mapNumber;
+  m_incrementalWindow.swap(window);
+
+  Logger::g_pLogger->LogPrint("Atlas: Sending %i of %i block hashes\n", changedIndices.size(), blocks.size());
+
+  size_t size = 18 + changedIndices.size() * (sizeof(uint16_t) + sizeof(uint32_t));
+  std::vector<uint8_t> response(size, 0);
+  uint8_t* pResponse = &response[0];
+
+  pResponse[0] = 0x3F;                                               //byte 000              -  cmd
+  *reinterpret_cast<uint16_t*>(pResponse + 1) = (uint16_t)size;      //byte 001 through 002  -  packet size
+  *reinterpret_cast<uint32_t*>(pResponse + 3) = htonl(blockNumber);  //byte 003 through 006  -  central block number for the query (block that player is standing in)
+  *reinterpret_cast<uint32_t*>(pResponse + 7) = htonl(8);            //byte 007 through 010  -  number of statics in the packet (8 for a query response)
+  *reinterpret_cast<uint16_t*>(pResponse + 11) = htons(m_incrementalSequence); //byte 011 through 012  -  UltimaLive sequence number of this response
+  pResponse[13] = 0xFB;                                              //byte 013              -  UltimaLive command (0xFB is an incremental block Query32 Response)
+  pResponse[14] = mapNumber;                                         //byte 014              -  UltimaLive mapnumber
+  pResponse[15] = fullWindow ? 0x01 : 0x00;                          //byte 015              -  1 if every block of the window is listed
+  *reinterpret_cast<uint16_t*>(pResponse + 16) = htons(static_cast<uint16_t>(changedIndices.size())); //byte 016 through 017 - number of blocks
+
+  //byte 018 onward - per block: index in the window, CRC32
+  for (size_t i = 0; i < changedIndices.size(); i++)
+  {
+    *reinterpret_cast<uint16_t*>(pResponse + 18 + (i * 6)) = htons(changedIndices[i]);
+    *reinterpret_cast<uint32_t*>(pResponse + 20 + (i * 6)) = htonl(changedCrcs[i]);
+  }
+
+  m_pNetworkManager->sendPacketToServer(pResponse);
+}
+
+/**
+ * @brief Responds to a server region hash query. For every requested node of the block hash tree, the hashes of its
+ *        four children are returned so the server can descend only into the regions that differ.
+ *
+ * @param blockNumber Block the player is standing in, echoed back to the server
+ * @param mapNumber Map Number
+ * @param pNodeData Pointer to the requested nodes, 5 bytes each (level, node x, node y)
+ * @param numberOfNodes Number of requested nodes
+ */
+void Atlas::onRegionHashQuery(uint32_t blockNumber, uint8_t mapNumber, uint8_t* pNodeData, uint16_t numberOfNodes)
+{
+  Logger::g_pLogger->LogPrint("Atlas: Got Region Hash Query for %i nodes\n", numberOfNodes);
+
+  if (mapNumber != m_currentMap)
+  {
+    Logger::g_pLogger->LogPrint("Atlas: Ignoring Region Hash Query for map %i while map %i is loaded\n", mapNumber, m_currentMap);
+    return;
+  }
+
+  startPendingPrecompute(mapNumber, blockNumber);
+  recordVisit(mapNumber, blockNumber);
+  numberOfNodes = min(numberOfNodes, MAX_REGION_HASH_QUERY_NODES);
+
+  size_t size = 17 + numberOfNodes * (5 + 4 * sizeof(uint32_t));
+  std::vector<uint8_t> response(size, 0);
+  uint8_t* pResponse = &response[0];
+
+  pResponse[0] = 0x3F;                                               //byte 000              -  cmd
+  *reinterpret_cast<uint16_t*>(pResponse + 1) = (uint16_t)size;      //byte 001 through 002  -  packet size
+  *reinterpret_cast<uint32_t*>(pResponse + 3) = htonl(blockNumber);  //byte 003 through 006  -  central block number for the query (block that player is standing in)
+  *reinterpret_cast<uint32_t*>(pResponse + 7) = htonl(8);            //byte 007 through 010  -  number of statics in the packet (8 for a query response)
+  *reinterpret_cast<uint16_t*>(pResponse + 11) = htons(0);           //byte 011 through 012  -  UltimaLive sequence number
+  pResponse[13] = 0xFC;                                              //byte 013              -  UltimaLive command (0xFC is a region hash query response)
+  pResponse[14] = mapNumber;                                         //byte 014              -  UltimaLive mapnumber
+  *reinterpret_cast<uint16_t*>(pResponse + 15) = htons(numberOfNodes); //byte 015 through 016 - number of nodes
+
+  //byte 017 onward - per node: level, node x, node y, 4 child hashes
+  uint8_t* pNodeResponse = pResponse + 17;
+
+  for (uint16_t i = 0; i < numberOfNodes; i++)
+  {
+    uint8_t level = pNodeData[i * 5];
+    uint16_t nodeX = ntohs(*reinterpret_cast<uint16_t*>(&pNodeData[(i * 5) + 1]));
+    uint16_t nodeY = ntohs(*reinterpret_cast<uint16_t*>(&pNodeData[(i * 5) + 3]));
+
+    uint32_t childHashes[4];
+    m_blockHashTree.getChildHashes(m_pFileManager, mapNumber, level, nodeX, nodeY, childHashes);
+
+    pNodeResponse[0] = level;
+    *reinterpret_cast<uint16_t*>(pNodeResponse + 1) = htons(nodeX);
+    *reinterpret_cast<uint16_t*>(pNodeResponse + 3) = htons(nodeY);
+
+    for (uint32_t child = 0; child < 4; child++)
+    {
+      *reinterpret_cast<uint32_t*>(pNodeResponse + 5 + (child * sizeof(uint32_t))) = htonl(childHashes[child]);
+    }
+
+    pNodeResponse += 5 + 4 * sizeof(uint32_t);
+  }
+
+  m_pNetworkManager->sendPacketToServer(pResponse);
+}
+
 /**
 * @brief Updates map definitions as received from the server
 *
@@ -334,6 +786,8 @@ void Atlas::onHashQuery32(uint32_t blockNumber, uint8_t mapNumber)
 void Atlas::onUpdateMapDefinitions(std::vector<MapDefinition> definitions)
 {
   m_mapDefinitions.clear();
+  m_hashResponseCache.clear();
+  m_blockGroupLayout.clear();
 
   for (std::vector<MapDefinition>::iterator itr = definitions.begin(); itr != definitions.end(); itr++)
   {
@@ -414,30 +868,22 @@ uint8_t Atlas::getCurrentMap()
  *
  * @ return 16 bit CRC
  */
-uint16_t Atlas::fletcher16(uint8_t* pBlockData, uint8_t* pStaticsData, uint32_t staticsLength)
+uint16_t Atlas::fletcher16(const uint8_t* pBlockData, const uint8_t* pStaticsData, uint32_t staticsLength)
 {
-  uint16_t sum1 = 0;
-  uint16_t sum2 = 0;
+  uint32_t sum1 = 0;
+  uint32_t sum2 = 0;
 
   if (pBlockData != NULL)
   {
-    for (int index = 0; index < 192; ++index)
-    {
-      sum1 = (uint16_t)((sum1 + pBlockData[index]) % 255);
-      sum2 = (uint16_t)((sum2 + sum1) % 255);
-    }
+    Fletcher16::update(sum1, sum2, pBlockData, 192);
   }
 
   if (pStaticsData != NULL)
   {
-    for (uint32_t index = 0; index < staticsLength; ++index)
-    {
-      sum1 = (uint16_t)((sum1 + pStaticsData[index]) % 255);
-      sum2 = (uint16_t)((sum2 + sum1) % 255);
-    }
+    Fletcher16::update(sum1, sum2, pStaticsData, staticsLength);
   }
 
-  return (uint16_t)((sum2 << 8) | sum1);
+  return Fletcher16::finalize(sum1, sum2);
 }
 
 /**
@@ -449,186 +895,39 @@ uint16_t Atlas::fletcher16(uint8_t* pBlockData, uint8_t* pStaticsData, uint32_t
  *
  * @ return 32 bit CRC
  */
-uint32_t Atlas::calculateCrc32(uint8_t* pBlockData, uint8_t* pStaticsData, uint32_t staticsLength)
+uint32_t Atlas::calculateCrc32(const uint8_t* pBlockData, const uint8_t* pStaticsData, uint32_t staticsLength)
 {
-    const uint32_t crc32Table[256] =
-    {
-        0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
-        0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-        0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
-        0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-        0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE,
-        0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-        0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,
-        0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-        0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-        0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-        0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940,
-        0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-        0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116,
-        0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-        0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
-        0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-        0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A,
-        0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-        0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818,
-        0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-        0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
-        0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-        0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C,
-        0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-        0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2,
-        0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-        0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-        0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-        0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086,
-        0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-        0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4,
-        0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-        0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
-        0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-        0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8,
-        0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-        0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE,
-        0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-        0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
-        0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-        0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252,
-        0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-        0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60,
-        0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-        0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-        0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-        0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04,
-        0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-        0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A,
-        0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-        0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
-        0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-        0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E,
-        0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-        0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C,
-        0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-        0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
-        0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-        0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0,
-        0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-        0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6,
-        0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-        0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-        0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
-    };
-
-    uint32_t currentCrc = 0xFFFFFFFF;
-
-    if (pBlockData != NULL)
-    {
-        for (int index = 0; index < 192; ++index)
-        {
-            currentCrc = (currentCrc >> 8) ^ crc32Table[(currentCrc & 0xFF) ^ pBlockData[index]];
-        }
-    }
+  uint32_t currentCrc = Crc32::INITIAL_STATE;
 
-    if (pStaticsData != NULL)
-    {
-        for (uint32_t index = 0; index < staticsLength; ++index)
-        {
-            currentCrc = (currentCrc >> 8) ^ crc32Table[(currentCrc & 0xFF) ^ pStaticsData[index]];
-        }
-    }
+  if (pBlockData != NULL)
+  {
+    currentCrc = Crc32::update(currentCrc, pBlockData, 192);
+  }
 
-    return (uint32_t)(currentCrc ^ 0xFFFFFFFF);
+  if (pStaticsData != NULL)
+  {
+    currentCrc = Crc32::update(currentCrc, pStaticsData, staticsLength);
+  }
+
+  return (uint32_t)(currentCrc ^ 0xFFFFFFFF);
 }
 
 int32_t Atlas::BLOCK_POSITION_OFFSETS[5] = { -2, -1, 0, 1, 2 };
+const uint16_t Atlas::MAX_REGION_HASH_QUERY_NODES;
+const uint32_t Atlas::DEFAULT_WARMUP_SPOTS;
+const uint16_t Atlas::EXPECTED_HASH_QUERY_CAPABILITY;
 
 /**
  * @brief Gets CRCs for the 25 blocks surrounding the current players position
  *
  * @param mapNumber Map Number
  * @param blockNumber Number of the block containing the current player position
- * 
+ *
  * @return Array of 25 block numbers
  */
 std::vector<uint16_t> Atlas::GetGroupOfBlockCrcs(uint32_t mapNumber, uint32_t blockNumber)
 {
-    std::vector<uint16_t> pCrcs(m_BlocksWidth * m_BlocksHeight, 0);
-  if (m_mapDefinitions.find(mapNumber) != m_mapDefinitions.end())
-  {
-    MapDefinition def = m_mapDefinitions[mapNumber];
-    int32_t blockX = ((int32_t)blockNumber /  (def.mapHeightInTiles >> 3));
-    int32_t blockY = ((int32_t)blockNumber % (def.mapHeightInTiles >> 3));
-
-    int32_t wrapWidthInBlocks = (def.mapWrapWidthInTiles >> 3);
-    int32_t wrapHeightInBlocks = (def.mapWrapHeightInTiles >> 3);
-    int32_t mapWidthInBlocks = (def.mapWidthInTiles >> 3);
-    int32_t mapHeightInBlocks = (def.mapHeightInTiles >> 3);
-
-    if (blockX < 0 || blockX >= mapWidthInBlocks|| blockY < 0 || blockY >= mapHeightInBlocks)
-    {
-    }
-    else
-    {
-        int32_t boundX = m_MinBlockX - 1;
-        int32_t absOffsetX = std::abs(m_MinBlockX);
-        int32_t absOffsetY = std::abs(m_MinBlockY);
-
-      for (int x = m_MinBlockX; x <= m_MaxBlockX; x++)
-      {
-        int xBlockItr = -1;
-        if (blockX < wrapWidthInBlocks)
-        {
-          xBlockItr = (blockX + x) % wrapWidthInBlocks;
-          if (xBlockItr < 0 && xBlockItr > boundX)
-          {
-            xBlockItr += wrapWidthInBlocks;
-          }
-        }
-        else
-        {
-          xBlockItr = (blockX + x) % mapWidthInBlocks;
-          if (xBlockItr < 0 && xBlockItr > boundX)
-          {
-            xBlockItr += mapWidthInBlocks;
-          }
-        }
-        for (int y = m_MinBlockY; y <= m_MaxBlockY; y++)
-        {
-          int yBlockItr = 0;
-          if (blockY < wrapHeightInBlocks)
-          {
-            yBlockItr = (blockY + y) % wrapHeightInBlocks;
-            if (yBlockItr < 0)
-            {
-              yBlockItr += wrapHeightInBlocks;
-            }
-          }
-          else
-          {
-            yBlockItr = (blockY + y) % mapHeightInBlocks;
-            if (yBlockItr < 0)
-            {
-              yBlockItr += mapHeightInBlocks;
-            }
-          }
-
-          int32_t currentBlock = (xBlockItr * mapHeightInBlocks) + yBlockItr;
-
-          if (currentBlock >= 0 && currentBlock <= (mapHeightInBlocks * mapWidthInBlocks))
-          {
-              uint16_t &currentCrc = m_crcCache[currentBlock];
-
-              if (currentCrc == 0xFFFF)
-                  currentCrc = getBlockCrc(mapNumber, currentBlock);
-
-              pCrcs[((x + absOffsetX) * m_BlocksHeight) + (y + absOffsetY)] = currentCrc;
-          }
-        }
-      }
-    }
-  }
-
-  return pCrcs;
+  return getGroupOfBlockHashes<Fletcher16HashPolicy>(mapNumber, blockNumber);
 }
 
 /**
@@ -641,87 +940,41 @@ std::vector<uint16_t> Atlas::GetGroupOfBlockCrcs(uint32_t mapNumber, uint32_t bl
  */
 std::vector<uint32_t> Atlas::GetGroupOfBlockCrcs32(uint32_t mapNumber, uint32_t blockNumber)
 {
-    std::vector<uint32_t> pCrcs(m_BlocksWidth * m_BlocksHeight, 0);
-    if (m_mapDefinitions.find(mapNumber) != m_mapDefinitions.end())
+  return getGroupOfBlockHashes<Crc32HashPolicy>(mapNumber, blockNumber);
+}
+
+/**
+ * @brief Gets the numbers of the blocks in the view range surrounding the current players position, in the order
+ *        their hashes are sent to the server
+ *
+ * @param mapNumber Map Number
+ * @param blockNumber Number of the block containing the current player position
+ *
+ * @return Array of block numbers, -1 for positions outside of the map
+ */
+std::vector<int32_t> Atlas::GetGroupOfBlockNumbers(uint32_t mapNumber, uint32_t blockNumber)
+{
+  if (!m_blockGroupLayout.isLayoutFor(static_cast<uint8_t>(mapNumber)))
+  {
+    std::map<uint32_t, MapDefinition>::iterator itr = m_mapDefinitions.find(mapNumber);
+    if (itr != m_mapDefinitions.end())
     {
-        MapDefinition def = m_mapDefinitions[mapNumber];
-        int32_t blockX = ((int32_t)blockNumber / (def.mapHeightInTiles >> 3));
-        int32_t blockY = ((int32_t)blockNumber % (def.mapHeightInTiles >> 3));
-
-        int32_t wrapWidthInBlocks = (def.mapWrapWidthInTiles >> 3);
-        int32_t wrapHeightInBlocks = (def.mapWrapHeightInTiles >> 3);
-        int32_t mapWidthInBlocks = (def.mapWidthInTiles >> 3);
-        int32_t mapHeightInBlocks = (def.mapHeightInTiles >> 3);
-
-        if (blockX < 0 || blockX >= mapWidthInBlocks || blockY < 0 || blockY >= mapHeightInBlocks)
-        {
-        }
-        else
-        {
-            int32_t boundX = m_MinBlockX - 1;
-            int32_t absOffsetX = std::abs(m_MinBlockX);
-            int32_t absOffsetY = std::abs(m_MinBlockY);
-
-            for (int x = m_MinBlockX; x <= m_MaxBlockX; x++)
-            {
-                int xBlockItr = -1;
-                if (blockX < wrapWidthInBlocks)
-                {
-                    xBlockItr = (blockX + x) % wrapWidthInBlocks;
-                    if (xBlockItr < 0 && xBlockItr > boundX)
-                    {
-                        xBlockItr += wrapWidthInBlocks;
-                    }
-                }
-                else
-                {
-                    xBlockItr = (blockX + x) % mapWidthInBlocks;
-                    if (xBlockItr < 0 && xBlockItr > boundX)
-                    {
-                        xBlockItr += mapWidthInBlocks;
-                    }
-                }
-                for (int y = m_MinBlockY; y <= m_MaxBlockY; y++)
-                {
-                    int yBlockItr = 0;
-                    if (blockY < wrapHeightInBlocks)
-                    {
-                        yBlockItr = (blockY + y) % wrapHeightInBlocks;
-                        if (yBlockItr < 0)
-                        {
-                            yBlockItr += wrapHeightInBlocks;
-                        }
-                    }
-                    else
-                    {
-                        yBlockItr = (blockY + y) % mapHeightInBlocks;
-                        if (yBlockItr < 0)
-                        {
-                            yBlockItr += mapHeightInBlocks;
-                        }
-                    }
-
-                    int32_t currentBlock = (xBlockItr * mapHeightInBlocks) + yBlockItr;
-
-                    if (currentBlock >= 0 && currentBlock <= (mapHeightInBlocks * mapWidthInBlocks))
-                    {
-                        uint32_t &currentCrc = m_crc32Cache[currentBlock];
-
-                        if (currentCrc == 0xFFFFFFFF)
-                            currentCrc = getBlockCrc32(mapNumber, currentBlock);
-
-                        pCrcs[((x + absOffsetX) * m_BlocksHeight) + (y + absOffsetY)] = currentCrc;
-                    }
-                }
-            }
-        }
+      m_blockGroupLayout.reset(itr->second, m_MinBlockX, m_MaxBlockX, m_MinBlockY, m_MaxBlockY);
     }
+    else
+    {
+      std::vector<int32_t> blocks(m_BlocksWidth * m_BlocksHeight, -1);
+      return blocks;
+    }
+  }
 
-    return pCrcs;
+  std::vector<int32_t> blocks;
+  m_blockGroupLayout.getBlockNumbers(blockNumber, blocks);
+  return blocks;
 }
 
 /**
- * @brief Looks up the memory blocks for a specified block number and map number, returns the CRC of the block
+ * @brief Looks up the cached CRC of a block, hashing the land and statics parts that changed since the last lookup
  *
  * @param mapNumber Map Number
  * @param blockNumber Block Number
@@ -729,30 +982,17 @@ std::vector<uint32_t> Atlas::GetGroupOfBlockCrcs32(uint32_t mapNumber, uint32_t
 uint16_t Atlas::getBlockCrc(uint32_t mapNumber, uint32_t blockNumber)
 {
   uint16_t crc = 0; 
-  if (m_mapDefinitions.find(mapNumber) != m_mapDefinitions.end())
+  MapBlockReader* pReader = getBlockReader(static_cast<uint8_t>(mapNumber));
+  if (pReader != NULL)
   {
-    uint8_t* pBlockData = m_pFileManager->readLandBlock(static_cast<uint8_t>(mapNumber), blockNumber);
-    uint32_t staticsLength = 0;
-
-    uint8_t* pStaticsData = m_pFileManager->readStaticsBlock(mapNumber, blockNumber, staticsLength);
-
-    if (pBlockData != NULL)
-    {
-      crc = fletcher16(pBlockData, pStaticsData, staticsLength);
-      delete pBlockData;
-    }
-
-    if (pStaticsData != NULL)
-    {
-      delete pStaticsData;
-    }
+    crc = m_blockHashCache.getFletcher16(pReader, static_cast<uint8_t>(mapNumber), blockNumber);
   }
 
   return crc;
 }
 
 /**
- * @brief Looks up the memory blocks for a specified block number and map number, returns the CRC32 of the block
+ * @brief Looks up the cached CRC32 of a block, hashing the land and statics parts that changed since the last lookup
  *
  * @param mapNumber Map Number
  * @param blockNumber Block Number
@@ -760,24 +1000,59 @@ uint16_t Atlas::getBlockCrc(uint32_t mapNumber, uint32_t blockNumber)
 uint32_t Atlas::getBlockCrc32(uint32_t mapNumber, uint32_t blockNumber)
 {
     uint32_t crc = 0;
-    if (m_mapDefinitions.find(mapNumber) != m_mapDefinitions.end())
+    MapBlockReader* pReader = getBlockReader(static_cast<uint8_t>(mapNumber));
+    if (pReader != NULL)
     {
-        uint8_t* pBlockData = m_pFileManager->readLandBlock(static_cast<uint8_t>(mapNumber), blockNumber);
-        uint32_t staticsLength = 0;
+        crc = m_blockHashCache.getCrc32(pReader, static_cast<uint8_t>(mapNumber), blockNumber);
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Gets the reader hash queries about a map are answered from. The loaded map is read by the file manager, any
+ *        other shard map from its files. Opening another map's files selects it as the destination map of the block
+ *        hash cache.
+ *
+ *        This is client side groundwork for syncing an arrival area before a map change. The shipped server scripts
+ *        only query the map the player is on, and land and statics updates are always written to the loaded map, so
+ *        the server must not push updates for another map until they are routed to that map's files.
+ *
+ * @param mapNumber Map Number
+ *
+ * @return Reader of the map, NULL if the map is not defined or its files cannot be opened
+ */
+MapBlockReader* Atlas::getBlockReader(uint8_t mapNumber)
+{
+  std::map<uint32_t, MapDefinition>::iterator itr = m_mapDefinitions.find(mapNumber);
+  if (itr == m_mapDefinitions.end())
+  {
+    return NULL;
+  }
 
-        uint8_t* pStaticsData = m_pFileManager->readStaticsBlock(mapNumber, blockNumber, staticsLength);
+  if (mapNumber == m_currentMap)
+  {
+    return m_pFileManager;
+  }
 
-        if (pBlockData != NULL)
-        {
-            crc = calculateCrc32(pBlockData, pStaticsData, staticsLength);
-            delete pBlockData;
-        }
+  if (!m_mapFileReader.isOpen() || m_mapFileReader.getMapNumber() != mapNumber)
+  {
+    m_blockHashCache.beginDataUpdate();
+    m_mapFileReader.close();
 
-        if (pStaticsData != NULL)
-        {
-            delete pStaticsData;
-        }
+    if (m_mapFileReader.open(m_pFileManager->getShardMapFolder(), mapNumber))
+    {
+      m_blockHashCache.selectDestinationMap(mapNumber, (itr->second.mapWidthInTiles / 8) * (itr->second.mapHeightInTiles / 8),
+        m_mapFileReader.hasBlockHashStamps());
     }
 
-    return crc;
+    m_blockHashCache.endDataUpdate();
+  }
+
+  if (!m_mapFileReader.isOpen())
+  {
+    return NULL;
+  }
+
+  return &m_mapFileReader;
 }
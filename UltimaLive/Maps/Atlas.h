@@ -32,11 +32,20 @@
 #include <map>
 
 #include "..\FileSystem\BaseFileManager.h"
+#include "..\FileSystem\MapFileReader.h"
 #include "..\LocalPeHelper32.hpp"
 #include "..\ClassRegistration\SelfRegisteringClass.h"
 #include "..\Client.h"
+#include "..\Hashing\HashCompare.h"
 
 #include "MapDefinition.h"
+#include "BlockHashCache.h"
+#include "BlockGroupLayout.h"
+#include "BlockHashPrecomputer.h"
+#include "BlockHashPrefetcher.h"
+#include "BlockHeatmap.h"
+#include "BlockHashTree.h"
+#include "HashResponseCache.h"
 
 class UltimaLive;
 class NetworkManager;
@@ -53,9 +62,10 @@ class Atlas
     Atlas();
     std::vector<uint16_t> GetGroupOfBlockCrcs(uint32_t mapNumber, uint32_t blockNumber);
     std::vector<uint32_t> GetGroupOfBlockCrcs32(uint32_t mapNumber, uint32_t blockNumber);
+    std::vector<int32_t> GetGroupOfBlockNumbers(uint32_t mapNumber, uint32_t blockNumber);
 
-    static uint16_t fletcher16(uint8_t* pBlockData, uint8_t* pStaticsData, uint32_t staticsLength);
-    static uint32_t calculateCrc32(uint8_t* pBlockData, uint8_t* pStaticsData, uint32_t staticsLength);
+    static uint16_t fletcher16(const uint8_t* pBlockData, const uint8_t* pStaticsData, uint32_t staticsLength);
+    static uint32_t calculateCrc32(const uint8_t* pBlockData, const uint8_t* pStaticsData, uint32_t staticsLength);
 
     void LoadMap(uint8_t map);
     uint8_t getCurrentMap();
@@ -69,15 +79,34 @@ class Atlas
       int32_t m_BlocksWidth = 5;
       int32_t m_BlocksHeight = 5;
 
-      std::vector<uint16_t> m_crcCache;
-      std::vector<uint32_t> m_crc32Cache;
+      BlockHashCache m_blockHashCache; //!< Cached block hashes for the loaded map and the maps visited before it
+      MapFileReader m_mapFileReader; //!< Files of the shard map hash queries last asked about while it was not loaded
+      BlockHashPrecomputer m_precomputer; //!< Background hashing of the loaded map
+      BlockHashPrefetcher m_prefetcher; //!< Hashing of the blocks ahead of the player on the loaded map
+      BlockHashTree m_blockHashTree; //!< Region hashes of the loaded map
+      HashResponseCache m_hashResponseCache; //!< Last hash query responses, answered again while the player stands still
+      BlockGroupLayout m_blockGroupLayout; //!< Layout of the view range window on the map it was last used for
+      uint32_t m_precomputeThreads; //!< Number of background hashing threads, 0 when disabled
+      uint32_t m_prefetchInterval; //!< Milliseconds between samples of the player's position, 0 when prefetching is disabled
+      uint32_t m_prefetchLookahead; //!< Number of blocks ahead of the view range to prefetch
+      BlockHeatmap m_blockHeatmap; //!< Blocks the player stood in on the loaded map, this session and earlier ones
+      uint32_t m_warmupSpots; //!< Number of the most visited blocks whose view range is hashed after a map load
+      bool m_precomputePending; //!< Background hashing waits for the first hash query on the loaded map
+      std::map<uint32_t, uint32_t> m_incrementalWindow; //!< Block CRCs32 of the window in the last incremental hash response
+      uint16_t m_incrementalSequence; //!< Sequence number of the last incremental hash response
+      uint8_t m_incrementalMap; //!< Map number of the last incremental hash response
 
     void onBeforeMapChange(uint8_t& rMap);
     void onMapChange(uint8_t& rMap);
 
     void onBlocksViewRange(int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY);
     void onHashQuery(uint32_t blockNumber, uint8_t mapNumber);
-    void onHashQuery32(uint32_t blockNumber, uint8_t mapNumber);
+    void onHashQuery32(uint32_t blockNumber, uint8_t mapNumber, bool incremental, uint16_t acknowledgedSequence);
+    void sendIncrementalHashResponse(uint32_t blockNumber, uint8_t mapNumber, uint16_t acknowledgedSequence);
+    void onRegionHashQuery(uint32_t blockNumber, uint8_t mapNumber, uint8_t* pNodeData, uint16_t numberOfNodes);
+    void onHashCapabilitiesQuery();
+    void onHashModeQuery(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode);
+    void onExpectedHashQuery(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode, uint8_t* pExpectedHashes, uint16_t numberOfHashes, uint16_t dataLength);
     void onRefreshClientView();
     void onUpdateMapDefinitions(std::vector<MapDefinition> definitions);
     void onUpdateStatics(uint8_t mapNumber, uint32_t blockNumber, uint8_t* pData, uint32_t length);
@@ -87,10 +116,31 @@ class Atlas
 
     void onLogout();
 
+    void startPendingPrecompute(uint8_t mapNumber, uint32_t blockNumber);
+    void recordVisit(uint8_t mapNumber, uint32_t blockNumber);
+    void saveHeatmap();
+    void getWarmupBlocks(uint8_t mapNumber, std::vector<uint32_t>& rBlocksOut);
+
+    template <typename HashPolicy>
+    std::vector<typename HashPolicy::HashType> getGroupOfBlockHashes(uint32_t mapNumber, uint32_t blockNumber);
+
+    template <typename HashPolicy>
+    std::vector<uint8_t> buildHashModeResponse(uint32_t blockNumber, uint8_t mapNumber);
+
+    template <typename HashPolicy>
+    std::vector<uint8_t> buildExpectedHashResponse(uint32_t blockNumber, uint8_t mapNumber, const uint8_t* pExpectedHashes, uint16_t numberOfHashes, uint16_t dataLength);
+
+    template <typename HashType>
+    static void writeHashes(const std::vector<HashType>& hashes, uint8_t* pOut);
+
     static int32_t BLOCK_POSITION_OFFSETS[5];  //!< Array of offsets used when calculating hashes
+    static const uint16_t MAX_REGION_HASH_QUERY_NODES = 1024; //!< Most nodes answered by one region hash query response
+    static const uint32_t DEFAULT_WARMUP_SPOTS = 16; //!< Most visited blocks warmed after a map load unless configured
+    static const uint16_t EXPECTED_HASH_QUERY_CAPABILITY = 0x0001; //!< Capabilities response bit of the expected hash query (0xF8)
 
     uint16_t getBlockCrc(uint32_t mapNumber, uint32_t blockNumber);
     uint32_t getBlockCrc32(uint32_t mapNumber, uint32_t blockNumber);
+    MapBlockReader* getBlockReader(uint8_t mapNumber);
 
 
     std::map<uint32_t, MapDefinition> m_mapDefinitions; //!< Map linking map indices to map definitions 
@@ -113,4 +163,136 @@ class Atlas
 #pragma endregion
 };
 
+/**
+ * @brief Gets the hashes of the blocks in the view range surrounding the current players position, in the order
+ *        they are sent to the server. Cells outside of the map, or of a map that cannot be read, hash to 0.
+ *
+ * @param mapNumber Map Number
+ * @param blockNumber Number of the block containing the current player position
+ *
+ * @return Array of block hashes of the type the hash policy provides
+ */
+template <typename HashPolicy>
+std::vector<typename HashPolicy::HashType> Atlas::getGroupOfBlockHashes(uint32_t mapNumber, uint32_t blockNumber)
+{
+  std::vector<int32_t> blocks = GetGroupOfBlockNumbers(mapNumber, blockNumber);
+  std::vector<typename HashPolicy::HashType> hashes(blocks.size(), 0);
+  MapBlockReader* pReader = getBlockReader(static_cast<uint8_t>(mapNumber));
+
+  for (size_t i = 0; i < blocks.size() && pReader != NULL; i++)
+  {
+    if (blocks[i] >= 0)
+    {
+      hashes[i] = HashPolicy::getHash(m_blockHashCache, pReader, static_cast<uint8_t>(mapNumber), blocks[i]);
+    }
+  }
+
+  return hashes;
+}
+
+/**
+ * @brief Builds the hash mode query (0xF9) response for the view range surrounding a block. The hashes follow the
+ *        header in the order of GetGroupOfBlockNumbers, big endian and sizeof(HashPolicy::HashType) bytes each.
+ *
+ * @param blockNumber Number of the block containing the current player position
+ * @param mapNumber Map Number
+ *
+ * @return Serialized response
+ */
+template <typename HashPolicy>
+std::vector<uint8_t> Atlas::buildHashModeResponse(uint32_t blockNumber, uint8_t mapNumber)
+{
+  std::vector<typename HashPolicy::HashType> hashes = getGroupOfBlockHashes<HashPolicy>(mapNumber, blockNumber);
+  const size_t hashSize = sizeof(typename HashPolicy::HashType);
+  size_t size = 16 + hashes.size() * hashSize;
+  std::vector<uint8_t> response(size, 0);
+  uint8_t* pResponse = &response[0];
+
+  pResponse[0] = 0x3F;                                               //byte 000              -  cmd
+  *reinterpret_cast<uint16_t*>(pResponse + 1) = (uint16_t)size;      //byte 001 through 002  -  packet size
+  *reinterpret_cast<uint32_t*>(pResponse + 3) = htonl(blockNumber);  //byte 003 through 006  -  central block number for the query (block that player is standing in)
+  *reinterpret_cast<uint32_t*>(pResponse + 7) = htonl(8);            //byte 007 through 010  -  number of statics in the packet (8 for a query response)
+  *reinterpret_cast<uint16_t*>(pResponse + 11) = htons(0);           //byte 011 through 012  -  UltimaLive sequence number
+  pResponse[13] = 0xF9;                                              //byte 013              -  UltimaLive command (0xF9 is a hash mode query response)
+  pResponse[14] = mapNumber;                                         //byte 014              -  UltimaLive mapnumber
+  pResponse[15] = HashPolicy::HASH_MODE;                             //byte 015              -  hash mode of the block hashes
+  writeHashes(hashes, pResponse + 16);                               //byte 016 onwards      -  block hashes
+
+  return response;
+}
+
+/**
+ * @brief Builds the expected hash query (0xF8) response for the view range surrounding a block. The client's hashes
+ *        are serialized like the server's and compared in place. Blocks past the end of the server's hashes count
+ *        as mismatches, so a server that got the view range wrong resends rather than misses blocks.
+ *
+ * @param blockNumber Number of the block containing the current player position
+ * @param mapNumber Map Number
+ * @param pExpectedHashes Pointer to the server's hashes, big endian and sizeof(HashPolicy::HashType) bytes each
+ * @param numberOfHashes Number of expected hashes the server sent
+ * @param dataLength Number of bytes the expected hashes can take up in the packet
+ *
+ * @return Serialized response
+ */
+template <typename HashPolicy>
+std::vector<uint8_t> Atlas::buildExpectedHashResponse(uint32_t blockNumber, uint8_t mapNumber, const uint8_t* pExpectedHashes, uint16_t numberOfHashes, uint16_t dataLength)
+{
+  std::vector<typename HashPolicy::HashType> hashes = getGroupOfBlockHashes<HashPolicy>(mapNumber, blockNumber);
+  const size_t hashSize = sizeof(typename HashPolicy::HashType);
+  size_t bitmapSize = HashCompare::getBitmapSize(hashes.size());
+  size_t size = 18 + bitmapSize;
+  std::vector<uint8_t> response(size, 0);
+  uint8_t* pResponse = &response[0];
+
+  pResponse[0] = 0x3F;                                               //byte 000              -  cmd
+  *reinterpret_cast<uint16_t*>(pResponse + 1) = (uint16_t)size;      //byte 001 through 002  -  packet size
+  *reinterpret_cast<uint32_t*>(pResponse + 3) = htonl(blockNumber);  //byte 003 through 006  -  central block number for the query (block that player is standing in)
+  *reinterpret_cast<uint32_t*>(pResponse + 7) = htonl(8);            //byte 007 through 010  -  number of statics in the packet (8 for a query response)
+  *reinterpret_cast<uint16_t*>(pResponse + 11) = htons(0);           //byte 011 through 012  -  UltimaLive sequence number
+  pResponse[13] = 0xF8;                                              //byte 013              -  UltimaLive command (0xF8 is an expected hash query response)
+  pResponse[14] = mapNumber;                                         //byte 014              -  UltimaLive mapnumber
+  pResponse[15] = HashPolicy::HASH_MODE;                             //byte 015              -  hash mode of the compared hashes
+  *reinterpret_cast<uint16_t*>(pResponse + 16) = htons(static_cast<uint16_t>(hashes.size())); //byte 016 through 017 - number of blocks
+  //byte 018 onwards      -  mismatch bitmap, bit (i & 7) of byte (i >> 3) set when block i differs
+
+  if (!hashes.empty())
+  {
+    //never read past the end of the packet
+    size_t comparedHashes = min((size_t)numberOfHashes, dataLength / hashSize);
+    comparedHashes = min(comparedHashes, hashes.size());
+    std::vector<uint8_t> ownHashes(hashes.size() * hashSize, 0);
+    writeHashes(hashes, &ownHashes[0]);
+
+    HashCompare::findMismatches(&ownHashes[0], pExpectedHashes, comparedHashes, hashSize, pResponse + 18);
+
+    for (size_t i = comparedHashes; i < hashes.size(); i++)
+    {
+      pResponse[18 + (i >> 3)] |= (uint8_t)(1 << (i & 7));
+    }
+  }
+
+  return response;
+}
+
+/**
+ * @brief Serializes block hashes big endian, sizeof(HashType) bytes each, as they are sent to and from the server
+ *
+ * @param hashes Block hashes
+ * @param pOut Pointer to hashes.size() * sizeof(HashType) bytes
+ */
+template <typename HashType>
+void Atlas::writeHashes(const std::vector<HashType>& hashes, uint8_t* pOut)
+{
+  const size_t hashSize = sizeof(HashType);
+
+  for (size_t i = 0; i < hashes.size(); i++)
+  {
+    uint8_t* pHash = pOut + (i * hashSize);
+    for (size_t byteIndex = 0; byteIndex < hashSize; byteIndex++)
+    {
+      pHash[byteIndex] = static_cast<uint8_t>(hashes[i] >> (8 * (hashSize - 1 - byteIndex)));
+    }
+  }
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_CRC32_SOURCE_H
+#define _BLOCK_CRC32_SOURCE_H
+
+#include <stdint.h>
+
+class MapBlockReader;
+
+/**
+ * @class BlockCrc32Source
+ *
+ * @brief Source of the block CRC32s that the BlockHashTree is built over. Implemented by the BlockHashCache, and by
+ * plain tables of hashes where the tree is simulated without the client's map data.
+ */
+class BlockCrc32Source
+{
+  public:
+    virtual ~BlockCrc32Source() {}
+
+    /**
+     * @brief Gets the CRC32 of a block
+     *
+     * @param pReader Reader of the block data
+     * @param mapNumber Map Number
+     * @param blockNumber Block Number
+     *
+     * @return CRC32 of the land and statics data, 0 if the block does not exist
+     */
+    virtual uint32_t getCrc32(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber) = 0;
+};
+
+#endif
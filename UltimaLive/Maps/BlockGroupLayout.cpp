@@ -0,0 +1,176 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "BlockGroupLayout.h"
+
+/**
+ * @brief BlockGroupLayout constructor
+ */
+BlockGroupLayout::BlockGroupLayout()
+  : m_valid(false),
+  m_mapNumber(0),
+  m_widthInBlocks(0),
+  m_heightInBlocks(0),
+  m_wrapWidthInBlocks(0),
+  m_wrapHeightInBlocks(0),
+  m_minBlockX(0),
+  m_maxBlockX(0),
+  m_minBlockY(0),
+  m_maxBlockY(0),
+  m_offsets()
+{
+  //do nothing
+}
+
+/**
+ * @brief Computes the layout of a view range on a map
+ *
+ * @param definition Map definition
+ * @param minBlockX min block x
+ * @param maxBlockX max block x
+ * @param minBlockY min block y
+ * @param maxBlockY max block y
+ */
+void BlockGroupLayout::reset(MapDefinition definition, int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY)
+{
+  m_mapNumber = definition.mapNumber;
+  m_widthInBlocks = definition.mapWidthInTiles >> 3;
+  m_heightInBlocks = definition.mapHeightInTiles >> 3;
+  m_wrapWidthInBlocks = definition.mapWrapWidthInTiles >> 3;
+  m_wrapHeightInBlocks = definition.mapWrapHeightInTiles >> 3;
+  m_minBlockX = minBlockX;
+  m_maxBlockX = maxBlockX;
+  m_minBlockY = minBlockY;
+  m_maxBlockY = maxBlockY;
+
+  m_offsets.clear();
+  for (int32_t x = minBlockX; x <= maxBlockX; x++)
+  {
+    for (int32_t y = minBlockY; y <= maxBlockY; y++)
+    {
+      m_offsets.push_back((x * m_heightInBlocks) + y);
+    }
+  }
+
+  m_valid = true;
+}
+
+/**
+ * @brief Drops the layout, used when the view range or the map definitions change
+ */
+void BlockGroupLayout::clear()
+{
+  m_valid = false;
+  m_offsets.clear();
+}
+
+/**
+ * @brief Checks if the layout has been computed for a map
+ *
+ * @param mapNumber Map Number
+ *
+ * @return true if the layout can be used for the map
+ */
+bool BlockGroupLayout::isLayoutFor(uint8_t mapNumber) const
+{
+  return m_valid && m_mapNumber == mapNumber;
+}
+
+/**
+ * @brief Gets the numbers of the blocks in the window around a block, in the order their hashes are sent to the
+ * server
+ *
+ * @param blockNumber Number of the block containing the current player position
+ * @param rBlocksOut Receives the block numbers, -1 for cells outside of the map
+ */
+void BlockGroupLayout::getBlockNumbers(uint32_t blockNumber, std::vector<int32_t>& rBlocksOut) const
+{
+  rBlocksOut.assign(m_offsets.size(), -1);
+
+  if (!m_valid || m_heightInBlocks <= 0)
+  {
+    return;
+  }
+
+  int32_t blockX = (int32_t)blockNumber / m_heightInBlocks;
+  int32_t blockY = (int32_t)blockNumber % m_heightInBlocks;
+
+  if (blockX < 0 || blockX >= m_widthInBlocks || blockY < 0 || blockY >= m_heightInBlocks)
+  {
+    return;
+  }
+
+  //blocks left of the wrapping coordinate wrap around it, the others wrap around the edge of the map
+  int32_t limitX = (blockX < m_wrapWidthInBlocks) ? m_wrapWidthInBlocks : m_widthInBlocks;
+  int32_t limitY = (blockY < m_wrapHeightInBlocks) ? m_wrapHeightInBlocks : m_heightInBlocks;
+
+  if (blockX + m_minBlockX >= 0 && blockX + m_maxBlockX < limitX && blockY + m_minBlockY >= 0 && blockY + m_maxBlockY < limitY)
+  {
+    for (size_t i = 0; i < m_offsets.size(); i++)
+    {
+      rBlocksOut[i] = (int32_t)blockNumber + m_offsets[i];
+    }
+  }
+  else
+  {
+    std::vector<int32_t> columns;
+    std::vector<int32_t> rows;
+    getWrappedIndices(blockX, m_minBlockX, m_maxBlockX, limitX, columns);
+    getWrappedIndices(blockY, m_minBlockY, m_maxBlockY, limitY, rows);
+
+    size_t i = 0;
+    for (size_t column = 0; column < columns.size(); column++)
+    {
+      for (size_t row = 0; row < rows.size(); row++)
+      {
+        rBlocksOut[i++] = (columns[column] * m_heightInBlocks) + rows[row];
+      }
+    }
+  }
+}
+
+/**
+ * @brief Wraps the block indices of one axis of the window
+ *
+ * @param center Block index of the central block on the axis
+ * @param minOffset Lowest offset from the central block
+ * @param maxOffset Highest offset from the central block
+ * @param limit Block index the axis wraps at
+ * @param rIndicesOut Receives the wrapped block indices
+ */
+void BlockGroupLayout::getWrappedIndices(int32_t center, int32_t minOffset, int32_t maxOffset, int32_t limit, std::vector<int32_t>& rIndicesOut)
+{
+  rIndicesOut.clear();
+
+  for (int32_t offset = minOffset; offset <= maxOffset; offset++)
+  {
+    int32_t index = (center + offset) % limit;
+    if (index < 0)
+    {
+      index += limit;
+    }
+
+    rIndicesOut.push_back(index);
+  }
+}
@@ -0,0 +1,68 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_GROUP_LAYOUT_H
+#define _BLOCK_GROUP_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "MapDefinition.h"
+
+/**
+ * @class BlockGroupLayout
+ *
+ * @brief Precomputed layout of the view range window on one map. Block numbers are column major
+ * (x * heightInBlocks + y), so while the whole window lies inside the map the blocks of a group are the central block
+ * plus a fixed offset per cell. Only windows that cross an edge are wrapped, one column and one row at a time,
+ * the same way the server wraps them.
+ */
+class BlockGroupLayout
+{
+  public:
+    BlockGroupLayout();
+
+    void reset(MapDefinition definition, int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY);
+    void clear();
+    bool isLayoutFor(uint8_t mapNumber) const;
+    void getBlockNumbers(uint32_t blockNumber, std::vector<int32_t>& rBlocksOut) const;
+
+  private:
+    static void getWrappedIndices(int32_t center, int32_t minOffset, int32_t maxOffset, int32_t limit, std::vector<int32_t>& rIndicesOut);
+
+    bool m_valid;                   //!< Indicates if the layout has been computed for a map
+    uint8_t m_mapNumber;            //!< Map the layout was computed for
+    int32_t m_widthInBlocks;        //!< Map width in blocks
+    int32_t m_heightInBlocks;       //!< Map height in blocks
+    int32_t m_wrapWidthInBlocks;    //!< Horizontal wrapping coordinate in blocks
+    int32_t m_wrapHeightInBlocks;   //!< Vertical wrapping coordinate in blocks
+    int32_t m_minBlockX;            //!< min block x of the view range
+    int32_t m_maxBlockX;            //!< max block x of the view range
+    int32_t m_minBlockY;            //!< min block y of the view range
+    int32_t m_maxBlockY;            //!< max block y of the view range
+    std::vector<int32_t> m_offsets; //!< Block number offset of every cell from the central block, in query order
+};
+
+#endif
@@ -0,0 +1,834 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "BlockHashCache.h"
+#include "..\FileSystem\BaseFileManager.h"
+#include "..\Hashing\Crc32.h"
+#include "..\Hashing\Crc32c.h"
+#include "..\Hashing\Xxh64.h"
+#include "..\Hashing\Fletcher16.h"
+#include "..\Hashing\Fletcher16Crc32.h"
+#include "..\Debug.h"
+
+const uint32_t BlockHashCache::DEFAULT_MEMORY_LIMIT_MEGABYTES;
+
+/**
+ * @brief BlockHashCache constructor
+ */
+BlockHashCache::BlockHashCache()
+  : m_maps(),
+  m_pLoadedMap(NULL),
+  m_loadedMapNumber(0),
+  m_pDestinationMap(NULL),
+  m_destinationMapNumber(0),
+  m_selectionCounter(0),
+  m_memoryLimit(DEFAULT_MEMORY_LIMIT_MEGABYTES * 1024 * 1024)
+{
+  InitializeCriticalSection(&m_cacheLock);
+  InitializeSRWLock(&m_dataLock);
+}
+
+/**
+ * @brief BlockHashCache destructor
+ */
+BlockHashCache::~BlockHashCache()
+{
+  DeleteCriticalSection(&m_cacheLock);
+}
+
+/**
+ * @brief Waits for in-flight hashing to finish and blocks new hashing until endDataUpdate() is called. Must wrap
+ * every change to the map data that the cache was built from.
+ */
+void BlockHashCache::beginDataUpdate()
+{
+  AcquireSRWLockExclusive(&m_dataLock);
+}
+
+/**
+ * @brief Allows hashing again after beginDataUpdate()
+ */
+void BlockHashCache::endDataUpdate()
+{
+  ReleaseSRWLockExclusive(&m_dataLock);
+}
+
+/**
+ * @brief Sets how much memory the resident maps may use, dropping the least recently loaded maps that no longer fit
+ *
+ * @param memoryLimit Limit in bytes
+ */
+void BlockHashCache::setMemoryLimit(size_t memoryLimit)
+{
+  EnterCriticalSection(&m_cacheLock);
+  m_memoryLimit = memoryLimit;
+  trimToMemoryLimit();
+  LeaveCriticalSection(&m_cacheLock);
+}
+
+/**
+ * @brief Makes the hashes of a map the loaded ones. The hashes of a resident map are kept if its size did not
+ * change, otherwise the map starts out empty with its finished hashes freed until their width is asked for. Clears
+ * the destination map. Must be called between beginDataUpdate() and endDataUpdate().
+ *
+ * @param mapNumber Map Number
+ * @param numberOfBlocks Number of blocks in the map
+ *
+ * @return true if the hashes of the map were kept from an earlier visit
+ */
+bool BlockHashCache::selectMap(uint8_t mapNumber, uint32_t numberOfBlocks)
+{
+  bool kept = false;
+
+  EnterCriticalSection(&m_cacheLock);
+
+  m_pLoadedMap = &findOrResetMap(mapNumber, numberOfBlocks, kept);
+  m_loadedMapNumber = mapNumber;
+  m_pDestinationMap = NULL;
+  m_pLoadedMap->lastSelected = ++m_selectionCounter;
+  trimToMemoryLimit();
+
+  LeaveCriticalSection(&m_cacheLock);
+
+  Logger::g_pLogger->LogPrint("Block hash cache: map %i %s, %u maps resident\n", mapNumber, kept ? "kept" : "new", (uint32_t)m_maps.size());
+
+  return kept;
+}
+
+/**
+ * @brief Selects a map that is not loaded as the destination map, so its blocks can be hashed from its files ahead
+ * of a map change. The hashes of a resident map are kept if its size did not change. Must be called between
+ * beginDataUpdate() and endDataUpdate(), and before the reader of the destination map is used.
+ *
+ * @param mapNumber Map Number
+ * @param numberOfBlocks Number of blocks in the map
+ * @param hasBlockHashStamps true if the hash stamps in the files of the map can be trusted
+ */
+void BlockHashCache::selectDestinationMap(uint8_t mapNumber, uint32_t numberOfBlocks, bool hasBlockHashStamps)
+{
+  bool kept = false;
+
+  EnterCriticalSection(&m_cacheLock);
+
+  m_pDestinationMap = &findOrResetMap(mapNumber, numberOfBlocks, kept);
+  m_destinationMapNumber = mapNumber;
+  m_pDestinationMap->lastSelected = ++m_selectionCounter;
+
+  if (!kept)
+  {
+    m_pDestinationMap->seedCrc32FromStamps = hasBlockHashStamps;
+  }
+
+  trimToMemoryLimit();
+
+  LeaveCriticalSection(&m_cacheLock);
+
+  Logger::g_pLogger->LogPrint("Block hash cache: destination map %i %s\n", mapNumber, kept ? "kept" : "new");
+}
+
+/**
+ * @brief Gets the hashes of a resident map, clearing them if the map is new or its size changed. Must be called with
+ * the cache lock held.
+ *
+ * @param mapNumber Map Number
+ * @param numberOfBlocks Number of blocks in the map
+ * @param rKept Set to true if the hashes of the map were kept
+ *
+ * @return Hashes of the map
+ */
+BlockHashCache::MapHashes& BlockHashCache::findOrResetMap(uint8_t mapNumber, uint32_t numberOfBlocks, bool& rKept)
+{
+  std::map<uint8_t, MapHashes>::iterator itr = m_maps.find(mapNumber);
+
+  if (itr != m_maps.end() && itr->second.parts.size() == numberOfBlocks)
+  {
+    rKept = true;
+    return itr->second;
+  }
+
+  MapHashes& rMap = m_maps[mapNumber];
+  rMap.fletcher16Cache.release();
+  rMap.crc32Cache.release();
+  rMap.crc32cCache.release();
+  rMap.xxh64Cache.release();
+  rMap.seedCrc32FromStamps = false;
+  rMap.parts.reset(numberOfBlocks);
+
+  rKept = false;
+  return rMap;
+}
+
+/**
+ * @brief Finds the hashes a block is looked up in, those of the loaded map or of the destination map. Must be called
+ * with the cache lock held.
+ *
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ *
+ * @return Hashes of the map, NULL if the map is neither loaded nor the destination or the block does not exist
+ */
+BlockHashCache::MapHashes* BlockHashCache::findMap(uint8_t mapNumber, uint32_t blockNumber)
+{
+  MapHashes* pMap = NULL;
+
+  if (m_pLoadedMap != NULL && mapNumber == m_loadedMapNumber)
+  {
+    pMap = m_pLoadedMap;
+  }
+  else if (m_pDestinationMap != NULL && mapNumber == m_destinationMapNumber)
+  {
+    pMap = m_pDestinationMap;
+  }
+
+  if (pMap != NULL && blockNumber >= pMap->parts.size())
+  {
+    pMap = NULL;
+  }
+
+  return pMap;
+}
+
+/**
+ * @brief Marks the land part of a block as changed, keeping the statics part
+ *
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ */
+void BlockHashCache::invalidateLand(uint8_t mapNumber, uint32_t blockNumber)
+{
+  invalidate(mapNumber, blockNumber, LAND_PARTS_VALID);
+}
+
+/**
+ * @brief Marks the statics part of a block as changed, keeping the land part
+ *
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ */
+void BlockHashCache::invalidateStatics(uint8_t mapNumber, uint32_t blockNumber)
+{
+  invalidate(mapNumber, blockNumber, STATICS_PARTS_VALID);
+}
+
+/**
+ * @brief Drops the finished hashes and the given parts of a block in a resident map
+ *
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ * @param partFlags Parts that changed
+ */
+void BlockHashCache::invalidate(uint8_t mapNumber, uint32_t blockNumber, uint8_t partFlags)
+{
+  EnterCriticalSection(&m_cacheLock);
+
+  std::map<uint8_t, MapHashes>::iterator itr = m_maps.find(mapNumber);
+
+  if (itr != m_maps.end() && blockNumber < itr->second.parts.size())
+  {
+    MapHashes& rMap = itr->second;
+    PartsPage* pPartsPage = rMap.parts.findPage(blockNumber);
+
+    if (pPartsPage != NULL)
+    {
+      pPartsPage->parts[BlockPageTable<PartsPage>::getIndexInPage(blockNumber)].flags &= ~partFlags;
+    }
+
+    rMap.fletcher16Cache.invalidate(blockNumber);
+    rMap.crc32Cache.invalidate(blockNumber);
+    rMap.crc32cCache.invalidate(blockNumber);
+    rMap.xxh64Cache.invalidate(blockNumber);
+  }
+
+  LeaveCriticalSection(&m_cacheLock);
+}
+
+/**
+ * @brief Lets the loaded map take its finished CRC32s from the hash stamps stored in the map files. The stamps are
+ * kept up to date whenever a block is written, so each page of the CRC32 cache is filled when it is first used. The
+ * parts stay uncached, so a block that changes later is rehashed in full.
+ */
+void BlockHashCache::enableCrc32Seeding()
+{
+  EnterCriticalSection(&m_cacheLock);
+
+  if (m_pLoadedMap != NULL)
+  {
+    m_pLoadedMap->seedCrc32FromStamps = true;
+  }
+
+  LeaveCriticalSection(&m_cacheLock);
+}
+
+/**
+ * @brief Gets the Fletcher-16 of a block, hashing only the parts that are not cached
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ *
+ * @return Fletcher-16 of the land and statics data, 0 if the block does not exist
+ */
+uint16_t BlockHashCache::getFletcher16(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+{
+  uint16_t fletcher16 = 0;
+  getHashes(pReader, mapNumber, blockNumber, &fletcher16, NULL, NULL);
+
+  return fletcher16;
+}
+
+/**
+ * @brief Gets the CRC32 of a block, hashing only the parts that are not cached
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ *
+ * @return CRC32 of the land and statics data, 0 if the block does not exist
+ */
+uint32_t BlockHashCache::getCrc32(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+{
+  uint32_t crc32 = 0;
+  getHashes(pReader, mapNumber, blockNumber, NULL, &crc32, NULL);
+
+  return crc32;
+}
+
+/**
+ * @brief Gets the CRC32 of the land data and the CRC32 of the statics data of a block, from the cached parts
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ *
+ * @return Land CRC32 in the high 32 bits and statics CRC32 in the low 32 bits, 0 if the block does not exist
+ */
+uint64_t BlockHashCache::getSplitCrc32(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+{
+  BlockHashParts parts;
+  parts.flags = 0;
+  getHashes(pReader, mapNumber, blockNumber, NULL, NULL, &parts);
+
+  if ((parts.flags & LAND_PARTS_VALID) == 0)
+  {
+    return 0;
+  }
+
+  return ((uint64_t)parts.landCrc32 << 32) | parts.staticsCrc32;
+}
+
+/**
+ * @brief Gets the Fletcher-16 and/or the CRC32 of a block. A miss hashes the missing land and statics parts for both
+ * widths in a single pass over the data and fills the finished hashes of every allocated width, so mixed hash
+ * queries (0xFF) and hash query32s (0xFD) read each block once. The finished hashes of a requested width are
+ * allocated on first use.
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ * @param pFletcher16Out Receives the Fletcher-16, 0 if the block does not exist. NULL if it is not wanted.
+ * @param pCrc32Out Receives the CRC32, 0 if the block does not exist. NULL if it is not wanted.
+ * @param pPartsOut Receives the land and statics parts, untouched if the block does not exist. NULL if they are not
+ * wanted.
+ */
+void BlockHashCache::getHashes(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber, uint16_t* pFletcher16Out, uint32_t* pCrc32Out, BlockHashParts* pPartsOut)
+{
+  AcquireSRWLockShared(&m_dataLock);
+  EnterCriticalSection(&m_cacheLock);
+
+  MapHashes* pMap = findMap(mapNumber, blockNumber);
+
+  if (pMap == NULL)
+  {
+    LeaveCriticalSection(&m_cacheLock);
+    ReleaseSRWLockShared(&m_dataLock);
+    return;
+  }
+
+  //the loaded and destination maps cannot change or be dropped while the shared data lock is held
+  MapHashes& rMap = *pMap;
+
+  if (pFletcher16Out != NULL && !rMap.fletcher16Cache.isAllocated())
+  {
+    rMap.fletcher16Cache.allocate(rMap.parts.size());
+  }
+
+  if (pCrc32Out != NULL && !rMap.crc32Cache.isAllocated())
+  {
+    rMap.crc32Cache.allocate(rMap.parts.size());
+  }
+
+  if (rMap.seedCrc32FromStamps && rMap.crc32Cache.isAllocated() && !rMap.crc32Cache.isPageAllocated(blockNumber))
+  {
+    seedCrc32Page(rMap, pReader, blockNumber);
+  }
+
+  uint16_t fletcher16 = 0;
+  uint32_t crc32 = 0;
+  bool fletcher16Valid = (pFletcher16Out != NULL) ? rMap.fletcher16Cache.lookup(blockNumber, fletcher16) : rMap.fletcher16Cache.isValid(blockNumber);
+  bool crc32Valid = (pCrc32Out != NULL) ? rMap.crc32Cache.lookup(blockNumber, crc32) : rMap.crc32Cache.isValid(blockNumber);
+  const PartsPage* pPartsPage = rMap.parts.findPage(blockNumber);
+  uint32_t partsIndex = BlockPageTable<PartsPage>::getIndexInPage(blockNumber);
+  BlockHashParts parts;
+
+  if (pPartsPage != NULL)
+  {
+    parts = pPartsPage->parts[partsIndex];
+  }
+  else
+  {
+    memset(&parts, 0, sizeof(parts));
+  }
+
+  bool missed = (pFletcher16Out != NULL && !fletcher16Valid) || (pCrc32Out != NULL && !crc32Valid);
+
+  if (pFletcher16Out == NULL && pCrc32Out == NULL)
+  {
+    //precomputing or asked for the parts, fill in the parts and every allocated width
+    missed = (parts.flags & (LAND_PARTS_VALID | STATICS_PARTS_VALID)) != (LAND_PARTS_VALID | STATICS_PARTS_VALID) ||
+      (rMap.fletcher16Cache.isAllocated() && !fletcher16Valid) || (rMap.crc32Cache.isAllocated() && !crc32Valid);
+  }
+  LeaveCriticalSection(&m_cacheLock);
+
+  if (missed)
+  {
+    //the data cannot change while the shared data lock is held, so the parts are hashed outside the cache lock
+    bool landFound = hashMissingParts(pReader, mapNumber, blockNumber, parts);
+
+    if (landFound)
+    {
+      uint32_t sum1 = parts.landSum1;
+      uint32_t sum2 = parts.landSum2;
+      Fletcher16::combine(sum1, sum2, parts.staticsSum1, parts.staticsSum2, parts.staticsLengthMod255);
+      fletcher16 = Fletcher16::finalize(sum1, sum2);
+      crc32 = Crc32::combine(parts.landCrc32, parts.staticsCrc32, parts.staticsCrc32Operator);
+    }
+
+    EnterCriticalSection(&m_cacheLock);
+    BlockHashParts& rParts = rMap.parts.getPage(blockNumber).parts[partsIndex];
+
+    if (parts.flags & LAND_PARTS_VALID)
+    {
+      rParts.landSum1 = parts.landSum1;
+      rParts.landSum2 = parts.landSum2;
+      rParts.landCrc32 = parts.landCrc32;
+    }
+
+    rParts.staticsSum1 = parts.staticsSum1;
+    rParts.staticsSum2 = parts.staticsSum2;
+    rParts.staticsLengthMod255 = parts.staticsLengthMod255;
+    rParts.staticsCrc32 = parts.staticsCrc32;
+    rParts.staticsCrc32Operator = parts.staticsCrc32Operator;
+    rParts.flags |= parts.flags;
+
+    if (landFound)
+    {
+      if (!fletcher16Valid)
+      {
+        rMap.fletcher16Cache.store(blockNumber, fletcher16);
+      }
+
+      if (!crc32Valid)
+      {
+        rMap.crc32Cache.store(blockNumber, crc32);
+      }
+    }
+
+    trimToMemoryLimit();
+    LeaveCriticalSection(&m_cacheLock);
+
+    if (!landFound)
+    {
+      fletcher16 = 0;
+      crc32 = 0;
+    }
+  }
+
+  if (pFletcher16Out != NULL)
+  {
+    *pFletcher16Out = fletcher16;
+  }
+
+  if (pCrc32Out != NULL)
+  {
+    *pCrc32Out = crc32;
+  }
+
+  if (pPartsOut != NULL)
+  {
+    *pPartsOut = parts;
+  }
+
+  ReleaseSRWLockShared(&m_dataLock);
+}
+
+/**
+ * @brief Hashes the land and statics parts of a block that are not cached in both widths, reading the data of each
+ * part once. Must be called with the shared data lock held.
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ * @param rParts Cached parts of the block, the missing ones are filled in
+ *
+ * @return false if the block has no land data
+ */
+bool BlockHashCache::hashMissingParts(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber, BlockHashParts& rParts)
+{
+  bool landFound = true;
+
+  if ((rParts.flags & LAND_PARTS_VALID) == 0)
+  {
+    const uint8_t* pLandData = pReader->viewLandBlock(mapNumber, blockNumber);
+
+    if (pLandData != NULL)
+    {
+      uint32_t sum1 = 0;
+      uint32_t sum2 = 0;
+      uint32_t crc32State = Crc32::INITIAL_STATE;
+      Fletcher16Crc32::update(sum1, sum2, crc32State, pLandData, 192);
+
+      rParts.landSum1 = (uint8_t)sum1;
+      rParts.landSum2 = (uint8_t)sum2;
+      rParts.landCrc32 = ~crc32State;
+      rParts.flags |= LAND_PARTS_VALID;
+    }
+    else
+    {
+      landFound = false;
+    }
+  }
+
+  if ((rParts.flags & STATICS_PARTS_VALID) == 0)
+  {
+    uint32_t staticsLength = 0;
+    const uint8_t* pStaticsData = pReader->viewStaticsBlock(mapNumber, blockNumber, staticsLength);
+
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+    uint32_t crc32State = Crc32::INITIAL_STATE;
+
+    if (pStaticsData != NULL)
+    {
+      Fletcher16Crc32::update(sum1, sum2, crc32State, pStaticsData, staticsLength);
+    }
+
+    rParts.staticsSum1 = (uint8_t)sum1;
+    rParts.staticsSum2 = (uint8_t)sum2;
+    rParts.staticsLengthMod255 = (uint8_t)(staticsLength % 255);
+    rParts.staticsCrc32 = ~crc32State;
+    rParts.staticsCrc32Operator = Crc32::getCombineOperator(staticsLength);
+    rParts.flags |= STATICS_PARTS_VALID;
+  }
+
+  return landFound;
+}
+
+/**
+ * @brief Fills the finished CRC32s of the page holding a block from the map file hash stamps. Must be called with
+ * the cache lock held, before anything else is stored in that page.
+ *
+ * @param rMap Hashes of the map
+ * @param pReader Reader of the map
+ * @param blockNumber Block Number
+ */
+void BlockHashCache::seedCrc32Page(MapHashes& rMap, MapBlockReader* pReader, uint32_t blockNumber)
+{
+  uint32_t firstBlock = blockNumber & ~(BlockPage::SIZE - 1);
+  uint32_t endBlock = min(firstBlock + BlockPage::SIZE, rMap.parts.size());
+
+  for (uint32_t seedBlock = firstBlock; seedBlock < endBlock; seedBlock++)
+  {
+    uint32_t stamp = pReader->getBlockHashStamp(seedBlock);
+
+    if (stamp != BaseFileManager::INVALID_BLOCK_HASH_STAMP)
+    {
+      rMap.crc32Cache.store(seedBlock, stamp);
+    }
+  }
+}
+
+/**
+ * @brief Gets the CRC-32C of a block, hashing the land and statics data if it is not cached
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ *
+ * @return CRC-32C of the land and statics data, 0 if the block does not exist
+ */
+uint32_t BlockHashCache::getCrc32c(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+{
+  uint32_t hash = 0;
+
+  AcquireSRWLockShared(&m_dataLock);
+  EnterCriticalSection(&m_cacheLock);
+
+  MapHashes* pMap = findMap(mapNumber, blockNumber);
+
+  if (pMap != NULL)
+  {
+    MapHashes& rMap = *pMap;
+
+    if (!rMap.crc32cCache.isAllocated())
+    {
+      rMap.crc32cCache.allocate(rMap.parts.size());
+    }
+
+    bool valid = rMap.crc32cCache.lookup(blockNumber, hash);
+    LeaveCriticalSection(&m_cacheLock);
+
+    if (!valid)
+    {
+      //the data cannot change while the shared data lock is held, so the block is hashed outside the cache lock
+      hash = 0;
+      const uint8_t* pLandData = pReader->viewLandBlock(mapNumber, blockNumber);
+
+      if (pLandData != NULL)
+      {
+        uint32_t staticsLength = 0;
+        const uint8_t* pStaticsData = pReader->viewStaticsBlock(mapNumber, blockNumber, staticsLength);
+
+        uint32_t state = Crc32c::update(Crc32c::INITIAL_STATE, pLandData, 192);
+        if (pStaticsData != NULL)
+        {
+          state = Crc32c::update(state, pStaticsData, staticsLength);
+        }
+
+        hash = ~state;
+
+        EnterCriticalSection(&m_cacheLock);
+        rMap.crc32cCache.store(blockNumber, hash);
+        trimToMemoryLimit();
+        LeaveCriticalSection(&m_cacheLock);
+      }
+    }
+  }
+  else
+  {
+    LeaveCriticalSection(&m_cacheLock);
+  }
+
+  ReleaseSRWLockShared(&m_dataLock);
+
+  return hash;
+}
+
+/**
+ * @brief Gets the XXH64 of a block, hashing the land and statics data if it is not cached
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ *
+ * @return XXH64 of the land and statics data, 0 if the block does not exist
+ */
+uint64_t BlockHashCache::getXxh64(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+{
+  uint64_t hash = 0;
+
+  AcquireSRWLockShared(&m_dataLock);
+  EnterCriticalSection(&m_cacheLock);
+
+  MapHashes* pMap = findMap(mapNumber, blockNumber);
+
+  if (pMap != NULL)
+  {
+    MapHashes& rMap = *pMap;
+
+    if (!rMap.xxh64Cache.isAllocated())
+    {
+      rMap.xxh64Cache.allocate(rMap.parts.size());
+    }
+
+    bool valid = rMap.xxh64Cache.lookup(blockNumber, hash);
+    LeaveCriticalSection(&m_cacheLock);
+
+    if (!valid)
+    {
+      //the data cannot change while the shared data lock is held, so the block is hashed outside the cache lock
+      hash = 0;
+      const uint8_t* pLandData = pReader->viewLandBlock(mapNumber, blockNumber);
+
+      if (pLandData != NULL)
+      {
+        uint32_t staticsLength = 0;
+        const uint8_t* pStaticsData = pReader->viewStaticsBlock(mapNumber, blockNumber, staticsLength);
+
+        Xxh64 state;
+        state.update(pLandData, 192);
+        if (pStaticsData != NULL)
+        {
+          state.update(pStaticsData, staticsLength);
+        }
+
+        hash = state.digest();
+
+        EnterCriticalSection(&m_cacheLock);
+        rMap.xxh64Cache.store(blockNumber, hash);
+        trimToMemoryLimit();
+        LeaveCriticalSection(&m_cacheLock);
+      }
+    }
+  }
+  else
+  {
+    LeaveCriticalSection(&m_cacheLock);
+  }
+
+  ReleaseSRWLockShared(&m_dataLock);
+
+  return hash;
+}
+
+/**
+ * @brief Hashes the land and statics parts of a block ahead of the first query and fills the finished hashes of
+ * the widths that are in use
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param blockNumber Block Number
+ * @param pCrc32Out Receives the CRC32 of the block, untouched if the block does not exist. NULL if it is not wanted.
+ *
+ * @return false if the block does not exist
+ */
+bool BlockHashCache::precompute(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber, uint32_t* pCrc32Out)
+{
+  BlockHashParts parts;
+  memset(&parts, 0, sizeof(parts));
+  getHashes(pReader, mapNumber, blockNumber, NULL, NULL, &parts);
+
+  if ((parts.flags & (LAND_PARTS_VALID | STATICS_PARTS_VALID)) != (LAND_PARTS_VALID | STATICS_PARTS_VALID))
+  {
+    return false;
+  }
+
+  if (pCrc32Out != NULL)
+  {
+    *pCrc32Out = Crc32::combine(parts.landCrc32, parts.staticsCrc32, parts.staticsCrc32Operator);
+  }
+
+  return true;
+}
+
+/**
+ * @brief Logs the lookup counters of every hash width that is in use on the loaded map and the memory used by the
+ * resident maps
+ */
+void BlockHashCache::logStatistics()
+{
+  const char* widthNames[] = { "Fletcher-16", "CRC32", "CRC-32C", "XXH64" };
+  bool allocated[4];
+  HashCacheStatistics statistics[4];
+  size_t memoryUsage = 0;
+
+  EnterCriticalSection(&m_cacheLock);
+
+  if (m_pLoadedMap == NULL)
+  {
+    LeaveCriticalSection(&m_cacheLock);
+    return;
+  }
+
+  for (std::map<uint8_t, MapHashes>::iterator itr = m_maps.begin(); itr != m_maps.end(); itr++)
+  {
+    memoryUsage += getMemoryUsage(itr->second);
+  }
+
+  const MapHashes& rMap = *m_pLoadedMap;
+  uint8_t mapNumber = m_loadedMapNumber;
+  uint32_t numberOfMaps = static_cast<uint32_t>(m_maps.size());
+  allocated[0] = rMap.fletcher16Cache.isAllocated();
+  allocated[1] = rMap.crc32Cache.isAllocated();
+  allocated[2] = rMap.crc32cCache.isAllocated();
+  allocated[3] = rMap.xxh64Cache.isAllocated();
+  statistics[0] = rMap.fletcher16Cache.getStatistics();
+  statistics[1] = rMap.crc32Cache.getStatistics();
+  statistics[2] = rMap.crc32cCache.getStatistics();
+  statistics[3] = rMap.xxh64Cache.getStatistics();
+  LeaveCriticalSection(&m_cacheLock);
+
+  for (int i = 0; i < 4; i++)
+  {
+    if (allocated[i])
+    {
+      Logger::g_pLogger->LogPrint("Block hash cache: map %i %s %u hits, %u misses, %u rehashes\n", mapNumber, widthNames[i],
+        statistics[i].hits, statistics[i].misses, statistics[i].rehashes);
+    }
+  }
+
+  Logger::g_pLogger->LogPrint("Block hash cache: %u maps resident, %u of %u KB\n", numberOfMaps, (uint32_t)(memoryUsage / 1024),
+    (uint32_t)(m_memoryLimit / 1024));
+}
+
+/**
+ * @brief Drops the least recently loaded maps until the resident maps fit in the memory limit. The loaded and
+ * destination maps are never dropped, even if they do not fit on their own. Must be called with the cache lock held.
+ */
+void BlockHashCache::trimToMemoryLimit()
+{
+  size_t memoryUsage = 0;
+
+  for (std::map<uint8_t, MapHashes>::iterator itr = m_maps.begin(); itr != m_maps.end(); itr++)
+  {
+    memoryUsage += getMemoryUsage(itr->second);
+  }
+
+  while (memoryUsage > m_memoryLimit)
+  {
+    std::map<uint8_t, MapHashes>::iterator oldest = m_maps.end();
+
+    for (std::map<uint8_t, MapHashes>::iterator itr = m_maps.begin(); itr != m_maps.end(); itr++)
+    {
+      if (&itr->second != m_pLoadedMap && &itr->second != m_pDestinationMap && (oldest == m_maps.end() || itr->second.lastSelected < oldest->second.lastSelected))
+      {
+        oldest = itr;
+      }
+    }
+
+    if (oldest == m_maps.end())
+    {
+      break;
+    }
+
+    size_t mapMemoryUsage = getMemoryUsage(oldest->second);
+    Logger::g_pLogger->LogPrint("Block hash cache: dropping map %i, %u KB\n", oldest->first, (uint32_t)(mapMemoryUsage / 1024));
+    memoryUsage -= mapMemoryUsage;
+    m_maps.erase(oldest);
+  }
+}
+
+/**
+ * @brief Gets the memory held by the hashes of a map
+ *
+ * @param rMap Hashes of the map
+ *
+ * @return Size in bytes
+ */
+size_t BlockHashCache::getMemoryUsage(const MapHashes& rMap)
+{
+  return rMap.parts.getMemoryUsage() + rMap.fletcher16Cache.getMemoryUsage() + rMap.crc32Cache.getMemoryUsage() +
+    rMap.crc32cCache.getMemoryUsage() + rMap.xxh64Cache.getMemoryUsage();
+}
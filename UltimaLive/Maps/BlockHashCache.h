@@ -0,0 +1,160 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_HASH_CACHE_H
+#define _BLOCK_HASH_CACHE_H
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+#include <Windows.h>
+
+#include "BlockCrc32Source.h"
+#include "BlockPageTable.h"
+#include "FinishedHashCache.h"
+
+class MapBlockReader;
+
+/**
+ * @class BlockHashCache
+ *
+ * @brief Caches block hashes for the loaded map. Besides the finished hash of each block, the Fletcher-16 and CRC32
+ * of the land and statics parts are cached separately and recombined when one side changes, so a land update only
+ * rehashes 192 bytes and a statics update only rehashes the statics. Both widths of a part are hashed together
+ * whenever either one misses, so a block is only read once no matter which hash is asked for first. The land and
+ * statics CRC32s are also handed out on their own, so the server can tell which half of a block is stale.
+ *
+ * The finished hashes of a width are only allocated once that width is asked for, so a server that only sends hash
+ * query32s never pays for Fletcher-16, CRC-32C or XXH64 caches. Lookup counters per width are kept for logging.
+ * Parts and finished hashes are kept in pages that are allocated the first time one of their blocks is hashed, so a
+ * large custom map only costs memory for the areas the player has been to.
+ *
+ * The hashes of a map stay resident after another map is loaded, so moving back and forth between maps does not
+ * rehash them. Updates to a resident map that is not loaded are applied to its hashes as well. When the resident
+ * maps use more memory than the limit, the maps loaded least recently are dropped, never the loaded one.
+ *
+ * One map that is not loaded can be selected as the destination map, so hash queries about it are answered from its
+ * files before the player arrives. Its hashes are kept when it is loaded later, and it is not dropped while selected.
+ *
+ * Lookups may come from several threads at once. Hashing reads the map pools under a shared data lock, while
+ * anything that changes the pools (block updates, map loads) must happen between beginDataUpdate() and
+ * endDataUpdate(), which take the data lock exclusively.
+ */
+class BlockHashCache : public BlockCrc32Source
+{
+  public:
+    static const uint32_t DEFAULT_MEMORY_LIMIT_MEGABYTES = 48; //!< Memory the resident maps may use unless setMemoryLimit() is called
+
+    BlockHashCache();
+    ~BlockHashCache();
+
+    void beginDataUpdate();
+    void endDataUpdate();
+
+    void setMemoryLimit(size_t memoryLimit);
+    bool selectMap(uint8_t mapNumber, uint32_t numberOfBlocks);
+    void selectDestinationMap(uint8_t mapNumber, uint32_t numberOfBlocks, bool hasBlockHashStamps);
+    void invalidateLand(uint8_t mapNumber, uint32_t blockNumber);
+    void invalidateStatics(uint8_t mapNumber, uint32_t blockNumber);
+    void enableCrc32Seeding();
+
+    uint16_t getFletcher16(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber);
+    uint32_t getCrc32(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber);
+    uint32_t getCrc32c(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber);
+    uint64_t getXxh64(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber);
+    uint64_t getSplitCrc32(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber);
+    bool precompute(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber, uint32_t* pCrc32Out);
+
+    void logStatistics();
+
+  private:
+    /**
+     * @struct BlockHashParts
+     *
+     * @brief Separately hashed land and statics parts of a block
+     */
+    struct BlockHashParts
+    {
+      uint32_t landCrc32;               //!< CRC32 of the land data
+      uint32_t staticsCrc32;            //!< CRC32 of the statics data
+      uint32_t staticsCrc32Operator;    //!< Operator that shifts the land CRC32 past the statics data
+      uint8_t landSum1;                 //!< Fletcher sum1 of the land data
+      uint8_t landSum2;                 //!< Fletcher sum2 of the land data
+      uint8_t staticsSum1;              //!< Fletcher sum1 of the statics data
+      uint8_t staticsSum2;              //!< Fletcher sum2 of the statics data
+      uint8_t staticsLengthMod255;      //!< Length of the statics data modulo 255
+      uint8_t flags;                    //!< Valid part flags
+    };
+
+    /**
+     * @struct PartsPage
+     *
+     * @brief Land and statics parts of BlockPage::SIZE blocks
+     */
+    struct PartsPage
+    {
+      BlockHashParts parts[BlockPage::SIZE]; //!< Land and statics parts per block
+    };
+
+    /**
+     * @struct MapHashes
+     *
+     * @brief Cached hashes of one resident map
+     */
+    struct MapHashes
+    {
+      FinishedHashCache<uint16_t> fletcher16Cache; //!< Finished Fletcher-16 per block
+      FinishedHashCache<uint32_t> crc32Cache;      //!< Finished CRC32 per block
+      FinishedHashCache<uint32_t> crc32cCache;     //!< Finished CRC-32C per block
+      FinishedHashCache<uint64_t> xxh64Cache;      //!< Finished XXH64 per block
+      BlockPageTable<PartsPage> parts;             //!< Land and statics parts per block
+      bool seedCrc32FromStamps;                    //!< Seed each page of the CRC32 cache from the map file hash stamps when it is first used
+      uint32_t lastSelected;                       //!< Value of the selection counter when the map was last loaded
+    };
+
+    static const uint8_t LAND_PARTS_VALID = 0x01;    //!< landSum1, landSum2 and landCrc32 are valid
+    static const uint8_t STATICS_PARTS_VALID = 0x02; //!< staticsSum1, staticsSum2, staticsLengthMod255, staticsCrc32 and staticsCrc32Operator are valid
+
+    void getHashes(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber, uint16_t* pFletcher16Out, uint32_t* pCrc32Out, BlockHashParts* pPartsOut);
+    bool hashMissingParts(MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber, BlockHashParts& rParts);
+    MapHashes& findOrResetMap(uint8_t mapNumber, uint32_t numberOfBlocks, bool& rKept);
+    MapHashes* findMap(uint8_t mapNumber, uint32_t blockNumber);
+    void seedCrc32Page(MapHashes& rMap, MapBlockReader* pReader, uint32_t blockNumber);
+    void invalidate(uint8_t mapNumber, uint32_t blockNumber, uint8_t partFlags);
+    void trimToMemoryLimit();
+    static size_t getMemoryUsage(const MapHashes& rMap);
+
+    std::map<uint8_t, MapHashes> m_maps; //!< Resident maps by map number
+    MapHashes* m_pLoadedMap;             //!< Hashes of the loaded map, NULL until a map is selected
+    uint8_t m_loadedMapNumber;           //!< Map number of the loaded map
+    MapHashes* m_pDestinationMap;        //!< Hashes of the destination map, NULL if none is selected
+    uint8_t m_destinationMapNumber;      //!< Map number of the destination map
+    uint32_t m_selectionCounter;         //!< Counts map selections, orders the resident maps by last use
+    size_t m_memoryLimit;                //!< Memory the resident maps may use before the least recently loaded are dropped
+
+    CRITICAL_SECTION m_cacheLock; //!< Guards the caches
+    SRWLOCK m_dataLock;           //!< Shared while hashing map data, exclusive while the map data changes
+};
+
+#endif
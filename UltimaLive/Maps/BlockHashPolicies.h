@@ -0,0 +1,170 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_HASH_POLICIES_H
+#define _BLOCK_HASH_POLICIES_H
+
+#include <stdint.h>
+
+#include "BlockHashCache.h"
+
+class MapBlockReader;
+
+/**
+ * @class Fletcher16HashPolicy
+ *
+ * @brief Block hash used by hash queries (0xFF)
+ */
+class Fletcher16HashPolicy
+{
+  public:
+    typedef uint16_t HashType; //!< Type of a block hash
+    static const uint8_t HASH_MODE = 0x00; //!< Hash mode number in the hash capabilities handshake
+
+    /**
+     * @brief Looks up the cached Fletcher16 of a block
+     *
+     * @param rCache Block hash cache of the loaded map
+     * @param pReader Reader the block is read from
+     * @param mapNumber Map Number
+     * @param blockNumber Block Number
+     *
+     * @return Fletcher16 of the block
+     */
+    static HashType getHash(BlockHashCache& rCache, MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+    {
+      return rCache.getFletcher16(pReader, mapNumber, blockNumber);
+    }
+};
+
+/**
+ * @class Crc32HashPolicy
+ *
+ * @brief Block hash used by hash query32s (0xFD)
+ */
+class Crc32HashPolicy
+{
+  public:
+    typedef uint32_t HashType; //!< Type of a block hash
+    static const uint8_t HASH_MODE = 0x01; //!< Hash mode number in the hash capabilities handshake
+
+    /**
+     * @brief Looks up the cached CRC32 of a block
+     *
+     * @param rCache Block hash cache of the loaded map
+     * @param pReader Reader the block is read from
+     * @param mapNumber Map Number
+     * @param blockNumber Block Number
+     *
+     * @return CRC32 of the block
+     */
+    static HashType getHash(BlockHashCache& rCache, MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+    {
+      return rCache.getCrc32(pReader, mapNumber, blockNumber);
+    }
+};
+
+/**
+ * @class Crc32cHashPolicy
+ *
+ * @brief Block hash offered through the hash capabilities handshake, hardware accelerated on SSE4.2 processors
+ */
+class Crc32cHashPolicy
+{
+  public:
+    typedef uint32_t HashType; //!< Type of a block hash
+    static const uint8_t HASH_MODE = 0x02; //!< Hash mode number in the hash capabilities handshake
+
+    /**
+     * @brief Looks up the cached CRC-32C of a block
+     *
+     * @param rCache Block hash cache of the loaded map
+     * @param pReader Reader the block is read from
+     * @param mapNumber Map Number
+     * @param blockNumber Block Number
+     *
+     * @return CRC-32C of the block
+     */
+    static HashType getHash(BlockHashCache& rCache, MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+    {
+      return rCache.getCrc32c(pReader, mapNumber, blockNumber);
+    }
+};
+
+/**
+ * @class Xxh64HashPolicy
+ *
+ * @brief 64 bit block hash offered through the hash capabilities handshake
+ */
+class Xxh64HashPolicy
+{
+  public:
+    typedef uint64_t HashType; //!< Type of a block hash
+    static const uint8_t HASH_MODE = 0x03; //!< Hash mode number in the hash capabilities handshake
+
+    /**
+     * @brief Looks up the cached XXH64 of a block
+     *
+     * @param rCache Block hash cache of the loaded map
+     * @param pReader Reader the block is read from
+     * @param mapNumber Map Number
+     * @param blockNumber Block Number
+     *
+     * @return XXH64 of the block
+     */
+    static HashType getHash(BlockHashCache& rCache, MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+    {
+      return rCache.getXxh64(pReader, mapNumber, blockNumber);
+    }
+};
+
+/**
+ * @class SplitCrc32HashPolicy
+ *
+ * @brief Separate CRC32s of the land and of the statics of a block, offered through the hash capabilities handshake
+ * so the server can resend only the half of a block that changed
+ */
+class SplitCrc32HashPolicy
+{
+  public:
+    typedef uint64_t HashType; //!< Type of a block hash
+    static const uint8_t HASH_MODE = 0x04; //!< Hash mode number in the hash capabilities handshake
+
+    /**
+     * @brief Looks up the cached land and statics CRC32s of a block
+     *
+     * @param rCache Block hash cache of the loaded map
+     * @param pReader Reader the block is read from
+     * @param mapNumber Map Number
+     * @param blockNumber Block Number
+     *
+     * @return Land CRC32 in the high 32 bits, statics CRC32 in the low 32 bits
+     */
+    static HashType getHash(BlockHashCache& rCache, MapBlockReader* pReader, uint8_t mapNumber, uint32_t blockNumber)
+    {
+      return rCache.getSplitCrc32(pReader, mapNumber, blockNumber);
+    }
+};
+
+#endif
@@ -0,0 +1,285 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "BlockHashPrecomputer.h"
+#include "BlockHashCache.h"
+#include "..\FileSystem\BaseFileManager.h"
+#include "..\Debug.h"
+
+/**
+ * @brief BlockHashPrecomputer constructor
+ *
+ * @param pCache Cache to fill
+ */
+BlockHashPrecomputer::BlockHashPrecomputer(BlockHashCache* pCache)
+  : m_pCache(pCache),
+  m_pFileManager(NULL),
+  m_mapNumber(0),
+  m_widthInBlocks(0),
+  m_heightInBlocks(0),
+  m_centerX(0),
+  m_centerY(0),
+  m_numberOfRings(0),
+  m_threads(),
+  m_cancel(0),
+  m_nextRing(0),
+  m_activeWorkers(0),
+  m_blocksHashed(0),
+  m_totalBlocks(0),
+  m_startTicks(0)
+{
+  //do nothing
+}
+
+/**
+ * @brief BlockHashPrecomputer destructor, stops any running workers
+ */
+BlockHashPrecomputer::~BlockHashPrecomputer()
+{
+  stop();
+}
+
+/**
+ * @brief Starts hashing a map, stopping any previous run first
+ *
+ * @param pFileManager File manager holding the map data
+ * @param mapNumber Map Number
+ * @param widthInBlocks Map width in blocks
+ * @param heightInBlocks Map height in blocks
+ * @param centerBlock Block to work outward from
+ * @param numberOfThreads Number of worker threads
+ */
+void BlockHashPrecomputer::start(BaseFileManager* pFileManager, uint8_t mapNumber, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t centerBlock, uint32_t numberOfThreads)
+{
+  stop();
+
+  if (widthInBlocks == 0 || heightInBlocks == 0 || numberOfThreads == 0)
+  {
+    return;
+  }
+
+  m_pFileManager = pFileManager;
+  m_mapNumber = mapNumber;
+  m_widthInBlocks = (int32_t)widthInBlocks;
+  m_heightInBlocks = (int32_t)heightInBlocks;
+  m_totalBlocks = widthInBlocks * heightInBlocks;
+
+  if (centerBlock >= m_totalBlocks)
+  {
+    centerBlock = ((widthInBlocks / 2) * heightInBlocks) + (heightInBlocks / 2);
+  }
+
+  m_centerX = (int32_t)(centerBlock / heightInBlocks);
+  m_centerY = (int32_t)(centerBlock % heightInBlocks);
+
+  int32_t ringsX = max(m_centerX, m_widthInBlocks - 1 - m_centerX);
+  int32_t ringsY = max(m_centerY, m_heightInBlocks - 1 - m_centerY);
+  m_numberOfRings = max(ringsX, ringsY) + 1;
+
+  m_cancel = 0;
+  m_nextRing = 0;
+  m_blocksHashed = 0;
+  m_activeWorkers = (LONG)numberOfThreads;
+  m_startTicks = GetTickCount();
+
+  Logger::g_pLogger->LogPrint("Hash precompute: map %i, %u blocks, center %i/%i, %u threads\n", mapNumber, m_totalBlocks, m_centerX, m_centerY, numberOfThreads);
+
+  for (uint32_t i = 0; i < numberOfThreads; ++i)
+  {
+    HANDLE hThread = CreateThread(NULL, 0, &BlockHashPrecomputer::workerThreadProc, this, 0, NULL);
+
+    if (hThread != NULL)
+    {
+      SetThreadPriority(hThread, THREAD_PRIORITY_BELOW_NORMAL);
+      m_threads.push_back(hThread);
+    }
+    else
+    {
+      Logger::g_pLogger->LogPrintError("Hash precompute: failed to create worker thread (%i)\n", GetLastError());
+      InterlockedDecrement(&m_activeWorkers);
+    }
+  }
+}
+
+/**
+ * @brief Cancels a run and waits for the workers to exit. Safe to call when nothing is running.
+ */
+void BlockHashPrecomputer::stop()
+{
+  if (!m_threads.empty())
+  {
+    InterlockedExchange(&m_cancel, 1);
+
+    for (std::vector<HANDLE>::iterator itr = m_threads.begin(); itr != m_threads.end(); itr++)
+    {
+      WaitForSingleObject(*itr, INFINITE);
+      CloseHandle(*itr);
+    }
+
+    m_threads.clear();
+
+    if (m_blocksHashed < (LONG)m_totalBlocks)
+    {
+      Logger::g_pLogger->LogPrint("Hash precompute: cancelled after %i of %u blocks\n", m_blocksHashed, m_totalBlocks);
+    }
+  }
+}
+
+/**
+ * @brief Checks if workers are still hashing
+ *
+ * @return true while any worker has work left
+ */
+bool BlockHashPrecomputer::isRunning()
+{
+  return m_activeWorkers > 0 && m_cancel == 0;
+}
+
+/**
+ * @brief Gets the block the current run works outward from
+ *
+ * @return Center block number
+ */
+uint32_t BlockHashPrecomputer::getCenterBlock()
+{
+  return (uint32_t)((m_centerX * m_heightInBlocks) + m_centerY);
+}
+
+/**
+ * @brief Gets the progress counters of the current or last run
+ *
+ * @param rBlocksHashed Number of blocks hashed so far
+ * @param rTotalBlocks Number of blocks in the map
+ */
+void BlockHashPrecomputer::getProgress(uint32_t& rBlocksHashed, uint32_t& rTotalBlocks)
+{
+  rBlocksHashed = (uint32_t)m_blocksHashed;
+  rTotalBlocks = m_totalBlocks;
+}
+
+/**
+ * @brief Worker thread entry point
+ *
+ * @param pParameter Pointer to the owning BlockHashPrecomputer
+ *
+ * @return 0
+ */
+DWORD WINAPI BlockHashPrecomputer::workerThreadProc(LPVOID pParameter)
+{
+  static_cast<BlockHashPrecomputer*>(pParameter)->work();
+  return 0;
+}
+
+/**
+ * @brief Takes rings from the shared counter until the map is covered or the run is cancelled
+ */
+void BlockHashPrecomputer::work()
+{
+  while (m_cancel == 0)
+  {
+    LONG ring = InterlockedIncrement(&m_nextRing) - 1;
+
+    if (ring >= m_numberOfRings)
+    {
+      break;
+    }
+
+    hashRing(ring);
+  }
+
+  if (InterlockedDecrement(&m_activeWorkers) == 0 && m_cancel == 0)
+  {
+    Logger::g_pLogger->LogPrint("Hash precompute: map %i finished, %i blocks in %u ms\n", m_mapNumber, m_blocksHashed, GetTickCount() - m_startTicks);
+  }
+}
+
+/**
+ * @brief Hashes the blocks that lie exactly ring blocks away from the center (Chebyshev distance)
+ *
+ * @param ring Ring index, 0 is the center block itself
+ */
+void BlockHashPrecomputer::hashRing(int32_t ring)
+{
+  int32_t minX = max(m_centerX - ring, 0);
+  int32_t maxX = min(m_centerX + ring, m_widthInBlocks - 1);
+  int32_t minY = max(m_centerY - ring + 1, 0);
+  int32_t maxY = min(m_centerY + ring - 1, m_heightInBlocks - 1);
+
+  //top and bottom rows
+  for (int32_t x = minX; x <= maxX; ++x)
+  {
+    if (!hashBlock(x, m_centerY - ring))
+    {
+      return;
+    }
+
+    if (ring != 0 && !hashBlock(x, m_centerY + ring))
+    {
+      return;
+    }
+  }
+
+  //left and right columns without the corners
+  for (int32_t y = minY; y <= maxY; ++y)
+  {
+    if (!hashBlock(m_centerX - ring, y) || !hashBlock(m_centerX + ring, y))
+    {
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Hashes one block if it lies on the map
+ *
+ * @param x Block x
+ * @param y Block y
+ *
+ * @return false if the run has been cancelled
+ */
+bool BlockHashPrecomputer::hashBlock(int32_t x, int32_t y)
+{
+  if (m_cancel != 0)
+  {
+    return false;
+  }
+
+  if (x >= 0 && x < m_widthInBlocks && y >= 0 && y < m_heightInBlocks)
+  {
+    uint32_t blockNumber = (uint32_t)((x * m_heightInBlocks) + y);
+    uint32_t crc32 = BaseFileManager::INVALID_BLOCK_HASH_STAMP;
+    m_pCache->precompute(m_pFileManager, m_mapNumber, blockNumber, &crc32);
+    InterlockedIncrement(&m_blocksHashed);
+
+    //the block hash stamps of the map are complete, write them out while nothing else can write the statics index
+    if (m_pFileManager->recordBlockHashStamp(m_mapNumber, blockNumber, crc32))
+    {
+      m_pCache->beginDataUpdate();
+      m_pFileManager->writeBlockHashStamps();
+      m_pCache->endDataUpdate();
+    }
+  }
+
+  return true;
+}
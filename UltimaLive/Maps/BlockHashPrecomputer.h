@@ -0,0 +1,80 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_HASH_PRECOMPUTER_H
+#define _BLOCK_HASH_PRECOMPUTER_H
+
+#include <stdint.h>
+#include <vector>
+#include <Windows.h>
+
+class BaseFileManager;
+class BlockHashCache;
+
+/**
+ * @class BlockHashPrecomputer
+ *
+ * @brief Fills a BlockHashCache for a whole map on low priority worker threads. Blocks are hashed in square rings
+ * around a center block, so the blocks closest to the player are ready first. Workers take whole rings from a
+ * shared counter and check for cancellation between blocks. The CRC32 of every block is also handed to the file
+ * manager as its hash stamp, so a map whose statics index carries no stamps yet is stamped by the end of a full run.
+ */
+class BlockHashPrecomputer
+{
+  public:
+    BlockHashPrecomputer(BlockHashCache* pCache);
+    ~BlockHashPrecomputer();
+
+    void start(BaseFileManager* pFileManager, uint8_t mapNumber, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t centerBlock, uint32_t numberOfThreads);
+    void stop();
+
+    bool isRunning();
+    uint32_t getCenterBlock();
+    void getProgress(uint32_t& rBlocksHashed, uint32_t& rTotalBlocks);
+
+  private:
+    static DWORD WINAPI workerThreadProc(LPVOID pParameter);
+    void work();
+    void hashRing(int32_t ring);
+    bool hashBlock(int32_t x, int32_t y);
+
+    BlockHashCache* m_pCache;          //!< Cache being filled
+    BaseFileManager* m_pFileManager;   //!< File manager holding the map data
+    uint8_t m_mapNumber;               //!< Map being hashed
+    int32_t m_widthInBlocks;           //!< Map width in blocks
+    int32_t m_heightInBlocks;          //!< Map height in blocks
+    int32_t m_centerX;                 //!< Block x of the ring center
+    int32_t m_centerY;                 //!< Block y of the ring center
+    int32_t m_numberOfRings;           //!< Number of rings needed to cover the map
+
+    std::vector<HANDLE> m_threads;     //!< Worker thread handles
+    volatile LONG m_cancel;            //!< Set to stop the workers
+    volatile LONG m_nextRing;          //!< Next ring to hand out to a worker
+    volatile LONG m_activeWorkers;     //!< Number of workers that have not finished
+    volatile LONG m_blocksHashed;      //!< Progress counter
+    uint32_t m_totalBlocks;            //!< Number of blocks in the map
+    DWORD m_startTicks;                //!< Tick count when the run started
+};
+
+#endif
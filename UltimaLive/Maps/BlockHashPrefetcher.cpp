@@ -0,0 +1,305 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "BlockHashPrefetcher.h"
+#include "BlockHashCache.h"
+#include "..\FileSystem\BaseFileManager.h"
+#include "..\Client.h"
+#include "..\Debug.h"
+
+const uint32_t BlockHashPrefetcher::DEFAULT_INTERVAL_MILLISECONDS;
+const uint32_t BlockHashPrefetcher::DEFAULT_LOOKAHEAD_BLOCKS;
+const int32_t BlockHashPrefetcher::MAX_STEP_TILES;
+
+/**
+ * @brief BlockHashPrefetcher constructor
+ *
+ * @param pCache Cache to warm
+ */
+BlockHashPrefetcher::BlockHashPrefetcher(BlockHashCache* pCache)
+  : m_pCache(pCache),
+  m_pFileManager(NULL),
+  m_pClient(NULL),
+  m_mapNumber(0),
+  m_widthInBlocks(0),
+  m_heightInBlocks(0),
+  m_intervalMilliseconds(DEFAULT_INTERVAL_MILLISECONDS),
+  m_lookaheadBlocks(DEFAULT_LOOKAHEAD_BLOCKS),
+  m_warmupBlocks(),
+  m_minBlockX(-2),
+  m_maxBlockX(2),
+  m_minBlockY(-2),
+  m_maxBlockY(2),
+  m_thread(NULL),
+  m_wakeEvent(CreateEvent(NULL, FALSE, FALSE, NULL)),
+  m_cancel(0),
+  m_blocksPrefetched(0)
+{
+  //do nothing
+}
+
+/**
+ * @brief BlockHashPrefetcher destructor, stops the worker if it is running
+ */
+BlockHashPrefetcher::~BlockHashPrefetcher()
+{
+  stop();
+
+  if (m_wakeEvent != NULL)
+  {
+    CloseHandle(m_wakeEvent);
+  }
+}
+
+/**
+ * @brief Starts warming a map and following the player on it, stopping any previous run first
+ *
+ * @param pFileManager File manager holding the map data
+ * @param pClient Client holding the player structure
+ * @param mapNumber Map Number
+ * @param widthInBlocks Map width in blocks
+ * @param heightInBlocks Map height in blocks
+ * @param intervalMilliseconds Time between position samples
+ * @param lookaheadBlocks Number of blocks ahead of the view range to warm, 0 to only warm the warmup blocks
+ * @param warmupBlocks Blocks to hash before following the player
+ */
+void BlockHashPrefetcher::start(BaseFileManager* pFileManager, Client* pClient, uint8_t mapNumber, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t intervalMilliseconds, uint32_t lookaheadBlocks, const std::vector<uint32_t>& warmupBlocks)
+{
+  stop();
+
+  if (intervalMilliseconds == 0)
+  {
+    lookaheadBlocks = 0;
+  }
+
+  if (widthInBlocks == 0 || heightInBlocks == 0 || (lookaheadBlocks == 0 && warmupBlocks.empty()) || m_wakeEvent == NULL)
+  {
+    return;
+  }
+
+  m_pFileManager = pFileManager;
+  m_pClient = pClient;
+  m_mapNumber = mapNumber;
+  m_widthInBlocks = (int32_t)widthInBlocks;
+  m_heightInBlocks = (int32_t)heightInBlocks;
+  m_intervalMilliseconds = intervalMilliseconds;
+  m_lookaheadBlocks = (int32_t)lookaheadBlocks;
+  m_warmupBlocks = warmupBlocks;
+  m_cancel = 0;
+  m_blocksPrefetched = 0;
+
+  m_thread = CreateThread(NULL, 0, &BlockHashPrefetcher::workerThreadProc, this, 0, NULL);
+
+  if (m_thread != NULL)
+  {
+    SetThreadPriority(m_thread, THREAD_PRIORITY_LOWEST);
+  }
+  else
+  {
+    Logger::g_pLogger->LogPrintError("Hash prefetch: failed to create worker thread (%i)\n", GetLastError());
+  }
+}
+
+/**
+ * @brief Stops the worker and waits for it to exit. Safe to call when nothing is running.
+ */
+void BlockHashPrefetcher::stop()
+{
+  if (m_thread != NULL)
+  {
+    InterlockedExchange(&m_cancel, 1);
+    SetEvent(m_wakeEvent);
+
+    WaitForSingleObject(m_thread, INFINITE);
+    CloseHandle(m_thread);
+    m_thread = NULL;
+
+    Logger::g_pLogger->LogPrint("Hash prefetch: map %i, %i blocks prefetched\n", m_mapNumber, m_blocksPrefetched);
+  }
+}
+
+/**
+ * @brief Sets the view range the server queries hashes for, as block offsets from the player's block
+ *
+ * @param minBlockX min block x
+ * @param maxBlockX max block x
+ * @param minBlockY min block y
+ * @param maxBlockY max block y
+ */
+void BlockHashPrefetcher::setViewRange(int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY)
+{
+  InterlockedExchange(&m_minBlockX, minBlockX);
+  InterlockedExchange(&m_maxBlockX, maxBlockX);
+  InterlockedExchange(&m_minBlockY, minBlockY);
+  InterlockedExchange(&m_maxBlockY, maxBlockY);
+}
+
+/**
+ * @brief Worker thread entry point
+ *
+ * @param pParameter Pointer to the owning BlockHashPrefetcher
+ *
+ * @return 0
+ */
+DWORD WINAPI BlockHashPrefetcher::workerThreadProc(LPVOID pParameter)
+{
+  static_cast<BlockHashPrefetcher*>(pParameter)->work();
+  return 0;
+}
+
+/**
+ * @brief Warms the warmup blocks, then samples the player's position until the run is stopped. Each move sets the
+ *        heading, and every time the player's block or heading changes the blocks ahead of the view range are warmed.
+ */
+void BlockHashPrefetcher::work()
+{
+  warmUp();
+
+  if (m_lookaheadBlocks == 0)
+  {
+    return;
+  }
+
+  int32_t lastX = -1;
+  int32_t lastY = -1;
+  int32_t prefetchedBlockX = -1;
+  int32_t prefetchedBlockY = -1;
+  int32_t prefetchedHeadingX = 0;
+  int32_t prefetchedHeadingY = 0;
+
+  while (m_cancel == 0)
+  {
+    WaitForSingleObject(m_wakeEvent, m_intervalMilliseconds);
+
+    CPlayerMobile* pPlayer = m_pClient->getCurrentPlayerMobile();
+
+    if (m_cancel != 0 || pPlayer == NULL)
+    {
+      continue;
+    }
+
+    int32_t x = pPlayer->drawItemMembers.x;
+    int32_t y = pPlayer->drawItemMembers.y;
+    int32_t stepX = x - lastX;
+    int32_t stepY = y - lastY;
+    bool moved = lastX >= 0 && (stepX != 0 || stepY != 0);
+
+    lastX = x;
+    lastY = y;
+
+    if (!moved || abs(stepX) > MAX_STEP_TILES || abs(stepY) > MAX_STEP_TILES)
+    {
+      continue;
+    }
+
+    int32_t blockX = x >> 3;
+    int32_t blockY = y >> 3;
+    int32_t headingX = (stepX > 0) - (stepX < 0);
+    int32_t headingY = (stepY > 0) - (stepY < 0);
+
+    if (blockX != prefetchedBlockX || blockY != prefetchedBlockY || headingX != prefetchedHeadingX || headingY != prefetchedHeadingY)
+    {
+      prefetch(blockX, blockY, headingX, headingY);
+
+      prefetchedBlockX = blockX;
+      prefetchedBlockY = blockY;
+      prefetchedHeadingX = headingX;
+      prefetchedHeadingY = headingY;
+    }
+  }
+}
+
+/**
+ * @brief Hashes the warmup blocks that lie on the map, checking for cancellation between blocks
+ */
+void BlockHashPrefetcher::warmUp()
+{
+  if (m_warmupBlocks.empty())
+  {
+    return;
+  }
+
+  DWORD startTicks = GetTickCount();
+  uint32_t numberOfBlocks = (uint32_t)(m_widthInBlocks * m_heightInBlocks);
+  uint32_t blocksWarmed = 0;
+
+  for (std::vector<uint32_t>::iterator itr = m_warmupBlocks.begin(); itr != m_warmupBlocks.end() && m_cancel == 0; itr++)
+  {
+    if (*itr < numberOfBlocks)
+    {
+      m_pCache->precompute(m_pFileManager, m_mapNumber, *itr, NULL);
+      blocksWarmed++;
+    }
+  }
+
+  Logger::g_pLogger->LogPrint("Hash prefetch: map %i, warmed %u blocks in %u ms\n", m_mapNumber, blocksWarmed, GetTickCount() - startTicks);
+}
+
+/**
+ * @brief Warms the blocks that enter the view range over the next lookahead blocks of travel. Each step only hashes
+ *        the blocks that were not in the view range one step earlier, and blocks that are cached already cost a
+ *        lookup.
+ *
+ * @param blockX Block x of the player
+ * @param blockY Block y of the player
+ * @param headingX -1, 0 or 1 for the x direction of travel
+ * @param headingY -1, 0 or 1 for the y direction of travel
+ */
+void BlockHashPrefetcher::prefetch(int32_t blockX, int32_t blockY, int32_t headingX, int32_t headingY)
+{
+  int32_t minBlockX = m_minBlockX;
+  int32_t maxBlockX = m_maxBlockX;
+  int32_t minBlockY = m_minBlockY;
+  int32_t maxBlockY = m_maxBlockY;
+
+  for (int32_t step = 1; step <= m_lookaheadBlocks; ++step)
+  {
+    int32_t centerX = blockX + (headingX * step);
+    int32_t centerY = blockY + (headingY * step);
+
+    for (int32_t x = centerX + minBlockX; x <= centerX + maxBlockX; ++x)
+    {
+      for (int32_t y = centerY + minBlockY; y <= centerY + maxBlockY; ++y)
+      {
+        if (m_cancel != 0)
+        {
+          return;
+        }
+
+        //skip blocks off the map and blocks that were in the view range one step earlier
+        int32_t previousOffsetX = x - (centerX - headingX);
+        int32_t previousOffsetY = y - (centerY - headingY);
+
+        if (x < 0 || x >= m_widthInBlocks || y < 0 || y >= m_heightInBlocks ||
+          (previousOffsetX >= minBlockX && previousOffsetX <= maxBlockX && previousOffsetY >= minBlockY && previousOffsetY <= maxBlockY))
+        {
+          continue;
+        }
+
+        m_pCache->precompute(m_pFileManager, m_mapNumber, (uint32_t)((x * m_heightInBlocks) + y), NULL);
+        InterlockedIncrement(&m_blocksPrefetched);
+      }
+    }
+  }
+}
@@ -0,0 +1,87 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_HASH_PREFETCHER_H
+#define _BLOCK_HASH_PREFETCHER_H
+
+#include <stdint.h>
+#include <vector>
+#include <Windows.h>
+
+class BaseFileManager;
+class BlockHashCache;
+class Client;
+
+/**
+ * @class BlockHashPrefetcher
+ *
+ * @brief Warms a BlockHashCache ahead of the player on a low priority worker thread. The player's position is
+ * sampled between server hash queries and the heading is taken from the last move, so the blocks that are about to
+ * enter the view range are hashed, and their map data paged in, before the next query asks for them.
+ *
+ * A run can start with a list of blocks to warm first, such as the places the player usually stands after a login.
+ */
+class BlockHashPrefetcher
+{
+  public:
+    static const uint32_t DEFAULT_INTERVAL_MILLISECONDS = 100; //!< Time between position samples unless configured
+    static const uint32_t DEFAULT_LOOKAHEAD_BLOCKS = 2;        //!< Blocks ahead of the view range to warm unless configured
+
+    BlockHashPrefetcher(BlockHashCache* pCache);
+    ~BlockHashPrefetcher();
+
+    void start(BaseFileManager* pFileManager, Client* pClient, uint8_t mapNumber, uint32_t widthInBlocks, uint32_t heightInBlocks, uint32_t intervalMilliseconds, uint32_t lookaheadBlocks, const std::vector<uint32_t>& warmupBlocks);
+    void stop();
+    void setViewRange(int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY);
+
+  private:
+    static const int32_t MAX_STEP_TILES = 8; //!< Moves longer than this between two samples are teleports and have no heading
+
+    static DWORD WINAPI workerThreadProc(LPVOID pParameter);
+    void work();
+    void warmUp();
+    void prefetch(int32_t blockX, int32_t blockY, int32_t headingX, int32_t headingY);
+
+    BlockHashCache* m_pCache;          //!< Cache being warmed
+    BaseFileManager* m_pFileManager;   //!< File manager holding the map data
+    Client* m_pClient;                 //!< Client holding the player structure
+    uint8_t m_mapNumber;               //!< Map being prefetched
+    int32_t m_widthInBlocks;           //!< Map width in blocks
+    int32_t m_heightInBlocks;          //!< Map height in blocks
+    uint32_t m_intervalMilliseconds;   //!< Time between position samples
+    int32_t m_lookaheadBlocks;         //!< Number of blocks ahead of the view range to warm
+    std::vector<uint32_t> m_warmupBlocks; //!< Blocks to hash before following the player
+
+    volatile LONG m_minBlockX;         //!< View range min block x offset
+    volatile LONG m_maxBlockX;         //!< View range max block x offset
+    volatile LONG m_minBlockY;         //!< View range min block y offset
+    volatile LONG m_maxBlockY;         //!< View range max block y offset
+
+    HANDLE m_thread;                   //!< Worker thread handle, NULL when not running
+    HANDLE m_wakeEvent;                //!< Signalled to end the wait between samples early
+    volatile LONG m_cancel;            //!< Set to stop the worker
+    volatile LONG m_blocksPrefetched;  //!< Number of blocks handed to the cache in the current run
+};
+
+#endif
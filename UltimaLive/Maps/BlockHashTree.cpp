@@ -0,0 +1,194 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "BlockHashTree.h"
+#include "BlockCrc32Source.h"
+#include "..\Hashing\Crc32.h"
+
+const uint32_t BlockHashTree::INVALID_NODE_HASH;
+
+/**
+ * @brief BlockHashTree constructor
+ *
+ * @param pSource Source of the block CRC32s
+ */
+BlockHashTree::BlockHashTree(BlockCrc32Source* pSource)
+  : m_pSource(pSource),
+  m_widthInBlocks(0),
+  m_heightInBlocks(0),
+  m_levels()
+{
+  //do nothing
+}
+
+/**
+ * @brief Drops every cached node hash and sizes the tree for a map. Levels are added until a single node covers
+ * the whole map.
+ *
+ * @param widthInBlocks Map width in blocks
+ * @param heightInBlocks Map height in blocks
+ */
+void BlockHashTree::reset(uint32_t widthInBlocks, uint32_t heightInBlocks)
+{
+  m_widthInBlocks = widthInBlocks;
+  m_heightInBlocks = heightInBlocks;
+  m_levels.clear();
+
+  uint8_t level = 1;
+
+  do
+  {
+    m_levels.push_back(std::vector<uint32_t>(getLevelWidth(level) * getLevelHeight(level), INVALID_NODE_HASH));
+    level++;
+  } while (getLevelWidth(level - 1) > 1 || getLevelHeight(level - 1) > 1);
+}
+
+/**
+ * @brief Drops the cached hashes of every node above a block. The block's own CRC32 is invalidated in the
+ * BlockCrc32Source.
+ *
+ * @param blockNumber Block Number
+ */
+void BlockHashTree::invalidateBlock(uint32_t blockNumber)
+{
+  if (m_heightInBlocks == 0)
+  {
+    return;
+  }
+
+  uint32_t blockX = blockNumber / m_heightInBlocks;
+  uint32_t blockY = blockNumber % m_heightInBlocks;
+
+  if (blockX >= m_widthInBlocks)
+  {
+    return;
+  }
+
+  for (uint8_t level = 1; level <= m_levels.size(); level++)
+  {
+    m_levels[level - 1][((blockX >> level) * getLevelHeight(level)) + (blockY >> level)] = INVALID_NODE_HASH;
+  }
+}
+
+/**
+ * @brief Gets the number of levels above the blocks
+ *
+ * @return Level of the root node
+ */
+uint8_t BlockHashTree::getNumberOfLevels()
+{
+  return static_cast<uint8_t>(m_levels.size());
+}
+
+/**
+ * @brief Gets the hashes of the four children of a node
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param level Level of the node, at least 1
+ * @param nodeX Node x at that level
+ * @param nodeY Node y at that level
+ * @param pHashesOut Receives the four child hashes in tree order
+ *
+ * @return false if the node is not part of the tree, in which case the hashes are 0
+ */
+bool BlockHashTree::getChildHashes(MapBlockReader* pReader, uint8_t mapNumber, uint8_t level, uint32_t nodeX, uint32_t nodeY, uint32_t* pHashesOut)
+{
+  bool validNode = level >= 1 && level <= m_levels.size() && nodeX < getLevelWidth(level) && nodeY < getLevelHeight(level);
+
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    pHashesOut[i] = validNode ? getNodeHash(pReader, mapNumber, level - 1, (nodeX << 1) + (i >> 1), (nodeY << 1) + (i & 1)) : 0;
+  }
+
+  return validNode;
+}
+
+/**
+ * @brief Gets the hash of a node, computing and caching it if needed
+ *
+ * @param pReader Reader of the block data
+ * @param mapNumber Map Number
+ * @param level Level of the node
+ * @param nodeX Node x at that level
+ * @param nodeY Node y at that level
+ *
+ * @return Node hash, 0 for nodes outside the map
+ */
+uint32_t BlockHashTree::getNodeHash(MapBlockReader* pReader, uint8_t mapNumber, uint8_t level, uint32_t nodeX, uint32_t nodeY)
+{
+  if (nodeX >= getLevelWidth(level) || nodeY >= getLevelHeight(level))
+  {
+    return 0;
+  }
+
+  if (level == 0)
+  {
+    return m_pSource->getCrc32(pReader, mapNumber, (nodeX * m_heightInBlocks) + nodeY);
+  }
+
+  uint32_t& rHash = m_levels[level - 1][(nodeX * getLevelHeight(level)) + nodeY];
+
+  if (rHash == INVALID_NODE_HASH)
+  {
+    uint8_t childHashes[4 * sizeof(uint32_t)];
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+      uint32_t childHash = getNodeHash(pReader, mapNumber, level - 1, (nodeX << 1) + (i >> 1), (nodeY << 1) + (i & 1));
+      childHashes[(i * 4) + 0] = static_cast<uint8_t>(childHash >> 24);
+      childHashes[(i * 4) + 1] = static_cast<uint8_t>(childHash >> 16);
+      childHashes[(i * 4) + 2] = static_cast<uint8_t>(childHash >> 8);
+      childHashes[(i * 4) + 3] = static_cast<uint8_t>(childHash);
+    }
+
+    rHash = Crc32::calculate(childHashes, sizeof(childHashes));
+  }
+
+  return rHash;
+}
+
+/**
+ * @brief Gets the number of node columns at a level
+ *
+ * @param level Level
+ *
+ * @return Number of nodes across the map width
+ */
+uint32_t BlockHashTree::getLevelWidth(uint8_t level)
+{
+  return (m_widthInBlocks + (1 << level) - 1) >> level;
+}
+
+/**
+ * @brief Gets the number of node rows at a level
+ *
+ * @param level Level
+ *
+ * @return Number of nodes across the map height
+ */
+uint32_t BlockHashTree::getLevelHeight(uint8_t level)
+{
+  return (m_heightInBlocks + (1 << level) - 1) >> level;
+}
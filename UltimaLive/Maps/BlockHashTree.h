@@ -0,0 +1,70 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_HASH_TREE_H
+#define _BLOCK_HASH_TREE_H
+
+#include <stdint.h>
+#include <vector>
+
+class BlockCrc32Source;
+class MapBlockReader;
+
+/**
+ * @class BlockHashTree
+ *
+ * @brief Quadtree of CRC32s over the blocks of the loaded map, used to answer region hash queries. Level 0 is the
+ * block CRC32 from a BlockCrc32Source, which is the BlockHashCache in the client. A node at level L covers the square
+ * of 2^L x 2^L blocks starting at block (nodeX << L, nodeY << L), and its hash is the CRC32 of its four child hashes
+ * in the order (2x, 2y), (2x, 2y + 1), (2x + 1, 2y), (2x + 1, 2y + 1), each written big endian. Children that fall
+ * outside the map hash to 0.
+ *
+ * Node hashes are computed on demand and kept until a block below them changes. The tree is only used from the
+ * network thread.
+ */
+class BlockHashTree
+{
+  public:
+    BlockHashTree(BlockCrc32Source* pSource);
+
+    void reset(uint32_t widthInBlocks, uint32_t heightInBlocks);
+    void invalidateBlock(uint32_t blockNumber);
+
+    uint8_t getNumberOfLevels();
+    bool getChildHashes(MapBlockReader* pReader, uint8_t mapNumber, uint8_t level, uint32_t nodeX, uint32_t nodeY, uint32_t* pHashesOut);
+
+    static const uint32_t INVALID_NODE_HASH = 0xFFFFFFFF; //!< Marks an uncached node hash
+
+  private:
+    uint32_t getNodeHash(MapBlockReader* pReader, uint8_t mapNumber, uint8_t level, uint32_t nodeX, uint32_t nodeY);
+    uint32_t getLevelWidth(uint8_t level);
+    uint32_t getLevelHeight(uint8_t level);
+
+    BlockCrc32Source* m_pSource;                //!< Source of the block CRC32s
+    uint32_t m_widthInBlocks;                   //!< Map width in blocks
+    uint32_t m_heightInBlocks;                  //!< Map height in blocks
+    std::vector<std::vector<uint32_t>> m_levels; //!< Cached node hashes, m_levels[L - 1] holds level L in column order
+};
+
+#endif
@@ -0,0 +1,231 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <stdio.h>
+
+#include "BlockHeatmap.h"
+#include "..\Debug.h"
+
+const uint32_t BlockHeatmap::MAX_SAVED_BLOCKS;
+const uint32_t BlockHeatmap::FILE_MAGIC;
+const uint32_t BlockHeatmap::FILE_VERSION;
+
+/**
+ * @brief BlockHeatmap constructor
+ */
+BlockHeatmap::BlockHeatmap()
+  : m_visits(),
+  m_changed(false)
+{
+  //do nothing
+}
+
+/**
+ * @brief Replaces the visit counts with those saved in a heatmap file, halving each count. Blocks beyond the end of
+ * the map are dropped, so a map that was resized does not warm blocks it no longer has.
+ *
+ * @param filePath Path of the heatmap file
+ * @param numberOfBlocks Number of blocks in the map
+ *
+ * @return false if the file does not exist or is not a heatmap file
+ */
+bool BlockHeatmap::load(std::string filePath, uint32_t numberOfBlocks)
+{
+  clear();
+
+  std::ifstream heatmapFile(filePath, std::ifstream::binary);
+  if (!heatmapFile.is_open())
+  {
+    return false;
+  }
+
+  uint32_t header[3] = { 0, 0, 0 };
+  heatmapFile.read(reinterpret_cast<char*>(header), sizeof(header));
+
+  if (!heatmapFile.good() || header[0] != FILE_MAGIC || header[1] != FILE_VERSION || header[2] > MAX_SAVED_BLOCKS)
+  {
+    Logger::g_pLogger->LogPrint("Block heatmap: ignoring %s\n", filePath.c_str());
+    return false;
+  }
+
+  std::vector<uint32_t> entries(header[2] * 2, 0);
+  if (!entries.empty())
+  {
+    heatmapFile.read(reinterpret_cast<char*>(&entries[0]), entries.size() * sizeof(uint32_t));
+  }
+
+  if (!heatmapFile.good())
+  {
+    Logger::g_pLogger->LogPrint("Block heatmap: ignoring truncated %s\n", filePath.c_str());
+    return false;
+  }
+
+  for (size_t i = 0; i < entries.size(); i += 2)
+  {
+    if (entries[i] < numberOfBlocks && entries[i + 1] > 0)
+    {
+      m_visits[entries[i]] = (entries[i + 1] + 1) / 2;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Saves the hottest blocks to a heatmap file if any visits were recorded since the heatmap was loaded
+ *
+ * @param filePath Path of the heatmap file
+ *
+ * @return true on success or when there was nothing to save
+ */
+bool BlockHeatmap::save(std::string filePath)
+{
+  if (!m_changed)
+  {
+    return true;
+  }
+
+  std::vector<std::pair<uint32_t, uint32_t> > entries;
+  getEntriesByVisits(entries);
+
+  if (entries.size() > MAX_SAVED_BLOCKS)
+  {
+    entries.resize(MAX_SAVED_BLOCKS);
+  }
+
+  std::vector<uint32_t> data;
+  data.reserve(3 + (entries.size() * 2));
+  data.push_back(FILE_MAGIC);
+  data.push_back(FILE_VERSION);
+  data.push_back(static_cast<uint32_t>(entries.size()));
+
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    data.push_back(entries[i].first);
+    data.push_back(entries[i].second);
+  }
+
+  std::ofstream heatmapFile(filePath, std::ofstream::binary | std::ofstream::trunc);
+  heatmapFile.write(reinterpret_cast<const char*>(&data[0]), data.size() * sizeof(uint32_t));
+  heatmapFile.close();
+
+  if (heatmapFile.fail())
+  {
+    Logger::g_pLogger->LogPrintError("Block heatmap: failed to write %s\n", filePath.c_str());
+    return false;
+  }
+
+  m_changed = false;
+  return true;
+}
+
+/**
+ * @brief Forgets every visit
+ */
+void BlockHeatmap::clear()
+{
+  m_visits.clear();
+  m_changed = false;
+}
+
+/**
+ * @brief Counts a visit to a block
+ *
+ * @param blockNumber Block Number
+ */
+void BlockHeatmap::recordVisit(uint32_t blockNumber)
+{
+  uint32_t& rVisits = m_visits[blockNumber];
+
+  if (rVisits < UINT32_MAX)
+  {
+    rVisits++;
+  }
+
+  m_changed = true;
+}
+
+/**
+ * @brief Gets the most visited blocks, most visited first
+ *
+ * @param count Most blocks to get
+ * @param rBlocksOut Receives the block numbers
+ */
+void BlockHeatmap::getHottestBlocks(uint32_t count, std::vector<uint32_t>& rBlocksOut)
+{
+  std::vector<std::pair<uint32_t, uint32_t> > entries;
+  getEntriesByVisits(entries);
+
+  rBlocksOut.clear();
+  for (size_t i = 0; i < entries.size() && i < count; i++)
+  {
+    rBlocksOut.push_back(entries[i].first);
+  }
+}
+
+/**
+ * @brief Gets the path of the heatmap file of a map
+ *
+ * @param pathWithoutFilename Folder containing the map files, ending in a path separator
+ * @param mapNumber Map Number
+ *
+ * @return Heatmap file path
+ */
+std::string BlockHeatmap::getFilePath(std::string pathWithoutFilename, uint8_t mapNumber)
+{
+  char filename[32];
+  sprintf_s(filename, "heatmap%i.dat", mapNumber);
+  pathWithoutFilename.append(filename);
+
+  return pathWithoutFilename;
+}
+
+/**
+ * @brief Gets every block with its visit count, most visited first. Blocks with the same count are ordered by
+ * block number, so the saved file does not depend on the order of the visits.
+ *
+ * @param rEntriesOut Receives pairs of block number and visit count
+ */
+void BlockHeatmap::getEntriesByVisits(std::vector<std::pair<uint32_t, uint32_t> >& rEntriesOut)
+{
+  rEntriesOut.assign(m_visits.begin(), m_visits.end());
+
+  //std::map iterates in block order, so a stable sort keeps ties in block order
+  std::stable_sort(rEntriesOut.begin(), rEntriesOut.end(), &BlockHeatmap::hasMoreVisits);
+}
+
+/**
+ * @brief Orders heatmap entries by visit count, highest first
+ *
+ * @param rLeft Pair of block number and visit count
+ * @param rRight Pair of block number and visit count
+ *
+ * @return true if rLeft has more visits than rRight
+ */
+bool BlockHeatmap::hasMoreVisits(const std::pair<uint32_t, uint32_t>& rLeft, const std::pair<uint32_t, uint32_t>& rRight)
+{
+  return rLeft.second > rRight.second;
+}
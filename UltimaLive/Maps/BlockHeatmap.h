@@ -0,0 +1,70 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_HEATMAP_H
+#define _BLOCK_HEATMAP_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/**
+ * @class BlockHeatmap
+ *
+ * @brief Counts how often the player stood in each block of the loaded map, so the places players log in and out
+ * at can be hashed ahead of the first hash queries of the next session. The counts are saved next to the shard's map
+ * files. Only the hottest blocks are saved, and loading halves every count, so places that are no longer visited
+ * fade out over a few sessions.
+ *
+ * The heatmap is only used from the network thread.
+ */
+class BlockHeatmap
+{
+  public:
+    static const uint32_t MAX_SAVED_BLOCKS = 1024; //!< Most blocks kept in a heatmap file
+
+    BlockHeatmap();
+
+    bool load(std::string filePath, uint32_t numberOfBlocks);
+    bool save(std::string filePath);
+    void clear();
+
+    void recordVisit(uint32_t blockNumber);
+    void getHottestBlocks(uint32_t count, std::vector<uint32_t>& rBlocksOut);
+
+    static std::string getFilePath(std::string pathWithoutFilename, uint8_t mapNumber);
+
+  private:
+    static const uint32_t FILE_MAGIC = 0x4D484C55;  //!< "ULHM"
+    static const uint32_t FILE_VERSION = 1;         //!< Version of the heatmap file layout
+
+    void getEntriesByVisits(std::vector<std::pair<uint32_t, uint32_t> >& rEntriesOut);
+    static bool hasMoreVisits(const std::pair<uint32_t, uint32_t>& rLeft, const std::pair<uint32_t, uint32_t>& rRight);
+
+    std::map<uint32_t, uint32_t> m_visits; //!< Visit counts by block number
+    bool m_changed;                        //!< Indicates if visits were recorded since the last load or save
+};
+
+#endif
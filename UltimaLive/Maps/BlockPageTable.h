@@ -0,0 +1,203 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _BLOCK_PAGE_TABLE_H
+#define _BLOCK_PAGE_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @struct BlockPage
+ *
+ * @brief Number of blocks covered by each page of a BlockPageTable. A page covers consecutive block numbers, which is
+ * a strip of whole or half columns of the map.
+ */
+struct BlockPage
+{
+  static const uint32_t SHIFT = 10;        //!< log2 of the number of blocks per page
+  static const uint32_t SIZE = 1 << SHIFT; //!< Number of blocks per page
+};
+
+/**
+ * @class BlockPageTable
+ *
+ * @brief Directory of fixed size pages covering every block of a map, where a page is only allocated the first time
+ * one of its blocks is written. Large custom maps are mostly never visited, so a per block cache only pays for the
+ * areas the player has been to. A page type holds the values of BlockPage::SIZE blocks.
+ *
+ * Not thread safe, the owner guards it.
+ */
+template <typename PageType>
+class BlockPageTable
+{
+  public:
+    BlockPageTable();
+    ~BlockPageTable();
+
+    void reset(uint32_t numberOfBlocks);
+    void release();
+
+    uint32_t size() const;
+    PageType* findPage(uint32_t blockNumber) const;
+    PageType& getPage(uint32_t blockNumber);
+    size_t getMemoryUsage() const;
+
+    static uint32_t getIndexInPage(uint32_t blockNumber);
+
+  private:
+    BlockPageTable(const BlockPageTable&);
+    BlockPageTable& operator=(const BlockPageTable&);
+
+    std::vector<PageType*> m_pages;    //!< Page per BlockPage::SIZE blocks, NULL until one of its blocks is written
+    uint32_t m_numberOfBlocks;         //!< Number of blocks covered
+    uint32_t m_numberOfAllocatedPages; //!< Number of pages that are not NULL
+};
+
+/**
+ * @brief BlockPageTable constructor
+ */
+template <typename PageType>
+BlockPageTable<PageType>::BlockPageTable()
+  : m_pages(),
+  m_numberOfBlocks(0),
+  m_numberOfAllocatedPages(0)
+{
+  //do nothing
+}
+
+/**
+ * @brief BlockPageTable destructor, frees every page
+ */
+template <typename PageType>
+BlockPageTable<PageType>::~BlockPageTable()
+{
+  release();
+}
+
+/**
+ * @brief Covers a map with pages that are all unallocated
+ *
+ * @param numberOfBlocks Number of blocks in the map
+ */
+template <typename PageType>
+void BlockPageTable<PageType>::reset(uint32_t numberOfBlocks)
+{
+  release();
+  m_numberOfBlocks = numberOfBlocks;
+  m_pages.assign((numberOfBlocks + BlockPage::SIZE - 1) >> BlockPage::SHIFT, NULL);
+}
+
+/**
+ * @brief Frees every page and the directory, the table covers no blocks until it is reset again
+ */
+template <typename PageType>
+void BlockPageTable<PageType>::release()
+{
+  for (size_t i = 0; i < m_pages.size(); i++)
+  {
+    delete m_pages[i];
+  }
+
+  std::vector<PageType*>().swap(m_pages);
+  m_numberOfBlocks = 0;
+  m_numberOfAllocatedPages = 0;
+}
+
+/**
+ * @brief Gets the number of blocks covered
+ *
+ * @return Number of blocks, 0 while the table is released
+ */
+template <typename PageType>
+uint32_t BlockPageTable<PageType>::size() const
+{
+  return m_numberOfBlocks;
+}
+
+/**
+ * @brief Finds the page holding a block without allocating it
+ *
+ * @param blockNumber Block Number
+ *
+ * @return Page holding the block, NULL if it has not been allocated or the block is not covered
+ */
+template <typename PageType>
+PageType* BlockPageTable<PageType>::findPage(uint32_t blockNumber) const
+{
+  if (blockNumber >= m_numberOfBlocks)
+  {
+    return NULL;
+  }
+
+  return m_pages[blockNumber >> BlockPage::SHIFT];
+}
+
+/**
+ * @brief Gets the page holding a block, allocating a zero filled page on first use. The block must be covered.
+ *
+ * @param blockNumber Block Number
+ *
+ * @return Page holding the block
+ */
+template <typename PageType>
+PageType& BlockPageTable<PageType>::getPage(uint32_t blockNumber)
+{
+  PageType*& rpPage = m_pages[blockNumber >> BlockPage::SHIFT];
+
+  if (rpPage == NULL)
+  {
+    rpPage = new PageType();
+    m_numberOfAllocatedPages++;
+  }
+
+  return *rpPage;
+}
+
+/**
+ * @brief Gets the memory held by the directory and the allocated pages
+ *
+ * @return Size in bytes
+ */
+template <typename PageType>
+size_t BlockPageTable<PageType>::getMemoryUsage() const
+{
+  return (m_pages.capacity() * sizeof(PageType*)) + ((size_t)m_numberOfAllocatedPages * sizeof(PageType));
+}
+
+/**
+ * @brief Gets the position of a block within its page
+ *
+ * @param blockNumber Block Number
+ *
+ * @return Index into the page
+ */
+template <typename PageType>
+uint32_t BlockPageTable<PageType>::getIndexInPage(uint32_t blockNumber)
+{
+  return blockNumber & (BlockPage::SIZE - 1);
+}
+
+#endif
@@ -0,0 +1,300 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _FINISHED_HASH_CACHE_H
+#define _FINISHED_HASH_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BlockPageTable.h"
+
+/**
+ * @struct HashCacheStatistics
+ *
+ * @brief Lookup counters of a finished hash cache
+ */
+struct HashCacheStatistics
+{
+  uint32_t hits;     //!< Lookups answered from the cache
+  uint32_t misses;   //!< Lookups of blocks that had never been hashed
+  uint32_t rehashes; //!< Lookups of blocks whose hash was dropped by a land or statics update
+};
+
+/**
+ * @class FinishedHashCache
+ *
+ * @brief Finished hash of every block of a map in one hash width. Whether a block's hash is valid is kept in a
+ * bitset instead of a reserved hash value, so every hash value can be cached. The cache takes no memory until
+ * allocate() is called, which happens the first time its hash width is asked for, and even then only the pages of
+ * blocks that have been stored take memory.
+ *
+ * Not thread safe, the owner guards it.
+ */
+template <typename HashType>
+class FinishedHashCache
+{
+  public:
+    FinishedHashCache();
+
+    bool isAllocated() const;
+    void allocate(uint32_t numberOfBlocks);
+    void release();
+
+    bool isPageAllocated(uint32_t blockNumber) const;
+    bool isValid(uint32_t blockNumber) const;
+    bool lookup(uint32_t blockNumber, HashType& rHashOut);
+    void store(uint32_t blockNumber, HashType hash);
+    void invalidate(uint32_t blockNumber);
+
+    const HashCacheStatistics& getStatistics() const;
+    size_t getMemoryUsage() const;
+
+  private:
+    /**
+     * @struct Page
+     *
+     * @brief Finished hashes and bits of BlockPage::SIZE blocks
+     */
+    struct Page
+    {
+      HashType hashes[BlockPage::SIZE];         //!< Finished hash per block
+      uint32_t validBits[BlockPage::SIZE / 32]; //!< Set for blocks whose hash is valid
+      uint32_t staleBits[BlockPage::SIZE / 32]; //!< Set for blocks whose valid hash was invalidated since
+    };
+
+    static bool testBit(const uint32_t* pBits, uint32_t index);
+    static void setBit(uint32_t* pBits, uint32_t index, bool value);
+
+    BlockPageTable<Page> m_pages;     //!< Pages of the blocks of the map
+    HashCacheStatistics m_statistics; //!< Lookup counters since the cache was allocated
+};
+
+/**
+ * @brief FinishedHashCache constructor
+ */
+template <typename HashType>
+FinishedHashCache<HashType>::FinishedHashCache()
+  : m_pages(),
+  m_statistics()
+{
+  //do nothing
+}
+
+/**
+ * @brief Checks if the cache has been allocated
+ *
+ * @return true after allocate() until release()
+ */
+template <typename HashType>
+bool FinishedHashCache<HashType>::isAllocated() const
+{
+  return m_pages.size() != 0;
+}
+
+/**
+ * @brief Sizes the cache for a map with every block invalid and clears the counters. Pages are allocated as blocks
+ * are stored.
+ *
+ * @param numberOfBlocks Number of blocks in the map
+ */
+template <typename HashType>
+void FinishedHashCache<HashType>::allocate(uint32_t numberOfBlocks)
+{
+  m_pages.reset(numberOfBlocks);
+  m_statistics.hits = 0;
+  m_statistics.misses = 0;
+  m_statistics.rehashes = 0;
+}
+
+/**
+ * @brief Frees the cache, it takes no memory until it is allocated again
+ */
+template <typename HashType>
+void FinishedHashCache<HashType>::release()
+{
+  m_pages.release();
+}
+
+/**
+ * @brief Checks if the page holding a block has been allocated, that is if any block near it has been stored
+ *
+ * @param blockNumber Block Number
+ *
+ * @return true if the page is allocated
+ */
+template <typename HashType>
+bool FinishedHashCache<HashType>::isPageAllocated(uint32_t blockNumber) const
+{
+  return m_pages.findPage(blockNumber) != NULL;
+}
+
+/**
+ * @brief Checks if the hash of a block is valid without counting a lookup
+ *
+ * @param blockNumber Block Number
+ *
+ * @return true if the hash is valid
+ */
+template <typename HashType>
+bool FinishedHashCache<HashType>::isValid(uint32_t blockNumber) const
+{
+  const Page* pPage = m_pages.findPage(blockNumber);
+
+  return pPage != NULL && testBit(pPage->validBits, BlockPageTable<Page>::getIndexInPage(blockNumber));
+}
+
+/**
+ * @brief Looks up the hash of a block and counts the lookup
+ *
+ * @param blockNumber Block Number
+ * @param rHashOut Receives the hash if it is valid
+ *
+ * @return true if the hash is valid
+ */
+template <typename HashType>
+bool FinishedHashCache<HashType>::lookup(uint32_t blockNumber, HashType& rHashOut)
+{
+  if (blockNumber >= m_pages.size())
+  {
+    return false;
+  }
+
+  const Page* pPage = m_pages.findPage(blockNumber);
+  uint32_t index = BlockPageTable<Page>::getIndexInPage(blockNumber);
+
+  if (pPage != NULL && testBit(pPage->validBits, index))
+  {
+    m_statistics.hits++;
+    rHashOut = pPage->hashes[index];
+    return true;
+  }
+
+  if (pPage != NULL && testBit(pPage->staleBits, index))
+  {
+    m_statistics.rehashes++;
+  }
+  else
+  {
+    m_statistics.misses++;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Stores the hash of a block and marks it valid, allocating its page if needed
+ *
+ * @param blockNumber Block Number
+ * @param hash Hash of the block
+ */
+template <typename HashType>
+void FinishedHashCache<HashType>::store(uint32_t blockNumber, HashType hash)
+{
+  if (blockNumber < m_pages.size())
+  {
+    Page& rPage = m_pages.getPage(blockNumber);
+    uint32_t index = BlockPageTable<Page>::getIndexInPage(blockNumber);
+
+    rPage.hashes[index] = hash;
+    setBit(rPage.validBits, index, true);
+    setBit(rPage.staleBits, index, false);
+  }
+}
+
+/**
+ * @brief Marks the hash of a block invalid, does nothing while the cache or the block's page is not allocated
+ *
+ * @param blockNumber Block Number
+ */
+template <typename HashType>
+void FinishedHashCache<HashType>::invalidate(uint32_t blockNumber)
+{
+  Page* pPage = m_pages.findPage(blockNumber);
+  uint32_t index = BlockPageTable<Page>::getIndexInPage(blockNumber);
+
+  if (pPage != NULL && testBit(pPage->validBits, index))
+  {
+    setBit(pPage->validBits, index, false);
+    setBit(pPage->staleBits, index, true);
+  }
+}
+
+/**
+ * @brief Gets the lookup counters since the cache was allocated
+ *
+ * @return Lookup counters
+ */
+template <typename HashType>
+const HashCacheStatistics& FinishedHashCache<HashType>::getStatistics() const
+{
+  return m_statistics;
+}
+
+/**
+ * @brief Gets the memory held by the cache
+ *
+ * @return Size in bytes, 0 while the cache is not allocated
+ */
+template <typename HashType>
+size_t FinishedHashCache<HashType>::getMemoryUsage() const
+{
+  return m_pages.getMemoryUsage();
+}
+
+/**
+ * @brief Tests the bit of a block
+ *
+ * @param pBits Bitset of a page
+ * @param index Index of the block in the page
+ *
+ * @return Value of the bit
+ */
+template <typename HashType>
+bool FinishedHashCache<HashType>::testBit(const uint32_t* pBits, uint32_t index)
+{
+  return (pBits[index >> 5] & (1u << (index & 31))) != 0;
+}
+
+/**
+ * @brief Sets or clears the bit of a block
+ *
+ * @param pBits Bitset of a page
+ * @param index Index of the block in the page
+ * @param value New value of the bit
+ */
+template <typename HashType>
+void FinishedHashCache<HashType>::setBit(uint32_t* pBits, uint32_t index, bool value)
+{
+  if (value)
+  {
+    pBits[index >> 5] |= (1u << (index & 31));
+  }
+  else
+  {
+    pBits[index >> 5] &= ~(1u << (index & 31));
+  }
+}
+
+#endif
@@ -0,0 +1,168 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "HashResponseCache.h"
+
+const uint8_t HashResponseCache::NUMBER_OF_HASH_MODES;
+const uint8_t HashResponseCache::NUMBER_OF_SLOTS;
+
+/**
+ * @brief HashResponseCache constructor
+ */
+HashResponseCache::HashResponseCache()
+  : m_responses()
+{
+  //do nothing
+}
+
+/**
+ * @brief Copies the cached response for a query if the query matches the one it answered and no block of its
+ * window changed since it was built
+ *
+ * @param command UltimaLive command of the response (0xFF, 0xFD or 0xF9)
+ * @param hashMode Hash mode of the response
+ * @param mapNumber Map Number
+ * @param blockNumber Central block number of the query
+ * @param minBlockX min block x of the view range
+ * @param maxBlockX max block x of the view range
+ * @param minBlockY min block y of the view range
+ * @param maxBlockY max block y of the view range
+ * @param rResponseOut Receives a copy of the cached response
+ *
+ * @return true if the cached response was copied
+ */
+bool HashResponseCache::lookup(uint8_t command, uint8_t hashMode, uint8_t mapNumber, uint32_t blockNumber, int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY, std::vector<uint8_t>& rResponseOut)
+{
+  CachedResponse* pCached = getCachedResponse(command, hashMode);
+
+  if (pCached == NULL || pCached->response.empty() || pCached->responseGeneration != pCached->windowGeneration ||
+    pCached->mapNumber != mapNumber || pCached->blockNumber != blockNumber ||
+    pCached->minBlockX != minBlockX || pCached->maxBlockX != maxBlockX || pCached->minBlockY != minBlockY || pCached->maxBlockY != maxBlockY)
+  {
+    return false;
+  }
+
+  rResponseOut.assign(pCached->response.begin(), pCached->response.end());
+  return true;
+}
+
+/**
+ * @brief Replaces the cached response for a command
+ *
+ * @param command UltimaLive command of the response (0xFF, 0xFD or 0xF9)
+ * @param hashMode Hash mode of the response
+ * @param mapNumber Map Number
+ * @param blockNumber Central block number of the query
+ * @param minBlockX min block x of the view range
+ * @param maxBlockX max block x of the view range
+ * @param minBlockY min block y of the view range
+ * @param maxBlockY max block y of the view range
+ * @param windowBlocks Block numbers the response covers, negative for positions outside of the map
+ * @param response Serialized response
+ */
+void HashResponseCache::store(uint8_t command, uint8_t hashMode, uint8_t mapNumber, uint32_t blockNumber, int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY, const std::vector<int32_t>& windowBlocks, const std::vector<uint8_t>& response)
+{
+  CachedResponse* pCached = getCachedResponse(command, hashMode);
+
+  if (pCached != NULL)
+  {
+    pCached->mapNumber = mapNumber;
+    pCached->blockNumber = blockNumber;
+    pCached->minBlockX = minBlockX;
+    pCached->maxBlockX = maxBlockX;
+    pCached->minBlockY = minBlockY;
+    pCached->maxBlockY = maxBlockY;
+
+    pCached->windowBlocks.clear();
+    for (size_t i = 0; i < windowBlocks.size(); i++)
+    {
+      if (windowBlocks[i] >= 0)
+      {
+        pCached->windowBlocks.push_back(static_cast<uint32_t>(windowBlocks[i]));
+      }
+    }
+    std::sort(pCached->windowBlocks.begin(), pCached->windowBlocks.end());
+
+    pCached->responseGeneration = pCached->windowGeneration;
+    pCached->response = response;
+  }
+}
+
+/**
+ * @brief Bumps the window generation of every cached response whose window contains a block
+ *
+ * @param blockNumber Block Number
+ */
+void HashResponseCache::invalidateBlock(uint32_t blockNumber)
+{
+  for (size_t i = 0; i < NUMBER_OF_SLOTS; i++)
+  {
+    if (std::binary_search(m_responses[i].windowBlocks.begin(), m_responses[i].windowBlocks.end(), blockNumber))
+    {
+      m_responses[i].windowGeneration++;
+    }
+  }
+}
+
+/**
+ * @brief Drops every cached response, used when the map data is reloaded
+ */
+void HashResponseCache::clear()
+{
+  for (size_t i = 0; i < NUMBER_OF_SLOTS; i++)
+  {
+    m_responses[i].response.clear();
+    m_responses[i].windowBlocks.clear();
+  }
+}
+
+/**
+ * @brief Gets the cached response slot for a command
+ *
+ * @param command UltimaLive command of the response
+ * @param hashMode Hash mode of the response, only used by the hash mode query
+ *
+ * @return Pointer to the slot, NULL for commands that are not cached
+ */
+HashResponseCache::CachedResponse* HashResponseCache::getCachedResponse(uint8_t command, uint8_t hashMode)
+{
+  CachedResponse* pCached = NULL;
+
+  if (command == 0xFF)
+  {
+    pCached = &m_responses[0];
+  }
+  else if (command == 0xFD)
+  {
+    pCached = &m_responses[1];
+  }
+  else if (command == 0xF9 && hashMode < NUMBER_OF_HASH_MODES)
+  {
+    pCached = &m_responses[2 + hashMode];
+  }
+
+  return pCached;
+}
@@ -0,0 +1,79 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _HASH_RESPONSE_CACHE_H
+#define _HASH_RESPONSE_CACHE_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @class HashResponseCache
+ *
+ * @brief Keeps the last serialized hash query (0xFF), hash query32 (0xFD) and, per hash mode, hash mode query (0xF9)
+ * response together with the map,
+ * central block and view range it answered. Every cached response has a window generation that is bumped when a
+ * block inside its window changes, so a repeated query from a player that has not moved is answered with a copy of
+ * the cached bytes as long as the generation it was built at is current.
+ *
+ * The cache is only used from the network thread.
+ */
+class HashResponseCache
+{
+  public:
+    HashResponseCache();
+
+    static const uint8_t NUMBER_OF_HASH_MODES = 5; //!< Hash modes of the hash mode query with a slot of their own
+
+    bool lookup(uint8_t command, uint8_t hashMode, uint8_t mapNumber, uint32_t blockNumber, int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY, std::vector<uint8_t>& rResponseOut);
+    void store(uint8_t command, uint8_t hashMode, uint8_t mapNumber, uint32_t blockNumber, int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY, const std::vector<int32_t>& windowBlocks, const std::vector<uint8_t>& response);
+    void invalidateBlock(uint32_t blockNumber);
+    void clear();
+
+  private:
+    /**
+     * @brief A cached response and the query it answered
+     */
+    struct CachedResponse
+    {
+      uint8_t mapNumber;                 //!< Map number of the query
+      uint32_t blockNumber;              //!< Central block number of the query
+      int32_t minBlockX;                 //!< View range the response was built for
+      int32_t maxBlockX;                 //!< View range the response was built for
+      int32_t minBlockY;                 //!< View range the response was built for
+      int32_t maxBlockY;                 //!< View range the response was built for
+      std::vector<uint32_t> windowBlocks; //!< Sorted block numbers of the window
+      uint32_t windowGeneration;         //!< Bumped whenever a block of the window changes
+      uint32_t responseGeneration;       //!< Window generation the response was built at
+      std::vector<uint8_t> response;     //!< Serialized response, empty if there is none
+    };
+
+    CachedResponse* getCachedResponse(uint8_t command, uint8_t hashMode);
+
+    static const uint8_t NUMBER_OF_SLOTS = 2 + NUMBER_OF_HASH_MODES; //!< Hash query, hash query32 and one slot per hash mode
+
+    CachedResponse m_responses[NUMBER_OF_SLOTS]; //!< Last response per command and hash mode
+};
+
+#endif
@@ -0,0 +1,64 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "UltimaLiveExpectedHashQueryHandler.h"
+#include "..\NetworkManager.h"
+
+ /**
+ * @brief UltimaLiveExpectedHashQueryHandler constructor
+ */
+UltimaLiveExpectedHashQueryHandler::UltimaLiveExpectedHashQueryHandler(NetworkManager* pManager)
+  : BasePacketHandler(pManager)
+{
+  //do nothing
+}
+
+/**
+ * @brief Fires onExpectedHashQueryRequest event with the hash mode from byte 15 and the expected hashes that follow
+ *        the number of hashes. The hashes are passed on still serialized, their size depends on the hash mode.
+ *
+ * @param pPacketData Pointer to packet data
+ *
+ * @return False (Does not pass this packet on to the client)
+ */
+bool UltimaLiveExpectedHashQueryHandler::handlePacket(uint8_t* pPacketData)
+{
+  uint16_t packetSize = ntohs(*reinterpret_cast<uint16_t*>(&pPacketData[1]));
+  uint32_t blockNum = ntohl(*reinterpret_cast<uint32_t*>(&pPacketData[3]));
+  uint8_t mapNum = pPacketData[14];
+  uint8_t hashMode = 0;
+  uint16_t numberOfHashes = 0;
+  uint16_t dataLength = 0;
+
+  if (packetSize >= 18)
+  {
+    hashMode = pPacketData[15];
+    numberOfHashes = ntohs(*reinterpret_cast<uint16_t*>(&pPacketData[16]));
+    dataLength = packetSize - 18;
+  }
+
+  m_pManager->onExpectedHashQueryRequest(blockNum, mapNum, hashMode, &pPacketData[18], numberOfHashes, dataLength);
+
+  return false;
+}
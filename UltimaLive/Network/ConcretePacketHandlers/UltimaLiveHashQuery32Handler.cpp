@@ -36,7 +36,8 @@ UltimaLiveHashQuery32Handler::UltimaLiveHashQuery32Handler(NetworkManager* pMana
 }
 
 /**
- * @brief Fires onBlockQueryRequest event
+ * @brief Fires onBlockQueryRequest event. Queries longer than 15 bytes carry a query mode in byte 15 and the
+ *        sequence number of the last incremental response the server applied in bytes 11 and 12.
  *
  * @param pPacketData Pointer to packet data
  *
@@ -44,9 +45,19 @@ UltimaLiveHashQuery32Handler::UltimaLiveHashQuery32Handler(NetworkManager* pMana
  */
 bool UltimaLiveHashQuery32Handler::handlePacket(uint8_t* pPacketData)
 {
+  uint16_t packetSize = ntohs(*reinterpret_cast<uint16_t*>(&pPacketData[1]));
   uint32_t blockNum = ntohl(*reinterpret_cast<uint32_t*>(&pPacketData[3]));
   uint8_t mapNum = pPacketData[14];
-  m_pManager->onBlockQuery32Request(blockNum, mapNum);
+  bool incremental = false;
+  uint16_t acknowledgedSequence = 0;
+
+  if (packetSize >= 16)
+  {
+    incremental = pPacketData[15] == 0x01;
+    acknowledgedSequence = ntohs(*reinterpret_cast<uint16_t*>(&pPacketData[11]));
+  }
+
+  m_pManager->onBlockQuery32Request(blockNum, mapNum, incremental, acknowledgedSequence);
 
   return false;
 }
@@ -0,0 +1,65 @@
+/* @file
+ *
+ * Copyright(c) 2016 UltimaLive
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "UltimaLiveRegionHashQueryHandler.h"
+#include "..\NetworkManager.h"
+
+ /**
+ * @brief UltimaLiveRegionHashQueryHandler constructor
+ */
+UltimaLiveRegionHashQueryHandler::UltimaLiveRegionHashQueryHandler(NetworkManager* pManager)
+  : BasePacketHandler(pManager)
+{
+  //do nothing
+}
+
+/**
+ * @brief Fires onRegionHashQueryRequest event
+ *
+ * @param pPacketData Pointer to packet data
+ *
+ * @return False (Does not pass this packet on to the client)
+ */
+bool UltimaLiveRegionHashQueryHandler::handlePacket(uint8_t* pPacketData)
+{
+  uint16_t packetSize = ntohs(*reinterpret_cast<uint16_t*>(&pPacketData[1]));
+  uint32_t blockNum = ntohl(*reinterpret_cast<uint32_t*>(&pPacketData[3]));
+  uint8_t mapNum = pPacketData[14];
+  uint16_t numberOfNodes = 0;
+
+  if (packetSize >= 17)
+  {
+    numberOfNodes = ntohs(*reinterpret_cast<uint16_t*>(&pPacketData[15]));
+
+    //never read past the end of the packet
+    if (numberOfNodes > (packetSize - 17) / 5)
+    {
+      numberOfNodes = static_cast<uint16_t>((packetSize - 17) / 5);
+    }
+  }
+
+  m_pManager->onRegionHashQueryRequest(blockNum, mapNum, &pPacketData[17], numberOfNodes);
+
+  return false;
+}
@@ -134,7 +134,11 @@ NetworkManager::NetworkManager()
   m_onBlocksViewRangeSubscriber(),
   m_onBlockQueryRequestSubscriber(),
   m_onBlockQuery32RequestSubscriber(),
+  m_onRegionHashQueryRequestSubscriber(),
   m_onUltimaLiveLoginCompleteSubscriber(),
+  m_onHashCapabilitiesRequestSubscriber(),
+  m_onHashModeQueryRequestSubscriber(),
+  m_onExpectedHashQueryRequestSubscriber(),
   m_onServerMobileUpdateSubscribers(),
   m_onLoginConfirmSubscribers(),
   m_onLoginCompleteSubscribers(),
@@ -389,11 +393,21 @@ void NetworkManager::subscribeToBlockQueryRequest(std::function<void(int32_t, ui
  *
  * @param pCallback Packet handler function
  */
-void NetworkManager::subscribeToBlockQuery32Request(std::function<void(int32_t, uint8_t)> pCallback)
+void NetworkManager::subscribeToBlockQuery32Request(std::function<void(int32_t, uint8_t, bool, uint16_t)> pCallback)
 {
     m_onBlockQuery32RequestSubscriber.push_back(pCallback);
 }
 
+/**
+ * @brief Subscribes to the UltimaLive region hash query request packet
+ *
+ * @param pCallback Packet handler function
+ */
+void NetworkManager::subscribeToRegionHashQueryRequest(std::function<void(uint32_t, uint8_t, uint8_t*, uint16_t)> pCallback)
+{
+  m_onRegionHashQueryRequestSubscriber.push_back(pCallback);
+}
+
 /**
  * @brief Subscribes to the UltimaLive login complete packet
  *
@@ -404,6 +418,36 @@ void NetworkManager::subscribeToUltimaLiveLoginComplete(std::function<void(std::
   m_onUltimaLiveLoginCompleteSubscriber.push_back(pCallback);
 }
 
+/**
+ * @brief Subscribes to the UltimaLive hash capabilities request packet
+ *
+ * @param pCallback Packet handler function
+ */
+void NetworkManager::subscribeToHashCapabilitiesRequest(std::function<void()> pCallback)
+{
+  m_onHashCapabilitiesRequestSubscriber.push_back(pCallback);
+}
+
+/**
+ * @brief Subscribes to the UltimaLive hash mode query request packet
+ *
+ * @param pCallback Packet handler function
+ */
+void NetworkManager::subscribeToHashModeQueryRequest(std::function<void(uint32_t, uint8_t, uint8_t)> pCallback)
+{
+  m_onHashModeQueryRequestSubscriber.push_back(pCallback);
+}
+
+/**
+ * @brief Subscribes to the UltimaLive expected hash query request packet
+ *
+ * @param pCallback Packet handler function
+ */
+void NetworkManager::subscribeToExpectedHashQueryRequest(std::function<void(uint32_t, uint8_t, uint8_t, uint8_t*, uint16_t, uint16_t)> pCallback)
+{
+  m_onExpectedHashQueryRequestSubscriber.push_back(pCallback);
+}
+
 /**
  * @brief Subscribes to the Update Mobile packet
  *
@@ -554,15 +598,33 @@ void NetworkManager::onBlockQueryRequest(int32_t blockNumber, uint8_t mapNumber)
  *
  * @param blockNumber Block Number
  * @param mapNumber Map Number
+ * @param incremental True if the server asked for an incremental response
+ * @param acknowledgedSequence Sequence number of the last incremental response the server applied, 0 for none
  */
-void NetworkManager::onBlockQuery32Request(int32_t blockNumber, uint8_t mapNumber)
+void NetworkManager::onBlockQuery32Request(int32_t blockNumber, uint8_t mapNumber, bool incremental, uint16_t acknowledgedSequence)
 {
-    for (std::vector<std::function<void(uint32_t, uint8_t)>>::iterator itr = m_onBlockQuery32RequestSubscriber.begin(); itr != m_onBlockQuery32RequestSubscriber.end(); itr++)
+    for (std::vector<std::function<void(uint32_t, uint8_t, bool, uint16_t)>>::iterator itr = m_onBlockQuery32RequestSubscriber.begin(); itr != m_onBlockQuery32RequestSubscriber.end(); itr++)
     {
-        (*itr)(blockNumber, mapNumber);
+        (*itr)(blockNumber, mapNumber, incremental, acknowledgedSequence);
     }
 }
 
+/**
+ * @brief Fires the region hash query request event
+ *
+ * @param blockNumber Block the player is standing in
+ * @param mapNumber Map Number
+ * @param pNodeData Pointer to the requested nodes, 5 bytes each (level, node x, node y)
+ * @param numberOfNodes Number of requested nodes
+ */
+void NetworkManager::onRegionHashQueryRequest(uint32_t blockNumber, uint8_t mapNumber, uint8_t* pNodeData, uint16_t numberOfNodes)
+{
+  for (std::vector<std::function<void(uint32_t, uint8_t, uint8_t*, uint16_t)>>::iterator itr = m_onRegionHashQueryRequestSubscriber.begin(); itr != m_onRegionHashQueryRequestSubscriber.end(); itr++)
+  {
+    (*itr)(blockNumber, mapNumber, pNodeData, numberOfNodes);
+  }
+}
+
 /**
 * @brief Fires the Ultaima Live Login Complete event
 *
@@ -576,6 +638,50 @@ void NetworkManager::onUltimaLiveLoginComplete(std::string shardIdentifier)
   }
 }
 
+/**
+ * @brief Fires the hash capabilities request event
+ */
+void NetworkManager::onHashCapabilitiesRequest()
+{
+  for (std::vector<std::function<void()>>::iterator itr = m_onHashCapabilitiesRequestSubscriber.begin(); itr != m_onHashCapabilitiesRequestSubscriber.end(); itr++)
+  {
+    (*itr)();
+  }
+}
+
+/**
+ * @brief Fires the hash mode query request event
+ *
+ * @param blockNumber Block the player is standing in
+ * @param mapNumber Map Number
+ * @param hashMode Hash mode the server picked from the client's hash capabilities
+ */
+void NetworkManager::onHashModeQueryRequest(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode)
+{
+  for (std::vector<std::function<void(uint32_t, uint8_t, uint8_t)>>::iterator itr = m_onHashModeQueryRequestSubscriber.begin(); itr != m_onHashModeQueryRequestSubscriber.end(); itr++)
+  {
+    (*itr)(blockNumber, mapNumber, hashMode);
+  }
+}
+
+/**
+ * @brief Fires the expected hash query request event
+ *
+ * @param blockNumber Block the player is standing in
+ * @param mapNumber Map Number
+ * @param hashMode Hash mode of the expected hashes
+ * @param pExpectedHashes Pointer to the server's hashes of the view range, big endian
+ * @param numberOfHashes Number of expected hashes the server sent
+ * @param dataLength Number of bytes following the header, never read past
+ */
+void NetworkManager::onExpectedHashQueryRequest(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode, uint8_t* pExpectedHashes, uint16_t numberOfHashes, uint16_t dataLength)
+{
+  for (std::vector<std::function<void(uint32_t, uint8_t, uint8_t, uint8_t*, uint16_t, uint16_t)>>::iterator itr = m_onExpectedHashQueryRequestSubscriber.begin(); itr != m_onExpectedHashQueryRequestSubscriber.end(); itr++)
+  {
+    (*itr)(blockNumber, mapNumber, hashMode, pExpectedHashes, numberOfHashes, dataLength);
+  }
+}
+
 /**
 * @brief Fires the Server Mobile Update event
 */
@@ -87,8 +87,12 @@ class NetworkManager
     void onRefreshClient();
     void onBlocksViewRange(int32_t minBlockX, int32_t maxBlockX, int32_t minBlockY, int32_t maxBlockY);
     void onBlockQueryRequest(int32_t blockNumber, uint8_t mapNumber);
-    void onBlockQuery32Request(int32_t blockNumber, uint8_t mapNumber);
+    void onBlockQuery32Request(int32_t blockNumber, uint8_t mapNumber, bool incremental, uint16_t acknowledgedSequence);
+    void onRegionHashQueryRequest(uint32_t blockNumber, uint8_t mapNumber, uint8_t* pNodeData, uint16_t numberOfNodes);
     void onUltimaLiveLoginComplete(std::string shardIdentifier);
+    void onHashCapabilitiesRequest();
+    void onHashModeQueryRequest(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode);
+    void onExpectedHashQueryRequest(uint32_t blockNumber, uint8_t mapNumber, uint8_t hashMode, uint8_t* pExpectedHashes, uint16_t numberOfHashes, uint16_t dataLength);
 
     void onServerMobileUpdate();
     void onLoginConfirm(uint8_t* pData);
@@ -103,8 +107,12 @@ class NetworkManager
     void subscribeToRefreshClient(std::function<void()> pCallback);
     void subscribeToBlocksViewRange(std::function<void(int32_t, int32_t, int32_t, int32_t)> pCallback);
     void subscribeToBlockQueryRequest(std::function<void(int32_t, uint8_t)> pCallback);
-    void subscribeToBlockQuery32Request(std::function<void(int32_t, uint8_t)> pCallback);
+    void subscribeToBlockQuery32Request(std::function<void(int32_t, uint8_t, bool, uint16_t)> pCallback);
+    void subscribeToRegionHashQueryRequest(std::function<void(uint32_t, uint8_t, uint8_t*, uint16_t)> pCallback);
     void subscribeToUltimaLiveLoginComplete(std::function<void(std::string)> pCallback);
+    void subscribeToHashCapabilitiesRequest(std::function<void()> pCallback);
+    void subscribeToHashModeQueryRequest(std::function<void(uint32_t, uint8_t, uint8_t)> pCallback);
+    void subscribeToExpectedHashQueryRequest(std::function<void(uint32_t, uint8_t, uint8_t, uint8_t*, uint16_t, uint16_t)> pCallback);
 
     void subscribeToServerMobileUpdate(std::function<void()> pCallback);
     void subscribeToLoginConfirm(std::function<void(uint8_t*)> pCallback);
@@ -126,8 +134,12 @@ class NetworkManager
     std::vector<std::function<void()>> m_onRefreshClientViewSubscriber;                                  //!< RefreshClientView event subscriber list
     std::vector<std::function<void(int32_t, int32_t, int32_t, int32_t)>> m_onBlocksViewRangeSubscriber;				 //!< BlocksViewRange event subscriber list
     std::vector<std::function<void(uint32_t, uint8_t)>> m_onBlockQueryRequestSubscriber;				 //!< BlockQueryRequest event subscriber list
-    std::vector<std::function<void(uint32_t, uint8_t)>> m_onBlockQuery32RequestSubscriber;				 //!< BlockQuery32Request event subscriber list
+    std::vector<std::function<void(uint32_t, uint8_t, bool, uint16_t)>> m_onBlockQuery32RequestSubscriber;				 //!< BlockQuery32Request event subscriber list
+    std::vector<std::function<void(uint32_t, uint8_t, uint8_t*, uint16_t)>> m_onRegionHashQueryRequestSubscriber; //!< RegionHashQueryRequest event subscriber list
     std::vector<std::function<void(std::string)>> m_onUltimaLiveLoginCompleteSubscriber;				 //!< UltimaLive LoginComplete event subscriber list
+    std::vector<std::function<void()>> m_onHashCapabilitiesRequestSubscriber;                          //!< HashCapabilitiesRequest event subscriber list
+    std::vector<std::function<void(uint32_t, uint8_t, uint8_t)>> m_onHashModeQueryRequestSubscriber;   //!< HashModeQueryRequest event subscriber list
+    std::vector<std::function<void(uint32_t, uint8_t, uint8_t, uint8_t*, uint16_t, uint16_t)>> m_onExpectedHashQueryRequestSubscriber; //!< ExpectedHashQueryRequest event subscriber list
 
     //regular game logic
     std::vector<std::function<void()>> m_onServerMobileUpdateSubscribers;      //!< MobileUpdate event subscriber list
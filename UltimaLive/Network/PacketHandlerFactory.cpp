@@ -33,6 +33,10 @@
 #include "ConcretePacketHandlers\UltimaLiveUpdateStaticsHandler.h"
 #include "ConcretePacketHandlers\UltimaLiveHashQueryHandler.h"
 #include "ConcretePacketHandlers\UltimaLiveHashQuery32Handler.h"
+#include "ConcretePacketHandlers\UltimaLiveRegionHashQueryHandler.h"
+#include "ConcretePacketHandlers\UltimaLiveHashModeQueryHandler.h"
+#include "ConcretePacketHandlers\UltimaLiveExpectedHashQueryHandler.h"
+#include "ConcretePacketHandlers\UltimaLiveHashCapabilitiesHandler.h"
 #include "ConcretePacketHandlers\UltimaLiveUpdateLandBlockHandler.h"
 #include "ConcretePacketHandlers\UltimaLiveLoginCompleteHandler.h"
 #include "ConcretePacketHandlers\ServerMobileStatusHandler.h"
@@ -77,6 +81,10 @@ std::map<uint8_t, BasePacketHandler*> PacketHandlerFactory::GenerateUltimaLiveSe
   handlers[0x02] = new UltimaLiveLoginCompleteHandler(pManager);
   handlers[0x03] = new UltimaLiveRefreshClientViewHandler(pManager);
   handlers[0x04] = new UltimaLiveBlocksViewRangeHandler(pManager);
+  handlers[0xF8] = new UltimaLiveExpectedHashQueryHandler(pManager);
+  handlers[0xF9] = new UltimaLiveHashModeQueryHandler(pManager);
+  handlers[0xFA] = new UltimaLiveHashCapabilitiesHandler(pManager);
+  handlers[0xFC] = new UltimaLiveRegionHashQueryHandler(pManager);
   handlers[0xFD] = new UltimaLiveHashQuery32Handler(pManager);
   handlers[0xFF] = new UltimaLiveHashQueryHandler(pManager);
 
@@ -245,4 +245,20 @@ std::string Utils::getFilenameFromPath(std::string path)
   }
 
   return filenameToReturn;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Reads an integer setting from UltimaLive.ini in the client folder. Settings that are missing, or a missing
+ * settings file, yield the default value.
+ *
+ * @param section Section name
+ * @param key Setting name
+ * @param defaultValue Value to use when the setting is not present
+ *
+ * @return Setting value
+ */
+int Utils::GetSettingInt(std::string section, std::string key, int defaultValue)
+{
+  std::string settingsPath = GetCurrentPathWithoutFilename() + "\\UltimaLive.ini";
+  return (int)GetPrivateProfileIntA(section.c_str(), key.c_str(), defaultValue, settingsPath.c_str());
+}
@@ -62,6 +62,8 @@ class Utils
     static int getModuleMinorVersionUpper();
 
     static std::wstring s2ws(const std::string& s);
+
+    static int GetSettingInt(std::string section, std::string key, int defaultValue);
 };
 
 #endif
\ No newline at end of file